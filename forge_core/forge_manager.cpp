@@ -4,6 +4,10 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include "forge_manager.h"
+#include "../native/forge_archive.h"
+#include "../native/forge_cache.h"
+#include "../native/forge_scan.h"
+#include "../native/forge_hash_kernels.h"
 #include <iostream>
 #include <thread>
 #include <atomic>
@@ -45,6 +49,12 @@ FORGE_EXPORT bool forge_init() {
     }
     g_initialized.store(true);
     std::cout << "[Forge] Initializing backend..." << std::endl;
+
+    // Pick the fastest hash kernels for this CPU once, up front
+    HashKernels::Init();
+    const HashKernels& kernels = HashKernels::Active();
+    std::cout << "[Forge] Hash kernels: SHA-1=" << kernels.sha1_name
+              << ", CRC32=" << kernels.crc32_name << std::endl;
     return true;
 }
 
@@ -53,6 +63,7 @@ FORGE_EXPORT void forge_shutdown() {
         return;
     }
     std::cout << "[Forge] Shutting down..." << std::endl;
+    FingerprintCache::Shared().Save();
     
     std::lock_guard<std::mutex> lock(g_missions_mutex);
     for (auto& [id, thread] : g_missions) {
@@ -67,40 +78,118 @@ FORGE_EXPORT void forge_shutdown() {
 #include <filesystem>
 namespace fs = std::filesystem;
 
+// Serial walk behind both forge_scan_folder entry points
+static int ScanFolder(const char* folder_path, bool recursive, const LibraryScanner::WalkFn& on_found) {
+    std::string error;
+    int found_count = LibraryScanner::Walk(folder_path, recursive, on_found, &error);
+    if (!error.empty()) std::cerr << "[Forge] Scan error: " << error << std::endl;
+    return found_count;
+}
+
 FORGE_EXPORT int forge_scan_folder(const char* folder_path, bool recursive, ForgeGameFoundCallback callback) {
     if (!g_initialized || !folder_path || !callback) return 0;
-
-    int found_count = 0;
-    try {
-        if (recursive) {
-            for (const auto& entry : fs::recursive_directory_iterator(folder_path)) {
-                if (entry.is_regular_file()) {
-                    GameIdentity identity;
-                    if (identify_from_file(entry.path().string().c_str(), &identity)) {
-                        callback(entry.path().string().c_str(), &identity);
-                        found_count++;
-                    }
-                }
-            }
+    return ScanFolder(folder_path, recursive, [&](const fs::path&, const std::string& path, const GameIdentity& identity) {
+        // The member separator is a NUL, which would cut the C string short
+        std::string archive, member;
+        if (SplitArchiveMemberPath(path, &archive, &member)) {
+            std::string joined = (fs::path(archive) / member).string();
+            callback(joined.c_str(), &identity);
         } else {
-            for (const auto& entry : fs::directory_iterator(folder_path)) {
-                if (entry.is_regular_file()) {
-                    GameIdentity identity;
-                    if (identify_from_file(entry.path().string().c_str(), &identity)) {
-                        callback(entry.path().string().c_str(), &identity);
-                        found_count++;
-                    }
-                }
-            }
+            callback(path.c_str(), &identity);
         }
-    } catch (const std::exception& e) {
-        std::cerr << "[Forge] Scan error: " << e.what() << std::endl;
+        return true;
+    });
+}
+
+// Fills the caller's record array and string table, handing them over
+// whenever either is full. Directory strings are stored once per batch.
+class ScanBatchWriter {
+public:
+    ScanBatchWriter(ForgeScanRecord* records, uint32_t capacity, char* strings, uint32_t strings_size,
+                    ForgeScanBatchCallback callback, void* user_data)
+        : records(records), capacity(capacity), strings(strings), strings_size(strings_size),
+          callback(callback), user_data(user_data) {}
+
+    // member is the entry name for a game inside an archive, else empty
+    bool Add(const std::string& directory, const std::string& name, const std::string& member,
+             const GameIdentity& identity) {
+        if (count == capacity || used + Needed(directory, name, member) > strings_size) {
+            if (!Flush()) return false;
+        }
+        // A path longer than the whole table cannot be delivered
+        if (Needed(directory, name, member) > strings_size) return true;
+
+        ForgeScanRecord& record = records[count++];
+        record.identity = identity;
+        auto it = directories.find(directory);
+        if (it == directories.end()) it = directories.emplace(directory, Append(directory)).first;
+        record.directory_offset = it->second;
+        record.name_offset = Append(name);
+        record.member_offset = member.empty() ? FORGE_SCAN_NO_MEMBER : Append(member);
+        record.reserved = 0;
+        return true;
     }
 
-    return found_count;
+    bool Flush() {
+        if (count == 0) return true;
+        bool keep_going = callback(count, used, user_data);
+        count = 0;
+        used = 0;
+        directories.clear();
+        return keep_going;
+    }
+
+private:
+    size_t Needed(const std::string& directory, const std::string& name, const std::string& member) const {
+        size_t needed = name.size() + 1 + (member.empty() ? 0 : member.size() + 1);
+        if (!directories.count(directory)) needed += directory.size() + 1;
+        return needed;
+    }
+
+    uint32_t Append(const std::string& s) {
+        uint32_t offset = used;
+        memcpy(strings + used, s.c_str(), s.size() + 1);
+        used += (uint32_t)s.size() + 1;
+        return offset;
+    }
+
+    ForgeScanRecord* records;
+    uint32_t capacity;
+    char* strings;
+    uint32_t strings_size;
+    ForgeScanBatchCallback callback;
+    void* user_data;
+    uint32_t count = 0;
+    uint32_t used = 0;
+    std::map<std::string, uint32_t> directories;
+};
+
+FORGE_EXPORT int forge_scan_folder_batched(const char* folder_path, bool recursive,
+                                           ForgeScanRecord* records, uint32_t record_capacity,
+                                           char* strings, uint32_t strings_size,
+                                           ForgeScanBatchCallback callback, void* user_data) {
+    if (!g_initialized || !folder_path || !records || record_capacity == 0 || !strings ||
+        strings_size == 0 || !callback) {
+        return -1;
+    }
+
+    ScanBatchWriter writer(records, record_capacity, strings, strings_size, callback, user_data);
+    bool stopped = false;
+    int found = ScanFolder(folder_path, recursive, [&](const fs::path& entry, const std::string& path, const GameIdentity& identity) {
+        std::string member;
+        SplitArchiveMemberPath(path, nullptr, &member);
+        stopped = !writer.Add(entry.parent_path().string(), entry.filename().string(), member, identity);
+        return !stopped;
+    });
+    if (!stopped) writer.Flush();
+    return found;
 }
 
 #include "../native/forge_logic.h"
+#include "../native/forge_hash.h"
+#include "../native/forge_dat.h"
+#include "../native/forge_quick.h"
+#include "../native/forge_wii.h"
 #include <windows.h>
 #include <winhttp.h>
 #pragma comment(lib, "winhttp.lib")
@@ -430,7 +519,104 @@ FORGE_EXPORT bool forge_format_drive_32kb(const char* drive_path, const char* la
 }
 
 FORGE_EXPORT bool forge_verify_redump_hash(const char* file_path, const char* expected_hash) {
-    return true;
+    if (expected_hash && expected_hash[0]) return forge_verify_hash(file_path, expected_hash);
+    if (!file_path || !fs::exists(file_path)) return false;
+    return IntegrityAuditor::VerifyRedumpHash(file_path, "");
+}
+
+FORGE_EXPORT bool forge_quick_verify(const char* file_path, uint32_t sample_clusters, ForgeQuickVerifyResult* result) {
+    if (result) memset(result, 0, sizeof(ForgeQuickVerifyResult));
+    if (!file_path) return false;
+
+    QuickVerifyResult quick = QuickVerifier::Verify(file_path, sample_clusters ? sample_clusters : QuickVerifier::DEFAULT_SAMPLES);
+    if (result) {
+        result->confidence = quick.confidence;
+        result->checks = quick.checks;
+        result->checks_passed = quick.checks_passed;
+        result->clusters_sampled = quick.clusters_sampled;
+        result->hash_tree_checked = quick.hash_tree_checked;
+        result->suspicious = quick.Suspicious();
+        strncpy(result->first_failure, quick.first_failure.c_str(), sizeof(result->first_failure) - 1);
+    }
+    return !quick.Suspicious();
+}
+
+FORGE_EXPORT bool forge_set_wii_common_key(uint32_t index, const uint8_t* key) {
+    return WiiHashTreeVerifier::SetCommonKey(index, key);
+}
+
+FORGE_EXPORT bool forge_verify_wii_hash_tree(const char* file_path, ForgeWiiVerifyResult* result,
+                                             uint8_t* damage_map, size_t damage_map_size,
+                                             ForgeProgressCallback callback) {
+    if (result) memset(result, 0, sizeof(ForgeWiiVerifyResult));
+    if (!file_path) return false;
+
+    float last_reported = -1.0f;
+    auto progress = [&](uint64_t done, uint64_t total) {
+        if (!callback) return;
+        float fraction = total ? (float)((double)done / (double)total) : 1.0f;
+        if (fraction - last_reported < 0.01f && done != total) return;
+        last_reported = fraction;
+        callback(FORGE_STATUS_FORGING, fraction, "Checking Wii hash tree...");
+    };
+
+    WiiVerifyReport report = WiiHashTreeVerifier::Verify(file_path, 0, progress);
+
+    if (result) {
+        result->partition_count = (uint32_t)report.partitions.size();
+        for (const auto& part : report.partitions) {
+            if (part.header_ok) result->partitions_verified++;
+            if (part.h3_ok) result->partitions_h3_ok++;
+        }
+        result->cluster_count = report.ClusterCount();
+        result->damaged_clusters = report.DamagedClusters();
+    }
+    if (damage_map) {
+        size_t written = 0;
+        for (const auto& part : report.partitions) {
+            size_t count = (std::min)(part.damage.size(), damage_map_size - written);
+            memcpy(damage_map + written, part.damage.data(), count);
+            written += count;
+        }
+    }
+
+    bool intact = report.Intact();
+    if (callback) {
+        if (!report.ok) callback(FORGE_STATUS_ERROR, 0.0f, report.error.c_str());
+        else callback(FORGE_STATUS_READY, 1.0f, intact ? "Hash tree intact" : "Damaged clusters found");
+    }
+    return intact;
+}
+
+FORGE_EXPORT bool forge_dat_import(const char** dat_paths, size_t dat_count, const char* index_path) {
+    if (!dat_paths || dat_count == 0 || !index_path) return false;
+
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < dat_count; i++) {
+        if (dat_paths[i]) paths.emplace_back(dat_paths[i]);
+    }
+
+    DatIndex::Shared().Unload();
+    DatIndex::ImportStats stats;
+    if (!DatIndex::Build(paths, index_path, &stats)) {
+        std::cerr << "[Forge] DAT import failed" << std::endl;
+        // The previous index is untouched on disk; keep verifying against it
+        DatIndex::Shared().Load(index_path);
+        return false;
+    }
+    std::cout << "[Forge] Imported " << stats.roms << " ROM hashes from " << stats.dat_files
+              << " DAT file(s)" << std::endl;
+    return DatIndex::Shared().Load(index_path);
+}
+
+FORGE_EXPORT bool forge_cache_open(const char* cache_path) {
+    if (!cache_path) return false;
+    return FingerprintCache::Shared().Open(cache_path);
+}
+
+FORGE_EXPORT bool forge_dat_load(const char* index_path) {
+    if (!index_path) return false;
+    return DatIndex::Shared().Load(index_path);
 }
 
 FORGE_EXPORT bool forge_deploy_structure(const char* drive_path) {
@@ -504,21 +690,16 @@ FORGE_EXPORT bool forge_split_wbfs_fat32(const char* file_path, ForgeProgressCal
     }
 }
 
-FORGE_EXPORT char* forge_get_file_format(const char* file_path) {
-    if (!file_path || !fs::exists(file_path)) return _strdup("Unknown");
-    
-    std::string path_str(file_path);
-    std::string ext = fs::path(path_str).extension().string();
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::toupper);
-    
-    if (ext == ".ISO") return _strdup("ISO");
-    if (ext == ".WBFS") return _strdup("WBFS");
-    if (ext == ".RVZ") return _strdup("RVZ");
-    if (ext == ".GCM") return _strdup("GCM");
-    if (ext == ".CISO") return _strdup("CISO");
-    if (ext == ".NKIT") return _strdup("NKIT");
-    
-    return _strdup("Unknown");
+// The names are string constants: nothing is allocated and nothing is freed
+FORGE_EXPORT const char* forge_get_file_format(const char* file_path) {
+    if (!file_path || !fs::exists(file_path)) return "Unknown";
+
+    // From the content, not the extension: a renamed or mislabelled image
+    // would otherwise only fail once a conversion is under way
+    GameIdentity identity;
+    FingerprintCache::Shared().Identify(file_path, &identity);
+    if (identity.format == FORMAT_ISO && identity.platform == PLATFORM_GAMECUBE) return "GCM";
+    return disc_format_to_string(identity.format);
 }
 
 
@@ -544,8 +725,45 @@ FORGE_EXPORT bool forge_format_drive(const char* drive_letter, const char* label
 }
 
 FORGE_EXPORT bool forge_verify_hash(const char* file_path, const char* expected_hash) {
-    if (!file_path || !fs::exists(file_path)) return false;
-    // Placeholder: Always return true for now to allow progress
+    if (!file_path || !expected_hash || !fs::exists(file_path)) return false;
+
+    std::string expected(expected_hash);
+    uint32_t kind = HashEngine::KindForHex(expected);
+    if (kind == 0) return false;
+
+    // Only compute the digest the caller can actually compare against
+    HashResult result = FingerprintCache::Shared().Hash(file_path, kind);
+    FingerprintCache::Shared().Save();
+    return HashEngine::Matches(result, expected);
+}
+
+FORGE_EXPORT bool forge_hash_file(const char* file_path, ForgeHashResult* result, ForgeProgressCallback callback) {
+    if (!file_path || !result) return false;
+    memset(result, 0, sizeof(ForgeHashResult));
+
+    float last_reported = -1.0f;
+    auto progress = [&](uint64_t done, uint64_t total) {
+        if (!callback) return;
+        float fraction = total ? (float)((double)done / (double)total) : 1.0f;
+        // Report in 1% steps so the UI thread is not flooded
+        if (fraction - last_reported < 0.01f && done != total) return;
+        last_reported = fraction;
+        callback(FORGE_STATUS_FORGING, fraction, "Hashing (CRC32 + MD5 + SHA-1)...");
+    };
+
+    HashResult hashes = FingerprintCache::Shared().Hash(file_path, HASH_ALL, progress);
+    FingerprintCache::Shared().Save();
+    if (!hashes.ok) {
+        if (callback) callback(FORGE_STATUS_ERROR, 0.0f, "Failed to read file for hashing");
+        return false;
+    }
+
+    strncpy(result->crc32, hashes.Crc32Hex().c_str(), sizeof(result->crc32) - 1);
+    strncpy(result->md5, hashes.Md5Hex().c_str(), sizeof(result->md5) - 1);
+    strncpy(result->sha1, hashes.Sha1Hex().c_str(), sizeof(result->sha1) - 1);
+    result->bytes_hashed = hashes.bytes_hashed;
+
+    if (callback) callback(FORGE_STATUS_READY, 1.0f, "Hashing complete");
     return true;
 }
 
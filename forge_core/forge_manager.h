@@ -42,13 +42,56 @@ FORGE_EXPORT void forge_shutdown(void);
 /// Callback for when a game is found during folder scan
 typedef void (*ForgeGameFoundCallback)(const char* file_path, const GameIdentity* identity);
 
-/// Scan a folder for games and invoke callback for each found
+/// Scan a folder for games and invoke callback for each found. Games inside
+/// .zip/.7z files are reported once per member; their file_path is the
+/// archive's path, a separator and the entry name (which may itself hold
+/// '/'), so it names no file on disk.
 /// @param folder_path Path to scan
 /// @param recursive Whether to scan subdirectories
 /// @param callback Callback for each game found
 /// @return Number of games found
 FORGE_EXPORT int forge_scan_folder(const char* folder_path, bool recursive, ForgeGameFoundCallback callback);
 
+/// One game in a batched scan. The offsets index the batch's string table
+/// and point at NUL-terminated strings; the full path is directory + separator
+/// + name. Each directory is stored once per batch. For a game inside a
+/// .zip/.7z file, name is the archive and member_offset its entry name;
+/// otherwise member_offset is FORGE_SCAN_NO_MEMBER.
+#define FORGE_SCAN_NO_MEMBER 0xFFFFFFFFu
+
+typedef struct {
+    GameIdentity identity;
+    uint32_t directory_offset;
+    uint32_t name_offset;
+    uint32_t member_offset;
+    uint32_t reserved;
+} ForgeScanRecord;
+
+/// Called whenever the record array or string table is full, and once at the end
+/// @param record_count Records filled in this batch
+/// @param string_bytes Bytes of the string table in use
+/// @param user_data Passed through from forge_scan_folder_batched
+/// @return false to stop the scan
+typedef bool (*ForgeScanBatchCallback)(uint32_t record_count, uint32_t string_bytes, void* user_data);
+
+/// Scan a folder like forge_scan_folder, but deliver games in batches through
+/// caller-owned buffers: one callback per batch instead of one per game, and
+/// nothing is allocated per game on either side. Buffers are reused for every
+/// batch, so copy out what you need before returning from the callback.
+/// @param folder_path Path to scan
+/// @param recursive Whether to scan subdirectories
+/// @param records Record array (a few hundred entries is plenty)
+/// @param record_capacity Length of records
+/// @param strings String table for directory and file names
+/// @param strings_size Size of strings in bytes
+/// @param callback Batch callback
+/// @param user_data Passed to callback
+/// @return Number of games found, -1 on invalid arguments
+FORGE_EXPORT int forge_scan_folder_batched(const char* folder_path, bool recursive,
+                                           ForgeScanRecord* records, uint32_t record_capacity,
+                                           char* strings, uint32_t strings_size,
+                                           ForgeScanBatchCallback callback, void* user_data);
+
 /// Format a drive to FAT32 with 32KB clusters (Wii Compatible)
 /// @param drive_letter Drive letter (e.g. "E:")
 /// @param label Volume label
@@ -56,15 +99,101 @@ FORGE_EXPORT int forge_scan_folder(const char* folder_path, bool recursive, Forg
 /// @return true if successful
 FORGE_EXPORT bool forge_format_drive(const char* drive_letter, const char* label, ForgeProgressCallback callback);
 
-/// Verify file hash against expected value (SHA-1)
+/// Verify file hash against expected value
 /// @param file_path Path to file
-/// @param expected_hash Expected hash string
+/// @param expected_hash Expected hex digest (8 = CRC32, 32 = MD5, 40 = SHA-1)
 /// @return true if match
 FORGE_EXPORT bool forge_verify_hash(const char* file_path, const char* expected_hash);
+
+/// Hex digests produced by forge_hash_file
+typedef struct {
+    char crc32[9];
+    char md5[33];
+    char sha1[41];
+    uint64_t bytes_hashed;
+} ForgeHashResult;
+
+/// Compute CRC32, MD5 and SHA-1 in a single streaming pass (constant memory)
+/// @param file_path Path to file
+/// @param result Output digests
+/// @param callback Progress callback (optional, can be null)
+/// @return true if the whole file was read
+FORGE_EXPORT bool forge_hash_file(const char* file_path, ForgeHashResult* result, ForgeProgressCallback callback);
 FORGE_EXPORT uint64_t forge_start_mission(const char* url, const char* dest_path, ForgeProgressCallback callback);
 FORGE_EXPORT bool forge_cancel_mission(uint64_t mission_id);
 FORGE_EXPORT bool forge_format_drive_32kb(const char* drive_path, const char* label, ForgeProgressCallback callback);
+
+/// Verify a file against Redump/No-Intro data
+/// @param file_path Path to file
+/// @param expected_hash Expected hex digest, or null/empty to look the file up in the loaded DAT index
+/// @return true if the file matches
 FORGE_EXPORT bool forge_verify_redump_hash(const char* file_path, const char* expected_hash);
+
+/// Summary produced by forge_verify_wii_hash_tree
+typedef struct {
+    uint32_t partition_count;
+    uint32_t partitions_verified;   // Header, TMD and H3 table read and decrypted
+    uint32_t partitions_h3_ok;      // H3 table matches the TMD content hash
+    uint64_t cluster_count;         // 32 KiB clusters across all partitions
+    uint64_t damaged_clusters;
+} ForgeWiiVerifyResult;
+
+/// Result of forge_quick_verify
+typedef struct {
+    float confidence;               // Share of sampled checks that passed (0..1)
+    uint32_t checks;
+    uint32_t checks_passed;
+    uint32_t clusters_sampled;
+    bool hash_tree_checked;         // Wii clusters were checked against H0-H3
+    bool suspicious;                // Worth a full hash
+    char first_failure[128];
+} ForgeQuickVerifyResult;
+
+/// Sampled health check: header, FST, partition boundaries and a
+/// deterministic set of 32 KiB clusters. Meant to pick out the files that
+/// need a full forge_hash_file / forge_verify_wii_hash_tree pass.
+/// @param file_path Path to file
+/// @param sample_clusters Random clusters to sample (0 = default of 16)
+/// @param result Output (optional)
+/// @return true if nothing looked wrong
+FORGE_EXPORT bool forge_quick_verify(const char* file_path, uint32_t sample_clusters, ForgeQuickVerifyResult* result);
+
+/// Provide a Wii common key (not shipped with the app)
+/// @param index Ticket common key index (0 = retail, 1 = Korean, 2 = vWii)
+/// @param key 16-byte key
+/// @return true if the index is valid
+FORGE_EXPORT bool forge_set_wii_common_key(uint32_t index, const uint8_t* key);
+
+/// Verify a raw Wii image against its own H0-H3 hash trees on all cores
+/// @param file_path Path to a .iso
+/// @param result Output summary (optional)
+/// @param damage_map Output: one flag byte per cluster, partitions in table order
+///        (0 = intact, 0x01 H0, 0x02 H1, 0x04 H2, 0x08 H3 mismatch, 0x10 unreadable); optional
+/// @param damage_map_size Capacity of damage_map; clusters beyond it are not written
+/// @param callback Progress callback (optional, can be null)
+/// @return true if every partition's hash tree is intact
+FORGE_EXPORT bool forge_verify_wii_hash_tree(const char* file_path, ForgeWiiVerifyResult* result,
+                                             uint8_t* damage_map, size_t damage_map_size,
+                                             ForgeProgressCallback callback);
+
+/// Build a binary hash index from Redump/No-Intro XML DAT files and load it
+/// @param dat_paths Array of DAT file paths (merged into one index)
+/// @param dat_count Number of paths
+/// @param index_path Output index file
+/// @return true if the index was written and loaded
+FORGE_EXPORT bool forge_dat_import(const char** dat_paths, size_t dat_count, const char* index_path);
+
+/// Memory-map a previously built DAT index (replaces the loaded one)
+/// @param index_path Index file written by forge_dat_import
+/// @return true if the index is valid and loaded
+FORGE_EXPORT bool forge_dat_load(const char* index_path);
+
+/// Open the persistent fingerprint cache. Scans and hash checks skip any
+/// file whose device, file ID, size and mtime match a cached entry.
+/// Without this call results are only cached for the current session.
+/// @param cache_path Cache file (created on first save)
+/// @return true if the cache was loaded or did not exist yet
+FORGE_EXPORT bool forge_cache_open(const char* cache_path);
 FORGE_EXPORT bool forge_deploy_structure(const char* drive_path);
 FORGE_EXPORT char* forge_handshake_resolve(const char* url, int provider_id);
 
@@ -90,10 +219,11 @@ FORGE_EXPORT bool forge_convert_iso_to_wbfs(const char* input_path, const char*
 /// @return true if successful (or splitting not needed)
 FORGE_EXPORT bool forge_split_wbfs_fat32(const char* file_path, ForgeProgressCallback callback);
 
-/// Get file format identity
+/// Get file format identity from the file's content (extensions are ignored)
 /// @param file_path Path to file
-/// @return "ISO", "WBFS", "RVZ", etc. or "Unknown" (Caller must free)
-FORGE_EXPORT char* forge_get_file_format(const char* file_path);
+/// @return "ISO", "GCM", "WBFS", "RVZ", "WIA", "CISO", "GCZ", "NKIT", "CSO",
+///         "CHD", "WUX", etc. or "Unknown" (static string; do not free)
+FORGE_EXPORT const char* forge_get_file_format(const char* file_path);
 
 #ifdef __cplusplus
 }
@@ -2,59 +2,22 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include "platform_identifier.h"
+#include "../native/forge_container.h"
+#include "../native/forge_io.h"
+#include "../native/forge_wiiu.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <utility>
 
-// ============================================================================
-// Magic Byte Definitions
-// ============================================================================
-
-// Wii/GC magic at offset 0x1C
-static const uint8_t WII_MAGIC[] = { 0x5D, 0x1C, 0x9E, 0xA3 };
-static const uint8_t GC_MAGIC[] = { 0xC2, 0x33, 0x9F, 0x3D };
-
-// WBFS container signature
-static const uint8_t WBFS_MAGIC[] = { 'W', 'B', 'F', 'S' };
-
-// RVZ compressed format
-static const uint8_t RVZ_MAGIC[] = { 'R', 'V', 'Z', '\0' };
-
-// Wii U WUD format
-static const uint8_t WUD_MAGIC[] = { 'W', 'U', 'P', '\0' };
-
-// NES iNES format
-static const uint8_t NES_MAGIC[] = { 'N', 'E', 'S', 0x1A };
-
-// Game Boy Nintendo logo (first 8 bytes of 48-byte logo)
-static const uint8_t GB_LOGO[] = { 0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B };
-
-// GBA Nintendo logo (first 8 bytes)
-static const uint8_t GBA_LOGO[] = { 0x24, 0xFF, 0xAE, 0x51, 0x69, 0x9A, 0xA2, 0x21 };
-
-// NDS header identifier
-static const uint8_t NDS_LOGO[] = { 0x24, 0xFF, 0xAE, 0x51 };  // Same as GBA, at 0xC0
-
-// N64 magic (big-endian)
-static const uint8_t N64_MAGIC_Z64[] = { 0x80, 0x37, 0x12, 0x40 };  // .z64
-static const uint8_t N64_MAGIC_N64[] = { 0x40, 0x12, 0x37, 0x80 };  // .n64 (byte-swapped)
-static const uint8_t N64_MAGIC_V64[] = { 0x37, 0x80, 0x40, 0x12 };  // .v64 (word-swapped)
-
-// PlayStation magic
-static const uint8_t PS1_MAGIC[] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
-
-// Sega Genesis magic
-static const uint8_t GENESIS_MAGIC[] = { 'S', 'E', 'G', 'A' };  // At offset 0x100
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 // ============================================================================
 // Helper Functions
 // ============================================================================
 
-static bool check_magic(const uint8_t* header, size_t offset, const uint8_t* magic, size_t magic_len, size_t header_size) {
-    if (offset + magic_len > header_size) return false;
-    return memcmp(header + offset, magic, magic_len) == 0;
-}
-
 static void extract_string(const uint8_t* src, char* dst, size_t len) {
     memcpy(dst, src, len);
     dst[len] = '\0';
@@ -68,181 +31,519 @@ static void extract_string(const uint8_t* src, char* dst, size_t len) {
     }
 }
 
+static uint32_t read_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t read_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
 // ============================================================================
-// Main Identification Logic
+// Title Extraction
 // ============================================================================
+// One per signature. Called only after the magic matched; fills in what the
+// header says about the title and may reject the match (returning false lets
+// lower-priority signatures try). Rejection happens before anything but the
+// platform is written.
 
-bool identify_from_header(const uint8_t* header, size_t header_size, GameIdentity* result) {
-    if (!header || !result || header_size < 64) {
-        return false;
+static bool extract_nothing(const uint8_t*, size_t, GameIdentity*) {
+    return true;
+}
+
+// Wii/GC disc header: ID at 0x00, disc number at 0x06, title at 0x20
+static void extract_disc_header(const uint8_t* disc, GameIdentity* result) {
+    extract_string(disc, result->title_id, 6);
+    extract_string(disc + 0x20, result->game_title, 64);
+    result->region = (char)disc[3];
+    result->disc_number = disc[6];
+}
+
+static constexpr size_t DISC_HEADER_SIZE = 0x60;   // Through the title
+
+static bool extract_wii_gc(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    extract_disc_header(header, result);
+    // NKit images keep the disc header and tag it with their own at 0x200
+    if (header_size >= 0x204 && memcmp(header + 0x200, "NKIT", 4) == 0) result->format = FORMAT_NKIt;
+    return true;
+}
+
+static bool extract_wbfs(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    // WBFS header contains disc header at offset 0x200
+    if (header_size >= 0x200 + DISC_HEADER_SIZE) extract_disc_header(header + 0x200, result);
+    return true;
+}
+
+// CISO: "CISO", block size, then one presence byte per block up to 0x8000,
+// where the stored blocks follow in order. PSP CSO files share the magic
+// but have a 0x18-byte header where the block size would be; forge_container
+// reads those.
+static constexpr size_t CISO_HEADER_SIZE = 0x8000;
+
+static bool extract_ciso(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    uint32_t block_size = read_le32(header + 4);
+    if (block_size < CISO_HEADER_SIZE || (block_size & (block_size - 1)) != 0) return false;
+    // Only identify_from_file's deep read reaches the disc header; block 0
+    // must be stored for it to be there
+    if (header_size < CISO_HEADER_SIZE + DISC_HEADER_SIZE || header[8] != 1) return false;
+
+    const uint8_t* disc = header + CISO_HEADER_SIZE;
+    if (read_be32(disc + 0x18) == 0x5D1C9EA3) result->platform = PLATFORM_WII;
+    else if (read_be32(disc + 0x1C) == 0xC2339F3D) result->platform = PLATFORM_GAMECUBE;
+    else return false;
+    extract_disc_header(disc, result);
+    return true;
+}
+
+// WIA and RVZ (Dolphin): header 1 (0x48 bytes: magic, versions, header 2
+// size, sizes and hashes), then header 2, which starts with the disc type
+// (1 = GameCube, 2 = Wii), compression type, level and chunk size, followed
+// by the first 0x80 bytes of the disc stored uncompressed. Those hold the
+// game ID, disc number, both magic words and the whole 64-byte title, so no
+// group has to be decompressed to identify the disc.
+static constexpr size_t WIA_HEADER_2_OFFSET = 0x48;
+static constexpr size_t WIA_DISC_HEADER_OFFSET = WIA_HEADER_2_OFFSET + 0x10;
+static constexpr size_t WIA_DISC_HEADER_SIZE = 0x80;
+
+static bool extract_wia(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    if (header_size < WIA_DISC_HEADER_OFFSET + WIA_DISC_HEADER_SIZE) return true;
+    // Header 2 too short to hold the disc header copy: not a file we can read
+    if (read_be32(header + 0x0C) < WIA_DISC_HEADER_OFFSET - WIA_HEADER_2_OFFSET + WIA_DISC_HEADER_SIZE) return false;
+
+    // The magic words in the copy are authoritative; the disc type only
+    // covers a copy that lacks them
+    const uint8_t* disc = header + WIA_DISC_HEADER_OFFSET;
+    uint32_t disc_type = read_be32(header + WIA_HEADER_2_OFFSET);
+    if (read_be32(disc + 0x18) == 0x5D1C9EA3) result->platform = PLATFORM_WII;
+    else if (read_be32(disc + 0x1C) == 0xC2339F3D) result->platform = PLATFORM_GAMECUBE;
+    else if (disc_type == 1) result->platform = PLATFORM_GAMECUBE;
+    else if (disc_type == 2) result->platform = PLATFORM_WII;
+    else return false;
+
+    extract_disc_header(disc, result);
+    return true;
+}
+
+// WUD: product code "WUP-P-ARPE" at 0x00; the last letter is the region
+static bool extract_wud(const uint8_t* header, size_t, GameIdentity* result) {
+    if (memcmp(header, "WUP-P-", 6) == 0) {
+        extract_string(header + 6, result->title_id, 4);
+        result->region = (char)header[9];
     }
-    
-    memset(result, 0, sizeof(GameIdentity));
-    
-    // Try WBFS first (container format)
-    if (check_magic(header, 0, WBFS_MAGIC, 4, header_size)) {
-        result->platform = PLATFORM_WII;  // WBFS is always Wii
-        result->format = FORMAT_WBFS;
-        // WBFS header contains disc header at offset 0x200
-        if (header_size >= 0x200 + 64) {
-            extract_string(header + 0x200, result->title_id, 6);
-            extract_string(header + 0x200 + 0x20, result->game_title, 64);
-            result->region = header[0x200 + 3];
-        }
-        return true;
+    return true;
+}
+
+static bool extract_nes(const uint8_t*, size_t, GameIdentity* result) {
+    strcpy(result->game_title, "NES ROM");
+    return true;
+}
+
+static bool extract_n64(const uint8_t* header, size_t, GameIdentity* result) {
+    extract_string(header + 0x20, result->game_title, 20);
+    extract_string(header + 0x3B, result->title_id, 4);
+    return true;
+}
+
+static bool extract_gameboy(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    if (header_size < 0x150) return false;
+    // CGB flag at 0x143
+    if (header[0x143] == 0x80 || header[0x143] == 0xC0) result->platform = PLATFORM_GBC;
+    extract_string(header + 0x134, result->game_title, 16);
+    return true;
+}
+
+static bool extract_gba(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    if (header_size < 0xC0) return false;
+    extract_string(header + 0xA0, result->game_title, 12);
+    extract_string(header + 0xAC, result->title_id, 4);
+    return true;
+}
+
+static bool extract_nds(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    if (header_size < 0x160) return false;
+    // The logo alone is shared with GBA; a sane ROM size confirms it
+    uint32_t rom_size = read_le32(header + 0x80);
+    if (rom_size == 0 || rom_size >= 0x20000000) return false;   // Max 512MB
+    extract_string(header, result->game_title, 12);
+    extract_string(header + 0x0C, result->title_id, 4);
+    return true;
+}
+
+static bool extract_genesis(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    if (header_size < 0x150) return false;
+    extract_string(header + 0x120, result->game_title, 48);
+    return true;
+}
+
+static bool extract_ncch(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    // Product code at 0x150, e.g. "CTR-P-AREE"
+    if (header_size >= 0x160 && memcmp(header + 0x150, "CTR-", 4) == 0) {
+        extract_string(header + 0x156, result->title_id, 4);
+        result->region = (char)header[0x159];
     }
-    
-    // Try RVZ compressed format
-    if (check_magic(header, 0, RVZ_MAGIC, 3, header_size)) {
-        result->format = FORMAT_RVZ;
-        // RVZ contains Wii/GC disc - would need to decompress header to get title
-        // For now, mark as Wii (most common)
-        result->platform = PLATFORM_WII;
-        return true;
+    return true;
+}
+
+// IP.BIN: device info "xxxx GD-ROM1/1" at 0x20, software name at 0x80
+static bool extract_dreamcast_ip(const uint8_t* ip, size_t available, GameIdentity* result) {
+    if (available < 0x100) return false;
+    if (memcmp(ip + 0x25, "GD-ROM", 6) == 0 && ip[0x2B] >= '1' && ip[0x2B] <= '9') {
+        result->disc_number = (uint8_t)(ip[0x2B] - '1');
     }
-    
-    // Try Wii U WUD/WUX
-    if (check_magic(header, 0, WUD_MAGIC, 3, header_size)) {
-        result->platform = PLATFORM_WII_U;
-        result->format = FORMAT_WUD;
+    extract_string(ip + 0x80, result->game_title, 128);
+    return true;
+}
+
+static bool extract_dreamcast(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    return extract_dreamcast_ip(header, header_size, result);
+}
+
+// Raw 2352-byte sectors: 16 bytes of sync and sector header come first
+static bool extract_dreamcast_raw(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    return extract_dreamcast_ip(header + 0x10, header_size - 0x10, result);
+}
+
+// ISO 9660 primary volume descriptor (sector 16). Both PlayStations put
+// "PLAYSTATION" in the system identifier; only PS2 DVDs exceed a CD. PSP
+// UMDs say "PSP GAME" and may be larger than a CD too.
+static bool extract_playstation_pvd(const uint8_t* pvd, GameIdentity* result) {
+    if (pvd[0] != 1 || memcmp(pvd + 1, "CD001", 5) != 0) return false;
+    uint64_t volume_bytes = (uint64_t)read_le32(pvd + 80) * 2048;
+    if (result->platform == PLATFORM_PS1 && volume_bytes > 900ull * 1024 * 1024) result->platform = PLATFORM_PS2;
+    extract_string(pvd + 40, result->game_title, 32);
+    return true;
+}
+
+static bool extract_playstation(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    if (header_size < 0x8000 + 0x58) return false;
+    return extract_playstation_pvd(header + 0x8000, result);
+}
+
+// Raw images: sector 16 starts at 16 * 2352; its mode 2 user data (where the
+// descriptor lives) follows 24 bytes of sync, header and subheader
+static bool extract_playstation_raw(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    if (header_size < 0x9318 + 0x58) return false;
+    if (memcmp(header + 0x9320, "PLAYSTATION", 11) != 0) return false;
+    return extract_playstation_pvd(header + 0x9318, result);
+}
+
+// SNES has no magic: find an internal header whose checksum and complement
+// agree, at the LoROM or HiROM location, with or without a copier header
+static bool extract_snes(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    static const struct { size_t base; uint8_t hirom; } layouts[] = {
+        { 0x7FC0, 0 }, { 0xFFC0, 1 }, { 0x7FC0 + 0x200, 0 }, { 0xFFC0 + 0x200, 1 },
+    };
+    for (const auto& layout : layouts) {
+        size_t base = layout.base;
+        if (base + 0x40 > header_size) continue;
+        const uint8_t* h = header + base;
+        uint16_t complement = (uint16_t)(h[0x1C] | (h[0x1D] << 8));
+        uint16_t checksum = (uint16_t)(h[0x1E] | (h[0x1F] << 8));
+        uint8_t map_mode = h[0x15];
+        if ((uint16_t)(checksum ^ complement) != 0xFFFF) continue;
+        if ((map_mode & 0xE0) != 0x20) continue;
+        // HiROM sets bit 0 of the map mode; it must match where we found it
+        if ((map_mode & 1) != layout.hirom) continue;
+        bool printable = true;
+        for (size_t i = 0; i < 21 && printable; i++) printable = h[i] >= 0x20 && h[i] != 0x7F;
+        if (!printable) continue;
+
+        extract_string(h, result->game_title, 21);
+        uint8_t country = h[0x19];
+        result->region = country == 0x00 ? 'J' : country == 0x01 ? 'E' : 'P';
         return true;
     }
-    
-    // Try Wii/GC ISO (check magic at offset 0x1C)
-    if (header_size >= 0x20) {
-        if (check_magic(header, 0x1C, WII_MAGIC, 4, header_size)) {
-            result->platform = PLATFORM_WII;
-            result->format = FORMAT_ISO;
-            extract_string(header, result->title_id, 6);
-            extract_string(header + 0x20, result->game_title, 64);
-            result->region = header[3];
-            result->disc_number = header[6];
-            return true;
+    return false;
+}
+
+// ============================================================================
+// Signature Table
+// ============================================================================
+// In priority order: when several magics match, the first whose extractor
+// accepts wins. Offsets and magics are compiled into the matcher below; a
+// new entry at a known offset costs one register compare, not a new load.
+
+typedef bool (*ExtractFn)(const uint8_t* header, size_t header_size, GameIdentity* result);
+
+static constexpr size_t SIGNATURE_MAX_LENGTH = 16;
+
+struct Signature {
+    uint32_t offset;
+    uint8_t length;     // 0: no magic; the extractor decides alone once the header reaches offset
+    uint8_t magic[SIGNATURE_MAX_LENGTH];
+    Platform platform;
+    DiscFormat format;
+    ExtractFn extract;
+};
+
+template <size_t N>
+static constexpr Signature Magic(uint32_t offset, const char (&magic)[N], Platform platform, DiscFormat format,
+                                 ExtractFn extract) {
+    static_assert(N - 1 <= SIGNATURE_MAX_LENGTH, "magic longer than one compare");
+    Signature signature{ offset, (uint8_t)(N - 1), {}, platform, format, extract };
+    for (size_t i = 0; i + 1 < N; i++) signature.magic[i] = (uint8_t)magic[i];
+    return signature;
+}
+
+static constexpr Signature SIGNATURES[] = {
+    // Containers first: their payload may carry any of the magics below
+    Magic(0x000, "WBFS", PLATFORM_WII, FORMAT_WBFS, extract_wbfs),
+    Magic(0x000, "RVZ\x01", PLATFORM_WII, FORMAT_RVZ, extract_wia),
+    Magic(0x000, "WIA\x01", PLATFORM_WII, FORMAT_WIA, extract_wia),
+    Magic(0x000, "CISO", PLATFORM_WII, FORMAT_CISO, extract_ciso),
+    Magic(0x000, "WUP", PLATFORM_WII_U, FORMAT_WUD, extract_wud),
+    Magic(0x000, "3DSX", PLATFORM_3DS, FORMAT_3DSX, extract_nothing),
+    // CIA: header size 0x2020, type 0, version 0
+    Magic(0x000, "\x20\x20\x00\x00\x00\x00\x00\x00", PLATFORM_3DS, FORMAT_CIA, extract_nothing),
+
+    Magic(0x018, "\x5D\x1C\x9E\xA3", PLATFORM_WII, FORMAT_ISO, extract_wii_gc),
+    Magic(0x01C, "\xC2\x33\x9F\x3D", PLATFORM_GAMECUBE, FORMAT_ISO, extract_wii_gc),
+
+    Magic(0x000, "NES\x1A", PLATFORM_NES, FORMAT_UNKNOWN, extract_nes),
+    Magic(0x000, "\x80\x37\x12\x40", PLATFORM_N64, FORMAT_UNKNOWN, extract_n64),   // .z64
+    Magic(0x000, "\x40\x12\x37\x80", PLATFORM_N64, FORMAT_UNKNOWN, extract_n64),   // .n64 (byte-swapped)
+    Magic(0x000, "\x37\x80\x40\x12", PLATFORM_N64, FORMAT_UNKNOWN, extract_n64),   // .v64 (word-swapped)
+    // Nintendo logos (first 8 bytes); NDS repeats the GBA logo at 0xC0
+    Magic(0x104, "\xCE\xED\x66\x66\xCC\x0D\x00\x0B", PLATFORM_GAMEBOY, FORMAT_UNKNOWN, extract_gameboy),
+    Magic(0x004, "\x24\xFF\xAE\x51\x69\x9A\xA2\x21", PLATFORM_GBA, FORMAT_UNKNOWN, extract_gba),
+    Magic(0x0C0, "\x24\xFF\xAE\x51", PLATFORM_NDS, FORMAT_UNKNOWN, extract_nds),
+    Magic(0x100, "NCSD", PLATFORM_3DS, FORMAT_UNKNOWN, extract_nothing),
+    Magic(0x100, "NCCH", PLATFORM_3DS, FORMAT_UNKNOWN, extract_ncch),
+    Magic(0x100, "SEGA", PLATFORM_GENESIS, FORMAT_UNKNOWN, extract_genesis),
+    Magic(0x000, "SEGA SEGAKATANA ", PLATFORM_DREAMCAST, FORMAT_ISO, extract_dreamcast),
+    Magic(0x010, "SEGA SEGAKATANA ", PLATFORM_DREAMCAST, FORMAT_ISO, extract_dreamcast_raw),
+
+    // Past the first sector: only identify_from_file's deep read reaches these
+    Magic(0x8008, "PLAYSTATION", PLATFORM_PS1, FORMAT_ISO, extract_playstation),
+    Magic(0x8008, "PSP GAME", PLATFORM_PSP, FORMAT_ISO, extract_playstation),
+    // Raw CD sector sync pattern
+    Magic(0x000, "\x00\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x00", PLATFORM_PS1, FORMAT_ISO,
+          extract_playstation_raw),
+    Magic(0x7FC0, "", PLATFORM_SNES, FORMAT_UNKNOWN, extract_snes),
+};
+
+static constexpr size_t SIGNATURE_COUNT = sizeof(SIGNATURES) / sizeof(SIGNATURES[0]);
+static_assert(SIGNATURE_COUNT <= 64, "candidate set is a 64-bit mask");
+
+// ============================================================================
+// Matcher
+// ============================================================================
+// Built at compile time from SIGNATURES. A group of magics at the same
+// offset is skipped unless the byte there starts one of them (a few byte
+// compares); otherwise the group shares one load of the 16-byte window and
+// each magic is one or two masked 64-bit compares whose constants the
+// compiler folds into the instructions.
+// The probes are unrolled per group by templates, so the matcher is
+// straight-line code generated from the table.
+
+struct Probe {
+    uint64_t mask[2];               // Window words, as loaded
+    uint64_t value[2];
+    uint8_t length;
+    uint8_t signature;              // SIGNATURES index
+};
+
+struct ProbeGroup {
+    uint32_t offset;
+    uint8_t first;                  // Into Matcher::probes
+    uint8_t count;
+    bool wide;                      // Some magic spans the second word
+};
+
+struct Matcher {
+    Probe probes[SIGNATURE_COUNT];
+    ProbeGroup groups[SIGNATURE_COUNT];
+    size_t group_count;
+    uint64_t always;                // Signatures with no magic
+};
+
+static constexpr uint64_t LittleEndianWord(const uint8_t* bytes, size_t count) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < count && i < 8; i++) word |= (uint64_t)bytes[i] << (8 * i);
+    return word;
+}
+
+static constexpr Matcher BuildMatcher() {
+    Matcher matcher{};
+    size_t probe_count = 0;
+    bool have_last = false;
+    uint32_t last = 0;
+    for (;;) {
+        // Next larger offset; groups come out in ascending order
+        bool found = false;
+        uint32_t offset = 0;
+        for (const Signature& s : SIGNATURES) {
+            if (s.length == 0 || (have_last && s.offset <= last)) continue;
+            if (!found || s.offset < offset) offset = s.offset;
+            found = true;
         }
-        if (check_magic(header, 0x1C, GC_MAGIC, 4, header_size)) {
-            result->platform = PLATFORM_GAMECUBE;
-            result->format = FORMAT_ISO;
-            extract_string(header, result->title_id, 6);
-            extract_string(header + 0x20, result->game_title, 64);
-            result->region = header[3];
-            result->disc_number = header[6];
-            return true;
+        if (!found) break;
+        have_last = true;
+        last = offset;
+
+        ProbeGroup& group = matcher.groups[matcher.group_count++];
+        group.offset = offset;
+        group.first = (uint8_t)probe_count;
+        for (size_t i = 0; i < SIGNATURE_COUNT; i++) {
+            const Signature& s = SIGNATURES[i];
+            if (s.length == 0 || s.offset != offset) continue;
+            Probe& probe = matcher.probes[probe_count++];
+            const uint8_t ones[SIGNATURE_MAX_LENGTH] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                                         0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+            probe.mask[0] = LittleEndianWord(ones, s.length);
+            probe.value[0] = LittleEndianWord(s.magic, s.length);
+            if (s.length > 8) {
+                probe.mask[1] = LittleEndianWord(ones, s.length - 8);
+                probe.value[1] = LittleEndianWord(s.magic + 8, s.length - 8);
+                group.wide = true;
+            }
+            probe.length = s.length;
+            probe.signature = (uint8_t)i;
+            group.count++;
         }
     }
-    
-    // Try NES
-    if (check_magic(header, 0, NES_MAGIC, 4, header_size)) {
-        result->platform = PLATFORM_NES;
-        result->format = FORMAT_UNKNOWN;
-        strcpy(result->game_title, "NES ROM");
-        return true;
-    }
-    
-    // Try N64
-    if (check_magic(header, 0, N64_MAGIC_Z64, 4, header_size) ||
-        check_magic(header, 0, N64_MAGIC_N64, 4, header_size) ||
-        check_magic(header, 0, N64_MAGIC_V64, 4, header_size)) {
-        result->platform = PLATFORM_N64;
-        result->format = FORMAT_UNKNOWN;
-        extract_string(header + 0x20, result->game_title, 20);
-        extract_string(header + 0x3B, result->title_id, 4);
-        return true;
+    for (size_t i = 0; i < SIGNATURE_COUNT; i++) {
+        if (SIGNATURES[i].length == 0) matcher.always |= 1ull << i;
     }
-    
-    // Try Game Boy (check Nintendo logo at 0x104)
-    if (header_size >= 0x150) {
-        if (check_magic(header, 0x104, GB_LOGO, 8, header_size)) {
-            // Check if GBC (0x143 flag)
-            if (header[0x143] == 0x80 || header[0x143] == 0xC0) {
-                result->platform = PLATFORM_GBC;
-            } else {
-                result->platform = PLATFORM_GAMEBOY;
-            }
-            result->format = FORMAT_UNKNOWN;
-            extract_string(header + 0x134, result->game_title, 16);
-            return true;
-        }
+    return matcher;
+}
+
+static constexpr Matcher MATCHER = BuildMatcher();
+
+static uint64_t LoadWord(const uint8_t* bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+template <size_t P>
+static uint64_t MatchProbe(uint64_t low, uint64_t high, size_t available) {
+    constexpr Probe probe = MATCHER.probes[P];
+    bool match = (low & probe.mask[0]) == probe.value[0];
+    if (probe.length > 8) match = match && (high & probe.mask[1]) == probe.value[1];
+    // A magic running past a short header cannot be present
+    return (uint64_t)(match && probe.length <= available) << probe.signature;
+}
+
+template <size_t G, size_t... I>
+static uint64_t MatchGroupProbes(uint64_t low, uint64_t high, size_t available, std::index_sequence<I...>) {
+    return (0 | ... | MatchProbe<MATCHER.groups[G].first + I>(low, high, available));
+}
+
+template <size_t G, size_t... I>
+static bool StartsGroupProbe(uint8_t first, std::index_sequence<I...>) {
+    return (false || ... || (first == (uint8_t)MATCHER.probes[MATCHER.groups[G].first + I].value[0]));
+}
+
+template <size_t G>
+static uint64_t MatchGroup(const uint8_t* header, size_t header_size) {
+    constexpr uint32_t offset = MATCHER.groups[G].offset;
+    constexpr size_t count = MATCHER.groups[G].count;
+    if (offset >= header_size) return 0;
+    const uint8_t* window = header + offset;
+    // Most headers start no magic here: a few byte compares rule the group
+    // out before any load of the window
+    if (!StartsGroupProbe<G>(window[0], std::make_index_sequence<count>())) return 0;
+
+    size_t available = header_size - offset;
+    if (available >= 16) {
+        uint64_t low = LoadWord(window);
+        uint64_t high = MATCHER.groups[G].wide ? LoadWord(window + 8) : 0;
+        return MatchGroupProbes<G>(low, high, 16, std::make_index_sequence<count>());
     }
-    
-    // Try GBA (Nintendo logo at 0x04)
-    if (header_size >= 0xC0) {
-        if (check_magic(header, 0x04, GBA_LOGO, 8, header_size)) {
-            result->platform = PLATFORM_GBA;
-            result->format = FORMAT_UNKNOWN;
-            extract_string(header + 0xA0, result->game_title, 12);
-            extract_string(header + 0xAC, result->title_id, 4);
-            return true;
-        }
+
+    // Only the tail of a short header needs a copy
+    uint8_t padded[16] = {};
+    memcpy(padded, window, available);
+    return MatchGroupProbes<G>(LoadWord(padded), LoadWord(padded + 8), available, std::make_index_sequence<count>());
+}
+
+template <size_t... G>
+static uint64_t MatchGroups(const uint8_t* header, size_t header_size, std::index_sequence<G...>) {
+    return (0 | ... | MatchGroup<G>(header, header_size));
+}
+
+static unsigned LowestBit(uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctzll(bits);
+#endif
+}
+
+// Bit i set: SIGNATURES[i] is a candidate (its magic is present, or it has
+// none and the header reaches its offset)
+static uint64_t MatchSignatures(const uint8_t* header, size_t header_size) {
+    uint64_t candidates = MatchGroups(header, header_size, std::make_index_sequence<MATCHER.group_count>());
+    for (uint64_t always = MATCHER.always; always != 0; always &= always - 1) {
+        unsigned i = LowestBit(always);
+        if (SIGNATURES[i].offset < header_size) candidates |= 1ull << i;
     }
-    
-    // Try NDS
-    if (header_size >= 0x160) {
-        // NDS has game title at 0x00 and game code at 0x0C
-        // Check for valid NDS header by looking at ROM size field
-        uint32_t rom_size = *(uint32_t*)(header + 0x80);
-        if (rom_size > 0 && rom_size < 0x20000000) {  // Max 512MB
-            // Additional validation: check for Nintendo logo at 0xC0
-            if (check_magic(header, 0xC0, NDS_LOGO, 4, header_size)) {
-                result->platform = PLATFORM_NDS;
-                result->format = FORMAT_UNKNOWN;
-                extract_string(header, result->game_title, 12);
-                extract_string(header + 0x0C, result->title_id, 4);
-                return true;
-            }
-        }
+    return candidates;
+}
+
+// ============================================================================
+// Main Identification Logic
+// ============================================================================
+
+bool identify_from_header(const uint8_t* header, size_t header_size, GameIdentity* result) {
+    if (!header || !result || header_size < 64) {
+        return false;
     }
-    
-    // Try Sega Genesis (SEGA at 0x100)
-    if (header_size >= 0x110) {
-        if (check_magic(header, 0x100, GENESIS_MAGIC, 4, header_size)) {
-            result->platform = PLATFORM_GENESIS;
-            result->format = FORMAT_UNKNOWN;
-            extract_string(header + 0x120, result->game_title, 48);
-            return true;
-        }
+
+    memset(result, 0, sizeof(GameIdentity));
+
+    // Lowest index first: the table is in priority order
+    for (uint64_t candidates = MatchSignatures(header, header_size); candidates != 0; candidates &= candidates - 1) {
+        const Signature& signature = SIGNATURES[LowestBit(candidates)];
+        result->platform = signature.platform;
+        result->format = signature.format;
+        if (signature.extract(header, header_size, result)) return true;
     }
-    
+    result->platform = PLATFORM_UNKNOWN;
+    result->format = FORMAT_UNKNOWN;
     return false;
 }
 
 bool identify_from_file(const char* file_path, GameIdentity* result) {
-    FILE* f = fopen(file_path, "rb");
-    if (!f) return false;
-    
-    uint8_t header[512];
-    size_t bytes_read = fread(header, 1, sizeof(header), f);
-    
-    // Get file size
-    fseek(f, 0, SEEK_END);
-    result->file_size = ftell(f);
-    fclose(f);
-    
-    return identify_from_header(header, bytes_read, result);
+    // 64-bit size: ftell's long stops at 2 GB on Windows, where most disc
+    // images are larger
+    RandomAccessFile file;
+    if (!file.Open(file_path)) return false;
+    uint64_t file_size = file.Size();
+
+    uint8_t header[IDENTIFY_HEADER_SIZE];
+    size_t bytes_read = 0;
+    file.ReadAt(0, header, sizeof(header), &bytes_read);
+
+    // identify_from_header clears result, so the size goes in afterwards
+    DiscFormat container = DetectContainer(header, bytes_read);
+    bool identified = container != FORMAT_UNKNOWN ? IdentifyContainer(file_path, container, result)
+                                                  : identify_from_header(header, bytes_read, result);
+    if (!identified && container == FORMAT_UNKNOWN && file_size >= IDENTIFY_DEEP_MIN_FILE_SIZE) {
+        size_t deep_size = file_size < IDENTIFY_DEEP_HEADER_SIZE ? (size_t)file_size : IDENTIFY_DEEP_HEADER_SIZE;
+        uint8_t* deep = (uint8_t*)malloc(deep_size);
+        size_t deep_read = 0;
+        if (deep && file.ReadAt(0, deep, deep_size, &deep_read)) {
+            identified = identify_from_header(deep, deep_read, result);
+        }
+        free(deep);
+    }
+
+    result->file_size = file_size;
+    return identified;
 }
 
 bool identify_wiiu_folder(const char* folder_path, GameIdentity* result) {
-    // Check for Wii U folder structure: code/, content/, meta/
-    char path_buf[512];
-    
-    snprintf(path_buf, sizeof(path_buf), "%s/code", folder_path);
-    FILE* f = fopen(path_buf, "rb");
-    if (!f) {
-        // Try backslash for Windows
-        snprintf(path_buf, sizeof(path_buf), "%s\\code", folder_path);
-        f = fopen(path_buf, "rb");
-    }
-    
-    // For folder check, we just verify the directory exists
-    // This is a simplified check - real implementation would use stat()
-    if (f) {
-        fclose(f);
-        result->platform = PLATFORM_WII_U;
-        result->format = FORMAT_FOLDER;
-        strcpy(result->game_title, "Wii U Game");
-        return true;
-    }
-    
-    return false;
+    WiiUTitleInfo info;
+    if (!folder_path || !ReadWiiUTitle(folder_path, &info)) return false;
+    WiiUTitleToIdentity(info, result);
+    return true;
 }
 
 const char* platform_to_string(Platform platform) {
@@ -267,6 +568,26 @@ const char* platform_to_string(Platform platform) {
     }
 }
 
+const char* disc_format_to_string(DiscFormat format) {
+    switch (format) {
+        case FORMAT_ISO: return "ISO";
+        case FORMAT_WBFS: return "WBFS";
+        case FORMAT_RVZ: return "RVZ";
+        case FORMAT_WUD: return "WUD";
+        case FORMAT_WUX: return "WUX";
+        case FORMAT_NKIt: return "NKIT";
+        case FORMAT_CIA: return "CIA";
+        case FORMAT_3DSX: return "3DSX";
+        case FORMAT_CSO: return "CSO";
+        case FORMAT_CHD: return "CHD";
+        case FORMAT_FOLDER: return "Folder";
+        case FORMAT_WIA: return "WIA";
+        case FORMAT_CISO: return "CISO";
+        case FORMAT_GCZ: return "GCZ";
+        default: return "Unknown";
+    }
+}
+
 bool get_organized_path(const GameIdentity* identity, const char* drive_root, char* output_path) {
     if (!identity || !drive_root || !output_path) return false;
     
@@ -6,6 +6,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,6 +47,9 @@ typedef enum {
     FORMAT_CSO = 9,
     FORMAT_CHD = 10,
     FORMAT_FOLDER = 11,  // Wii U extracted folder structure
+    FORMAT_WIA = 12,
+    FORMAT_CISO = 13,    // Wii/GameCube compact ISO (USB loaders); FORMAT_CSO is the PSP one
+    FORMAT_GCZ = 14,
 } DiscFormat;
 
 /// Game identification result
@@ -61,33 +65,40 @@ typedef struct {
     bool requires_cios;        // Wii games that need cIOS
 } GameIdentity;
 
-/// Magic byte signatures for platform detection
-typedef struct {
-    const uint8_t* signature;
-    size_t signature_length;
-    size_t offset;
-    Platform platform;
-    DiscFormat format;
-} MagicSignature;
+/// identify_from_header finds every first-sector signature in this many
+/// bytes. The 0x60 bytes past the sector hold the disc header of a WBFS file
+/// and the "NKIT" tag of an NKit image.
+#define IDENTIFY_HEADER_SIZE 0x260
+
+/// SNES internal headers (0x7FC0/0xFFC0, plus a 0x200 copier header) and the
+/// PlayStation volume descriptor (0x8000, 0x9318 in raw images) lie further
+/// in; identify_from_file reads this far when the first sector matched nothing
+#define IDENTIFY_DEEP_HEADER_SIZE 0x10200
+#define IDENTIFY_DEEP_MIN_FILE_SIZE 0x8000
 
 // ============================================================================
 // Platform Identification API
 // ============================================================================
 
 /// Identify a game from raw header bytes
-/// @param header First 512 bytes of the file
+/// @param header First IDENTIFY_HEADER_SIZE bytes of the file (or up to
+///               IDENTIFY_DEEP_HEADER_SIZE for SNES and PlayStation)
 /// @param header_size Size of header buffer
 /// @param result Output: filled GameIdentity struct
 /// @return true if platform was identified
 bool identify_from_header(const uint8_t* header, size_t header_size, GameIdentity* result);
 
-/// Identify a game from file path (reads header automatically)
+/// Identify a game from file path (reads header automatically). GCZ, CSO,
+/// WUX and CHD files are opened as containers: the disc inside is
+/// identified and format names the container.
 /// @param file_path Path to game file
-/// @param result Output: filled GameIdentity struct
+/// @param result Output: filled GameIdentity struct; format is set for a
+///               recognised container even when the disc inside is not
 /// @return true if platform was identified
 bool identify_from_file(const char* file_path, GameIdentity* result);
 
-/// Identify Wii U from folder structure (code/content/meta)
+/// Identify a Wii U title folder (code/, content/, meta/meta.xml). Title ID,
+/// region and name come from meta.xml; file_size is the total of content/.
 /// @param folder_path Path to potential Wii U folder
 /// @param result Output: filled GameIdentity struct
 /// @return true if valid Wii U structure detected
@@ -98,6 +109,11 @@ bool identify_wiiu_folder(const char* folder_path, GameIdentity* result);
 /// @return Static string like "Nintendo Wii"
 const char* platform_to_string(Platform platform);
 
+/// Get short format name
+/// @param format DiscFormat enum value
+/// @return Static string like "WBFS", or "Unknown"
+const char* disc_format_to_string(DiscFormat format);
+
 /// Get recommended output path for game organization
 /// @param identity Identified game
 /// @param drive_root Root of target drive (e.g., "E:\\")
@@ -106,26 +122,37 @@ const char* platform_to_string(Platform platform);
 bool get_organized_path(const GameIdentity* identity, const char* drive_root, char* output_path);
 
 // ============================================================================
-// Magic Byte Constants (Defined in platform_identifier.cpp)
+// Magic Byte Constants (signature table in platform_identifier.cpp)
 // ============================================================================
 
 // Wii/GC: Disc header at offset 0x00
 // - Bytes 0x00-0x03: Game ID (e.g., "RSPE")
-// - Byte 0x18: Magic word 0x5D1C9EA3 (Wii) or 0xC2339F3D (GC)
+// - Byte 0x18: Magic word 0x5D1C9EA3 (Wii); byte 0x1C: 0xC2339F3D (GC)
+// - Byte 0x200: "NKIT" in NKit images
+
+// CISO (Wii/GC): "CISO", block size (LE, >= 0x8000), block presence map;
+// the first stored block (the disc header) starts at 0x8000
 
 // WBFS: Header at offset 0x00
 // - Bytes 0x00-0x03: "WBFS" (0x57424653)
 
-// RVZ: Header at offset 0x00
-// - Bytes 0x00-0x03: "RVZ" followed by version
+// RVZ/WIA: Header at offset 0x00
+// - Bytes 0x00-0x03: "RVZ\x01" or "WIA\x01"
+// - Byte 0x48: Disc type (1 = GC, 2 = Wii); 0x58: uncompressed copy of the
+//   first 0x80 disc header bytes (ID, magic words, title)
 
 // Wii U WUD: First 0x8000 bytes contain header
-// - Magic at 0x00: 0x57555000 ("WUP\0")
+// - Product code at 0x00: "WUP-P-" + 4-character game ID (e.g., "WUP-P-ARPE")
+
+// Containers identified by forge_container (the disc header lies behind an
+// index): GCZ 0xB10BC001 (LE), CSO "CISO" with a 0x18-byte header / ZSO
+// "ZISO", WUX "WUX0" + 0x1099D02E, CHD "MComprHD"
 
 // NES: iNES header
 // - Bytes 0x00-0x03: "NES\x1A"
 
-// SNES: No universal header, use ROM makeup byte at 0x7FD5 or 0xFFD5
+// SNES: No universal header; internal header at 0x7FC0 (LoROM) or 0xFFC0
+// (HiROM) whose checksum (0x1E) and complement (0x1C) XOR to 0xFFFF
 
 // Game Boy/GBC: Nintendo logo at 0x104-0x133
 // - Bytes 0x104-0x133: Fixed Nintendo logo bitmap
@@ -137,6 +164,15 @@ bool get_organized_path(const GameIdentity* identity, const char* drive_root, ch
 // - Bytes 0x00-0x0B: Game title
 // - Bytes 0x0C-0x0F: Game code
 
+// 3DS: "NCSD" (.3ds/.cci) or "NCCH" (.cxi) at 0x100; "3DSX" at 0x00;
+// CIA starts with header size 0x2020
+
+// PS1/PS2: ISO 9660 system identifier "PLAYSTATION" at 0x8008, or the raw
+// sector sync pattern at 0x00 with the descriptor in sector 16
+// PSP: system identifier "PSP GAME" at 0x8008
+
+// Dreamcast: IP.BIN "SEGA SEGAKATANA " at 0x00 (0x10 in raw sectors)
+
 #ifdef __cplusplus
 }
 #endif
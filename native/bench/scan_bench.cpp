@@ -0,0 +1,458 @@
+// Benchmark for the library scanners over a generated library.
+//
+// Usage: forge_scan_bench [files] [directory]   (default 20000, a temp dir)
+// Generates a reproducible library (fixed seed) of sparse Wii/GameCube
+// ISOs, WBFS files, cartridge ROMs, Wii U title folders and non-game files
+// spread over a deep directory tree, then times each scanner on it:
+//
+//   walk              LibraryScanner::Walk, the serial forge_scan_folder path
+//   scan              LibraryScanner::Run full scan (forge_scan_start)
+//   scan incremental  LibraryScanner::Run against the previous scan's snapshot
+//
+// walk and scan run once with an empty fingerprint cache and once with the
+// cache the first run filled. Each run reports files/s, read/write syscalls
+// per file and peak RSS, and must find every generated game. The directory
+// is kept; a later run with the same file count reuses it, so one tree can
+// be scanned by several releases.
+
+#include "forge_cache.h"
+#include "forge_scan.h"
+#include "platform_identifier.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define PSAPI_VERSION 2
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint64_t LIBRARY_SEED = 0x9E3779B97F4A7C15ULL;
+static constexpr size_t FILES_PER_DIRECTORY = 40;
+static constexpr size_t MAX_DEPTH = 8;
+static constexpr size_t WIIU_EVERY = 1000;           // One title folder per this many files
+static constexpr size_t WIIU_CONTENT_FILES = 200;
+static constexpr const char* MANIFEST_NAME = "forge_scan_bench.txt";
+
+static uint64_t Next(uint64_t& x) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+}
+
+// ============================================================================
+// Library generator
+// ============================================================================
+
+struct Kind {
+    const char* name;
+    const char* extension;
+    uint64_t size;                      // Files larger than the header are sparse
+    unsigned weight;
+    bool game;
+    void (*build)(uint8_t* header, uint64_t& rng);
+};
+
+static constexpr size_t HEADER_BYTES = 0x400;
+
+static void Put(uint8_t* h, size_t offset, const void* bytes, size_t length) {
+    memcpy(h + offset, bytes, length);
+}
+
+static void Random(uint8_t* h, uint64_t& rng) {
+    for (size_t i = 0; i < HEADER_BYTES; i++) h[i] = (uint8_t)Next(rng);
+}
+
+static void DiscHeader(uint8_t* h, const char* id, bool wii) {
+    memset(h, 0, 0x60);
+    Put(h, 0, id, 6);
+    if (wii) Put(h, 0x18, "\x5D\x1C\x9E\xA3", 4);
+    else Put(h, 0x1C, "\xC2\x33\x9F\x3D", 4);
+    Put(h, 0x20, "Synthetic Game", 14);
+}
+
+static void BuildWii(uint8_t* h, uint64_t&) {
+    memset(h, 0, HEADER_BYTES);
+    DiscHeader(h, "RSPE01", true);
+}
+
+static void BuildGameCube(uint8_t* h, uint64_t&) {
+    memset(h, 0, HEADER_BYTES);
+    DiscHeader(h, "GALE01", false);
+}
+
+static void BuildWbfs(uint8_t* h, uint64_t&) {
+    memset(h, 0, HEADER_BYTES);
+    Put(h, 0, "WBFS", 4);
+    DiscHeader(h + 0x200, "RMCP01", true);
+}
+
+static void BuildNes(uint8_t* h, uint64_t& rng) {
+    Random(h, rng);
+    Put(h, 0, "NES\x1A", 4);
+}
+
+static void BuildN64(uint8_t* h, uint64_t& rng) {
+    Random(h, rng);
+    Put(h, 0, "\x80\x37\x12\x40", 4);
+}
+
+static void BuildGba(uint8_t* h, uint64_t& rng) {
+    Random(h, rng);
+    Put(h, 0, "\0\0\0\0", 4);
+    Put(h, 0x04, "\x24\xFF\xAE\x51\x69\x9A\xA2\x21", 8);
+}
+
+static void BuildNds(uint8_t* h, uint64_t& rng) {
+    Random(h, rng);
+    Put(h, 0, "GAME TITLE\0\0ABCE", 16);
+    Put(h, 0x80, "\x00\x00\x00\x01", 4);
+    Put(h, 0xC0, "\x24\xFF\xAE\x51", 4);
+}
+
+static void BuildGenesis(uint8_t* h, uint64_t& rng) {
+    Random(h, rng);
+    Put(h, 0, "\0\0\0\0", 4);
+    Put(h, 0x100, "SEGA MEGA DRIVE ", 16);
+}
+
+static void BuildText(uint8_t* h, uint64_t& rng) {
+    for (size_t i = 0; i < HEADER_BYTES; i++) h[i] = (uint8_t)('a' + Next(rng) % 26);
+}
+
+static void BuildZeros(uint8_t* h, uint64_t&) {
+    memset(h, 0, HEADER_BYTES);
+}
+
+// Weighted like a real library: mostly covers, saves, manuals and other
+// files that have to be ruled out. The large non-games take the deep read.
+static const Kind KINDS[] = {
+    { "Wii", "iso", 4699979776ULL, 4, true, BuildWii },
+    { "GameCube", "iso", 1459978240ULL, 4, true, BuildGameCube },
+    { "WBFS", "wbfs", 1ULL << 30, 3, true, BuildWbfs },
+    { "NES", "nes", 256 * 1024, 5, true, BuildNes },
+    { "N64", "z64", 8ULL << 20, 3, true, BuildN64 },
+    { "GBA", "gba", 16ULL << 20, 5, true, BuildGba },
+    { "NDS", "nds", 64ULL << 20, 4, true, BuildNds },
+    { "Genesis", "md", 1ULL << 20, 2, true, BuildGenesis },
+    { "text", "txt", HEADER_BYTES, 20, false, BuildText },
+    { "image", "jpg", HEADER_BYTES, 25, false, Random },
+    { "save", "sav", 8 * 1024, 10, false, Random },
+    { "video", "mkv", 256ULL << 20, 5, false, Random },
+    { "blank", "iso", 700ULL << 20, 5, false, BuildZeros },
+};
+
+struct Library {
+    size_t files = 0;          // Wii U title folders count as one file
+    size_t directories = 0;
+    size_t games = 0;
+};
+
+static bool WriteFile(const fs::path& path, const uint8_t* data, size_t length, uint64_t size) {
+    FILE* f = fopen(path.string().c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, length, f) == length;
+    ok = fclose(f) == 0 && ok;
+    std::error_code ec;
+    if (ok && size > length) fs::resize_file(path, size, ec);
+    return ok && !ec;
+}
+
+static bool WriteWiiUTitle(const fs::path& folder, size_t index, uint64_t& rng) {
+    std::error_code ec;
+    fs::create_directories(folder / "code", ec);
+    fs::create_directories(folder / "meta", ec);
+    fs::create_directories(folder / "content" / "Common", ec);
+    if (ec) return false;
+
+    char meta[1024];
+    int length = snprintf(meta, sizeof(meta),
+                          "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                          "<menu type=\"complex\" access=\"777\">\n"
+                          "  <product_code type=\"string\" length=\"32\">WUP-P-A%03zuE</product_code>\n"
+                          "  <company_code type=\"string\" length=\"8\">0001</company_code>\n"
+                          "  <title_id type=\"hexBinary\" length=\"8\">0005000010%06zX</title_id>\n"
+                          "  <longname_en type=\"string\" length=\"512\">Synthetic Title %zu</longname_en>\n"
+                          "</menu>\n",
+                          index % 1000, index, index);
+    if (!WriteFile(folder / "meta" / "meta.xml", (const uint8_t*)meta, (size_t)length, 0)) return false;
+
+    uint8_t block[HEADER_BYTES];
+    Random(block, rng);
+    if (!WriteFile(folder / "code" / "app.xml", block, sizeof(block), 0)) return false;
+    for (size_t i = 0; i < WIIU_CONTENT_FILES; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s%04zu.bin", i % 2 ? "Common/" : "", i);
+        if (!WriteFile(folder / "content" / name, block, 64, 0)) return false;
+    }
+    return true;
+}
+
+static std::string Manifest(size_t files, const Library& library) {
+    char text[128];
+    snprintf(text, sizeof(text), "%zu %zu %zu %zu %llx\n", files, library.files, library.directories,
+             library.games, (unsigned long long)LIBRARY_SEED);
+    return text;
+}
+
+// Reuse the tree a previous run generated with the same parameters
+static bool LoadLibrary(const fs::path& root, size_t files, Library* library) {
+    FILE* f = fopen((root / MANIFEST_NAME).string().c_str(), "rb");
+    if (!f) return false;
+    char text[128] = {};
+    size_t read = fread(text, 1, sizeof(text) - 1, f);
+    fclose(f);
+    unsigned long long seed = 0;
+    size_t requested = 0;
+    if (read == 0 || sscanf(text, "%zu %zu %zu %zu %llx", &requested, &library->files, &library->directories,
+                            &library->games, &seed) != 5) {
+        return false;
+    }
+    return requested == files && seed == LIBRARY_SEED;
+}
+
+static bool GenerateLibrary(const fs::path& root, size_t files, Library* library) {
+    std::error_code ec;
+    // Never delete a directory this benchmark did not create
+    if (fs::exists(root, ec) && !fs::is_empty(root, ec)) {
+        if (!fs::exists(root / MANIFEST_NAME, ec)) {
+            fprintf(stderr, "%s is not empty and was not generated by forge_scan_bench\n", root.string().c_str());
+            return false;
+        }
+        fs::remove_all(root, ec);
+    }
+    fs::create_directories(root, ec);
+    if (ec) return false;
+
+    uint64_t rng = LIBRARY_SEED;
+    unsigned total_weight = 0;
+    for (const Kind& kind : KINDS) total_weight += kind.weight;
+
+    // Random tree: each directory hangs off an earlier one, so depth varies
+    // from flat console folders to long nested chains
+    struct Dir {
+        fs::path path;
+        size_t depth;
+    };
+    std::vector<Dir> dirs = { { root, 0 } };
+    size_t dir_count = (std::max)((size_t)1, files / FILES_PER_DIRECTORY);
+    while (dirs.size() < dir_count) {
+        const Dir& parent = dirs[Next(rng) % dirs.size()];
+        if (parent.depth >= MAX_DEPTH) continue;
+        char name[16];
+        snprintf(name, sizeof(name), "d%05zu", dirs.size());
+        Dir dir = { parent.path / name, parent.depth + 1 };
+        fs::create_directory(dir.path, ec);
+        if (ec) return false;
+        dirs.push_back(std::move(dir));
+    }
+
+    Library local;
+    local.directories = dirs.size();
+    uint8_t header[HEADER_BYTES];
+    for (size_t i = 0; i < files; i++) {
+        const fs::path& dir = dirs[Next(rng) % dirs.size()].path;
+        if (i % WIIU_EVERY == WIIU_EVERY - 1) {
+            char name[32];
+            snprintf(name, sizeof(name), "wiiu%06zu", i);
+            if (!WriteWiiUTitle(dir / name, i, rng)) return false;
+            local.games++;
+            continue;
+        }
+
+        unsigned pick = (unsigned)(Next(rng) % total_weight);
+        const Kind* kind = KINDS;
+        while (pick >= kind->weight) pick -= (kind++)->weight;
+        kind->build(header, rng);
+        char name[48];
+        snprintf(name, sizeof(name), "%s%06zu.%s", kind->name, i, kind->extension);
+        if (!WriteFile(dir / name, header, (size_t)(std::min)((uint64_t)HEADER_BYTES, kind->size), kind->size)) {
+            return false;
+        }
+        if (kind->game) local.games++;
+    }
+    local.files = files;   // A title folder counts as one
+
+    std::string manifest = Manifest(files, local);
+    if (!WriteFile(root / MANIFEST_NAME, (const uint8_t*)manifest.data(), manifest.size(), 0)) return false;
+    *library = local;
+    return true;
+}
+
+// ============================================================================
+// Process counters
+// ============================================================================
+
+// Read and write syscalls made so far. Linux only: /proc/self/io counts the
+// read(2)/pread(2) family, not stat, getdents or io_uring submissions.
+static bool IoSyscalls(uint64_t* count) {
+#ifdef __linux__
+    FILE* f = fopen("/proc/self/io", "r");
+    if (!f) return false;
+    char line[128];
+    uint64_t total = 0;
+    int fields = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long value = 0;
+        if (sscanf(line, "syscr: %llu", &value) == 1 || sscanf(line, "syscw: %llu", &value) == 1) {
+            total += value;
+            fields++;
+        }
+    }
+    fclose(f);
+    *count = total;
+    return fields == 2;
+#else
+    (void)count;
+    return false;
+#endif
+}
+
+// Start a new peak-RSS window where the OS allows it (Linux resets VmHWM);
+// elsewhere the peak covers the whole process so far
+static void ResetPeakRss() {
+#ifdef __linux__
+    if (FILE* f = fopen("/proc/self/clear_refs", "w")) {
+        fputs("5", f);
+        fclose(f);
+    }
+#endif
+}
+
+static uint64_t PeakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.PeakWorkingSetSize;
+    return 0;
+#else
+#ifdef __linux__
+    if (FILE* f = fopen("/proc/self/status", "r")) {
+        char line[128];
+        unsigned long long kb = 0;
+        bool found = false;
+        while (!found && fgets(line, sizeof(line), f)) found = sscanf(line, "VmHWM: %llu kB", &kb) == 1;
+        fclose(f);
+        if (found) return kb * 1024;
+    }
+#endif
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss;
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// ============================================================================
+// Runs
+// ============================================================================
+
+struct RunResult {
+    double seconds = 0;
+    size_t titles = 0;
+    bool have_syscalls = false;
+    uint64_t syscalls = 0;
+    uint64_t peak_rss = 0;
+};
+
+template <typename Fn>
+static RunResult Measure(Fn run) {
+    RunResult result;
+    uint64_t before = 0, after = 0;
+    ResetPeakRss();
+    bool have_before = IoSyscalls(&before);
+    auto start = Clock::now();
+    result.titles = run();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.have_syscalls = have_before && IoSyscalls(&after);
+    result.syscalls = after - before;
+    result.peak_rss = PeakRssBytes();
+    return result;
+}
+
+static bool Report(const char* name, const RunResult& result, const Library& library, size_t expected) {
+    double files_per_second = result.seconds > 0 ? (double)library.files / result.seconds : 0.0;
+    char syscalls[32] = "n/a";
+    if (result.have_syscalls) {
+        snprintf(syscalls, sizeof(syscalls), "%.2f", (double)result.syscalls / (double)library.files);
+    }
+    bool ok = result.titles == expected;
+    printf("%-24s %10.0f %12s %9.1f MiB %8zu%s\n", name, files_per_second, syscalls,
+           (double)result.peak_rss / (1024.0 * 1024.0), result.titles, ok ? "" : "  MISMATCH");
+    return ok;
+}
+
+static size_t RunWalk(const fs::path& root) {
+    std::atomic<size_t> titles{0};
+    LibraryScanner::Walk(root.string(), true, [&](const fs::path&, const std::string&, const GameIdentity&) {
+        titles++;
+        return true;
+    });
+    return titles;
+}
+
+static size_t RunScan(const fs::path& root, bool incremental) {
+    LibraryScanner::Options options;
+    options.incremental = incremental;
+    std::atomic<size_t> titles{0};
+    LibraryScanner::Run({ root.string() }, options,
+                        [&](LibraryScanner::Change change, const std::string&, const GameIdentity*) {
+                            if (change != LibraryScanner::Change::Removed) titles++;
+                        });
+    return titles;
+}
+
+int main(int argc, char** argv) {
+    size_t files = argc > 1 ? (size_t)strtoull(argv[1], nullptr, 10) : 20000;
+    if (files == 0) files = 1;
+    fs::path root = argc > 2 ? fs::path(argv[2]) : fs::temp_directory_path() / "forge_scan_bench";
+
+    Library library;
+    bool reused = LoadLibrary(root, files, &library);
+    if (!reused) {
+        auto start = Clock::now();
+        if (!GenerateLibrary(root, files, &library)) {
+            fprintf(stderr, "Could not generate the library in %s\n", root.string().c_str());
+            return 2;
+        }
+        printf("Generated in %.1f s\n", std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    printf("Library: %s (%s)\n", root.string().c_str(), reused ? "reused" : "new");
+    printf("         %zu files, %zu directories, %zu games, %zu Wii U title folders\n\n", library.files,
+           library.directories, library.games, files / WIIU_EVERY);
+
+    printf("%-24s %10s %12s %13s %8s\n", "", "files/s", "io calls/f", "peak RSS", "titles");
+    bool ok = true;
+    FingerprintCache& cache = FingerprintCache::Shared();
+    ScanSnapshot& snapshot = ScanSnapshot::Shared();
+
+    cache.Clear();
+    ok &= Report("walk, empty cache", Measure([&] { return RunWalk(root); }), library, library.games);
+    ok &= Report("walk, warm cache", Measure([&] { return RunWalk(root); }), library, library.games);
+
+    cache.Clear();
+    snapshot.Clear();
+    ok &= Report("scan, empty cache", Measure([&] { return RunScan(root, false); }), library, library.games);
+    ok &= Report("scan, warm cache", Measure([&] { return RunScan(root, false); }), library, library.games);
+    // Nothing changed since the last scan, so nothing is reported
+    ok &= Report("scan incremental", Measure([&] { return RunScan(root, true); }), library, 0);
+
+    return ok ? 0 : 1;
+}
@@ -24,16 +24,73 @@ FORGE_API void forge_shutdown();
 FORGE_API const char* forge_get_version();
 
 // Scanning - real file system traversal (NO CALLBACK - uses polling)
+// Runs on a background thread pool and queues "scan_started", "title_found",
+// "scan_progress" and "scan_complete" events. With incremental set, the scan
+// is diffed against the snapshot of the previous one: directories whose mtime
+// is unchanged are not listed again, and only "title_added", "title_changed"
+// and "title_removed" are reported. A missing root queues "root_unavailable"
+// and keeps its snapshot. Games inside .zip/.7z files are identified from
+// the first few KB of each member, without extracting; their events carry
+// the archive as "path" and the entry name as "member".
+// Returns 0 if a scan is already running.
 FORGE_API int forge_scan_start(const char** root_paths, size_t path_count, int incremental);
 FORGE_API int forge_scan_cancel();
 
+// Watching - keep roots in sync after the initial scan. Reports changes since
+// the last scan, then "title_added" / "title_changed" / "title_removed" as
+// files finish writing, are renamed or are deleted (inotify on Linux,
+// incremental rescans every poll_interval_ms elsewhere; 0 = 60 s).
+// Starting again replaces the watched roots.
+FORGE_API int forge_watch_start(const char** root_paths, size_t path_count, uint32_t poll_interval_ms);
+FORGE_API int forge_watch_stop();
+
 // Event polling - retrieve queued events
 FORGE_API const char* forge_poll_event();  // Returns JSON event or nullptr if queue empty
 
 // Library queries - returns JSON
+// The library is every title of the last scan, kept current by watch events
+// and verification results. filter_json is an object of optional fields
+// (platform, region, format, status, issue, search, min_size, max_size, sort,
+// order, offset, limit); see ParseTitleFilter in forge_core.cpp. Null or ""
+// lists everything, 100 titles at a time. The issues list only returns
+// titles with an issue (same_title, no_title_id, scrubbed, damaged).
 FORGE_API const char* forge_get_library_summary();
 FORGE_API const char* forge_get_title_list(const char* filter_json);
 FORGE_API const char* forge_get_issues_list(const char* filter_json);
+// The same lists written into the caller's buffer, so a view refreshing
+// the same page reuses one buffer and nothing is allocated. Returns the
+// document's length; when that is buffer_size or more, the text was cut
+// short (but terminated) and the call can be repeated with a larger buffer.
+FORGE_API size_t forge_get_title_list_into(const char* filter_json, char* buffer, size_t buffer_size);
+FORGE_API size_t forge_get_issues_list_into(const char* filter_json, char* buffer, size_t buffer_size);
+
+// Remote catalog
+// The catalog (every downloadable title) is saved once per sync as a
+// compact file next to the database and mapped read-only from then on;
+// see CatalogFile in forge_catalog.h. Saving takes parallel columns and
+// sorts the entries by title: entry IDs are positions in that order, and
+// get_entries returns a JSON array of the entries with the given IDs.
+FORGE_API int forge_catalog_save(const char** titles, const char** urls, const uint64_t* sizes, const char** platforms,
+                                 const char** sources, const char** formats, size_t count);
+FORGE_API size_t forge_catalog_count();
+FORGE_API const char* forge_catalog_get_entries(const uint32_t* ids, size_t count);
+// Titles are searched natively; see CatalogIndex in forge_catalog.h. The
+// index follows the saved catalog, or replaces it with the titles given to
+// forge_catalog_build (entry i gets the ID i). A search writes up to
+// max_results IDs into ids, best match first, and returns how many it
+// wrote. platform narrows the search (either name may contain the other,
+// ignoring case); null, "" or "all" searches them all.
+FORGE_API int forge_catalog_build(const char** titles, const char** platforms, size_t count);
+FORGE_API size_t forge_catalog_search(const char* query, const char* platform, uint32_t* ids, size_t max_results);
+
+// GameTDB metadata - wiitdb.xml is imported once into an index next to the
+// database (index_path may be null for "gametdb.fgdb") and mapped at
+// forge_init; see GameTdbIndex in forge_gametdb.h. A lookup returns a JSON
+// object keyed by the given title IDs (null looks up every title in the
+// library) with names per language, region, players, controllers and ROM
+// sizes; IDs without an entry are left out.
+FORGE_API int forge_gametdb_import(const char* xml_path, const char* index_path);
+FORGE_API const char* forge_gametdb_lookup(const char** title_ids, size_t count);
 
 // Task queue - real background processing
 FORGE_API int64_t forge_task_enqueue(const char* task_type, const char* payload_json);
@@ -43,13 +100,32 @@ FORGE_API int forge_task_cancel(int64_t task_id);
 FORGE_API const char* forge_task_get_queue();
 
 // Health engine - real duplicate detection, hashing
-FORGE_API const char* forge_generate_fix_plan();
+// The fix plan lists byte-identical copies in the library and the deletions
+// that would keep one of each; nothing is changed on disk. It is built on a
+// background thread (hashing can take minutes) that queues
+// "fix_plan_started", "fix_plan_progress" and finally one "fix_plan" event
+// with the plan. Returns 0 if a plan is already being built.
+FORGE_API int forge_generate_fix_plan();
+FORGE_API int forge_fix_plan_cancel();
 FORGE_API int forge_calculate_hash(const char* file_path, char* hash_output, size_t hash_size);
 
+// Redump/No-Intro verification - DAT index is mmapped at forge_init
+// index_path may be null to use "redump.fdx" next to the database
+FORGE_API int forge_dat_import(const char** dat_paths, size_t dat_count, const char* index_path);
+FORGE_API int forge_verify_redump_hash(const char* file_path, const char* expected_hash);
+
+// Batch verification - paths may be files or library folders. mode is
+// "quick", "full" or "triage" (default). Concurrency is bounded per physical
+// device; results arrive as "verify_result" events and a final
+// "verify_complete" event. Returns the batch id, 0 on error.
+FORGE_API int64_t forge_verify_batch_start(const char** paths, size_t path_count, const char* mode);
+FORGE_API int forge_verify_batch_cancel(int64_t batch_id);
+
 // Quarantine
 FORGE_API int forge_quarantine_title(int title_id, const char* reason);
 
-// Free returned strings
+// Free returned strings: events, query results and the fix plan (not
+// forge_get_version)
 FORGE_API void forge_free_string(const char* str);
 
 #ifdef __cplusplus
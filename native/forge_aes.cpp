@@ -0,0 +1,261 @@
+#include "forge_aes.h"
+#include <cstring>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FORGE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FORGE_TARGET(features)
+#else
+#include <cpuid.h>
+#define FORGE_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+static inline uint32_t ReadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void WriteBE32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline uint32_t Rotr32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// ============================================================================
+// Tables (generated once)
+// ============================================================================
+
+static uint8_t g_sbox[256];
+static uint8_t g_inv_sbox[256];
+static uint32_t g_td[4][256];
+static bool g_has_aesni = false;
+static std::once_flag g_tables_once;
+
+static uint8_t GfMul(uint8_t a, uint8_t b) {
+    uint8_t p = 0;
+    while (b) {
+        if (b & 1) p ^= a;
+        a = (uint8_t)((a << 1) ^ ((a & 0x80) ? 0x1B : 0));
+        b >>= 1;
+    }
+    return p;
+}
+
+static inline uint8_t Rotl8(uint8_t x, int n) {
+    return (uint8_t)((x << n) | (x >> (8 - n)));
+}
+
+static void BuildTables() {
+    // Walk the multiplicative group with generator 3 to get inverses
+    uint8_t p = 1, q = 1;
+    do {
+        p = (uint8_t)(p ^ (p << 1) ^ ((p & 0x80) ? 0x1B : 0));
+        q ^= (uint8_t)(q << 1);
+        q ^= (uint8_t)(q << 2);
+        q ^= (uint8_t)(q << 4);
+        if (q & 0x80) q ^= 0x09;
+        uint8_t x = (uint8_t)(q ^ Rotl8(q, 1) ^ Rotl8(q, 2) ^ Rotl8(q, 3) ^ Rotl8(q, 4));
+        g_sbox[p] = x ^ 0x63;
+    } while (p != 1);
+    g_sbox[0] = 0x63;
+
+    for (int i = 0; i < 256; i++) g_inv_sbox[g_sbox[i]] = (uint8_t)i;
+
+    for (int i = 0; i < 256; i++) {
+        uint8_t y = g_inv_sbox[i];
+        uint32_t t = ((uint32_t)GfMul(y, 0x0E) << 24) | ((uint32_t)GfMul(y, 0x09) << 16) |
+                     ((uint32_t)GfMul(y, 0x0D) << 8) | (uint32_t)GfMul(y, 0x0B);
+        g_td[0][i] = t;
+        g_td[1][i] = Rotr32(t, 8);
+        g_td[2][i] = Rotr32(t, 16);
+        g_td[3][i] = Rotr32(t, 24);
+    }
+
+#ifdef FORGE_X86
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    unsigned int ecx = (unsigned int)regs[2];
+#else
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+#endif
+    g_has_aesni = ((ecx >> 25) & 1) && ((ecx >> 19) & 1);
+#endif
+}
+
+static inline void EnsureTables() {
+    std::call_once(g_tables_once, BuildTables);
+}
+
+// ============================================================================
+// Portable (T-table) decryption
+// ============================================================================
+
+static void DecryptBlockPortable(const uint32_t* rk, const uint8_t in[16], uint8_t out[16]) {
+    const uint32_t (*td)[256] = g_td;
+    uint32_t s0 = ReadBE32(in) ^ rk[0];
+    uint32_t s1 = ReadBE32(in + 4) ^ rk[1];
+    uint32_t s2 = ReadBE32(in + 8) ^ rk[2];
+    uint32_t s3 = ReadBE32(in + 12) ^ rk[3];
+
+    for (int round = 1; round < 10; round++) {
+        rk += 4;
+        uint32_t t0 = td[0][s0 >> 24] ^ td[1][(s3 >> 16) & 0xFF] ^ td[2][(s2 >> 8) & 0xFF] ^ td[3][s1 & 0xFF] ^ rk[0];
+        uint32_t t1 = td[0][s1 >> 24] ^ td[1][(s0 >> 16) & 0xFF] ^ td[2][(s3 >> 8) & 0xFF] ^ td[3][s2 & 0xFF] ^ rk[1];
+        uint32_t t2 = td[0][s2 >> 24] ^ td[1][(s1 >> 16) & 0xFF] ^ td[2][(s0 >> 8) & 0xFF] ^ td[3][s3 & 0xFF] ^ rk[2];
+        uint32_t t3 = td[0][s3 >> 24] ^ td[1][(s2 >> 16) & 0xFF] ^ td[2][(s1 >> 8) & 0xFF] ^ td[3][s0 & 0xFF] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    rk += 4;
+    const uint8_t* inv = g_inv_sbox;
+    WriteBE32(out, ((uint32_t)inv[s0 >> 24] << 24) ^ ((uint32_t)inv[(s3 >> 16) & 0xFF] << 16) ^
+                   ((uint32_t)inv[(s2 >> 8) & 0xFF] << 8) ^ (uint32_t)inv[s1 & 0xFF] ^ rk[0]);
+    WriteBE32(out + 4, ((uint32_t)inv[s1 >> 24] << 24) ^ ((uint32_t)inv[(s0 >> 16) & 0xFF] << 16) ^
+                       ((uint32_t)inv[(s3 >> 8) & 0xFF] << 8) ^ (uint32_t)inv[s2 & 0xFF] ^ rk[1]);
+    WriteBE32(out + 8, ((uint32_t)inv[s2 >> 24] << 24) ^ ((uint32_t)inv[(s1 >> 16) & 0xFF] << 16) ^
+                       ((uint32_t)inv[(s0 >> 8) & 0xFF] << 8) ^ (uint32_t)inv[s3 & 0xFF] ^ rk[2]);
+    WriteBE32(out + 12, ((uint32_t)inv[s3 >> 24] << 24) ^ ((uint32_t)inv[(s2 >> 16) & 0xFF] << 16) ^
+                        ((uint32_t)inv[(s1 >> 8) & 0xFF] << 8) ^ (uint32_t)inv[s0 & 0xFF] ^ rk[3]);
+}
+
+static void DecryptCbcPortable(const uint32_t* rk, const uint8_t iv[16], const uint8_t* in, uint8_t* out,
+                               size_t size) {
+    uint8_t chain[16];
+    uint8_t next[16];
+    memcpy(chain, iv, 16);
+    for (size_t offset = 0; offset + 16 <= size; offset += 16) {
+        memcpy(next, in + offset, 16);
+        DecryptBlockPortable(rk, next, out + offset);
+        for (int i = 0; i < 16; i++) out[offset + i] ^= chain[i];
+        memcpy(chain, next, 16);
+    }
+}
+
+// ============================================================================
+// AES-NI decryption (CBC decrypt is parallel: 4 blocks in flight)
+// ============================================================================
+
+#ifdef FORGE_X86
+
+FORGE_TARGET("aes,sse4.1")
+static void DecryptCbcAesNi(const uint8_t (*keys)[16], const uint8_t iv[16], const uint8_t* in, uint8_t* out,
+                            size_t size) {
+    __m128i k[11];
+    for (int i = 0; i < 11; i++) k[i] = _mm_load_si128((const __m128i*)keys[i]);
+    __m128i chain = _mm_loadu_si128((const __m128i*)iv);
+
+    size_t offset = 0;
+    for (; offset + 64 <= size; offset += 64) {
+        __m128i c0 = _mm_loadu_si128((const __m128i*)(in + offset));
+        __m128i c1 = _mm_loadu_si128((const __m128i*)(in + offset + 16));
+        __m128i c2 = _mm_loadu_si128((const __m128i*)(in + offset + 32));
+        __m128i c3 = _mm_loadu_si128((const __m128i*)(in + offset + 48));
+        __m128i b0 = _mm_xor_si128(c0, k[0]);
+        __m128i b1 = _mm_xor_si128(c1, k[0]);
+        __m128i b2 = _mm_xor_si128(c2, k[0]);
+        __m128i b3 = _mm_xor_si128(c3, k[0]);
+        for (int r = 1; r < 10; r++) {
+            b0 = _mm_aesdec_si128(b0, k[r]);
+            b1 = _mm_aesdec_si128(b1, k[r]);
+            b2 = _mm_aesdec_si128(b2, k[r]);
+            b3 = _mm_aesdec_si128(b3, k[r]);
+        }
+        b0 = _mm_xor_si128(_mm_aesdeclast_si128(b0, k[10]), chain);
+        b1 = _mm_xor_si128(_mm_aesdeclast_si128(b1, k[10]), c0);
+        b2 = _mm_xor_si128(_mm_aesdeclast_si128(b2, k[10]), c1);
+        b3 = _mm_xor_si128(_mm_aesdeclast_si128(b3, k[10]), c2);
+        _mm_storeu_si128((__m128i*)(out + offset), b0);
+        _mm_storeu_si128((__m128i*)(out + offset + 16), b1);
+        _mm_storeu_si128((__m128i*)(out + offset + 32), b2);
+        _mm_storeu_si128((__m128i*)(out + offset + 48), b3);
+        chain = c3;
+    }
+    for (; offset + 16 <= size; offset += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(in + offset));
+        __m128i b = _mm_xor_si128(c, k[0]);
+        for (int r = 1; r < 10; r++) b = _mm_aesdec_si128(b, k[r]);
+        b = _mm_xor_si128(_mm_aesdeclast_si128(b, k[10]), chain);
+        _mm_storeu_si128((__m128i*)(out + offset), b);
+        chain = c;
+    }
+}
+
+FORGE_TARGET("aes,sse4.1")
+static void InvMixColumnsAesNi(const uint8_t in[16], uint8_t out[16]) {
+    _mm_storeu_si128((__m128i*)out, _mm_aesimc_si128(_mm_loadu_si128((const __m128i*)in)));
+}
+
+#endif // FORGE_X86
+
+// ============================================================================
+// Key schedule
+// ============================================================================
+
+void Aes128Decryptor::SetKey(const uint8_t key[16]) {
+    EnsureTables();
+
+    // Encryption schedule
+    uint32_t w[44];
+    for (int i = 0; i < 4; i++) w[i] = ReadBE32(key + i * 4);
+    uint32_t rcon = 0x01;
+    for (int i = 4; i < 44; i++) {
+        uint32_t t = w[i - 1];
+        if (i % 4 == 0) {
+            t = ((uint32_t)g_sbox[(t >> 16) & 0xFF] << 24) | ((uint32_t)g_sbox[(t >> 8) & 0xFF] << 16) |
+                ((uint32_t)g_sbox[t & 0xFF] << 8) | (uint32_t)g_sbox[t >> 24];
+            t ^= rcon << 24;
+            rcon = GfMul((uint8_t)rcon, 2);
+        }
+        w[i] = w[i - 4] ^ t;
+    }
+
+    // Equivalent inverse cipher: reverse the rounds and run InvMixColumns
+    // over the middle round keys
+    for (int round = 0; round <= 10; round++) {
+        for (int j = 0; j < 4; j++) {
+            uint32_t k = w[(10 - round) * 4 + j];
+            if (round > 0 && round < 10) {
+                k = g_td[0][g_sbox[k >> 24]] ^ g_td[1][g_sbox[(k >> 16) & 0xFF]] ^
+                    g_td[2][g_sbox[(k >> 8) & 0xFF]] ^ g_td[3][g_sbox[k & 0xFF]];
+            }
+            round_keys[round * 4 + j] = k;
+        }
+    }
+
+#ifdef FORGE_X86
+    if (g_has_aesni) {
+        for (int round = 0; round <= 10; round++) {
+            uint8_t enc[16];
+            for (int j = 0; j < 4; j++) WriteBE32(enc + j * 4, w[(10 - round) * 4 + j]);
+            if (round > 0 && round < 10) InvMixColumnsAesNi(enc, ni_keys[round]);
+            else memcpy(ni_keys[round], enc, 16);
+        }
+    }
+#endif
+}
+
+void Aes128Decryptor::DecryptCbc(const uint8_t iv[16], const uint8_t* in, uint8_t* out, size_t size) const {
+    EnsureTables();
+#ifdef FORGE_X86
+    if (g_has_aesni) {
+        DecryptCbcAesNi(ni_keys, iv, in, out, size);
+        return;
+    }
+#endif
+    DecryptCbcPortable(round_keys, iv, in, out, size);
+}
+
+const char* Aes128Decryptor::KernelName() {
+    EnsureTables();
+    return g_has_aesni ? "aes-ni" : "portable";
+}
@@ -0,0 +1,30 @@
+#ifndef FORGE_AES_H
+#define FORGE_AES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// AES-128 decryption (FIPS 197), used for Wii partition data.
+//
+// The key schedule is expanded once; the object is immutable afterwards and
+// can be shared between worker threads. AES-NI is used when the CPU has it,
+// otherwise a table-driven portable implementation.
+class Aes128Decryptor {
+public:
+    Aes128Decryptor() = default;
+    explicit Aes128Decryptor(const uint8_t key[16]) { SetKey(key); }
+
+    void SetKey(const uint8_t key[16]);
+
+    // CBC decrypt size bytes (a multiple of 16). in and out may alias.
+    void DecryptCbc(const uint8_t iv[16], const uint8_t* in, uint8_t* out, size_t size) const;
+
+    // "aes-ni" or "portable"
+    static const char* KernelName();
+
+private:
+    uint32_t round_keys[44] = {};       // Decryption schedule for the portable path
+    alignas(16) uint8_t ni_keys[11][16] = {};  // Decryption schedule for AES-NI
+};
+
+#endif // FORGE_AES_H
@@ -0,0 +1,711 @@
+#include "forge_archive.h"
+#include "forge_decompress.h"
+#include "forge_io.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// Directories beyond this are not archives we could sensibly scan
+static constexpr uint64_t ARCHIVE_MAX_DIRECTORY_SIZE = 64 * 1024 * 1024;
+static constexpr uint64_t ARCHIVE_MAX_ENTRIES = 1 << 22;
+
+static inline uint16_t ReadLE16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t ReadLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t ReadLE64(const uint8_t* p) {
+    return (uint64_t)ReadLE32(p) | ((uint64_t)ReadLE32(p + 4) << 32);
+}
+
+ArchiveType DetectArchive(const uint8_t* header, size_t header_size) {
+    if (header_size >= 4 && memcmp(header, "PK\x03\x04", 4) == 0) return ArchiveType::Zip;
+    if (header_size >= 6 && memcmp(header, "7z\xBC\xAF\x27\x1C", 6) == 0) return ArchiveType::SevenZip;
+    return ArchiveType::None;
+}
+
+ArchiveType DetectArchiveFile(const std::string& path) {
+    RandomAccessFile file;
+    uint8_t header[8];
+    if (!file.Open(path) || !file.ReadExact(0, header, sizeof(header))) return ArchiveType::None;
+    return DetectArchive(header, sizeof(header));
+}
+
+bool ArchiveFileName(const std::string& path) {
+    size_t dot = path.find_last_of("./\\");
+    if (dot == std::string::npos || path[dot] != '.') return false;
+    std::string extension = path.substr(dot + 1);
+    for (auto& c : extension) c = (char)tolower((unsigned char)c);
+    return extension == "zip" || extension == "7z";
+}
+
+std::string ArchiveMemberPath(const std::string& archive, const std::string& member) {
+    std::string path = archive;
+    path += ARCHIVE_MEMBER_SEPARATOR;
+    path += member;
+    return path;
+}
+
+bool SplitArchiveMemberPath(const std::string& path, std::string* archive, std::string* member) {
+    size_t separator = path.find(ARCHIVE_MEMBER_SEPARATOR);
+    if (separator == std::string::npos) return false;
+    if (archive) *archive = path.substr(0, separator);
+    if (member) *member = path.substr(separator + 1);
+    return true;
+}
+
+// Identify a member from its decoded prefix. decode(out, capacity, produced)
+// restarts the member's stream each call: the first pass needs one sector,
+// and only members that match nothing there pay for the deep pass.
+template <typename DecodeFn>
+static bool IdentifyPrefix(uint64_t member_size, const DecodeFn& decode, GameIdentity* identity) {
+    std::vector<uint8_t> buffer((size_t)(std::min)(member_size, (uint64_t)IDENTIFY_DEEP_HEADER_SIZE));
+    size_t first = (std::min)(buffer.size(), (size_t)IDENTIFY_HEADER_SIZE);
+    size_t produced = 0;
+    decode(buffer.data(), first, &produced);
+    bool identified = produced > 0 && identify_from_header(buffer.data(), produced, identity);
+
+    if (!identified && member_size >= IDENTIFY_DEEP_MIN_FILE_SIZE && produced == first) {
+        decode(buffer.data(), buffer.size(), &produced);
+        identified = identify_from_header(buffer.data(), produced, identity);
+    }
+    if (identified) identity->file_size = member_size;
+    return identified;
+}
+
+// ============================================================================
+// Zip
+// ============================================================================
+
+static constexpr uint32_t ZIP_LOCAL_MAGIC = 0x04034B50;
+static constexpr uint32_t ZIP_CENTRAL_MAGIC = 0x02014B50;
+static constexpr uint32_t ZIP_END_MAGIC = 0x06054B50;
+static constexpr uint32_t ZIP64_END_MAGIC = 0x06064B50;
+static constexpr uint32_t ZIP64_LOCATOR_MAGIC = 0x07064B50;
+static constexpr size_t ZIP_LOCAL_HEADER_SIZE = 30;
+static constexpr size_t ZIP_CENTRAL_HEADER_SIZE = 46;
+static constexpr size_t ZIP_END_SIZE = 22;
+static constexpr size_t ZIP64_END_SIZE = 56;
+static constexpr size_t ZIP64_LOCATOR_SIZE = 20;
+static constexpr size_t ZIP_MAX_COMMENT = 0xFFFF;
+
+static constexpr uint16_t ZIP_METHOD_STORED = 0;
+static constexpr uint16_t ZIP_METHOD_DEFLATE = 8;
+static constexpr uint16_t ZIP_METHOD_LZMA = 14;
+static constexpr uint16_t ZIP_FLAG_ENCRYPTED = 0x0001;
+
+// Central directory location from the end-of-central-directory record
+// (searched backwards over a possible archive comment) and its ZIP64 twin
+static bool FindZipDirectory(const RandomAccessFile& file, uint64_t* offset, uint64_t* size, uint64_t* entries) {
+    uint64_t file_size = file.Size();
+    if (file_size < ZIP_END_SIZE) return false;
+    size_t tail_size = (size_t)(std::min)(file_size, (uint64_t)(ZIP_END_SIZE + ZIP_MAX_COMMENT + ZIP64_LOCATOR_SIZE));
+    std::vector<uint8_t> tail(tail_size);
+    uint64_t tail_offset = file_size - tail_size;
+    if (!file.ReadExact(tail_offset, tail.data(), tail_size)) return false;
+
+    size_t end = tail_size - ZIP_END_SIZE + 1;
+    do {
+        end--;
+        if (ReadLE32(&tail[end]) != ZIP_END_MAGIC) continue;
+        const uint8_t* record = &tail[end];
+        *entries = ReadLE16(record + 10);
+        *size = ReadLE32(record + 12);
+        *offset = ReadLE32(record + 16);
+
+        bool zip64 = *entries == 0xFFFF || *size == 0xFFFFFFFF || *offset == 0xFFFFFFFF;
+        if (zip64) {
+            if (end < ZIP64_LOCATOR_SIZE || ReadLE32(&tail[end - ZIP64_LOCATOR_SIZE]) != ZIP64_LOCATOR_MAGIC) return false;
+            uint64_t end64_offset = ReadLE64(&tail[end - ZIP64_LOCATOR_SIZE + 8]);
+            uint8_t end64[ZIP64_END_SIZE];
+            if (!file.ReadExact(end64_offset, end64, sizeof(end64)) || ReadLE32(end64) != ZIP64_END_MAGIC) return false;
+            *entries = ReadLE64(end64 + 32);
+            *size = ReadLE64(end64 + 40);
+            *offset = ReadLE64(end64 + 48);
+        }
+        return *offset + *size <= file_size && *size <= ARCHIVE_MAX_DIRECTORY_SIZE && *entries <= ARCHIVE_MAX_ENTRIES;
+    } while (end > 0);
+    return false;
+}
+
+static bool DecodeZipMember(const RandomAccessFile& file, uint16_t method, uint64_t data_offset, uint64_t packed_size,
+                            uint8_t* out, size_t capacity, size_t* produced) {
+    RangeReader in(file, data_offset, packed_size);
+    switch (method) {
+    case ZIP_METHOD_STORED:
+        *produced = in.Read(out, capacity);
+        return true;
+    case ZIP_METHOD_DEFLATE:
+        return InflatePrefix(in, out, capacity, produced);
+    case ZIP_METHOD_LZMA: {
+        // u16 version, u16 properties size, properties, then the LZMA stream
+        uint8_t header[4];
+        uint8_t props[5];
+        *produced = 0;
+        if (in.Read(header, 4) != 4 || ReadLE16(header + 2) != sizeof(props) ||
+            in.Read(props, sizeof(props)) != sizeof(props)) {
+            return false;
+        }
+        return LzmaDecodePrefix(in, props, sizeof(props), out, capacity, produced);
+    }
+    default:
+        *produced = 0;
+        return false;
+    }
+}
+
+static bool IdentifyZipMembers(const RandomAccessFile& file, std::vector<ArchiveMember>* members) {
+    uint64_t directory_offset = 0, directory_size = 0, entries = 0;
+    if (!FindZipDirectory(file, &directory_offset, &directory_size, &entries)) return false;
+
+    std::vector<uint8_t> directory((size_t)directory_size);
+    if (!file.ReadExact(directory_offset, directory.data(), directory.size())) return false;
+
+    size_t pos = 0;
+    for (uint64_t e = 0; e < entries; e++) {
+        if (pos + ZIP_CENTRAL_HEADER_SIZE > directory.size()) return false;
+        const uint8_t* header = &directory[pos];
+        if (ReadLE32(header) != ZIP_CENTRAL_MAGIC) return false;
+        uint16_t flags = ReadLE16(header + 8);
+        uint16_t method = ReadLE16(header + 10);
+        uint64_t packed_size = ReadLE32(header + 20);
+        uint64_t size = ReadLE32(header + 24);
+        size_t name_length = ReadLE16(header + 28);
+        size_t extra_length = ReadLE16(header + 30);
+        size_t comment_length = ReadLE16(header + 32);
+        uint64_t local_offset = ReadLE32(header + 42);
+        size_t next = pos + ZIP_CENTRAL_HEADER_SIZE + name_length + extra_length + comment_length;
+        if (next > directory.size()) return false;
+
+        std::string name((const char*)header + ZIP_CENTRAL_HEADER_SIZE, name_length);
+        // ZIP64 extra field: only the fields saturated above, in this order
+        const uint8_t* extra = header + ZIP_CENTRAL_HEADER_SIZE + name_length;
+        for (size_t x = 0; x + 4 <= extra_length;) {
+            uint16_t id = ReadLE16(extra + x);
+            size_t length = ReadLE16(extra + x + 2);
+            if (x + 4 + length > extra_length) break;
+            if (id == 0x0001) {
+                const uint8_t* field = extra + x + 4;
+                const uint8_t* field_end = field + length;
+                if (size == 0xFFFFFFFF && field + 8 <= field_end) size = ReadLE64(field), field += 8;
+                if (packed_size == 0xFFFFFFFF && field + 8 <= field_end) packed_size = ReadLE64(field), field += 8;
+                if (local_offset == 0xFFFFFFFF && field + 8 <= field_end) local_offset = ReadLE64(field);
+            }
+            x += 4 + length;
+        }
+        pos = next;
+
+        bool directory_entry = !name.empty() && name.back() == '/';
+        if (directory_entry || size == 0 || (flags & ZIP_FLAG_ENCRYPTED)) continue;
+        if (method != ZIP_METHOD_STORED && method != ZIP_METHOD_DEFLATE && method != ZIP_METHOD_LZMA) continue;
+
+        // The local header repeats the name and has its own extra field
+        uint8_t local[ZIP_LOCAL_HEADER_SIZE];
+        if (!file.ReadExact(local_offset, local, sizeof(local)) || ReadLE32(local) != ZIP_LOCAL_MAGIC) continue;
+        uint64_t data_offset = local_offset + ZIP_LOCAL_HEADER_SIZE + ReadLE16(local + 26) + ReadLE16(local + 28);
+        if (data_offset + packed_size > file.Size()) continue;
+
+        ArchiveMember member;
+        member.name = std::move(name);
+        member.identity = {};
+        auto decode = [&](uint8_t* out, size_t capacity, size_t* produced) {
+            return DecodeZipMember(file, method, data_offset, packed_size, out, capacity, produced);
+        };
+        if (IdentifyPrefix(size, decode, &member.identity)) members->push_back(std::move(member));
+    }
+    return true;
+}
+
+// ============================================================================
+// 7z
+//
+// The start header at offset 0 points at the archive header, which is
+// usually itself LZMA-compressed (kEncodedHeader) and then describes the
+// folders (coder chains over packed streams), how each folder's output is
+// split into files, and the file names. Numbers use 7z's variable-length
+// encoding: the leading 1-bits of the first byte count extra bytes.
+// ============================================================================
+
+static constexpr size_t SEVENZIP_START_HEADER_SIZE = 32;
+static constexpr unsigned SEVENZIP_MAX_HEADER_NESTING = 4;
+
+enum SevenZipProperty : uint64_t {
+    SZ_END = 0x00,
+    SZ_HEADER = 0x01,
+    SZ_ARCHIVE_PROPERTIES = 0x02,
+    SZ_ADDITIONAL_STREAMS_INFO = 0x03,
+    SZ_MAIN_STREAMS_INFO = 0x04,
+    SZ_FILES_INFO = 0x05,
+    SZ_PACK_INFO = 0x06,
+    SZ_UNPACK_INFO = 0x07,
+    SZ_SUBSTREAMS_INFO = 0x08,
+    SZ_SIZE = 0x09,
+    SZ_CRC = 0x0A,
+    SZ_FOLDER = 0x0B,
+    SZ_CODERS_UNPACK_SIZE = 0x0C,
+    SZ_NUM_UNPACK_STREAM = 0x0D,
+    SZ_EMPTY_STREAM = 0x0E,
+    SZ_NAME = 0x11,
+    SZ_ENCODED_HEADER = 0x17,
+};
+
+class SevenZipCursor {
+public:
+    SevenZipCursor(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint8_t Byte() {
+        if (pos >= size) {
+            ok = false;
+            return 0;
+        }
+        return data[pos++];
+    }
+
+    uint64_t Number() {
+        uint8_t first = Byte();
+        uint64_t value = 0;
+        uint8_t mask = 0x80;
+        for (int i = 0; i < 8; i++) {
+            if ((first & mask) == 0) return value | ((uint64_t)(first & (mask - 1)) << (8 * i));
+            value |= (uint64_t)Byte() << (8 * i);
+            mask >>= 1;
+        }
+        return value;
+    }
+
+    // A count that must fit what is left of the header
+    size_t Count() {
+        uint64_t value = Number();
+        if (value > ARCHIVE_MAX_ENTRIES) ok = false;
+        return ok ? (size_t)value : 0;
+    }
+
+    const uint8_t* Bytes(uint64_t count) {
+        if (count > size - pos) {
+            ok = false;
+            pos = size;
+            return data;
+        }
+        const uint8_t* p = data + pos;
+        pos += (size_t)count;
+        return p;
+    }
+
+    void Skip(uint64_t count) { Bytes(count); }
+
+    std::vector<bool> Bits(size_t count) {
+        std::vector<bool> bits(count);
+        uint8_t byte = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (i % 8 == 0) byte = Byte();
+            bits[i] = (byte & (0x80 >> (i % 8))) != 0;
+        }
+        return bits;
+    }
+
+    // An all-defined flag or a bit vector, then a CRC32 per defined item
+    std::vector<bool> SkipDigests(size_t count) {
+        std::vector<bool> defined = Byte() ? std::vector<bool>(count, true) : Bits(count);
+        for (size_t i = 0; i < count; i++) {
+            if (defined[i]) Skip(4);
+        }
+        return defined;
+    }
+
+    bool Expect(uint64_t id) {
+        if (Number() != id) ok = false;
+        return ok;
+    }
+
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+};
+
+struct SevenZipFolder {
+    bool supported = false;         // One coder we can decode
+    std::vector<uint8_t> method;
+    std::vector<uint8_t> properties;
+    size_t pack_streams = 0;
+    uint64_t pack_offset = 0;       // First packed stream, absolute
+    uint64_t pack_size = 0;
+    uint64_t unpack_size = 0;       // Final output of the coder chain
+    bool crc_defined = false;
+    size_t out_streams = 0;
+    std::vector<size_t> bound_outs;
+};
+
+struct SevenZipStreams {
+    std::vector<SevenZipFolder> folders;
+    std::vector<size_t> streams_per_folder;
+    std::vector<uint64_t> stream_sizes;     // Every unpacked stream, in folder order
+};
+
+static void ParseSevenZipFolder(SevenZipCursor& c, SevenZipFolder* folder) {
+    size_t coders = c.Count();
+    size_t in_streams = 0;
+    for (size_t i = 0; i < coders && c.ok; i++) {
+        uint8_t flags = c.Byte();
+        const uint8_t* id = c.Bytes(flags & 0x0F);
+        size_t coder_in = 1, coder_out = 1;
+        if (flags & 0x10) {
+            coder_in = c.Count();
+            coder_out = c.Count();
+        }
+        std::vector<uint8_t> properties;
+        if (flags & 0x20) {
+            uint64_t length = c.Number();
+            const uint8_t* data = c.Bytes(length);
+            if (c.ok) properties.assign(data, data + length);
+        }
+        if (flags & 0x80) c.ok = false;     // Alternative methods: never written by 7-Zip
+        if (!c.ok) return;
+        in_streams += coder_in;
+        folder->out_streams += coder_out;
+        if (i == 0) {
+            folder->method.assign(id, id + (flags & 0x0F));
+            folder->properties = std::move(properties);
+        }
+        folder->supported = coders == 1 && coder_in == 1 && coder_out == 1;
+    }
+    if (folder->out_streams == 0 || folder->out_streams > in_streams + 1) {
+        c.ok = false;
+        return;
+    }
+    for (size_t i = 0; i + 1 < folder->out_streams && c.ok; i++) {
+        c.Number();     // In index
+        folder->bound_outs.push_back(c.Count());
+    }
+    folder->pack_streams = in_streams - (folder->out_streams - 1);
+    if (folder->pack_streams > 1) {
+        for (size_t i = 0; i < folder->pack_streams; i++) c.Number();
+    }
+
+    static const uint8_t COPY[] = { 0x00 };
+    static const uint8_t LZMA[] = { 0x03, 0x01, 0x01 };
+    static const uint8_t LZMA2[] = { 0x21 };
+    auto is = [&](const uint8_t* id, size_t length) {
+        return folder->method.size() == length && memcmp(folder->method.data(), id, length) == 0;
+    };
+    folder->supported = folder->supported && (is(COPY, 1) || is(LZMA, 3) || is(LZMA2, 1));
+}
+
+static bool ParseSevenZipStreams(SevenZipCursor& c, SevenZipStreams* streams) {
+    std::vector<uint64_t> pack_sizes;
+    uint64_t pack_position = 0;
+    uint64_t id = c.Number();
+
+    if (id == SZ_PACK_INFO) {
+        pack_position = c.Number();
+        size_t count = c.Count();
+        id = c.Number();
+        if (id == SZ_SIZE) {
+            for (size_t i = 0; i < count && c.ok; i++) pack_sizes.push_back(c.Number());
+            id = c.Number();
+        }
+        if (id == SZ_CRC) {
+            c.SkipDigests(count);
+            id = c.Number();
+        }
+        if (id != SZ_END || pack_sizes.size() != count) return false;
+        id = c.Number();
+    }
+
+    if (id == SZ_UNPACK_INFO) {
+        if (!c.Expect(SZ_FOLDER)) return false;
+        size_t count = c.Count();
+        if (c.Byte() != 0) return false;    // Folders stored in another stream
+        streams->folders.resize(count);
+        for (size_t i = 0; i < count && c.ok; i++) ParseSevenZipFolder(c, &streams->folders[i]);
+        if (!c.Expect(SZ_CODERS_UNPACK_SIZE)) return false;
+        for (auto& folder : streams->folders) {
+            // The chain's output is the one stream no bind pair consumes
+            for (size_t out = 0; out < folder.out_streams; out++) {
+                uint64_t size = c.Number();
+                if (std::find(folder.bound_outs.begin(), folder.bound_outs.end(), out) == folder.bound_outs.end()) {
+                    folder.unpack_size = size;
+                }
+            }
+        }
+        id = c.Number();
+        if (id == SZ_CRC) {
+            std::vector<bool> defined = c.SkipDigests(count);
+            for (size_t i = 0; i < count; i++) streams->folders[i].crc_defined = defined[i];
+            id = c.Number();
+        }
+        if (id != SZ_END) return false;
+        id = c.Number();
+
+        // Packed streams are stored back to back after the start header
+        uint64_t offset = SEVENZIP_START_HEADER_SIZE + pack_position;
+        size_t pack_index = 0;
+        for (auto& folder : streams->folders) {
+            if (pack_index + folder.pack_streams > pack_sizes.size()) return false;
+            folder.pack_offset = offset;
+            folder.pack_size = pack_sizes[pack_index];
+            for (size_t i = 0; i < folder.pack_streams; i++) offset += pack_sizes[pack_index++];
+        }
+    }
+
+    size_t folder_count = streams->folders.size();
+    streams->streams_per_folder.assign(folder_count, 1);
+    if (id == SZ_SUBSTREAMS_INFO) {
+        id = c.Number();
+        if (id == SZ_NUM_UNPACK_STREAM) {
+            for (size_t i = 0; i < folder_count; i++) streams->streams_per_folder[i] = c.Count();
+            id = c.Number();
+        }
+        for (size_t i = 0; i < folder_count && c.ok; i++) {
+            size_t count = streams->streams_per_folder[i];
+            if (count == 0) continue;
+            // All but the last size are stored; the last is what remains
+            uint64_t sum = 0;
+            if (id == SZ_SIZE) {
+                for (size_t j = 1; j < count; j++) {
+                    uint64_t size = c.Number();
+                    streams->stream_sizes.push_back(size);
+                    sum += size;
+                }
+            } else if (count != 1) {
+                return false;
+            }
+            if (sum > streams->folders[i].unpack_size) return false;
+            streams->stream_sizes.push_back(streams->folders[i].unpack_size - sum);
+        }
+        if (id == SZ_SIZE) id = c.Number();
+        if (id == SZ_CRC) {
+            size_t unknown = 0;
+            for (size_t i = 0; i < folder_count; i++) {
+                size_t count = streams->streams_per_folder[i];
+                if (count != 1 || !streams->folders[i].crc_defined) unknown += count;
+            }
+            c.SkipDigests(unknown);
+            id = c.Number();
+        }
+        if (id != SZ_END) return false;
+        id = c.Number();
+    } else {
+        for (const auto& folder : streams->folders) streams->stream_sizes.push_back(folder.unpack_size);
+    }
+    return id == SZ_END && c.ok;
+}
+
+static bool DecodeSevenZipFolder(const RandomAccessFile& file, const SevenZipFolder& folder, uint8_t* out,
+                                 size_t capacity, size_t* produced) {
+    *produced = 0;
+    if (!folder.supported || folder.pack_offset + folder.pack_size > file.Size()) return false;
+    RangeReader in(file, folder.pack_offset, folder.pack_size);
+    switch (folder.method[0]) {
+    case 0x00:
+        *produced = in.Read(out, capacity);
+        return true;
+    case 0x03:
+        return LzmaDecodePrefix(in, folder.properties.data(), folder.properties.size(), out, capacity, produced);
+    default:
+        return Lzma2DecodePrefix(in, out, capacity, produced);
+    }
+}
+
+static void AppendUtf8(std::string* out, uint32_t c) {
+    if (c < 0x80) {
+        *out += (char)c;
+    } else if (c < 0x800) {
+        *out += (char)(0xC0 | (c >> 6));
+        *out += (char)(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        *out += (char)(0xE0 | (c >> 12));
+        *out += (char)(0x80 | ((c >> 6) & 0x3F));
+        *out += (char)(0x80 | (c & 0x3F));
+    } else {
+        *out += (char)(0xF0 | (c >> 18));
+        *out += (char)(0x80 | ((c >> 12) & 0x3F));
+        *out += (char)(0x80 | ((c >> 6) & 0x3F));
+        *out += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+struct SevenZipFile {
+    std::string name;
+    bool has_stream = true;
+};
+
+// File names (UTF-16LE, NUL-terminated) and which files have no data
+static bool ParseSevenZipFiles(SevenZipCursor& c, std::vector<SevenZipFile>* files) {
+    size_t count = c.Count();
+    files->assign(count, SevenZipFile());
+    for (;;) {
+        uint64_t type = c.Number();
+        if (type == SZ_END || !c.ok) break;
+        uint64_t size = c.Number();
+        const uint8_t* data = c.Bytes(size);
+        if (!c.ok) break;
+        SevenZipCursor property(data, (size_t)size);
+
+        if (type == SZ_EMPTY_STREAM) {
+            std::vector<bool> empty = property.Bits(count);
+            for (size_t i = 0; i < count; i++) (*files)[i].has_stream = !empty[i];
+        } else if (type == SZ_NAME) {
+            if (property.Byte() != 0) continue;     // Names stored in another stream
+            for (size_t i = 0; i < count && property.ok; i++) {
+                std::string& name = (*files)[i].name;
+                for (;;) {
+                    const uint8_t* unit = property.Bytes(2);
+                    if (!property.ok) break;
+                    uint32_t c16 = ReadLE16(unit);
+                    if (c16 == 0) break;
+                    if (c16 >= 0xD800 && c16 < 0xDC00 && property.pos + 2 <= property.size) {
+                        uint32_t low = ReadLE16(property.data + property.pos);
+                        if (low >= 0xDC00 && low < 0xE000) {
+                            property.Skip(2);
+                            c16 = 0x10000 + ((c16 - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                    }
+                    AppendUtf8(&name, c16);
+                }
+                // 7-Zip writes Windows separators on Windows
+                std::replace(name.begin(), name.end(), '\\', '/');
+            }
+        }
+    }
+    return c.ok;
+}
+
+struct SevenZipMemberRef {
+    size_t file;
+    uint64_t offset;    // Within the folder's output
+    uint64_t size;
+};
+
+static bool IdentifySevenZipMembers(const RandomAccessFile& file, std::vector<ArchiveMember>* members) {
+    uint8_t start[SEVENZIP_START_HEADER_SIZE];
+    if (!file.ReadExact(0, start, sizeof(start)) || DetectArchive(start, sizeof(start)) != ArchiveType::SevenZip) {
+        return false;
+    }
+    uint64_t header_offset = SEVENZIP_START_HEADER_SIZE + ReadLE64(start + 12);
+    uint64_t header_size = ReadLE64(start + 20);
+    if (header_size == 0) return true;      // Empty archive
+    if (header_size > ARCHIVE_MAX_DIRECTORY_SIZE || header_offset > file.Size() ||
+        header_size > file.Size() - header_offset) {
+        return false;
+    }
+    std::vector<uint8_t> header((size_t)header_size);
+    if (!file.ReadExact(header_offset, header.data(), header.size())) return false;
+
+    // An encoded header is a streams description whose one folder decodes
+    // to the real header
+    for (unsigned nesting = 0;; nesting++) {
+        SevenZipCursor c(header.data(), header.size());
+        uint64_t id = c.Number();
+        if (id == SZ_HEADER) break;
+        if (id != SZ_ENCODED_HEADER || nesting == SEVENZIP_MAX_HEADER_NESTING) return false;
+
+        SevenZipStreams streams;
+        if (!ParseSevenZipStreams(c, &streams) || streams.folders.size() != 1) return false;
+        const SevenZipFolder& folder = streams.folders[0];
+        if (folder.unpack_size > ARCHIVE_MAX_DIRECTORY_SIZE) return false;
+        std::vector<uint8_t> decoded((size_t)folder.unpack_size);
+        size_t produced = 0;
+        if (!DecodeSevenZipFolder(file, folder, decoded.data(), decoded.size(), &produced) ||
+            produced != decoded.size()) {
+            return false;
+        }
+        header = std::move(decoded);
+    }
+
+    SevenZipCursor c(header.data(), header.size());
+    c.Number();     // SZ_HEADER
+    SevenZipStreams streams;
+    std::vector<SevenZipFile> files;
+    uint64_t id = c.Number();
+    if (id == SZ_ARCHIVE_PROPERTIES) {
+        for (uint64_t type = c.Number(); type != SZ_END && c.ok; type = c.Number()) c.Skip(c.Number());
+        id = c.Number();
+    }
+    if (id == SZ_ADDITIONAL_STREAMS_INFO) {
+        SevenZipStreams additional;
+        if (!ParseSevenZipStreams(c, &additional)) return false;
+        id = c.Number();
+    }
+    if (id == SZ_MAIN_STREAMS_INFO) {
+        if (!ParseSevenZipStreams(c, &streams)) return false;
+        id = c.Number();
+    }
+    if (id == SZ_FILES_INFO) {
+        if (!ParseSevenZipFiles(c, &files)) return false;
+        id = c.Number();
+    }
+    if (id != SZ_END || !c.ok) return false;
+
+    // Files with data take the unpacked streams in order, folder by folder
+    std::vector<std::vector<SevenZipMemberRef>> by_folder(streams.folders.size());
+    size_t folder = 0, in_folder = 0, stream = 0;
+    uint64_t offset = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!files[i].has_stream) continue;
+        while (folder < streams.folders.size() && in_folder == streams.streams_per_folder[folder]) {
+            folder++;
+            in_folder = 0;
+            offset = 0;
+        }
+        if (folder == streams.folders.size() || stream == streams.stream_sizes.size()) return false;
+        uint64_t size = streams.stream_sizes[stream++];
+        if (size > 0 && offset < ARCHIVE_SOLID_SKIP_LIMIT) by_folder[folder].push_back({ i, offset, size });
+        offset += size;
+        in_folder++;
+    }
+
+    // A folder holding one file decodes like a zip member. In a solid folder
+    // reaching a member means decoding everything before it, so one pass
+    // takes every member's deep header at once instead of restarting.
+    std::vector<uint8_t> buffer;
+    for (size_t f = 0; f < by_folder.size(); f++) {
+        const auto& refs = by_folder[f];
+        const SevenZipFolder& folder_info = streams.folders[f];
+        if (refs.empty() || !folder_info.supported) continue;
+
+        if (refs.size() == 1 && refs[0].offset == 0) {
+            ArchiveMember member;
+            member.name = files[refs[0].file].name;
+            member.identity = {};
+            auto decode = [&](uint8_t* out, size_t capacity, size_t* produced) {
+                return DecodeSevenZipFolder(file, folder_info, out, capacity, produced);
+            };
+            if (IdentifyPrefix(refs[0].size, decode, &member.identity)) members->push_back(std::move(member));
+            continue;
+        }
+
+        uint64_t limit = 0;
+        for (const auto& ref : refs) {
+            uint64_t want = ref.size >= IDENTIFY_DEEP_MIN_FILE_SIZE ? IDENTIFY_DEEP_HEADER_SIZE : IDENTIFY_HEADER_SIZE;
+            limit = (std::max)(limit, ref.offset + (std::min)(ref.size, want));
+        }
+        buffer.resize((size_t)limit);
+        size_t decoded = 0;
+        DecodeSevenZipFolder(file, folder_info, buffer.data(), buffer.size(), &decoded);
+
+        for (const auto& ref : refs) {
+            if (ref.offset >= decoded) continue;
+            ArchiveMember member;
+            member.name = files[ref.file].name;
+            member.identity = {};
+            size_t available = (size_t)(std::min)(ref.size, (uint64_t)(decoded - ref.offset));
+            if (!identify_from_header(buffer.data() + ref.offset, available, &member.identity)) continue;
+            member.identity.file_size = ref.size;
+            members->push_back(std::move(member));
+        }
+    }
+    return true;
+}
+
+bool IdentifyArchiveMembers(const std::string& path, ArchiveType type, std::vector<ArchiveMember>* members) {
+    members->clear();
+    RandomAccessFile file;
+    if (type == ArchiveType::None || !file.Open(path)) return false;
+    bool ok = type == ArchiveType::Zip ? IdentifyZipMembers(file, members) : IdentifySevenZipMembers(file, members);
+    if (!ok) members->clear();
+    return ok;
+}
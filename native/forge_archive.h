@@ -0,0 +1,50 @@
+#ifndef FORGE_ARCHIVE_H
+#define FORGE_ARCHIVE_H
+
+#include "platform_identifier.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Games inside zip and 7z archives, identified without extracting them.
+//
+// Only the archive directory is parsed and only the first bytes of each
+// member are decompressed (IDENTIFY_HEADER_SIZE, or
+// IDENTIFY_DEEP_HEADER_SIZE when the first sector matched nothing), so a
+// multi-GB archive costs a few KB of inflate/LZMA work per member.
+//
+// Supported: zip stored/deflate/LZMA members (ZIP64 included) and 7z
+// folders with a single Copy, LZMA or LZMA2 coder. Encrypted members, other
+// methods and filter chains (BCJ, ...) are skipped. In a solid 7z folder
+// members are decoded in order, so only those starting within
+// ARCHIVE_SOLID_SKIP_LIMIT of the folder start are identified.
+constexpr uint64_t ARCHIVE_SOLID_SKIP_LIMIT = 16 * 1024 * 1024;
+
+// Joins a container path and a member name into one path for scan results.
+// A NUL cannot occur in a file name, so the result never names a real file.
+constexpr char ARCHIVE_MEMBER_SEPARATOR = '\0';
+
+enum class ArchiveType { None, Zip, SevenZip };
+
+struct ArchiveMember {
+    std::string name;           // Path within the archive, '/'-separated
+    GameIdentity identity;      // file_size is the uncompressed size
+};
+
+// Archive type from the file's first bytes
+ArchiveType DetectArchive(const uint8_t* header, size_t header_size);
+ArchiveType DetectArchiveFile(const std::string& path);
+
+// .zip or .7z (any case)
+bool ArchiveFileName(const std::string& path);
+
+// Every member of the archive that holds a recognised game. False if the
+// archive directory could not be read (members is then empty).
+bool IdentifyArchiveMembers(const std::string& path, ArchiveType type, std::vector<ArchiveMember>* members);
+
+std::string ArchiveMemberPath(const std::string& archive, const std::string& member);
+
+// Splits a path made by ArchiveMemberPath; false for a plain file path
+bool SplitArchiveMemberPath(const std::string& path, std::string* archive, std::string* member);
+
+#endif // FORGE_ARCHIVE_H
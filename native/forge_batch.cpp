@@ -0,0 +1,185 @@
+#include "forge_batch.h"
+#include "forge_cache.h"
+#include "forge_dat.h"
+#include "forge_device.h"
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// Caps hashing work at one file per core across all devices
+class CpuSlots {
+public:
+    explicit CpuSlots(unsigned count) : available(count) {}
+
+    void Acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return available > 0; });
+        available--;
+    }
+
+    void Release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            available++;
+        }
+        cv.notify_one();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    unsigned available;
+};
+
+struct DeviceQueue {
+    StorageDevice device;
+    std::vector<std::string> files;
+    std::atomic<size_t> next{0};
+};
+
+static std::vector<std::string> ExpandPaths(const std::vector<std::string>& paths, const std::atomic<bool>* cancel) {
+    std::vector<std::string> files;
+    std::set<std::string> seen;
+    FingerprintCache& cache = FingerprintCache::Shared();
+
+    for (const auto& path : paths) {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec)) {
+            if (seen.insert(path).second) files.push_back(path);
+            continue;
+        }
+        for (fs::recursive_directory_iterator it(path, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            if (cancel && cancel->load()) return files;
+            if (!it->is_regular_file(ec)) continue;
+            std::string file = it->path().string();
+            // Unchanged files are identified from the cache without being opened
+            if (cache.Identify(file, nullptr) && seen.insert(file).second) files.push_back(file);
+        }
+    }
+    return files;
+}
+
+static BatchVerifier::FileResult VerifyOne(const std::string& path, const std::string& device_id,
+                                           BatchVerifier::Mode mode, const std::atomic<bool>* cancel) {
+    using Mode = BatchVerifier::Mode;
+    using Status = BatchVerifier::Status;
+
+    BatchVerifier::FileResult result;
+    result.path = path;
+    result.device = device_id;
+
+    if (mode != Mode::Full) {
+        result.quick = QuickVerifier::Verify(path);
+        result.quick_ran = true;
+        if (!result.quick.supported && result.quick.first_failure == "File unreadable") {
+            result.status = Status::Error;
+            result.error = result.quick.first_failure;
+            return result;
+        }
+        if (mode == Mode::Quick || !result.quick.Suspicious()) {
+            result.status = result.quick.Suspicious() ? Status::Suspicious : Status::Healthy;
+            return result;
+        }
+    }
+
+    result.hashes = FingerprintCache::Shared().Hash(path, HASH_CRC32 | HASH_SHA1, nullptr, cancel);
+    if (!result.hashes.ok) {
+        result.status = Status::Error;
+        result.error = (cancel && cancel->load()) ? "Cancelled" : "Read failed";
+        return result;
+    }
+
+    DatMatch match;
+    if (DatIndex::Shared().Find(result.hashes, &match)) {
+        result.status = Status::Verified;
+        result.dat_name = match.name;
+    } else {
+        // Triage only hashes files that already failed the quick check
+        result.status = result.quick_ran ? Status::Suspicious : Status::Unknown;
+    }
+    return result;
+}
+
+BatchVerifier::Summary BatchVerifier::Run(const std::vector<std::string>& paths, Mode mode,
+                                          const ResultFn& on_result, const std::atomic<bool>* cancel) {
+    Summary summary;
+    std::vector<std::string> files = ExpandPaths(paths, cancel);
+    summary.files = files.size();
+
+    // One queue per physical device
+    std::vector<std::unique_ptr<DeviceQueue>> queues;
+    std::map<std::string, size_t> by_device;
+    for (const auto& file : files) {
+        StorageDevice device = DeviceForPath(file);
+        auto it = by_device.find(device.id);
+        if (it == by_device.end()) {
+            it = by_device.emplace(device.id, queues.size()).first;
+            queues.push_back(std::make_unique<DeviceQueue>());
+            queues.back()->device = device;
+        }
+        queues[it->second]->files.push_back(file);
+    }
+
+    CpuSlots slots((std::max)(1u, std::thread::hardware_concurrency()));
+    std::mutex result_mutex;
+    size_t done = 0;
+
+    auto worker = [&](DeviceQueue* queue) {
+        while (!(cancel && cancel->load())) {
+            size_t index = queue->next.fetch_add(1);
+            if (index >= queue->files.size()) break;
+
+            slots.Acquire();
+            FileResult result = VerifyOne(queue->files[index], queue->device.id, mode, cancel);
+            slots.Release();
+
+            std::lock_guard<std::mutex> lock(result_mutex);
+            done++;
+            switch (result.status) {
+            case Status::Healthy: summary.healthy++; break;
+            case Status::Verified: summary.verified++; break;
+            case Status::Unknown: summary.unknown++; break;
+            case Status::Suspicious: summary.suspicious++; break;
+            case Status::Error: summary.errors++; break;
+            }
+            if (on_result) on_result(result, done, files.size());
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (auto& queue : queues) {
+        size_t workers = (std::min)((size_t)queue->device.Concurrency(), queue->files.size());
+        for (size_t i = 0; i < workers; i++) pool.emplace_back(worker, queue.get());
+    }
+    for (auto& t : pool) t.join();
+
+    FingerprintCache::Shared().Save();
+    summary.cancelled = cancel && cancel->load();
+    return summary;
+}
+
+const char* BatchVerifier::StatusName(Status status) {
+    switch (status) {
+    case Status::Healthy: return "healthy";
+    case Status::Verified: return "verified";
+    case Status::Unknown: return "unknown";
+    case Status::Suspicious: return "suspicious";
+    default: return "error";
+    }
+}
+
+bool BatchVerifier::ParseMode(const std::string& name, Mode* mode) {
+    if (name == "quick") *mode = Mode::Quick;
+    else if (name == "full") *mode = Mode::Full;
+    else if (name == "triage") *mode = Mode::Triage;
+    else return false;
+    return true;
+}
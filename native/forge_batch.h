@@ -0,0 +1,64 @@
+#ifndef FORGE_BATCH_H
+#define FORGE_BATCH_H
+
+#include "forge_hash.h"
+#include "forge_quick.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Verifies many files at once with concurrency bounded per physical device:
+// every SSD gets one worker per core, every spinning disk or USB/SD device
+// gets a single sequential stream.
+class BatchVerifier {
+public:
+    enum class Mode {
+        Quick,      // QuickVerifier only
+        Full,       // CRC32 + SHA-1 (fingerprint cache) and DAT lookup
+        Triage,     // Quick first, full hash only for suspicious files
+    };
+
+    enum class Status {
+        Healthy,    // Quick check passed (no full hash run)
+        Verified,   // Full hash matches a DAT entry
+        Unknown,    // Hashed, but not in the DAT index
+        Suspicious, // Quick check failed and no DAT entry vouches for the file
+        Error,      // Unreadable
+    };
+
+    struct FileResult {
+        std::string path;
+        std::string device;
+        Status status = Status::Error;
+        QuickVerifyResult quick;
+        bool quick_ran = false;
+        HashResult hashes;
+        std::string dat_name;
+        std::string error;
+    };
+
+    struct Summary {
+        size_t files = 0;
+        size_t healthy = 0;
+        size_t verified = 0;
+        size_t unknown = 0;
+        size_t suspicious = 0;
+        size_t errors = 0;
+        bool cancelled = false;
+    };
+
+    // Called from worker threads as each file finishes
+    using ResultFn = std::function<void(const FileResult&, size_t done, size_t total)>;
+
+    // Directories are expanded recursively to the files identify_from_file
+    // recognises. Blocks until every file is done or cancel is set.
+    static Summary Run(const std::vector<std::string>& paths, Mode mode, const ResultFn& on_result,
+                       const std::atomic<bool>* cancel = nullptr);
+
+    static const char* StatusName(Status status);
+    static bool ParseMode(const std::string& name, Mode* mode);
+};
+
+#endif // FORGE_BATCH_H
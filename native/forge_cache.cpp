@@ -0,0 +1,381 @@
+#include "forge_cache.h"
+#include "forge_io.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// ============================================================================
+// On-disk layout (little-endian, native struct packing)
+//
+//   CacheFileHeader
+//   { CacheDiskRecord, path bytes[path_length] } * record_count
+//
+// identity_size pins the GameIdentity layout; a build with a different
+// layout discards the cache instead of misreading it.
+// ============================================================================
+
+static constexpr uint32_t CACHE_MAGIC = 0x43504646;   // "FFPC"
+static constexpr uint32_t CACHE_VERSION = 3;
+static constexpr uint32_t CACHE_MAX_PATH = 32 * 1024;
+
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t identity_size;
+    uint32_t record_count;
+};
+
+struct CacheDiskRecord {
+    uint64_t device;
+    uint64_t file_id;
+    uint64_t size;
+    int64_t mtime_ns;
+    uint32_t flags;
+    uint32_t hash_kinds;
+    uint32_t crc32;
+    uint32_t path_length;
+    uint8_t md5[16];
+    uint8_t sha1[20];
+    GameIdentity identity;
+};
+
+static constexpr uint32_t RECORD_IDENTITY_KNOWN = 1;
+static constexpr uint32_t RECORD_IDENTIFIED = 2;
+
+bool StatFileKey(const std::string& path, FileKey* key) {
+#ifdef _WIN32
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    if (wlen <= 0) return false;
+    std::wstring wpath(wlen, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wpath.data(), wlen);
+
+    // Attribute-only access: the file data is never opened
+    HANDLE h = CreateFileW(wpath.c_str(), FILE_READ_ATTRIBUTES,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                           OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(h, &info);
+    CloseHandle(h);
+    if (!ok) return false;
+
+    key->device = info.dwVolumeSerialNumber;
+    key->file_id = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    key->size = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    uint64_t ticks = ((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+    key->mtime_ns = (int64_t)(ticks * 100);
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    key->device = (uint64_t)st.st_dev;
+    key->file_id = (uint64_t)st.st_ino;
+    key->size = (uint64_t)st.st_size;
+#if defined(__APPLE__)
+    key->mtime_ns = (int64_t)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    key->mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+#endif
+    return true;
+}
+
+bool StatFolderKey(const std::string& folder, FileKey* key) {
+    FileKey meta, part;
+    fs::path root(folder);
+    if (!StatFileKey(folder, key) || !StatFileKey((root / "meta" / "meta.xml").string(), &meta)) return false;
+    key->size = meta.size;
+    key->mtime_ns = (std::max)(key->mtime_ns, meta.mtime_ns);
+    for (const char* sub : { "code", "content" }) {
+        if (!StatFileKey((root / sub).string(), &part)) return false;
+        key->mtime_ns = (std::max)(key->mtime_ns, part.mtime_ns);
+    }
+    return true;
+}
+
+// ============================================================================
+// Persistence
+// ============================================================================
+
+bool FingerprintCache::Open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache_path = path;
+    records.clear();
+    paths.clear();
+    dirty = false;
+
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return true; // First run
+
+    CacheFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              header.magic == CACHE_MAGIC && header.version == CACHE_VERSION &&
+              header.identity_size == sizeof(GameIdentity);
+
+    for (uint32_t i = 0; ok && i < header.record_count; i++) {
+        CacheDiskRecord disk;
+        if (fread(&disk, sizeof(disk), 1, f) != 1 || disk.path_length == 0 ||
+            disk.path_length > CACHE_MAX_PATH) {
+            ok = false;
+            break;
+        }
+        std::string file_path(disk.path_length, '\0');
+        if (fread(&file_path[0], 1, disk.path_length, f) != disk.path_length) {
+            ok = false;
+            break;
+        }
+
+        Entry entry;
+        entry.path = file_path;
+        FingerprintRecord& record = entry.record;
+        record.key.device = disk.device;
+        record.key.file_id = disk.file_id;
+        record.key.size = disk.size;
+        record.key.mtime_ns = disk.mtime_ns;
+        record.identity_known = (disk.flags & RECORD_IDENTITY_KNOWN) != 0;
+        record.identified = (disk.flags & RECORD_IDENTIFIED) != 0;
+        record.identity = disk.identity;
+        record.hash_kinds = disk.hash_kinds & (uint32_t)HASH_ALL;
+        record.crc32 = disk.crc32;
+        memcpy(record.md5, disk.md5, sizeof(record.md5));
+        memcpy(record.sha1, disk.sha1, sizeof(record.sha1));
+
+        IdKey id = { disk.device, disk.file_id };
+        paths[file_path] = id;
+        records[id] = std::move(entry);
+    }
+    fclose(f);
+
+    if (!ok) {
+        // Corrupt or from an incompatible build: start over
+        records.clear();
+        paths.clear();
+        dirty = true;
+    }
+    return ok;
+}
+
+bool FingerprintCache::Save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!dirty || cache_path.empty()) return true;
+
+    CacheFileHeader header = { CACHE_MAGIC, CACHE_VERSION, (uint32_t)sizeof(GameIdentity),
+                               (uint32_t)records.size() };
+
+    bool written = WriteFileAtomically(cache_path, [&](FILE* f) {
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        for (const auto& pair : records) {
+            if (!ok) break;
+            const Entry& entry = pair.second;
+            const FingerprintRecord& record = entry.record;
+
+            CacheDiskRecord disk;
+            memset(&disk, 0, sizeof(disk));
+            disk.device = record.key.device;
+            disk.file_id = record.key.file_id;
+            disk.size = record.key.size;
+            disk.mtime_ns = record.key.mtime_ns;
+            disk.flags = (record.identity_known ? RECORD_IDENTITY_KNOWN : 0) |
+                         (record.identified ? RECORD_IDENTIFIED : 0);
+            disk.hash_kinds = record.hash_kinds;
+            disk.crc32 = record.crc32;
+            disk.path_length = (uint32_t)entry.path.size();
+            memcpy(disk.md5, record.md5, sizeof(disk.md5));
+            memcpy(disk.sha1, record.sha1, sizeof(disk.sha1));
+            disk.identity = record.identity;
+
+            ok = fwrite(&disk, sizeof(disk), 1, f) == 1 &&
+                 fwrite(entry.path.data(), 1, entry.path.size(), f) == entry.path.size();
+        }
+        return ok;
+    });
+    if (!written) return false;
+    dirty = false;
+    return true;
+}
+
+void FingerprintCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    dirty = dirty || !records.empty();
+    records.clear();
+    paths.clear();
+}
+
+size_t FingerprintCache::Count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return records.size();
+}
+
+// ============================================================================
+// Lookup
+// ============================================================================
+
+FingerprintCache::Entry* FingerprintCache::Find(const std::string& path, const FileKey& key) {
+    auto it = records.find(IdKey{ key.device, key.file_id });
+    if (it != records.end()) {
+        return it->second.record.key.SameContent(key) ? &it->second : nullptr;
+    }
+
+    // Volume remounted under a new device number (or file IDs are not stable,
+    // as on FAT): fall back to the path
+    auto path_it = paths.find(path);
+    if (path_it == paths.end()) return nullptr;
+    it = records.find(path_it->second);
+    if (it == records.end() || !it->second.record.key.SameContent(key)) return nullptr;
+    return &it->second;
+}
+
+FingerprintCache::Entry& FingerprintCache::Upsert(const std::string& path, const FileKey& key) {
+    IdKey id = { key.device, key.file_id };
+    Entry* existing = Find(path, key);
+
+    Entry entry;
+    if (existing) {
+        entry = std::move(*existing);
+        IdKey old_id = { entry.record.key.device, entry.record.key.file_id };
+        if (!(old_id == id)) records.erase(old_id);
+    }
+
+    // Drop whatever the path pointed at before if it is a different file now
+    auto path_it = paths.find(path);
+    if (path_it != paths.end() && !(path_it->second == id)) {
+        auto stale = records.find(path_it->second);
+        if (stale != records.end() && stale->second.path == path) records.erase(stale);
+    }
+
+    entry.path = path;
+    entry.record.key = key;
+    paths[path] = id;
+    dirty = true;
+    Entry& slot = records[id];
+    slot = std::move(entry);
+    return slot;
+}
+
+bool FingerprintCache::Lookup(const std::string& path, const FileKey& key, FingerprintRecord* record) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry* entry = Find(path, key);
+    if (!entry) return false;
+    if (record) *record = entry->record;
+    return true;
+}
+
+void FingerprintCache::StoreIdentity(const std::string& path, const FileKey& key,
+                                     const GameIdentity* identity, bool identified) {
+    std::lock_guard<std::mutex> lock(mutex);
+    FingerprintRecord& record = Upsert(path, key).record;
+    record.identity_known = true;
+    record.identified = identified;
+    if (identity) record.identity = *identity;
+}
+
+void FingerprintCache::StoreHashes(const std::string& path, const FileKey& key, const HashResult& hashes) {
+    if (!hashes.ok || hashes.bytes_hashed != key.size) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    FingerprintRecord& record = Upsert(path, key).record;
+    if (hashes.kinds & HASH_CRC32) record.crc32 = hashes.crc32;
+    if (hashes.kinds & HASH_MD5) memcpy(record.md5, hashes.md5.data(), 16);
+    if (hashes.kinds & HASH_SHA1) memcpy(record.sha1, hashes.sha1.data(), 20);
+    record.hash_kinds |= hashes.kinds;
+}
+
+// ============================================================================
+// Cached operations
+// ============================================================================
+
+bool FingerprintCache::Identify(const std::string& path, GameIdentity* identity) {
+    FileKey key;
+    bool have_key = StatFileKey(path, &key);
+    if (have_key) {
+        FingerprintRecord record;
+        if (Lookup(path, key, &record) && record.identity_known) {
+            if (identity) *identity = record.identity;
+            return record.identified;
+        }
+    }
+
+    GameIdentity local;
+    memset(&local, 0, sizeof(local));
+    bool identified = identify_from_file(path.c_str(), &local);
+    // Negative results are cached too, so non-game files are not reopened
+    if (have_key) StoreIdentity(path, key, &local, identified);
+    if (identity) *identity = local;
+    return identified;
+}
+
+bool FingerprintCache::IdentifyFolder(const std::string& path, GameIdentity* identity, FileKey* key) {
+    FileKey local_key;
+    bool have_key = StatFolderKey(path, &local_key);
+    if (key) *key = local_key;
+    if (have_key) {
+        FingerprintRecord record;
+        if (Lookup(path, local_key, &record) && record.identity_known) {
+            if (identity) *identity = record.identity;
+            return record.identified;
+        }
+    }
+    return ReadFolder(path, have_key ? &local_key : nullptr, identity);
+}
+
+bool FingerprintCache::RefreshFolder(const std::string& path, GameIdentity* identity) {
+    FileKey key;
+    return ReadFolder(path, StatFolderKey(path, &key) ? &key : nullptr, identity);
+}
+
+bool FingerprintCache::ReadFolder(const std::string& path, const FileKey* key, GameIdentity* identity) {
+    GameIdentity local;
+    memset(&local, 0, sizeof(local));
+    bool identified = identify_wiiu_folder(path.c_str(), &local);
+    if (key) StoreIdentity(path, *key, &local, identified);
+    if (identity) *identity = local;
+    return identified;
+}
+
+HashResult FingerprintCache::Hash(const std::string& path, uint32_t kinds,
+                                  const HashEngine::ProgressFn& progress,
+                                  const std::atomic<bool>* cancel) {
+    kinds &= (uint32_t)HASH_ALL;
+    FileKey key;
+    bool have_key = StatFileKey(path, &key);
+    if (have_key) {
+        FingerprintRecord record;
+        if (Lookup(path, key, &record) && kinds && (record.hash_kinds & kinds) == kinds) {
+            HashResult result;
+            result.ok = true;
+            result.kinds = record.hash_kinds;
+            result.bytes_hashed = key.size;
+            result.crc32 = record.crc32;
+            memcpy(result.md5.data(), record.md5, 16);
+            memcpy(result.sha1.data(), record.sha1, 20);
+            if (progress) progress(key.size, key.size);
+            return result;
+        }
+    }
+
+    HashResult result = HashEngine::HashFile(path, kinds, progress, cancel);
+
+    // Only trust the digests if the file did not change while it was read
+    FileKey after;
+    if (have_key && result.ok && StatFileKey(path, &after) &&
+        after.device == key.device && after.file_id == key.file_id && after.SameContent(key)) {
+        StoreHashes(path, key, result);
+    }
+    return result;
+}
+
+FingerprintCache& FingerprintCache::Shared() {
+    static FingerprintCache instance;
+    return instance;
+}
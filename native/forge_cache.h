@@ -0,0 +1,115 @@
+#ifndef FORGE_CACHE_H
+#define FORGE_CACHE_H
+
+#include "forge_hash.h"
+#include "platform_identifier.h"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+// Identity of a file on disk as reported by stat(), without opening it for
+// reading. Two keys are equal only if the file has not been replaced,
+// resized or rewritten.
+struct FileKey {
+    uint64_t device = 0;
+    uint64_t file_id = 0;        // inode / NTFS file index
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+
+    bool SameContent(const FileKey& other) const {
+        return size == other.size && mtime_ns == other.mtime_ns;
+    }
+};
+
+// Fill key from file metadata; false if the path does not exist
+bool StatFileKey(const std::string& path, FileKey* key);
+
+// Key for a Wii U title folder: the folder's device/file ID, the size of
+// meta/meta.xml and the newest mtime of meta.xml, code/ and content/. Files
+// added to or removed from those directories change it; a content file
+// rewritten in place does not.
+bool StatFolderKey(const std::string& folder, FileKey* key);
+
+// Everything forge_core has learned about one file
+struct FingerprintRecord {
+    FileKey key;
+    bool identity_known = false;  // identify_from_file has run
+    bool identified = false;      // ...and recognised a game
+    GameIdentity identity;
+    uint32_t hash_kinds = 0;      // HashKind flags present below
+    uint32_t crc32 = 0;
+    uint8_t md5[16] = {};
+    uint8_t sha1[20] = {};
+};
+
+// Persistent cache of identification and hash results keyed by
+// (device, file ID) and validated against size + mtime. A hit means the
+// file contents are not touched at all. If the volume is remounted and its
+// device/file IDs change, the path is used as a fallback key.
+class FingerprintCache {
+public:
+    // Load records from disk (missing file = empty cache) and remember the
+    // path for Save(). Without Open() the cache is in-memory only.
+    bool Open(const std::string& cache_path);
+    // Write the cache back if anything changed (atomic replace)
+    bool Save();
+    void Clear();
+    size_t Count() const;
+
+    bool Lookup(const std::string& path, const FileKey& key, FingerprintRecord* record);
+
+    // identify_from_file, served from the cache when the file is unchanged
+    bool Identify(const std::string& path, GameIdentity* identity);
+
+    // identify_wiiu_folder, served from the cache while StatFolderKey is
+    // unchanged (a hit skips meta.xml and the content/ walk). key, if given,
+    // receives the folder key.
+    bool IdentifyFolder(const std::string& path, GameIdentity* identity, FileKey* key = nullptr);
+    // The same, but always re-reads the title and replaces the record: for
+    // callers that know a file inside content/ changed, which the folder key
+    // does not see
+    bool RefreshFolder(const std::string& path, GameIdentity* identity);
+
+    // HashEngine::HashFile, skipped when every requested digest is cached
+    HashResult Hash(const std::string& path, uint32_t kinds,
+                    const HashEngine::ProgressFn& progress = nullptr,
+                    const std::atomic<bool>* cancel = nullptr);
+
+    // Record results computed elsewhere
+    void StoreIdentity(const std::string& path, const FileKey& key, const GameIdentity* identity, bool identified);
+    void StoreHashes(const std::string& path, const FileKey& key, const HashResult& hashes);
+
+    static FingerprintCache& Shared();
+
+private:
+    struct IdKey {
+        uint64_t device;
+        uint64_t file_id;
+        bool operator==(const IdKey& o) const { return device == o.device && file_id == o.file_id; }
+    };
+    struct IdKeyHash {
+        size_t operator()(const IdKey& k) const {
+            return std::hash<uint64_t>()(k.device * 0x9E3779B97F4A7C15ULL ^ k.file_id);
+        }
+    };
+
+    struct Entry {
+        std::string path;
+        FingerprintRecord record;
+    };
+
+    // Record for the file if it is unchanged since it was cached
+    Entry* Find(const std::string& path, const FileKey& key);
+    Entry& Upsert(const std::string& path, const FileKey& key);
+    // identify_wiiu_folder, stored under key when there is one
+    bool ReadFolder(const std::string& path, const FileKey* key, GameIdentity* identity);
+
+    mutable std::mutex mutex;
+    std::string cache_path;
+    std::unordered_map<IdKey, Entry, IdKeyHash> records;
+    std::unordered_map<std::string, IdKey> paths;
+    bool dirty = false;
+};
+
+#endif // FORGE_CACHE_H
@@ -0,0 +1,705 @@
+#include "forge_catalog.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define FORGE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Space, a-z, 0-9
+static constexpr uint32_t CATALOG_SYMBOLS = 37;
+static constexpr uint32_t CATALOG_TRIGRAMS = CATALOG_SYMBOLS * CATALOG_SYMBOLS * CATALOG_SYMBOLS;
+
+static inline uint32_t Symbol(char c) {
+    if (c >= 'a' && c <= 'z') return (uint32_t)(c - 'a') + 1;
+    if (c >= '0' && c <= '9') return (uint32_t)(c - '0') + 27;
+    return 0;
+}
+
+static inline uint32_t TrigramAt(const char* p) {
+    return (Symbol(p[0]) * CATALOG_SYMBOLS + Symbol(p[1])) * CATALOG_SYMBOLS + Symbol(p[2]);
+}
+
+// Trigrams of " text ", each once, in order of first appearance
+static void Trigrams(std::string_view text, std::vector<uint32_t>* out) {
+    out->clear();
+    if (text.empty()) return;
+    std::string padded;
+    padded.reserve(text.size() + 2);
+    padded.push_back(' ');
+    padded.append(text);
+    padded.push_back(' ');
+    for (size_t i = 0; i + 3 <= padded.size(); i++) {
+        uint32_t trigram = TrigramAt(padded.data() + i);
+        if (std::find(out->begin(), out->end(), trigram) == out->end()) out->push_back(trigram);
+    }
+}
+
+static void PutVarint(uint32_t value, uint8_t* out, size_t* at) {
+    while (value >= 0x80) {
+        out[(*at)++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[(*at)++] = (uint8_t)value;
+}
+
+static size_t VarintSize(uint32_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static std::string Lower(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) {
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    }
+    return out;
+}
+
+std::string CatalogIndex::Normalize(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    bool space = false;
+    for (char c : text) {
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+            if (space && !out.empty()) out.push_back(' ');
+            space = false;
+            out.push_back(c);
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+            space = true;
+        }
+    }
+    return out;
+}
+
+// ============================================================================
+// Catalog file
+// ============================================================================
+
+static void AppendVarint(uint32_t value, std::vector<uint8_t>* out) {
+    while (value >= 0x80) {
+        out->push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back((uint8_t)value);
+}
+
+static bool ReadVarint(const uint8_t** p, const uint8_t* end, uint32_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*p >= end) return false;
+        uint8_t byte = *(*p)++;
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool CatalogFile::Write(std::vector<Entry> entries, const std::string& catalog_path) {
+    if (entries.size() >= UINT32_MAX) return false;
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        if (a.title != b.title) return a.title < b.title;
+        return a.url < b.url;
+    });
+
+    // Platform, source and format names are a handful of strings shared by
+    // every entry
+    std::map<std::string, uint16_t> interned;
+    std::vector<uint32_t> string_offsets(1, 0);
+    std::string strings;
+    bool too_many = false;
+    auto intern = [&](const std::string& name) -> uint16_t {
+        auto it = interned.find(name);
+        if (it != interned.end()) return it->second;
+        if (interned.size() >= UINT16_MAX) {
+            too_many = true;
+            return 0;
+        }
+        uint16_t number = (uint16_t)interned.size();
+        interned.emplace(name, number);
+        strings += name;
+        string_offsets.push_back((uint32_t)strings.size());
+        return number;
+    };
+
+    size_t n = entries.size();
+    std::vector<uint32_t> title_blocks;
+    std::vector<uint8_t> titles;
+    std::vector<uint64_t> sizes(n);
+    std::vector<uint32_t> url_offsets;
+    url_offsets.reserve(n + 1);
+    std::string urls;
+    std::vector<uint16_t> platforms(n), sources(n), formats(n);
+    for (size_t i = 0; i < n; i++) {
+        const Entry& entry = entries[i];
+        size_t shared = 0;
+        if (i % CATALOG_BLOCK_TITLES == 0) {
+            title_blocks.push_back((uint32_t)titles.size());
+        } else {
+            const std::string& previous = entries[i - 1].title;
+            size_t limit = (std::min)(previous.size(), entry.title.size());
+            while (shared < limit && previous[shared] == entry.title[shared]) shared++;
+            AppendVarint((uint32_t)shared, &titles);
+        }
+        AppendVarint((uint32_t)(entry.title.size() - shared), &titles);
+        titles.insert(titles.end(), entry.title.begin() + shared, entry.title.end());
+
+        sizes[i] = entry.size;
+        url_offsets.push_back((uint32_t)urls.size());
+        urls += entry.url;
+        platforms[i] = intern(entry.platform);
+        sources[i] = intern(entry.source);
+        formats[i] = intern(entry.format);
+        if (titles.size() > UINT32_MAX || urls.size() > UINT32_MAX || strings.size() > UINT32_MAX) return false;
+    }
+    url_offsets.push_back((uint32_t)urls.size());
+    if (too_many) return false;
+
+    CatalogFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CATALOG_MAGIC;
+    header.version = CATALOG_VERSION;
+    header.entry_count = (uint32_t)n;
+    header.string_count = (uint32_t)interned.size();
+
+    std::vector<uint8_t> image(sizeof(header), 0);
+    auto add = [&](CatalogSection section, const void* data, size_t size) {
+        image.resize((image.size() + 7) & ~(size_t)7, 0);
+        header.sections[section] = { image.size(), size };
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        if (size) image.insert(image.end(), bytes, bytes + size);
+    };
+    add(CATALOG_STRING_OFFSETS, string_offsets.data(), string_offsets.size() * sizeof(uint32_t));
+    add(CATALOG_STRINGS, strings.data(), strings.size());
+    add(CATALOG_TITLE_BLOCKS, title_blocks.data(), title_blocks.size() * sizeof(uint32_t));
+    add(CATALOG_TITLES, titles.data(), titles.size());
+    add(CATALOG_SIZES, sizes.data(), sizes.size() * sizeof(uint64_t));
+    add(CATALOG_URL_OFFSETS, url_offsets.data(), url_offsets.size() * sizeof(uint32_t));
+    add(CATALOG_URLS, urls.data(), urls.size());
+    add(CATALOG_PLATFORMS, platforms.data(), platforms.size() * sizeof(uint16_t));
+    add(CATALOG_SOURCES, sources.data(), sources.size() * sizeof(uint16_t));
+    add(CATALOG_FORMATS, formats.data(), formats.size() * sizeof(uint16_t));
+    memcpy(image.data(), &header, sizeof(header));
+    return WriteFileAtomically(catalog_path, image.data(), image.size());
+}
+
+// Only the shape of the file is checked here; offsets inside the sections
+// are checked as entries are read
+bool CatalogFile::Load(const std::string& catalog_path) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    header = nullptr;
+    mapping.Close();
+    if (!mapping.Open(catalog_path)) return false;
+
+    const uint8_t* base = mapping.Data();
+    size_t size = mapping.Size();
+    const CatalogFileHeader* h = reinterpret_cast<const CatalogFileHeader*>(base);
+    bool valid = size >= sizeof(CatalogFileHeader) && h->magic == CATALOG_MAGIC && h->version == CATALOG_VERSION;
+    for (size_t s = 0; valid && s < CATALOG_SECTION_COUNT; s++) {
+        const CatalogFileSection& section = h->sections[s];
+        valid = section.offset % 8 == 0 && section.offset <= size && section.size <= size - section.offset;
+    }
+    if (valid) {
+        uint64_t n = h->entry_count;
+        uint64_t blocks = (n + CATALOG_BLOCK_TITLES - 1) / CATALOG_BLOCK_TITLES;
+        auto is_array = [&](CatalogSection s, size_t element, uint64_t count) {
+            return h->sections[s].size == count * element;
+        };
+        valid = is_array(CATALOG_STRING_OFFSETS, sizeof(uint32_t), (uint64_t)h->string_count + 1) &&
+                is_array(CATALOG_TITLE_BLOCKS, sizeof(uint32_t), blocks) &&
+                is_array(CATALOG_SIZES, sizeof(uint64_t), n) &&
+                is_array(CATALOG_URL_OFFSETS, sizeof(uint32_t), n + 1) &&
+                is_array(CATALOG_PLATFORMS, sizeof(uint16_t), n) &&
+                is_array(CATALOG_SOURCES, sizeof(uint16_t), n) &&
+                is_array(CATALOG_FORMATS, sizeof(uint16_t), n);
+    }
+    if (!valid) {
+        mapping.Close();
+        return false;
+    }
+
+    auto at = [&](CatalogSection s) { return base + h->sections[s].offset; };
+    string_offsets = reinterpret_cast<const uint32_t*>(at(CATALOG_STRING_OFFSETS));
+    strings = reinterpret_cast<const char*>(at(CATALOG_STRINGS));
+    title_blocks = reinterpret_cast<const uint32_t*>(at(CATALOG_TITLE_BLOCKS));
+    titles = at(CATALOG_TITLES);
+    titles_size = (size_t)h->sections[CATALOG_TITLES].size;
+    sizes = reinterpret_cast<const uint64_t*>(at(CATALOG_SIZES));
+    url_offsets = reinterpret_cast<const uint32_t*>(at(CATALOG_URL_OFFSETS));
+    urls = reinterpret_cast<const char*>(at(CATALOG_URLS));
+    platforms = reinterpret_cast<const uint16_t*>(at(CATALOG_PLATFORMS));
+    sources = reinterpret_cast<const uint16_t*>(at(CATALOG_SOURCES));
+    formats = reinterpret_cast<const uint16_t*>(at(CATALOG_FORMATS));
+    header = h;
+    return true;
+}
+
+void CatalogFile::Unload() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    header = nullptr;
+    mapping.Close();
+}
+
+bool CatalogFile::IsLoaded() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return header != nullptr;
+}
+
+size_t CatalogFile::Count() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return header ? header->entry_count : 0;
+}
+
+std::string_view CatalogFile::String(uint16_t number) const {
+    if (number >= header->string_count) return {};
+    uint32_t start = string_offsets[number], end = string_offsets[number + 1];
+    if (start > end || end > header->sections[CATALOG_STRINGS].size) return {};
+    return std::string_view(strings + start, end - start);
+}
+
+std::string_view CatalogFile::DecodeTitle(size_t index, std::string* buffer) const {
+    size_t block = index / CATALOG_BLOCK_TITLES;
+    size_t blocks = (header->entry_count + CATALOG_BLOCK_TITLES - 1) / CATALOG_BLOCK_TITLES;
+    size_t start = title_blocks[block];
+    size_t end = block + 1 < blocks ? title_blocks[block + 1] : titles_size;
+    buffer->clear();
+    if (start > end || end > titles_size) return {};
+
+    const uint8_t* p = titles + start;
+    const uint8_t* limit = titles + end;
+    for (size_t i = block * CATALOG_BLOCK_TITLES; i <= index; i++) {
+        uint32_t shared = 0, suffix = 0;
+        bool ok = (i % CATALOG_BLOCK_TITLES == 0 || ReadVarint(&p, limit, &shared)) && ReadVarint(&p, limit, &suffix) &&
+                  shared <= buffer->size() && suffix <= (size_t)(limit - p);
+        if (!ok) {
+            buffer->clear();
+            return {};
+        }
+        buffer->resize(shared);
+        buffer->append(reinterpret_cast<const char*>(p), suffix);
+        p += suffix;
+    }
+    return *buffer;
+}
+
+CatalogFile::EntryView CatalogFile::View(size_t index, std::string_view title) const {
+    EntryView entry;
+    entry.title = title;
+    uint32_t start = url_offsets[index], end = url_offsets[index + 1];
+    if (start <= end && end <= header->sections[CATALOG_URLS].size) entry.url = std::string_view(urls + start, end - start);
+    entry.size = sizes[index];
+    entry.platform = String(platforms[index]);
+    entry.source = String(sources[index]);
+    entry.format = String(formats[index]);
+    return entry;
+}
+
+bool CatalogFile::Get(size_t index, Entry* entry) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (!header || index >= header->entry_count) return false;
+    std::string title;
+    EntryView view = View(index, DecodeTitle(index, &title));
+    if (entry) {
+        entry->title = std::string(view.title);
+        entry->url = std::string(view.url);
+        entry->size = view.size;
+        entry->platform = std::string(view.platform);
+        entry->source = std::string(view.source);
+        entry->format = std::string(view.format);
+    }
+    return true;
+}
+
+void CatalogFile::ForEach(const EntryFn& fn) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (!header) return;
+    std::string title;
+    size_t blocks = (header->entry_count + CATALOG_BLOCK_TITLES - 1) / CATALOG_BLOCK_TITLES;
+    for (size_t block = 0; block < blocks; block++) {
+        size_t start = title_blocks[block];
+        size_t end = block + 1 < blocks ? title_blocks[block + 1] : titles_size;
+        bool ok = start <= end && end <= titles_size;
+        const uint8_t* p = titles + (ok ? start : 0);
+        const uint8_t* limit = titles + (ok ? end : 0);
+        size_t first = block * CATALOG_BLOCK_TITLES;
+        size_t last = (std::min)(first + CATALOG_BLOCK_TITLES, (size_t)header->entry_count);
+        title.clear();
+        for (size_t i = first; i < last; i++) {
+            uint32_t shared = 0, suffix = 0;
+            ok = ok && (i == first || ReadVarint(&p, limit, &shared)) && ReadVarint(&p, limit, &suffix) &&
+                 shared <= title.size() && suffix <= (size_t)(limit - p);
+            if (ok) {
+                title.resize(shared);
+                title.append(reinterpret_cast<const char*>(p), suffix);
+                p += suffix;
+            } else {
+                title.clear();
+            }
+            fn(i, View(i, title));
+        }
+    }
+}
+
+size_t CatalogFile::LowerBound(std::string_view title) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (!header) return 0;
+    size_t count = header->entry_count;
+    size_t blocks = (count + CATALOG_BLOCK_TITLES - 1) / CATALOG_BLOCK_TITLES;
+
+    // Last block whose first title is below title; the answer is in it or
+    // starts the next one
+    std::string buffer;
+    size_t low = 0, high = blocks;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (DecodeTitle(middle * CATALOG_BLOCK_TITLES, &buffer) < title) low = middle + 1;
+        else high = middle;
+    }
+    if (low == 0) return 0;
+    size_t block = low - 1;
+    size_t last = (std::min)((block + 1) * CATALOG_BLOCK_TITLES, count);
+    for (size_t i = block * CATALOG_BLOCK_TITLES; i < last; i++) {
+        if (DecodeTitle(i, &buffer) >= title) return i;
+    }
+    return last;
+}
+
+CatalogFile& CatalogFile::Shared() {
+    static CatalogFile instance;
+    return instance;
+}
+
+// ============================================================================
+// Indexing
+// ============================================================================
+
+// Platform names become small codes in first-seen order
+class PlatformCodes {
+public:
+    uint16_t Code(std::string_view platform) {
+        std::string name = Lower(platform);
+        auto it = lookup.find(name);
+        if (it != lookup.end()) return it->second;
+        uint16_t code = (uint16_t)(std::min)(names.size(), (size_t)UINT16_MAX - 1);
+        if (names.size() < UINT16_MAX - 1) names.push_back(name);
+        lookup.emplace(std::move(name), code);
+        return code;
+    }
+    std::vector<std::string> names;
+
+private:
+    std::map<std::string, uint16_t> lookup;
+};
+
+void CatalogIndex::Build(const std::vector<Entry>& entries) {
+    std::string new_pool;
+    std::vector<uint32_t> new_title_offsets;
+    std::vector<uint16_t> new_platform_codes;
+    new_title_offsets.reserve(entries.size() + 1);
+    new_platform_codes.reserve(entries.size());
+    PlatformCodes codes;
+    for (const Entry& entry : entries) {
+        new_title_offsets.push_back((uint32_t)new_pool.size());
+        new_pool += Normalize(entry.title);
+        new_platform_codes.push_back(codes.Code(entry.platform));
+    }
+    new_title_offsets.push_back((uint32_t)new_pool.size());
+    Index(std::move(new_pool), std::move(new_title_offsets), std::move(new_platform_codes), std::move(codes.names));
+}
+
+void CatalogIndex::Build(const CatalogFile& file) {
+    std::string new_pool;
+    std::vector<uint32_t> new_title_offsets;
+    std::vector<uint16_t> new_platform_codes;
+    PlatformCodes codes;
+    file.ForEach([&](size_t, const CatalogFile::EntryView& entry) {
+        new_title_offsets.push_back((uint32_t)new_pool.size());
+        new_pool += Normalize(entry.title);
+        new_platform_codes.push_back(codes.Code(entry.platform));
+    });
+    new_title_offsets.push_back((uint32_t)new_pool.size());
+    Index(std::move(new_pool), std::move(new_title_offsets), std::move(new_platform_codes), std::move(codes.names));
+}
+
+void CatalogIndex::Index(std::string new_pool, std::vector<uint32_t> new_title_offsets,
+                         std::vector<uint16_t> new_platform_codes, std::vector<std::string> new_platform_names) {
+    new_pool.shrink_to_fit();
+    size_t count = new_platform_codes.size();
+
+    // Two passes over the titles: size every posting list, then write them.
+    // last[t] is the last entry (plus one) seen with trigram t, which both
+    // drops repeats within a title and gives the delta.
+    std::vector<uint32_t> new_posting_offsets(CATALOG_TRIGRAMS + 1, 0);
+    std::vector<uint32_t> new_posting_counts(CATALOG_TRIGRAMS, 0);
+    std::vector<uint32_t> last(CATALOG_TRIGRAMS, 0);
+    std::string padded;
+    auto for_each_trigram = [&](uint32_t id, auto fn) {
+        std::string_view title(new_pool.data() + new_title_offsets[id], new_title_offsets[id + 1] - new_title_offsets[id]);
+        if (title.empty()) return;
+        padded.assign(1, ' ');
+        padded.append(title);
+        padded.push_back(' ');
+        for (size_t i = 0; i + 3 <= padded.size(); i++) {
+            uint32_t trigram = TrigramAt(padded.data() + i);
+            if (last[trigram] == id + 1) continue;
+            uint32_t delta = id + 1 - last[trigram];   // First entry: id + 1
+            last[trigram] = id + 1;
+            fn(trigram, delta);
+        }
+    };
+
+    for (uint32_t id = 0; id < count; id++) {
+        for_each_trigram(id, [&](uint32_t trigram, uint32_t delta) {
+            new_posting_offsets[trigram + 1] += (uint32_t)VarintSize(delta);
+            new_posting_counts[trigram]++;
+        });
+    }
+    for (uint32_t t = 0; t < CATALOG_TRIGRAMS; t++) new_posting_offsets[t + 1] += new_posting_offsets[t];
+
+    std::vector<uint8_t> new_postings(new_posting_offsets[CATALOG_TRIGRAMS]);
+    std::vector<size_t> cursor(new_posting_offsets.begin(), new_posting_offsets.end() - 1);
+    std::fill(last.begin(), last.end(), 0);
+    for (uint32_t id = 0; id < count; id++) {
+        for_each_trigram(id, [&](uint32_t trigram, uint32_t delta) {
+            PutVarint(delta, new_postings.data(), &cursor[trigram]);
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pool = std::move(new_pool);
+    title_offsets = std::move(new_title_offsets);
+    platform_codes = std::move(new_platform_codes);
+    platform_names = std::move(new_platform_names);
+    posting_offsets = std::move(new_posting_offsets);
+    posting_counts = std::move(new_posting_counts);
+    postings = std::move(new_postings);
+    scores.assign(count, 0);
+}
+
+void CatalogIndex::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    pool.clear();
+    pool.shrink_to_fit();
+    title_offsets = {};
+    platform_codes = {};
+    platform_names = {};
+    posting_offsets = {};
+    posting_counts = {};
+    postings = {};
+    scores = {};
+}
+
+size_t CatalogIndex::Count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return platform_codes.size();
+}
+
+size_t CatalogIndex::MemoryBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t bytes = pool.capacity() + title_offsets.capacity() * sizeof(uint32_t) +
+                   platform_codes.capacity() * sizeof(uint16_t) + posting_offsets.capacity() * sizeof(uint32_t) +
+                   posting_counts.capacity() * sizeof(uint32_t) + postings.capacity() +
+                   scores.capacity() * sizeof(uint16_t);
+    for (const auto& name : platform_names) bytes += sizeof(name) + name.capacity();
+    return bytes;
+}
+
+// ============================================================================
+// Searching
+// ============================================================================
+
+std::string_view CatalogIndex::Title(uint32_t id) const {
+    return std::string_view(pool.data() + title_offsets[id], title_offsets[id + 1] - title_offsets[id]);
+}
+
+void CatalogIndex::Decode(uint32_t trigram, std::vector<uint32_t>* out) const {
+    out->clear();
+    out->reserve(posting_counts[trigram]);
+    const uint8_t* p = postings.data() + posting_offsets[trigram];
+    const uint8_t* end = postings.data() + posting_offsets[trigram + 1];
+    uint32_t id = 0;   // Plus one
+    while (p < end) {
+        uint32_t delta = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t byte = *p++;
+            delta |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        id += delta;
+        out->push_back(id - 1);
+    }
+}
+
+// Sorted, duplicate-free a and b; the common IDs go to out (room for na)
+static size_t Intersect(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+    size_t i = 0, j = 0, k = 0;
+
+    // Lopsided lists: binary search the long one for each ID of the short one
+    if (nb > na * 32) {
+        for (; i < na; i++) {
+            j = std::lower_bound(b + j, b + nb, a[i]) - b;
+            if (j == nb) break;
+            if (b[j] == a[i]) out[k++] = a[i];
+        }
+        return k;
+    }
+
+#ifdef FORGE_SSE2
+    // Four IDs of a against all four rotations of four IDs of b
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x39))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x4E)),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x93))));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(hits));
+        uint32_t a_last = a[i + 3], b_last = b[j + 3];
+        uint32_t block[4] = { a[i], a[i + 1], a[i + 2], a[i + 3] };
+        for (int lane = 0; lane < 4; lane++) {
+            if (mask & (1 << lane)) out[k++] = block[lane];
+        }
+        if (a_last <= b_last) i += 4;
+        if (b_last <= a_last) j += 4;
+    }
+#endif
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) i++;
+        else if (b[j] < a[i]) j++;
+        else {
+            out[k++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    return k;
+}
+
+// Entries holding every one of the trigrams, smallest list first
+std::vector<uint32_t> CatalogIndex::AllOf(const std::vector<uint32_t>& trigrams) const {
+    std::vector<uint32_t> order(trigrams);
+    std::sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) { return posting_counts[x] < posting_counts[y]; });
+
+    std::vector<uint32_t> result, list, common;
+    Decode(order[0], &result);
+    for (size_t n = 1; n < order.size() && !result.empty(); n++) {
+        Decode(order[n], &list);
+        common.resize(result.size());
+        common.resize(Intersect(result.data(), result.size(), list.data(), list.size(), common.data()));
+        result.swap(common);
+    }
+    return result;
+}
+
+size_t CatalogIndex::Search(std::string_view query, std::string_view platform, uint32_t* ids, size_t max_results) {
+    std::string needle = Normalize(query);
+    if (needle.empty() || !ids || max_results == 0) return 0;
+    std::vector<std::string_view> words;
+    for (size_t start = 0; start < needle.size();) {
+        size_t end = needle.find(' ', start);
+        if (end == std::string::npos) end = needle.size();
+        words.push_back(std::string_view(needle).substr(start, end - start));
+        start = end + 1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = platform_codes.size();
+    if (count == 0) return 0;
+
+    // Platforms match like the Dart index did: equal or either containing
+    // the other, ignoring case
+    std::string wanted = Lower(platform);
+    std::vector<bool> platform_ok(platform_names.size(), true);
+    if (!wanted.empty() && wanted != "all") {
+        for (size_t i = 0; i < platform_names.size(); i++) {
+            const std::string& name = platform_names[i];
+            platform_ok[i] = name.find(wanted) != std::string::npos || wanted.find(name) != std::string::npos;
+        }
+    }
+
+    auto words_in = [&](std::string_view title) {
+        uint16_t found = 0;
+        for (std::string_view word : words) {
+            if (title.find(word) != std::string_view::npos) found++;
+        }
+        return found;
+    };
+    auto candidate = [&](uint32_t id, uint16_t words_found, uint16_t shared) {
+        std::string_view title = Title(id);
+        Candidate c;
+        c.id = id;
+        c.words = words_found;
+        c.shared = shared;
+        c.exact = title == needle;
+        c.prefix = title.compare(0, needle.size(), needle) == 0;
+        return c;
+    };
+
+    // 1. Titles holding every word. Trigrams inside the words narrow the
+    // search; the words themselves are checked on what is left.
+    std::vector<uint32_t> inner;
+    for (std::string_view word : words) {
+        for (size_t i = 0; i + 3 <= word.size(); i++) {
+            uint32_t trigram = TrigramAt(word.data() + i);
+            if (std::find(inner.begin(), inner.end(), trigram) == inner.end()) inner.push_back(trigram);
+        }
+    }
+    std::vector<uint32_t> rows;
+    if (inner.empty()) {
+        rows.resize(count);
+        for (uint32_t id = 0; id < count; id++) rows[id] = id;
+    } else {
+        rows = AllOf(inner);
+    }
+    std::vector<Candidate> candidates;
+    for (uint32_t id : rows) {
+        if (!platform_ok[platform_codes[id]]) continue;
+        if (words_in(Title(id)) == words.size()) candidates.push_back(candidate(id, (uint16_t)words.size(), 0));
+    }
+
+    // 2. Too few: titles sharing at least half of the query's trigrams
+    if (candidates.size() < CATALOG_FUZZY_BELOW) {
+        std::vector<uint32_t> trigrams, list, touched;
+        Trigrams(needle, &trigrams);
+        for (uint32_t trigram : trigrams) {
+            Decode(trigram, &list);
+            for (uint32_t id : list) {
+                if (scores[id]++ == 0) touched.push_back(id);
+            }
+        }
+        for (const Candidate& c : candidates) scores[c.id] = 0;   // Already listed
+        for (uint32_t id : touched) {
+            uint16_t shared = scores[id];
+            scores[id] = 0;
+            if ((size_t)shared * 2 < trigrams.size() || !platform_ok[platform_codes[id]]) continue;
+            candidates.push_back(candidate(id, words_in(Title(id)), shared));
+        }
+    }
+
+    auto better = [&](const Candidate& a, const Candidate& b) {
+        if (a.exact != b.exact) return a.exact;
+        if (a.prefix != b.prefix) return a.prefix;
+        if (a.words != b.words) return a.words > b.words;
+        if (a.shared != b.shared) return a.shared > b.shared;
+        size_t la = title_offsets[a.id + 1] - title_offsets[a.id], lb = title_offsets[b.id + 1] - title_offsets[b.id];
+        if (la != lb) return la < lb;
+        return a.id < b.id;
+    };
+    size_t n = (std::min)(max_results, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(), better);
+    for (size_t i = 0; i < n; i++) ids[i] = candidates[i].id;
+    return n;
+}
+
+CatalogIndex& CatalogIndex::Shared() {
+    static CatalogIndex index;
+    return index;
+}
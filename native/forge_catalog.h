@@ -0,0 +1,196 @@
+#ifndef FORGE_CATALOG_H
+#define FORGE_CATALOG_H
+
+#include "forge_io.h"
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+// ============================================================================
+// On-disk layout of the remote catalog (little-endian, sections 8-aligned)
+//
+//   CatalogFileHeader
+//   CATALOG_STRING_OFFSETS   uint32[string_count + 1] into CATALOG_STRINGS
+//   CATALOG_STRINGS          Platform, source and format names, interned
+//   CATALOG_TITLE_BLOCKS     uint32 per CATALOG_BLOCK_TITLES titles, into
+//                            CATALOG_TITLES
+//   CATALOG_TITLES           Titles in byte order, front-coded: each block
+//                            starts with varint length + bytes, then every
+//                            title is varint shared prefix + varint suffix
+//                            length + suffix bytes
+//   CATALOG_SIZES            uint64[entry_count]
+//   CATALOG_URL_OFFSETS      uint32[entry_count + 1] into CATALOG_URLS
+//   CATALOG_URLS
+//   CATALOG_PLATFORMS        uint16[entry_count] string numbers
+//   CATALOG_SOURCES          uint16[entry_count]
+//   CATALOG_FORMATS          uint16[entry_count]
+// ============================================================================
+
+constexpr uint32_t CATALOG_MAGIC = 0x54414346;   // "FCAT"
+constexpr uint32_t CATALOG_VERSION = 1;
+constexpr uint32_t CATALOG_BLOCK_TITLES = 16;
+
+enum CatalogSection {
+    CATALOG_STRING_OFFSETS,
+    CATALOG_STRINGS,
+    CATALOG_TITLE_BLOCKS,
+    CATALOG_TITLES,
+    CATALOG_SIZES,
+    CATALOG_URL_OFFSETS,
+    CATALOG_URLS,
+    CATALOG_PLATFORMS,
+    CATALOG_SOURCES,
+    CATALOG_FORMATS,
+    CATALOG_SECTION_COUNT
+};
+
+struct CatalogFileSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct CatalogFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t string_count;
+    CatalogFileSection sections[CATALOG_SECTION_COUNT];
+};
+
+static_assert(sizeof(CatalogFileHeader) == 16 + 16 * CATALOG_SECTION_COUNT, "CatalogFileHeader layout");
+
+// Remote directory listings (every downloadable title with its URL, size,
+// platform, source and format), written once per sync and then mapped
+// read-only: opening costs page faults rather than parsing, and processes
+// with the catalog open share its pages.
+class CatalogFile {
+public:
+    struct Entry {
+        std::string title;
+        std::string url;
+        uint64_t size = 0;
+        std::string platform;
+        std::string source;         // Listing the entry came from
+        std::string format;
+    };
+
+    // An entry read in place; only valid during the ForEach() callback
+    struct EntryView {
+        std::string_view title;
+        std::string_view url;
+        uint64_t size = 0;
+        std::string_view platform;
+        std::string_view source;
+        std::string_view format;
+    };
+    using EntryFn = std::function<void(size_t index, const EntryView& entry)>;
+
+    // Sort by title and write a new catalog file. Entry i of the file is
+    // the i-th title in byte order.
+    static bool Write(std::vector<Entry> entries, const std::string& catalog_path);
+
+    bool Load(const std::string& catalog_path);
+    void Unload();
+    bool IsLoaded() const;
+    size_t Count() const;
+
+    bool Get(size_t index, Entry* entry) const;
+    // Every entry in order, titles decoded block by block
+    void ForEach(const EntryFn& fn) const;
+    // First entry whose title is not less than title
+    size_t LowerBound(std::string_view title) const;
+
+    // Process-wide catalog used by the catalog entry points
+    static CatalogFile& Shared();
+
+private:
+    std::string_view String(uint16_t number) const;
+    // Titles of the block holding index, decoded into buffer; the view of
+    // title index is returned
+    std::string_view DecodeTitle(size_t index, std::string* buffer) const;
+    EntryView View(size_t index, std::string_view title) const;
+
+    mutable std::shared_mutex mutex;
+    MappedFile mapping;
+    const CatalogFileHeader* header = nullptr;
+    const uint32_t* string_offsets = nullptr;
+    const char* strings = nullptr;
+    const uint32_t* title_blocks = nullptr;
+    const uint8_t* titles = nullptr;
+    size_t titles_size = 0;
+    const uint64_t* sizes = nullptr;
+    const uint32_t* url_offsets = nullptr;
+    const char* urls = nullptr;
+    const uint16_t* platforms = nullptr;
+    const uint16_t* sources = nullptr;
+    const uint16_t* formats = nullptr;
+};
+
+// Search index over the remote catalog (every downloadable title, 100k and
+// more). Titles are normalised the way the Dart index did it: lower case,
+// letters, digits and single spaces only.
+//
+// Every trigram of " title " packs into one of 37^3 IDs, and each ID has a
+// sorted posting list of entries, delta-encoded as varints in one shared
+// byte array. A search intersects the lists of the query's trigrams
+// (smallest first, four IDs at a time with SSE2) to find titles holding
+// every query word. When fewer than CATALOG_FUZZY_BELOW titles match, titles
+// sharing at least half of the query's trigrams are added, so typos still
+// find something. Results are ranked exact match, prefix match, words
+// matched, trigrams shared, then shorter titles first; only the top
+// max_results are sorted.
+class CatalogIndex {
+public:
+    static constexpr size_t CATALOG_FUZZY_BELOW = 10;
+
+    struct Entry {
+        std::string_view title;
+        std::string_view platform;
+    };
+
+    // Replace the catalog; entries[i] gets ID i
+    void Build(const std::vector<Entry>& entries);
+    // Index a catalog file; its entry i gets ID i
+    void Build(const CatalogFile& file);
+    void Clear();
+    // Up to max_results IDs, best first; platform is empty or "all" for any
+    size_t Search(std::string_view query, std::string_view platform, uint32_t* ids, size_t max_results);
+
+    size_t Count() const;
+    // Heap held by the index
+    size_t MemoryBytes() const;
+
+    static std::string Normalize(std::string_view text);
+    static CatalogIndex& Shared();
+
+private:
+    struct Candidate {
+        uint32_t id;
+        uint16_t words;        // Query words the title contains
+        uint16_t shared;       // Trigrams shared with the query (fuzzy matches)
+        bool exact;
+        bool prefix;
+    };
+
+    void Index(std::string new_pool, std::vector<uint32_t> new_title_offsets, std::vector<uint16_t> new_platform_codes,
+               std::vector<std::string> new_platform_names);
+    std::string_view Title(uint32_t id) const;
+    void Decode(uint32_t trigram, std::vector<uint32_t>* out) const;
+    std::vector<uint32_t> AllOf(const std::vector<uint32_t>& trigrams) const;
+
+    mutable std::mutex mutex;
+    std::string pool;                      // Normalised titles, back to back
+    std::vector<uint32_t> title_offsets;   // Count() + 1
+    std::vector<uint16_t> platform_codes;
+    std::vector<std::string> platform_names;   // Lower case
+    std::vector<uint32_t> posting_offsets; // Into postings, one per trigram + 1
+    std::vector<uint32_t> posting_counts;
+    std::vector<uint8_t> postings;
+    std::vector<uint16_t> scores;          // Fuzzy pass scratch, all zero between searches
+};
+
+#endif // FORGE_CATALOG_H
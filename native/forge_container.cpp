@@ -0,0 +1,763 @@
+#include "forge_container.h"
+#include "forge_decompress.h"
+#include "forge_io.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Index tables and CHD maps beyond this are not discs we could sensibly scan
+static constexpr uint64_t CONTAINER_MAX_INDEX_SIZE = 64 * 1024 * 1024;
+
+static inline uint32_t ReadLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t ReadLE64(const uint8_t* p) {
+    return (uint64_t)ReadLE32(p) | ((uint64_t)ReadLE32(p + 4) << 32);
+}
+
+static inline uint32_t ReadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t ReadBE64(const uint8_t* p) {
+    return ((uint64_t)ReadBE32(p) << 32) | ReadBE32(p + 4);
+}
+
+static inline bool PowerOfTwo(uint64_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// Identify the disc from its decoded prefix. read(out, capacity, produced)
+// decodes from the start of the disc each call: the first pass needs one
+// sector, and only discs that match nothing there pay for the deep pass.
+template <typename ReadFn>
+static bool IdentifyDiscPrefix(uint64_t disc_size, const ReadFn& read, GameIdentity* identity) {
+    std::vector<uint8_t> buffer((size_t)(std::min)(disc_size, (uint64_t)IDENTIFY_DEEP_HEADER_SIZE));
+    size_t first = (std::min)(buffer.size(), (size_t)IDENTIFY_HEADER_SIZE);
+    size_t produced = 0;
+    read(buffer.data(), first, &produced);
+    bool identified = produced > 0 && identify_from_header(buffer.data(), produced, identity);
+
+    if (!identified && disc_size >= IDENTIFY_DEEP_MIN_FILE_SIZE && produced == first) {
+        read(buffer.data(), buffer.size(), &produced);
+        identified = identify_from_header(buffer.data(), produced, identity);
+    }
+    return identified;
+}
+
+// Disc prefix from fixed-size blocks: decode(block, out, capacity, produced)
+// fills out with the start of one block. Every block but the disc's last
+// must decode in full.
+template <typename DecodeFn>
+static bool ReadBlocks(uint64_t disc_size, uint64_t block_size, const DecodeFn& decode, uint8_t* out,
+                       size_t capacity, size_t* produced) {
+    size_t pos = 0;
+    capacity = (size_t)(std::min)((uint64_t)capacity, disc_size);
+    for (uint64_t block = 0; pos < capacity; block++) {
+        size_t want = (size_t)(std::min)((uint64_t)(capacity - pos), block_size);
+        size_t got = 0;
+        bool ok = decode(block, out + pos, want, &got);
+        pos += got;
+        if (!ok || got != want) break;
+    }
+    *produced = pos;
+    return pos == capacity;
+}
+
+// zlib stream: 2-byte header (deflate, no preset dictionary), then raw deflate
+static bool InflateZlibPrefix(RangeReader& in, uint8_t* out, size_t capacity, size_t* produced) {
+    uint8_t cmf, flg;
+    *produced = 0;
+    if (!in.Next(&cmf) || !in.Next(&flg)) return false;
+    if ((cmf & 0x0F) != 8 || (flg & 0x20) || ((cmf << 8) | flg) % 31 != 0) return false;
+    return InflatePrefix(in, out, capacity, produced);
+}
+
+// ============================================================================
+// GCZ
+//
+// 0x20-byte header (magic, sub type, compressed and disc size, block size,
+// block count), a u64 pointer per block (bit 63: stored uncompressed), a
+// u32 hash per block, then the blocks as zlib streams.
+// ============================================================================
+
+static constexpr uint32_t GCZ_MAGIC = 0xB10BC001;
+static constexpr size_t GCZ_HEADER_SIZE = 0x20;
+static constexpr uint64_t GCZ_UNCOMPRESSED = 1ull << 63;
+
+static bool IdentifyGcz(const RandomAccessFile& file, GameIdentity* result) {
+    uint8_t header[GCZ_HEADER_SIZE];
+    if (!file.ReadExact(0, header, sizeof(header))) return false;
+    uint64_t compressed_size = ReadLE64(header + 0x08);
+    uint64_t disc_size = ReadLE64(header + 0x10);
+    uint32_t block_size = ReadLE32(header + 0x18);
+    uint32_t block_count = ReadLE32(header + 0x1C);
+    if (!PowerOfTwo(block_size) || block_count == 0 || (uint64_t)block_count * 12 > CONTAINER_MAX_INDEX_SIZE) {
+        return false;
+    }
+    uint64_t data_offset = GCZ_HEADER_SIZE + (uint64_t)block_count * 12;
+
+    // Pointers for the blocks a deep read covers, plus the one after them
+    size_t pointer_count = (size_t)(std::min)((uint64_t)block_count,
+                                              (uint64_t)IDENTIFY_DEEP_HEADER_SIZE / block_size + 2);
+    std::vector<uint8_t> pointers(pointer_count * 8);
+    if (!file.ReadExact(GCZ_HEADER_SIZE, pointers.data(), pointers.size())) return false;
+
+    auto decode = [&](uint64_t block, uint8_t* out, size_t capacity, size_t* produced) {
+        *produced = 0;
+        if (block >= pointer_count) return false;
+        uint64_t pointer = ReadLE64(&pointers[block * 8]);
+        uint64_t start = pointer & ~GCZ_UNCOMPRESSED;
+        uint64_t end = block + 1 < pointer_count ? ReadLE64(&pointers[(block + 1) * 8]) & ~GCZ_UNCOMPRESSED
+                                                 : compressed_size;
+        if (end < start || data_offset + end > file.Size()) return false;
+        RangeReader in(file, data_offset + start, end - start);
+        if (pointer & GCZ_UNCOMPRESSED) {
+            *produced = in.Read(out, capacity);
+            return true;
+        }
+        return InflateZlibPrefix(in, out, capacity, produced);
+    };
+    auto read = [&](uint8_t* out, size_t capacity, size_t* produced) {
+        return ReadBlocks(disc_size, block_size, decode, out, capacity, produced);
+    };
+    return IdentifyDiscPrefix(disc_size, read, result);
+}
+
+// ============================================================================
+// CSO / ZSO
+//
+// 0x18-byte header (magic, header size, disc size, block size, version,
+// index shift), then a u32 index entry per block plus one marking the end.
+// An entry is the block's file offset >> shift; its top bit is a flag whose
+// meaning depends on the format: CSO v1 "stored", CSO v2 "LZ4" (a block as
+// large as a disc block is stored, others are deflate), ZSO "stored" (others
+// are LZ4).
+// ============================================================================
+
+static constexpr size_t CSO_HEADER_SIZE = 0x18;
+static constexpr uint32_t CSO_FLAG = 0x80000000;
+static constexpr uint32_t CSO_MAX_BLOCK_SIZE = 1024 * 1024;
+
+static bool IdentifyCso(const RandomAccessFile& file, GameIdentity* result) {
+    uint8_t header[CSO_HEADER_SIZE];
+    if (!file.ReadExact(0, header, sizeof(header))) return false;
+    bool zso = memcmp(header, "ZISO", 4) == 0;
+    uint64_t disc_size = ReadLE64(header + 0x08);
+    uint32_t block_size = ReadLE32(header + 0x10);
+    uint8_t version = header[0x14];
+    uint8_t shift = header[0x15];
+    if (!PowerOfTwo(block_size) || block_size < 2048 || block_size > CSO_MAX_BLOCK_SIZE || shift > 31) return false;
+    uint64_t block_count = (disc_size + block_size - 1) / block_size;
+    if (block_count == 0 || block_count * 4 > CONTAINER_MAX_INDEX_SIZE) return false;
+
+    size_t entry_count = (size_t)(std::min)(block_count, (uint64_t)IDENTIFY_DEEP_HEADER_SIZE / block_size + 1) + 1;
+    std::vector<uint8_t> index(entry_count * 4);
+    if (!file.ReadExact(CSO_HEADER_SIZE, index.data(), index.size())) return false;
+
+    auto decode = [&](uint64_t block, uint8_t* out, size_t capacity, size_t* produced) {
+        *produced = 0;
+        if (block + 1 >= entry_count) return false;
+        uint32_t entry = ReadLE32(&index[block * 4]);
+        uint64_t start = (uint64_t)(entry & ~CSO_FLAG) << shift;
+        uint64_t end = (uint64_t)(ReadLE32(&index[(block + 1) * 4]) & ~CSO_FLAG) << shift;
+        if (end < start || end > file.Size()) return false;
+        bool flag = (entry & CSO_FLAG) != 0;
+        RangeReader in(file, start, end - start);
+        bool stored = zso ? flag : version >= 2 ? !flag && end - start >= block_size : flag;
+        if (stored) {
+            *produced = in.Read(out, capacity);
+            return true;
+        }
+        if (zso || (version >= 2 && flag)) return Lz4BlockDecodePrefix(in, out, capacity, produced);
+        return InflatePrefix(in, out, capacity, produced);
+    };
+    auto read = [&](uint8_t* out, size_t capacity, size_t* produced) {
+        return ReadBlocks(disc_size, block_size, decode, out, capacity, produced);
+    };
+    return IdentifyDiscPrefix(disc_size, read, result);
+}
+
+// ============================================================================
+// WUX
+//
+// 0x20-byte header (two magics, sector size, disc size, flags), a u32 per
+// disc sector naming the stored sector that holds it, then the stored
+// sectors from the next sector-aligned offset.
+// ============================================================================
+
+static constexpr uint32_t WUX_MAGIC_1 = 0x1099D02E;
+static constexpr size_t WUX_HEADER_SIZE = 0x20;
+
+static bool IdentifyWux(const RandomAccessFile& file, GameIdentity* result) {
+    uint8_t header[WUX_HEADER_SIZE];
+    if (!file.ReadExact(0, header, sizeof(header)) || ReadLE32(header + 4) != WUX_MAGIC_1) return false;
+    uint32_t sector_size = ReadLE32(header + 0x08);
+    uint64_t disc_size = ReadLE64(header + 0x10);
+    if (!PowerOfTwo(sector_size) || sector_size < 0x100) return false;
+    uint64_t sector_count = (disc_size + sector_size - 1) / sector_size;
+    if (sector_count == 0 || sector_count * 4 > CONTAINER_MAX_INDEX_SIZE) return false;
+    uint64_t sectors_offset = (WUX_HEADER_SIZE + sector_count * 4 + sector_size - 1) / sector_size * sector_size;
+
+    size_t entry_count = (size_t)(std::min)(sector_count, (uint64_t)IDENTIFY_DEEP_HEADER_SIZE / sector_size + 1);
+    std::vector<uint8_t> index(entry_count * 4);
+    if (!file.ReadExact(WUX_HEADER_SIZE, index.data(), index.size())) return false;
+
+    auto decode = [&](uint64_t sector, uint8_t* out, size_t capacity, size_t* produced) {
+        *produced = 0;
+        if (sector >= entry_count) return false;
+        uint64_t offset = sectors_offset + (uint64_t)ReadLE32(&index[sector * 4]) * sector_size;
+        return file.ReadAt(offset, out, capacity, produced);
+    };
+    auto read = [&](uint8_t* out, size_t capacity, size_t* produced) {
+        return ReadBlocks(disc_size, sector_size, decode, out, capacity, produced);
+    };
+    return IdentifyDiscPrefix(disc_size, read, result);
+}
+
+// ============================================================================
+// CHD
+//
+// A v5 header, a map giving each hunk's codec, file offset and length,
+// and a metadata chain (the CD track list, or a DVD tag). The map is
+// Huffman coded; hunks are only decoded up to those holding the disc
+// prefix, but the map has to be read to its end-of-types mark first.
+// ============================================================================
+
+static constexpr size_t CHD_V5_HEADER_SIZE = 124;
+static constexpr size_t CHD_MAP_HEADER_SIZE = 16;
+static constexpr size_t CHD_METADATA_HEADER_SIZE = 16;
+static constexpr unsigned CHD_MAX_METADATA = 1024;
+static constexpr uint32_t CHD_MAX_HUNK_SIZE = 1024 * 1024;
+
+static constexpr uint32_t FourCC(const char (&tag)[5]) {
+    return ((uint32_t)(uint8_t)tag[0] << 24) | ((uint32_t)(uint8_t)tag[1] << 16) |
+           ((uint32_t)(uint8_t)tag[2] << 8) | (uint32_t)(uint8_t)tag[3];
+}
+
+static constexpr uint32_t CHD_CODEC_ZLIB = FourCC("zlib");
+static constexpr uint32_t CHD_CODEC_LZMA = FourCC("lzma");
+static constexpr uint32_t CHD_CODEC_CD_ZLIB = FourCC("cdzl");
+static constexpr uint32_t CHD_CODEC_CD_LZMA = FourCC("cdlz");
+
+static constexpr uint32_t CHD_METADATA_CD_TRACK = FourCC("CHTR");
+static constexpr uint32_t CHD_METADATA_CD_TRACK_2 = FourCC("CHT2");
+static constexpr uint32_t CHD_METADATA_GD_TRACK = FourCC("CHGD");
+static constexpr uint32_t CHD_METADATA_DVD = FourCC("DVD ");
+
+// Map entry types; 0-3 select one of the header's four codecs
+enum : uint8_t {
+    CHD_HUNK_NONE = 4,          // Stored
+    CHD_HUNK_SELF = 5,          // Same as an earlier hunk
+    CHD_HUNK_PARENT = 6,        // From the parent CHD
+    CHD_HUNK_RLE_SMALL = 7,     // Map coding only: repeat the last type
+    CHD_HUNK_RLE_LARGE = 8,
+    CHD_HUNK_SELF_0 = 9,        // SELF relative to the last SELF
+    CHD_HUNK_SELF_1 = 10,
+    CHD_HUNK_PARENT_SELF = 11,
+    CHD_HUNK_PARENT_0 = 12,
+    CHD_HUNK_PARENT_1 = 13,
+};
+
+// CD hunks hold whole frames: sector data, then subcode
+static constexpr uint32_t CHD_CD_SECTOR_SIZE = 2352;
+static constexpr uint32_t CHD_CD_SUBCODE_SIZE = 96;
+static constexpr uint32_t CHD_CD_FRAME_SIZE = CHD_CD_SECTOR_SIZE + CHD_CD_SUBCODE_SIZE;
+static constexpr uint32_t CHD_CD_TRACK_PADDING = 4;     // Tracks start on a multiple of this many frames
+static constexpr uint8_t CD_SYNC_HEADER[12] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+// LZMA coding as chdman configures it: lc 3, lp 0, pb 2. The dictionary
+// size does not matter to a decoder whose output is the dictionary.
+static constexpr uint8_t CHD_LZMA_PROPS[5] = { 3 + 9 * (0 + 5 * 2), 0x00, 0x00, 0x00, 0x01 };
+
+// Most significant bit first, as the map is written; reads past the end
+// return zeros and set overflow
+class ChdBitReader {
+public:
+    ChdBitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint32_t Peek(int count) {
+        while (bit_count < count) {
+            uint64_t byte = 0;
+            if (pos < size) byte = data[pos];
+            else overflow = true;
+            pos++;
+            bits |= byte << (56 - bit_count);
+            bit_count += 8;
+        }
+        return count == 0 ? 0 : (uint32_t)(bits >> (64 - count));
+    }
+
+    void Remove(int count) {
+        bits <<= count;
+        bit_count -= count;
+    }
+
+    uint32_t Read(int count) {
+        uint32_t value = Peek(count);
+        Remove(count);
+        return value;
+    }
+
+    bool overflow = false;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    uint64_t bits = 0;
+    int bit_count = 0;
+};
+
+// The map's Huffman code: 16 symbols of at most 8 bits, code lengths sent
+// run-length coded, canonical codes assigned from the longest length down
+class ChdHuffman {
+public:
+    static constexpr int SYMBOLS = 16;
+    static constexpr int MAX_BITS = 8;
+
+    bool Import(ChdBitReader& in) {
+        uint8_t lengths[SYMBOLS];
+        int symbol = 0;
+        while (symbol < SYMBOLS) {
+            uint32_t length = in.Read(4);
+            if (length == 1) {
+                // 1 escapes: 1 again is a literal 1, else a repeat count follows
+                length = in.Read(4);
+                if (length != 1) {
+                    int repeat = (int)in.Read(4) + 3;
+                    if (symbol + repeat > SYMBOLS) return false;
+                    while (repeat--) lengths[symbol++] = (uint8_t)length;
+                    continue;
+                }
+            }
+            lengths[symbol++] = (uint8_t)length;
+        }
+        if (in.overflow) return false;
+
+        uint32_t histogram[MAX_BITS + 1] = {};
+        for (int i = 0; i < SYMBOLS; i++) {
+            if (lengths[i] > MAX_BITS) return false;
+            histogram[lengths[i]]++;
+        }
+        uint32_t start = 0;
+        for (int length = MAX_BITS; length > 0; length--) {
+            uint32_t next = (start + histogram[length]) >> 1;
+            if (length != 1 && next * 2 != start + histogram[length]) return false;
+            histogram[length] = start;
+            start = next;
+        }
+
+        memset(table, 0, sizeof(table));
+        for (int i = 0; i < SYMBOLS; i++) {
+            if (lengths[i] == 0) continue;
+            uint32_t code = histogram[lengths[i]]++;
+            int shift = MAX_BITS - lengths[i];
+            for (uint32_t fill = 0; fill < (1u << shift); fill++) {
+                uint32_t slot = (code << shift) | fill;
+                if (slot >= (1u << MAX_BITS)) return false;
+                table[slot] = (uint16_t)((i << 4) | lengths[i]);
+            }
+        }
+        return true;
+    }
+
+    // -1 for a code the table does not hold
+    int Decode(ChdBitReader& in) const {
+        uint16_t entry = table[in.Peek(MAX_BITS)];
+        if ((entry & 0x0F) == 0) return -1;
+        in.Remove(entry & 0x0F);
+        return entry >> 4;
+    }
+
+private:
+    uint16_t table[1 << MAX_BITS];      // Symbol << 4 | length, by the next MAX_BITS bits
+};
+
+struct ChdHunk {
+    uint8_t type = CHD_HUNK_NONE;
+    uint64_t offset = 0;        // File offset, or hunk number for SELF
+    uint32_t length = 0;
+};
+
+struct ChdTrack {
+    uint32_t number = 0;
+    std::string type;           // MODE1, MODE1_RAW, MODE2_RAW, AUDIO, ...
+    uint32_t frames = 0;
+    uint32_t pregap = 0;
+    bool pregap_stored = false; // PGTYPE "V...": the pregap's frames are in the CHD
+};
+
+class ChdReader {
+public:
+    explicit ChdReader(const RandomAccessFile& file) : file(file) {}
+
+    bool Open() {
+        uint8_t header[CHD_V5_HEADER_SIZE];
+        if (!file.ReadExact(0, header, sizeof(header)) || ReadBE32(header + 12) != 5) return false;
+        for (int i = 0; i < 4; i++) codecs[i] = ReadBE32(header + 16 + i * 4);
+        logical_size = ReadBE64(header + 32);
+        map_offset = ReadBE64(header + 40);
+        metadata_offset = ReadBE64(header + 48);
+        hunk_size = ReadBE32(header + 56);
+        unit_size = ReadBE32(header + 60);
+        if (hunk_size == 0 || hunk_size > CHD_MAX_HUNK_SIZE || unit_size == 0 || hunk_size % unit_size != 0) {
+            return false;
+        }
+        hunk_count = (logical_size + hunk_size - 1) / hunk_size;
+        return hunk_count > 0 && hunk_count * 12 <= CONTAINER_MAX_INDEX_SIZE;
+    }
+
+    // Map entries for hunks [0, count)
+    bool ReadMap(uint64_t count) {
+        count = (std::min)(count, hunk_count);
+        hunks.resize((size_t)count);
+        if (codecs[0] == 0) return ReadUncompressedMap();
+        return ReadCompressedMap();
+    }
+
+    // Logical bytes [offset, offset + size); only hunks ReadMap covered
+    bool Read(uint64_t offset, uint8_t* dst, size_t size) {
+        while (size > 0) {
+            uint64_t hunk = offset / hunk_size;
+            uint32_t within = (uint32_t)(offset % hunk_size);
+            if (!LoadHunk(hunk)) return false;
+            size_t take = (std::min)(size, (size_t)(hunk_size - within));
+            memcpy(dst, &hunk_data[within], take);
+            dst += take;
+            offset += take;
+            size -= take;
+        }
+        return true;
+    }
+
+    bool ReadMetadata(bool* dvd, bool* gdrom, std::vector<ChdTrack>* tracks) {
+        uint64_t offset = metadata_offset;
+        for (unsigned n = 0; offset != 0 && n < CHD_MAX_METADATA; n++) {
+            uint8_t entry[CHD_METADATA_HEADER_SIZE];
+            if (!file.ReadExact(offset, entry, sizeof(entry))) return false;
+            uint32_t tag = ReadBE32(entry);
+            uint32_t length = ReadBE32(entry + 4) & 0x00FFFFFF;
+            uint64_t next = ReadBE64(entry + 8);
+
+            if (tag == CHD_METADATA_DVD) *dvd = true;
+            if (tag == CHD_METADATA_CD_TRACK || tag == CHD_METADATA_CD_TRACK_2 || tag == CHD_METADATA_GD_TRACK) {
+                if (tag == CHD_METADATA_GD_TRACK) *gdrom = true;
+                std::string text(length, '\0');
+                if (!file.ReadExact(offset + CHD_METADATA_HEADER_SIZE, (uint8_t*)&text[0], length)) return false;
+                tracks->push_back(ParseTrack(text.c_str()));
+            }
+            offset = next;
+        }
+        std::sort(tracks->begin(), tracks->end(),
+                  [](const ChdTrack& a, const ChdTrack& b) { return a.number < b.number; });
+        return true;
+    }
+
+    uint64_t logical_size = 0;
+    uint32_t hunk_size = 0;
+    uint32_t unit_size = 0;
+
+private:
+    // "TRACK:1 TYPE:MODE2_RAW SUBTYPE:NONE FRAMES:1234 PREGAP:0 PGTYPE:MODE1 ..."
+    static ChdTrack ParseTrack(const char* text) {
+        ChdTrack track;
+        const char* p = text;
+        while (*p) {
+            while (*p == ' ') p++;
+            const char* colon = strchr(p, ':');
+            if (!colon) break;
+            const char* end = strchr(colon, ' ');
+            if (!end) end = colon + strlen(colon);
+            std::string key(p, colon - p);
+            std::string value(colon + 1, end - colon - 1);
+            if (key == "TRACK") track.number = (uint32_t)strtoul(value.c_str(), nullptr, 10);
+            else if (key == "TYPE") track.type = value;
+            else if (key == "FRAMES") track.frames = (uint32_t)strtoul(value.c_str(), nullptr, 10);
+            else if (key == "PREGAP") track.pregap = (uint32_t)strtoul(value.c_str(), nullptr, 10);
+            else if (key == "PGTYPE") track.pregap_stored = !value.empty() && value[0] == 'V';
+            p = end;
+        }
+        return track;
+    }
+
+    // One u32 per hunk: its offset in hunks (0: hunk is all zeros)
+    bool ReadUncompressedMap() {
+        std::vector<uint8_t> map(hunks.size() * 4);
+        if (!file.ReadExact(map_offset, map.data(), map.size())) return false;
+        for (size_t i = 0; i < hunks.size(); i++) {
+            hunks[i].type = CHD_HUNK_NONE;
+            hunks[i].offset = (uint64_t)ReadBE32(&map[i * 4]) * hunk_size;
+            hunks[i].length = hunk_size;
+        }
+        return true;
+    }
+
+    // Header: compressed size, first hunk offset (48-bit), CRC, field widths.
+    // Then the Huffman table, every hunk's type, and per hunk its length,
+    // CRC or reference in type-dependent widths.
+    bool ReadCompressedMap() {
+        uint8_t header[CHD_MAP_HEADER_SIZE];
+        if (!file.ReadExact(map_offset, header, sizeof(header))) return false;
+        uint32_t map_size = ReadBE32(header);
+        uint64_t offset = ((uint64_t)ReadBE32(header + 4) << 16) | ((uint64_t)header[8] << 8) | header[9];
+        int length_bits = header[12];
+        int self_bits = header[13];
+        int parent_bits = header[14];
+        if (map_size > CONTAINER_MAX_INDEX_SIZE || length_bits > 32 || self_bits > 32 || parent_bits > 32) return false;
+
+        std::vector<uint8_t> map(map_size);
+        if (!file.ReadExact(map_offset + CHD_MAP_HEADER_SIZE, map.data(), map.size())) return false;
+        ChdBitReader in(map.data(), map.size());
+        ChdHuffman huffman;
+        if (!huffman.Import(in)) return false;
+
+        // Types of all hunks come first, so they are decoded to the end
+        std::vector<uint8_t> types((size_t)hunk_count);
+        uint8_t last = 0;
+        for (uint64_t hunk = 0, repeat = 0; hunk < hunk_count; hunk++) {
+            if (repeat > 0) {
+                types[(size_t)hunk] = last;
+                repeat--;
+                continue;
+            }
+            int type = huffman.Decode(in);
+            if (type == CHD_HUNK_RLE_SMALL) {
+                int count = huffman.Decode(in);
+                if (count < 0) return false;
+                repeat = 2 + (uint64_t)count;
+            } else if (type == CHD_HUNK_RLE_LARGE) {
+                int high = huffman.Decode(in);
+                int low = huffman.Decode(in);
+                if (high < 0 || low < 0) return false;
+                repeat = 2 + 16 + ((uint64_t)high << 4) + (uint64_t)low;
+            } else if (type >= 0) {
+                last = (uint8_t)type;
+            } else {
+                return false;
+            }
+            types[(size_t)hunk] = last;
+        }
+
+        uint64_t last_self = 0, last_parent = 0;
+        for (size_t hunk = 0; hunk < hunks.size(); hunk++) {
+            ChdHunk& entry = hunks[hunk];
+            entry.type = types[hunk];
+            switch (entry.type) {
+            case 0: case 1: case 2: case 3:
+                entry.offset = offset;
+                entry.length = in.Read(length_bits);
+                offset += entry.length;
+                in.Read(16);    // CRC
+                break;
+            case CHD_HUNK_NONE:
+                entry.offset = offset;
+                entry.length = hunk_size;
+                offset += hunk_size;
+                in.Read(16);
+                break;
+            case CHD_HUNK_SELF:
+                entry.offset = last_self = in.Read(self_bits);
+                break;
+            case CHD_HUNK_PARENT:
+                entry.offset = last_parent = in.Read(parent_bits);
+                break;
+            case CHD_HUNK_SELF_1:
+                last_self++;
+                // fall through
+            case CHD_HUNK_SELF_0:
+                entry.type = CHD_HUNK_SELF;
+                entry.offset = last_self;
+                break;
+            case CHD_HUNK_PARENT_SELF:
+                entry.type = CHD_HUNK_PARENT;
+                entry.offset = last_parent = (uint64_t)hunk * hunk_size / unit_size;
+                break;
+            case CHD_HUNK_PARENT_1:
+                last_parent += hunk_size / unit_size;
+                // fall through
+            case CHD_HUNK_PARENT_0:
+                entry.type = CHD_HUNK_PARENT;
+                entry.offset = last_parent;
+                break;
+            default:
+                return false;
+            }
+        }
+        return !in.overflow;
+    }
+
+    bool LoadHunk(uint64_t hunk) {
+        // SELF entries point back at the hunk whose data they repeat
+        while (hunk < hunks.size() && hunks[(size_t)hunk].type == CHD_HUNK_SELF) {
+            if (hunks[(size_t)hunk].offset >= hunk) return false;
+            hunk = hunks[(size_t)hunk].offset;
+        }
+        if (hunk >= hunks.size()) return false;
+        if (hunk_loaded && loaded_hunk == hunk) return true;
+        hunk_loaded = false;
+        hunk_data.assign(hunk_size, 0);
+
+        const ChdHunk& entry = hunks[(size_t)hunk];
+        if (entry.type == CHD_HUNK_NONE) {
+            // Offset 0 in an uncompressed map: never written, all zeros
+            if (entry.offset != 0 && !file.ReadExact(entry.offset, hunk_data.data(), hunk_size)) return false;
+        } else if (entry.type <= 3) {
+            if (entry.offset + entry.length > file.Size()) return false;
+            if (!DecodeHunk(codecs[entry.type], entry.offset, entry.length)) return false;
+        } else {
+            return false;       // Parent CHDs are not opened
+        }
+        hunk_loaded = true;
+        loaded_hunk = hunk;
+        return true;
+    }
+
+    bool Decode(uint32_t codec, uint64_t offset, uint64_t length, uint8_t* out, size_t capacity) {
+        RangeReader in(file, offset, length);
+        size_t produced = 0;
+        bool ok = false;
+        if (codec == CHD_CODEC_ZLIB || codec == CHD_CODEC_CD_ZLIB) {
+            ok = InflatePrefix(in, out, capacity, &produced);
+        } else if (codec == CHD_CODEC_LZMA || codec == CHD_CODEC_CD_LZMA) {
+            ok = LzmaDecodePrefix(in, CHD_LZMA_PROPS, sizeof(CHD_LZMA_PROPS), out, capacity, &produced);
+        }
+        return ok && produced == capacity;
+    }
+
+    bool DecodeHunk(uint32_t codec, uint64_t offset, uint32_t length) {
+        if (codec != CHD_CODEC_CD_ZLIB && codec != CHD_CODEC_CD_LZMA) {
+            return Decode(codec, offset, length, hunk_data.data(), hunk_size);
+        }
+
+        // CD codecs: a bitmap of frames whose sync and ECC were dropped (they
+        // are regenerated), the base stream's length, the sector data of all
+        // frames, then their subcode as zlib. Only the sector data is decoded.
+        uint32_t frames = hunk_size / CHD_CD_FRAME_SIZE;
+        size_t ecc_bytes = (frames + 7) / 8;
+        size_t length_bytes = hunk_size < 65536 ? 2 : 3;
+        uint8_t header[(CHD_MAX_HUNK_SIZE / CHD_CD_FRAME_SIZE + 7) / 8 + 3];
+        if (frames == 0 || length < ecc_bytes + length_bytes ||
+            !file.ReadExact(offset, header, ecc_bytes + length_bytes)) {
+            return false;
+        }
+        uint32_t base_length = 0;
+        for (size_t i = 0; i < length_bytes; i++) base_length = (base_length << 8) | header[ecc_bytes + i];
+        if (ecc_bytes + length_bytes + base_length > length) return false;
+
+        std::vector<uint8_t> sectors((size_t)frames * CHD_CD_SECTOR_SIZE);
+        if (!Decode(codec, offset + ecc_bytes + length_bytes, base_length, sectors.data(), sectors.size())) return false;
+        for (uint32_t frame = 0; frame < frames; frame++) {
+            uint8_t* dst = &hunk_data[(size_t)frame * CHD_CD_FRAME_SIZE];
+            memcpy(dst, &sectors[(size_t)frame * CHD_CD_SECTOR_SIZE], CHD_CD_SECTOR_SIZE);
+            if (header[frame / 8] & (1 << (frame % 8))) memcpy(dst, CD_SYNC_HEADER, sizeof(CD_SYNC_HEADER));
+        }
+        return true;
+    }
+
+    const RandomAccessFile& file;
+    uint32_t codecs[4] = {};
+    uint64_t map_offset = 0;
+    uint64_t metadata_offset = 0;
+    uint64_t hunk_count = 0;
+    std::vector<ChdHunk> hunks;
+    std::vector<uint8_t> hunk_data;
+    uint64_t loaded_hunk = 0;
+    bool hunk_loaded = false;
+};
+
+// Bytes of each frame's sector that belong to the track
+static uint32_t ChdTrackSectorSize(const std::string& type) {
+    if (type == "MODE1" || type == "MODE2_FORM1") return 2048;
+    if (type == "MODE2_FORM2") return 2324;
+    if (type == "MODE2" || type == "MODE2_FORM_MIX") return 2336;
+    return CHD_CD_SECTOR_SIZE;      // *_RAW, AUDIO
+}
+
+static bool IdentifyChd(const RandomAccessFile& file, GameIdentity* result) {
+    ChdReader chd(file);
+    bool dvd = false, gdrom = false;
+    std::vector<ChdTrack> tracks;
+    if (!chd.Open() || !chd.ReadMetadata(&dvd, &gdrom, &tracks)) return false;
+
+    if (dvd) {
+        uint64_t disc_size = chd.logical_size;
+        if (!chd.ReadMap(IDENTIFY_DEEP_HEADER_SIZE / chd.hunk_size + 1)) return false;
+        auto read = [&](uint8_t* out, size_t capacity, size_t* produced) {
+            *produced = (size_t)(std::min)((uint64_t)capacity, disc_size);
+            return chd.Read(0, out, *produced);
+        };
+        return IdentifyDiscPrefix(disc_size, read, result);
+    }
+    if (tracks.empty() || chd.unit_size != CHD_CD_FRAME_SIZE) return false;
+
+    // The first data track; a GD-ROM's game starts with track 3, the first
+    // in the high-density area
+    uint64_t frame = 0;
+    const ChdTrack* track = nullptr;
+    for (const ChdTrack& t : tracks) {
+        bool wanted = gdrom ? t.number >= 3 && t.type != "AUDIO" : t.type != "AUDIO";
+        if (wanted) {
+            track = &t;
+            break;
+        }
+        frame += (t.frames + CHD_CD_TRACK_PADDING - 1) / CHD_CD_TRACK_PADDING * CHD_CD_TRACK_PADDING;
+    }
+    if (!track) return false;
+    uint64_t first_frame = frame + (track->pregap_stored ? track->pregap : 0);
+    uint64_t track_frames = track->frames - (track->pregap_stored ? (std::min)(track->pregap, track->frames) : 0);
+    uint32_t sector_size = ChdTrackSectorSize(track->type);
+    uint64_t disc_size = track_frames * sector_size;
+
+    uint64_t last_frame = first_frame + IDENTIFY_DEEP_HEADER_SIZE / sector_size + 1;
+    if (!chd.ReadMap(last_frame * CHD_CD_FRAME_SIZE / chd.hunk_size + 1)) return false;
+    auto read = [&](uint8_t* out, size_t capacity, size_t* produced) {
+        size_t pos = 0;
+        capacity = (size_t)(std::min)((uint64_t)capacity, disc_size);
+        for (uint64_t f = first_frame; pos < capacity; f++) {
+            size_t take = (std::min)(capacity - pos, (size_t)sector_size);
+            if (!chd.Read(f * CHD_CD_FRAME_SIZE, out + pos, take)) break;
+            pos += take;
+        }
+        *produced = pos;
+        return pos == capacity;
+    };
+    return IdentifyDiscPrefix(disc_size, read, result);
+}
+
+// ============================================================================
+// Entry points
+// ============================================================================
+
+DiscFormat DetectContainer(const uint8_t* header, size_t header_size) {
+    if (header_size < 0x18) return FORMAT_UNKNOWN;
+    if (ReadLE32(header) == GCZ_MAGIC) return FORMAT_GCZ;
+    if (memcmp(header, "ZISO", 4) == 0) return FORMAT_CSO;
+    // A Wii CISO has its block size (>= 0x8000) where CSO has its header
+    // size (0x18, or 0 in old files)
+    if (memcmp(header, "CISO", 4) == 0 && ReadLE32(header + 4) <= CSO_HEADER_SIZE) return FORMAT_CSO;
+    if (memcmp(header, "WUX0", 4) == 0 && ReadLE32(header + 4) == WUX_MAGIC_1) return FORMAT_WUX;
+    if (memcmp(header, "MComprHD", 8) == 0) return FORMAT_CHD;
+    return FORMAT_UNKNOWN;
+}
+
+bool IdentifyContainer(const char* file_path, DiscFormat format, GameIdentity* result) {
+    memset(result, 0, sizeof(GameIdentity));
+    RandomAccessFile file;
+    bool identified = false;
+    if (file.Open(file_path)) {
+        switch (format) {
+        case FORMAT_GCZ: identified = IdentifyGcz(file, result); break;
+        case FORMAT_CSO: identified = IdentifyCso(file, result); break;
+        case FORMAT_WUX: identified = IdentifyWux(file, result); break;
+        case FORMAT_CHD: identified = IdentifyChd(file, result); break;
+        default: break;
+        }
+    }
+    if (!identified) memset(result, 0, sizeof(GameIdentity));
+    result->format = format;
+    return identified;
+}
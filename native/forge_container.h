@@ -0,0 +1,30 @@
+#ifndef FORGE_CONTAINER_H
+#define FORGE_CONTAINER_H
+
+#include "platform_identifier.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Compressed disc images whose disc header sits behind a block index,
+// identified by decoding only the first blocks of the disc inside:
+//
+//   GCZ  Dolphin, GameCube/Wii: zlib blocks
+//   CSO  PSP/PS2 "CISO" (v1 deflate, v2 deflate/LZ4) and "ZISO" (LZ4)
+//   WUX  Wii U: WUD with duplicate sectors stored once
+//   CHD  MAME v5 CD, GD-ROM and DVD images: zlib, LZMA and the CD codecs
+//        built on them. Hunks stored as FLAC, Zstandard or Huffman, and
+//        hunks taken from a parent CHD, are not decoded.
+//
+// The disc is identified like a plain image (IDENTIFY_HEADER_SIZE first,
+// IDENTIFY_DEEP_HEADER_SIZE when that matched nothing), then format is set
+// to the container's. Containers whose disc header is at a fixed offset
+// (WBFS, RVZ/WIA, Wii CISO) go through identify_from_header instead.
+
+// Container type from the file's first bytes, or FORMAT_UNKNOWN
+DiscFormat DetectContainer(const uint8_t* header, size_t header_size);
+
+// Identify the disc inside a container DetectContainer recognised.
+// result->format is the container's even when false is returned.
+bool IdentifyContainer(const char* file_path, DiscFormat format, GameIdentity* result);
+
+#endif // FORGE_CONTAINER_H
@@ -0,0 +1,948 @@
+#include "forge/include/forge_core.h"
+#include "forge_logic.h"
+#include "forge_archive.h"
+#include "forge_batch.h"
+#include "forge_cache.h"
+#include "forge_catalog.h"
+#include "forge_dat.h"
+#include "forge_dupes.h"
+#include "forge_gametdb.h"
+#include "forge_hash.h"
+#include "forge_hash_kernels.h"
+#include "forge_json.h"
+#include "forge_library.h"
+#include "forge_scan.h"
+#include "forge_watch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::atomic<bool> g_initialized{false};
+static std::string g_db_path;
+
+// Files owned by forge_core live next to the library database. db_path may
+// name the database file or the directory that holds it.
+static std::string DataPath(const char* file_name) {
+    std::error_code ec;
+    fs::path base(g_db_path);
+    if (g_db_path.empty()) base = fs::current_path(ec);
+    else if (!fs::is_directory(base, ec)) base = base.parent_path();
+    return (base / file_name).string();
+}
+
+// Fixed-size header fields are NUL-padded
+static std::string_view FieldText(const char* field, size_t size) {
+    return std::string_view(field, strnlen(field, size));
+}
+
+// ============================================================================
+// Events
+// ============================================================================
+
+// Finished events wait as result blocks; polling hands them over as is
+static std::mutex g_events_mutex;
+static std::deque<const char*> g_events;
+
+static void PushEvent(JsonWriter& event) {
+    const char* json = event.Release();
+    if (!json) return;
+    std::lock_guard<std::mutex> lock(g_events_mutex);
+    g_events.push_back(json);
+}
+
+FORGE_API const char* forge_poll_event() {
+    std::lock_guard<std::mutex> lock(g_events_mutex);
+    if (g_events.empty()) return nullptr;
+    const char* event = g_events.front();
+    g_events.pop_front();
+    return event;
+}
+
+// Every string forge_core hands out is a JsonWriter result block
+FORGE_API void forge_free_string(const char* str) {
+    JsonWriter::ReleaseResult(str);
+}
+
+// ============================================================================
+// Scanning
+// ============================================================================
+
+static std::mutex g_scan_mutex;
+static std::thread g_scan_thread;
+static std::atomic<bool> g_scan_running{false};
+static std::atomic<bool> g_scan_cancel{false};
+
+static void ScanStatsFields(JsonWriter& json, const LibraryScanner::Stats& stats) {
+    json.Key("directories").UInt(stats.directories)
+        .Key("reused").UInt(stats.reused)
+        .Key("files").UInt(stats.files)
+        .Key("found").UInt(stats.found)
+        .Key("removed").UInt(stats.removed)
+        .Key("unchanged").UInt(stats.unchanged)
+        .Key("errors").UInt(stats.errors);
+}
+
+// Fields shared by title events and title lists. Games inside an archive
+// carry the archive as "path" and the entry as "member".
+static void TitleFields(JsonWriter& json, std::string_view path, const GameIdentity& identity) {
+    size_t separator = path.find(ARCHIVE_MEMBER_SEPARATOR);
+    if (separator == std::string_view::npos) {
+        json.Key("path").String(path);
+    } else {
+        json.Key("path").String(path.substr(0, separator)).Key("member").String(path.substr(separator + 1));
+    }
+    json.Key("platform").String(platform_to_string(identity.platform))
+        .Key("platform_id").Int((int)identity.platform)
+        .Key("format").Int((int)identity.format)
+        .Key("title_id").String(FieldText(identity.title_id, sizeof(identity.title_id)))
+        .Key("title").String(FieldText(identity.game_title, sizeof(identity.game_title)))
+        .Key("region").String(std::string_view(&identity.region, identity.region ? 1 : 0))
+        .Key("disc").Int(identity.disc_number)
+        .Key("size").UInt(identity.file_size);
+}
+
+// The library store follows every change as it is reported. Titles go out
+// as title_found for full scans and title_added / title_changed /
+// title_removed for incremental ones.
+static void PushScanChange(LibraryScanner::Change change, const std::string& path, const GameIdentity* identity) {
+    JsonWriter json;
+    json.BeginObject();
+    if (identity) {
+        if (change == LibraryScanner::Change::Removed) LibraryStore::Shared().Remove(path);
+        else LibraryStore::Shared().Upsert(path, *identity);
+        json.Key("type").String("title_" + std::string(LibraryScanner::ChangeName(change)));
+        TitleFields(json, path, *identity);
+    } else {
+        json.Key("type").String("root_unavailable").Key("path").String(path);
+    }
+    PushEvent(json.EndObject());
+}
+
+// Rebuild the library store from the snapshot of every root
+static void LoadLibraryStore() {
+    std::vector<std::pair<std::string, GameIdentity>> titles;
+    ScanSnapshot::Shared().ForEachTitle([&](const std::string& path, const GameIdentity& identity) {
+        titles.emplace_back(path, identity);
+    });
+    LibraryStore::Shared().Reset(titles);
+}
+
+static void StopScan() {
+    std::lock_guard<std::mutex> lock(g_scan_mutex);
+    g_scan_cancel.store(true);
+    if (g_scan_thread.joinable()) g_scan_thread.join();
+}
+
+FORGE_API int forge_scan_start(const char** root_paths, size_t path_count, int incremental) {
+    if (!g_initialized.load() || !root_paths || path_count == 0) return 0;
+
+    std::lock_guard<std::mutex> lock(g_scan_mutex);
+    if (g_scan_running.load()) return 0;
+    if (g_scan_thread.joinable()) g_scan_thread.join();
+
+    std::vector<std::string> roots;
+    for (size_t i = 0; i < path_count; i++) {
+        if (root_paths[i]) roots.emplace_back(root_paths[i]);
+    }
+    LibraryScanner::Options options;
+    options.incremental = incremental != 0;
+
+    g_scan_cancel.store(false);
+    g_scan_running.store(true);
+    JsonWriter started;
+    PushEvent(started.BeginObject()
+                  .Key("type").String("scan_started")
+                  .Key("roots").UInt(roots.size())
+                  .Key("incremental").Bool(options.incremental)
+                  .EndObject());
+    g_scan_thread = std::thread([roots, options]() {
+        auto started = std::chrono::steady_clock::now();
+        LibraryScanner::Stats stats = LibraryScanner::Run(
+            roots, options,
+            PushScanChange,
+            [](const LibraryScanner::Stats& progress) {
+                JsonWriter json;
+                json.BeginObject().Key("type").String("scan_progress");
+                ScanStatsFields(json, progress);
+                PushEvent(json.EndObject());
+            },
+            &g_scan_cancel);
+        // A completed scan replaced its roots' snapshots: titles under a
+        // root that disappeared during a full scan are dropped here
+        if (!stats.cancelled) LoadLibraryStore();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started).count();
+        JsonWriter json;
+        json.BeginObject().Key("type").String("scan_complete");
+        ScanStatsFields(json, stats);
+        PushEvent(json.Key("cancelled").Bool(stats.cancelled).Key("elapsed_ms").Int(elapsed).EndObject());
+        g_scan_running.store(false);
+    });
+    return 1;
+}
+
+FORGE_API int forge_scan_cancel() {
+    if (!g_scan_running.load()) return 0;
+    g_scan_cancel.store(true);
+    return 1;
+}
+
+// ============================================================================
+// Watching
+// ============================================================================
+
+static LibraryWatcher g_watcher;
+static std::mutex g_watch_mutex;
+
+FORGE_API int forge_watch_start(const char** root_paths, size_t path_count, uint32_t poll_interval_ms) {
+    if (!g_initialized.load() || !root_paths || path_count == 0) return 0;
+
+    std::vector<std::string> roots;
+    for (size_t i = 0; i < path_count; i++) {
+        if (root_paths[i]) roots.emplace_back(root_paths[i]);
+    }
+    std::lock_guard<std::mutex> lock(g_watch_mutex);
+    g_watcher.Stop();
+    return g_watcher.Start(roots, PushScanChange, poll_interval_ms) ? 1 : 0;
+}
+
+FORGE_API int forge_watch_stop() {
+    std::lock_guard<std::mutex> lock(g_watch_mutex);
+    if (!g_watcher.Running()) return 0;
+    g_watcher.Stop();
+    return 1;
+}
+
+// ============================================================================
+// Library queries
+// ============================================================================
+
+// Calls fn for a single value or for every item of an array
+template <typename Fn>
+static bool ForEachValue(const JsonValue* value, Fn fn) {
+    if (!value) return true;
+    if (!value->IsArray()) return fn(*value);
+    for (const auto& item : value->items) {
+        if (!fn(item)) return false;
+    }
+    return true;
+}
+
+static bool SameName(const std::string& a, const char* b) {
+    size_t length = strlen(b);
+    if (a.size() != length) return false;
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+static bool ParseSize(const JsonValue* value, uint64_t* out) {
+    if (!value) return true;
+    if (!value->IsNumber() || value->number < 0) return false;
+    *out = value->number >= 18446744073709551615.0 ? UINT64_MAX : (uint64_t)value->number;
+    return true;
+}
+
+// Filter for forge_get_title_list and forge_get_issues_list; every field is
+// optional and a single value may stand in for an array:
+//   {"platform": ["Nintendo Wii", 2], "region": ["E", "P"], "format": "WBFS",
+//    "status": "verified", "issue": "same_title", "search": "mario",
+//    "min_size": 0, "max_size": 1e9, "sort": "title", "order": "desc",
+//    "offset": 0, "limit": 100}
+// Platforms and formats are names or enum values. sort is one of title,
+// title_id, platform, region, format, size, path, status; limit 0 returns
+// every match.
+static bool ParseTitleFilter(const char* filter_json, LibraryStore::Filter* filter) {
+    if (!filter_json || !filter_json[0]) return true;
+    JsonValue root;
+    if (!JsonValue::Parse(filter_json, &root) || !root.IsObject()) return false;
+
+    bool ok = ForEachValue(root.Find("platform"), [&](const JsonValue& v) {
+        for (int p = PLATFORM_UNKNOWN; p <= PLATFORM_DREAMCAST; p++) {
+            if ((v.IsNumber() && v.number == p) || (v.IsString() && SameName(v.string, platform_to_string((Platform)p)))) {
+                filter->platforms.push_back((Platform)p);
+                return true;
+            }
+        }
+        return false;
+    });
+    ok = ok && ForEachValue(root.Find("region"), [&](const JsonValue& v) {
+        if (!v.IsString() || v.string.size() > 1) return false;
+        filter->regions.push_back(v.string.empty() ? '\0' : v.string[0]);
+        return true;
+    });
+    ok = ok && ForEachValue(root.Find("format"), [&](const JsonValue& v) {
+        for (int f = FORMAT_UNKNOWN; f <= FORMAT_GCZ; f++) {
+            if ((v.IsNumber() && v.number == f) || (v.IsString() && SameName(v.string, disc_format_to_string((DiscFormat)f)))) {
+                filter->formats.push_back((DiscFormat)f);
+                return true;
+            }
+        }
+        return false;
+    });
+    ok = ok && ForEachValue(root.Find("status"), [&](const JsonValue& v) {
+        TitleStatus status;
+        if (!v.IsString() || !ParseTitleStatus(v.string, &status)) return false;
+        filter->statuses.push_back(status);
+        return true;
+    });
+    ok = ok && ForEachValue(root.Find("issue"), [&](const JsonValue& v) {
+        TitleIssue issue;
+        if (!v.IsString() || !ParseTitleIssue(v.string, &issue)) return false;
+        filter->issues |= issue;
+        return true;
+    });
+    ok = ok && ParseSize(root.Find("min_size"), &filter->min_size) && ParseSize(root.Find("max_size"), &filter->max_size);
+    if (!ok) return false;
+
+    if (const JsonValue* search = root.Find("search")) {
+        if (!search->IsString()) return false;
+        filter->search = search->string;
+    }
+    if (const JsonValue* sort = root.Find("sort")) {
+        static const std::pair<const char*, LibraryStore::SortKey> KEYS[] = {
+            { "title", LibraryStore::SortKey::Title }, { "title_id", LibraryStore::SortKey::TitleId },
+            { "platform", LibraryStore::SortKey::Platform }, { "region", LibraryStore::SortKey::Region },
+            { "format", LibraryStore::SortKey::Format }, { "size", LibraryStore::SortKey::Size },
+            { "path", LibraryStore::SortKey::Path }, { "status", LibraryStore::SortKey::Status },
+        };
+        bool known = false;
+        for (const auto& key : KEYS) {
+            if (sort->IsString() && sort->string == key.first) {
+                filter->sort = key.second;
+                known = true;
+            }
+        }
+        if (!known) return false;
+    }
+    if (const JsonValue* order = root.Find("order")) {
+        if (!order->IsString() || (order->string != "asc" && order->string != "desc")) return false;
+        filter->descending = order->string == "desc";
+    }
+    uint64_t offset = filter->offset, limit = filter->limit;
+    if (!ParseSize(root.Find("offset"), &offset) || !ParseSize(root.Find("limit"), &limit)) return false;
+    filter->offset = (size_t)(std::min)(offset, (uint64_t)SIZE_MAX);
+    filter->limit = (size_t)(std::min)(limit, (uint64_t)SIZE_MAX);
+    return true;
+}
+
+static void IssuesJson(JsonWriter& json, uint32_t issues) {
+    json.BeginArray();
+    for (TitleIssue issue : { ISSUE_SAME_TITLE, ISSUE_NO_TITLE_ID, ISSUE_SCRUBBED, ISSUE_DAMAGED }) {
+        if (issues & issue) json.String(TitleIssueName(issue));
+    }
+    json.EndArray();
+}
+
+// Titles are written straight from the store's columns, with no copy of
+// the page in between
+static void PageJson(JsonWriter& json, const LibraryStore::Filter& filter) {
+    json.BeginObject().Key("titles").BeginArray();
+    size_t total = LibraryStore::Shared().Visit(filter, [&](const LibraryStore::TitleView& title) {
+        json.BeginObject().Key("id").Int(title.id);
+        TitleFields(json, title.path, *title.identity);
+        json.Key("format_name").String(disc_format_to_string(title.identity->format))
+            .Key("status").String(TitleStatusName(title.status))
+            .Key("issues");
+        IssuesJson(json, title.issues);
+        json.EndObject();
+    });
+    json.EndArray()
+        .Key("total").UInt(total)
+        .Key("offset").UInt(filter.offset)
+        .Key("limit").UInt(filter.limit)
+        .EndObject();
+}
+
+static void GroupFields(JsonWriter& json, const LibraryStore::Group& group) {
+    json.Key("titles").UInt(group.titles).Key("size").UInt(group.bytes);
+}
+
+FORGE_API const char* forge_get_library_summary() {
+    LibraryStore::Summary summary = LibraryStore::Shared().GetSummary();
+    JsonWriter json(1024);
+    json.BeginObject().Key("titles").UInt(summary.titles).Key("size").UInt(summary.bytes);
+
+    json.Key("platforms").BeginArray();
+    for (const auto& entry : summary.platforms) {
+        json.BeginObject()
+            .Key("platform").String(platform_to_string(entry.first))
+            .Key("platform_id").Int((int)entry.first);
+        GroupFields(json, entry.second);
+        json.EndObject();
+    }
+    json.EndArray().Key("regions").BeginArray();
+    for (const auto& entry : summary.regions) {
+        json.BeginObject().Key("region").String(std::string_view(&entry.first, entry.first ? 1 : 0));
+        GroupFields(json, entry.second);
+        json.EndObject();
+    }
+    json.EndArray().Key("formats").BeginArray();
+    for (const auto& entry : summary.formats) {
+        json.BeginObject()
+            .Key("format").Int((int)entry.first)
+            .Key("format_name").String(disc_format_to_string(entry.first));
+        GroupFields(json, entry.second);
+        json.EndObject();
+    }
+    json.EndArray().Key("statuses").BeginObject();
+    for (const auto& entry : summary.statuses) json.Key(TitleStatusName(entry.first)).UInt(entry.second.titles);
+    json.EndObject().Key("issues").BeginObject();
+    for (const auto& entry : summary.issues) json.Key(TitleIssueName(entry.first)).UInt(entry.second);
+    return json.EndObject().EndObject().Release();
+}
+
+static bool ListFilter(const char* filter_json, bool issues_only, LibraryStore::Filter* filter) {
+    if (!ParseTitleFilter(filter_json, filter)) return false;
+    if (issues_only && !filter->issues) filter->issues = ISSUE_ALL;
+    return true;
+}
+
+static JsonWriter& InvalidFilterJson(JsonWriter& json) {
+    return json.BeginObject().Key("error").String("invalid_filter").EndObject();
+}
+
+// A listed title runs to about 400 bytes, so the block is sized once for
+// the whole page
+static const char* TitleList(const char* filter_json, bool issues_only) {
+    LibraryStore::Filter filter;
+    if (!ListFilter(filter_json, issues_only, &filter)) {
+        JsonWriter json;
+        return InvalidFilterJson(json).Release();
+    }
+    // The page size is only known once the filter ran under the store lock;
+    // the writer doubles from its default block instead of guessing from the
+    // library size, which overshoots any narrow filter
+    JsonWriter json;
+    PageJson(json, filter);
+    return json.Release();
+}
+
+static size_t TitleListInto(const char* filter_json, bool issues_only, char* buffer, size_t buffer_size) {
+    JsonWriter json(buffer, buffer_size);
+    LibraryStore::Filter filter;
+    if (ListFilter(filter_json, issues_only, &filter)) PageJson(json, filter);
+    else InvalidFilterJson(json);
+    json.Release();
+    return json.Length();
+}
+
+FORGE_API const char* forge_get_title_list(const char* filter_json) {
+    return TitleList(filter_json, false);
+}
+
+// The title list restricted to titles with at least one issue
+FORGE_API const char* forge_get_issues_list(const char* filter_json) {
+    return TitleList(filter_json, true);
+}
+
+FORGE_API size_t forge_get_title_list_into(const char* filter_json, char* buffer, size_t buffer_size) {
+    return TitleListInto(filter_json, false, buffer, buffer_size);
+}
+
+FORGE_API size_t forge_get_issues_list_into(const char* filter_json, char* buffer, size_t buffer_size) {
+    return TitleListInto(filter_json, true, buffer, buffer_size);
+}
+
+// ============================================================================
+// Remote catalog
+// ============================================================================
+
+// The search index follows the catalog file; it is rebuilt from the file on
+// the first search after the file was loaded or replaced
+static std::mutex g_catalog_mutex;
+static bool g_catalog_stale = false;
+
+static void LoadCatalog() {
+    std::lock_guard<std::mutex> lock(g_catalog_mutex);
+    g_catalog_stale = CatalogFile::Shared().Load(DataPath("catalog.fcat"));
+}
+
+FORGE_API int forge_catalog_save(const char** titles, const char** urls, const uint64_t* sizes, const char** platforms,
+                                 const char** sources, const char** formats, size_t count) {
+    if (count && !titles) return 0;
+    auto text = [](const char** column, size_t i) { return column && column[i] ? std::string(column[i]) : std::string(); };
+    std::vector<CatalogFile::Entry> entries(count);
+    for (size_t i = 0; i < count; i++) {
+        CatalogFile::Entry& entry = entries[i];
+        entry.title = text(titles, i);
+        entry.url = text(urls, i);
+        entry.size = sizes ? sizes[i] : 0;
+        entry.platform = text(platforms, i);
+        entry.source = text(sources, i);
+        entry.format = text(formats, i);
+    }
+    CatalogFile::Shared().Unload();
+    bool written = CatalogFile::Write(std::move(entries), DataPath("catalog.fcat"));
+    LoadCatalog();
+    return written ? 1 : 0;
+}
+
+FORGE_API size_t forge_catalog_count() {
+    return CatalogFile::Shared().Count();
+}
+
+FORGE_API const char* forge_catalog_get_entries(const uint32_t* ids, size_t count) {
+    JsonWriter json(64 + count * 256);
+    json.BeginArray();
+    CatalogFile::Entry entry;
+    for (size_t i = 0; ids && i < count; i++) {
+        if (!CatalogFile::Shared().Get(ids[i], &entry)) continue;
+        json.BeginObject()
+            .Key("id").UInt(ids[i])
+            .Key("title").String(entry.title)
+            .Key("url").String(entry.url)
+            .Key("size").UInt(entry.size)
+            .Key("platform").String(entry.platform)
+            .Key("source").String(entry.source)
+            .Key("format").String(entry.format)
+            .EndObject();
+    }
+    return json.EndArray().Release();
+}
+
+FORGE_API int forge_catalog_build(const char** titles, const char** platforms, size_t count) {
+    if (count && !titles) return 0;
+    std::vector<CatalogIndex::Entry> entries(count);
+    for (size_t i = 0; i < count; i++) {
+        if (titles[i]) entries[i].title = titles[i];
+        if (platforms && platforms[i]) entries[i].platform = platforms[i];
+    }
+    std::lock_guard<std::mutex> lock(g_catalog_mutex);
+    CatalogIndex::Shared().Build(entries);
+    g_catalog_stale = false;
+    return 1;
+}
+
+FORGE_API size_t forge_catalog_search(const char* query, const char* platform, uint32_t* ids, size_t max_results) {
+    if (!query) return 0;
+    {
+        std::lock_guard<std::mutex> lock(g_catalog_mutex);
+        if (g_catalog_stale) CatalogIndex::Shared().Build(CatalogFile::Shared());
+        g_catalog_stale = false;
+    }
+    return CatalogIndex::Shared().Search(query, platform ? platform : "", ids, max_results);
+}
+
+// ============================================================================
+// GameTDB metadata
+// ============================================================================
+
+FORGE_API int forge_gametdb_import(const char* xml_path, const char* index_path) {
+    if (!xml_path) return 0;
+    std::string target = index_path ? index_path : DataPath("gametdb.fgdb");
+
+    GameTdbIndex::Shared().Unload();
+    GameTdbIndex::ImportStats stats;
+    bool built = GameTdbIndex::Build(xml_path, target, &stats);
+    if (built) {
+        std::cout << "[Forge] GameTDB import: " << stats.games << " games, " << stats.names << " titles, "
+                  << stats.duplicates << " skipped" << std::endl;
+    }
+    return GameTdbIndex::Shared().Load(target) && built ? 1 : 0;
+}
+
+static void WriteControls(JsonWriter& json, uint32_t controls) {
+    json.BeginArray();
+    for (size_t bit = 0; bit < GAMETDB_CONTROL_COUNT; bit++) {
+        GameTdbControl control = (GameTdbControl)(1u << bit);
+        if (controls & control) json.String(GameTdbControlName(control));
+    }
+    json.EndArray();
+}
+
+FORGE_API const char* forge_gametdb_lookup(const char** title_ids, size_t count) {
+    std::vector<std::string> ids;
+    if (title_ids) {
+        ids.reserve(count);
+        for (size_t i = 0; i < count; i++) ids.emplace_back(title_ids[i] ? title_ids[i] : "");
+    } else {
+        for (const LibraryStore::Title& title : LibraryStore::Shared().All()) {
+            const char* id = title.identity.title_id;
+            ids.emplace_back(id, strnlen(id, sizeof(title.identity.title_id)));
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    JsonWriter json(64 + ids.size() * 384);
+    json.BeginObject();
+    GameTdbIndex::Shared().FindAll(ids, [&](size_t i, const GameTdbRecord& record) {
+        json.Key(ids[i]).BeginObject()
+            .Key("id").String(record.title_id)
+            .Key("region").String(record.region)
+            .Key("type").String(record.type)
+            .Key("names").BeginObject();
+        for (const auto& name : record.names) json.Key(name.first).String(name.second);
+        json.EndObject()
+            .Key("players").UInt(record.players)
+            .Key("wifi_players").UInt(record.wifi_players)
+            .Key("controllers");
+        WriteControls(json, record.controllers);
+        json.Key("required_controllers");
+        WriteControls(json, record.required_controllers);
+        json.Key("sizes").BeginArray();
+        for (uint64_t size : record.sizes) json.UInt(size);
+        json.EndArray().EndObject();
+    });
+    return json.EndObject().Release();
+}
+
+// ============================================================================
+// Batch verification
+// ============================================================================
+
+struct VerifyBatch {
+    std::thread thread;
+    std::atomic<bool> cancel{false};
+    std::atomic<bool> finished{false};
+};
+
+static std::mutex g_batches_mutex;
+static std::map<int64_t, std::unique_ptr<VerifyBatch>> g_batches;
+static int64_t g_next_batch_id = 1;
+
+// Join batches whose thread has exited (or all of them when stopping)
+static void ReapBatches(bool stop_all) {
+    std::vector<std::unique_ptr<VerifyBatch>> done;
+    {
+        std::lock_guard<std::mutex> lock(g_batches_mutex);
+        for (auto it = g_batches.begin(); it != g_batches.end();) {
+            if (stop_all) it->second->cancel.store(true);
+            if (stop_all || it->second->finished.load()) {
+                done.push_back(std::move(it->second));
+                it = g_batches.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& batch : done) {
+        if (batch->thread.joinable()) batch->thread.join();
+    }
+}
+
+static void PushVerifyResult(int64_t batch_id, const BatchVerifier::FileResult& r, size_t done, size_t total) {
+    JsonWriter json(512);
+    json.BeginObject()
+        .Key("type").String("verify_result")
+        .Key("batch_id").Int(batch_id)
+        .Key("path").String(r.path)
+        .Key("device").String(r.device)
+        .Key("status").String(BatchVerifier::StatusName(r.status))
+        .Key("done").UInt(done)
+        .Key("total").UInt(total);
+    if (r.quick_ran) {
+        json.Key("confidence").Double(r.quick.confidence, 3);
+        if (!r.quick.first_failure.empty()) json.Key("reason").String(r.quick.first_failure);
+    }
+    if (r.hashes.ok) json.Key("crc32").String(r.hashes.Crc32Hex()).Key("sha1").String(r.hashes.Sha1Hex());
+    if (!r.dat_name.empty()) json.Key("dat_name").String(r.dat_name);
+    if (!r.error.empty()) json.Key("error").String(r.error);
+    PushEvent(json.EndObject());
+}
+
+static TitleStatus TitleStatusFor(BatchVerifier::Status status) {
+    switch (status) {
+    case BatchVerifier::Status::Healthy: return TitleStatus::Healthy;
+    case BatchVerifier::Status::Verified: return TitleStatus::Verified;
+    case BatchVerifier::Status::Unknown: return TitleStatus::Unknown;
+    case BatchVerifier::Status::Suspicious: return TitleStatus::Suspicious;
+    default: return TitleStatus::Error;
+    }
+}
+
+FORGE_API int64_t forge_verify_batch_start(const char** paths, size_t path_count, const char* mode) {
+    if (!g_initialized.load() || !paths || path_count == 0) return 0;
+    BatchVerifier::Mode batch_mode = BatchVerifier::Mode::Triage;
+    if (mode && mode[0] && !BatchVerifier::ParseMode(mode, &batch_mode)) return 0;
+
+    std::vector<std::string> list;
+    for (size_t i = 0; i < path_count; i++) {
+        if (paths[i]) list.emplace_back(paths[i]);
+    }
+    ReapBatches(false);
+
+    std::lock_guard<std::mutex> lock(g_batches_mutex);
+    int64_t batch_id = g_next_batch_id++;
+    auto batch = std::make_unique<VerifyBatch>();
+    VerifyBatch* raw = batch.get();
+    raw->thread = std::thread([raw, batch_id, list, batch_mode]() {
+        BatchVerifier::Summary summary = BatchVerifier::Run(
+            list, batch_mode,
+            [batch_id](const BatchVerifier::FileResult& r, size_t done, size_t total) {
+                LibraryStore::Shared().SetStatus(r.path, TitleStatusFor(r.status));
+                PushVerifyResult(batch_id, r, done, total);
+            },
+            &raw->cancel);
+        JsonWriter json;
+        PushEvent(json.BeginObject()
+                      .Key("type").String("verify_complete")
+                      .Key("batch_id").Int(batch_id)
+                      .Key("files").UInt(summary.files)
+                      .Key("healthy").UInt(summary.healthy)
+                      .Key("verified").UInt(summary.verified)
+                      .Key("unknown").UInt(summary.unknown)
+                      .Key("suspicious").UInt(summary.suspicious)
+                      .Key("errors").UInt(summary.errors)
+                      .Key("cancelled").Bool(summary.cancelled)
+                      .EndObject());
+        raw->finished.store(true);
+    });
+    g_batches[batch_id] = std::move(batch);
+    return batch_id;
+}
+
+FORGE_API int forge_verify_batch_cancel(int64_t batch_id) {
+    std::lock_guard<std::mutex> lock(g_batches_mutex);
+    auto it = g_batches.find(batch_id);
+    if (it == g_batches.end()) return 0;
+    it->second->cancel.store(true);
+    return 1;
+}
+
+// ============================================================================
+// Fix plan
+// ============================================================================
+
+static std::mutex g_plan_mutex;
+static std::thread g_plan_thread;
+static std::atomic<bool> g_plan_running{false};
+static std::atomic<bool> g_plan_cancel{false};
+
+static void DupeStatsFields(JsonWriter& json, const DuplicateFinder::Stats& stats) {
+    json.Key("candidates").UInt(stats.candidates)
+        .Key("hard_links").UInt(stats.hard_links)
+        .Key("bucketed").UInt(stats.bucketed)
+        .Key("partial_hashed").UInt(stats.partial_hashed)
+        .Key("colliding").UInt(stats.colliding)
+        .Key("full_hashed").UInt(stats.full_hashed)
+        .Key("bytes_read").UInt(stats.bytes_read)
+        .Key("errors").UInt(stats.errors);
+}
+
+// Byte-identical copies among the library's files (Wii U folders and games
+// inside archives are left out). Every group keeps its first path in sort
+// order and lists the others for removal:
+//   {"type":"fix_plan","groups":[{"sha1","size","title_id","title","keep",
+//    "remove":[...],"reclaim":n}],"actions":[{"action":"delete_duplicate",
+//    "path","duplicate_of","size"}],"reclaimable":n,"cancelled":false,
+//    "stats":{...}}
+// A cancelled plan has no groups or actions.
+static void RunFixPlan() {
+    std::vector<DuplicateFinder::Candidate> candidates;
+    std::map<std::string, std::string> titles;
+    for (const auto& title : LibraryStore::Shared().All()) {
+        std::string archive, member;
+        if (title.identity.format == FORMAT_FOLDER || SplitArchiveMemberPath(title.path, &archive, &member)) continue;
+        DuplicateFinder::Candidate candidate;
+        candidate.path = title.path;
+        candidate.title_id = std::string(title.identity.title_id, strnlen(title.identity.title_id, sizeof(title.identity.title_id)));
+        candidate.size = title.identity.file_size;
+        candidates.push_back(std::move(candidate));
+        titles[title.path] = std::string(title.identity.game_title, strnlen(title.identity.game_title, sizeof(title.identity.game_title)));
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    DuplicateFinder::Stats stats;
+    std::vector<DuplicateFinder::Group> groups = DuplicateFinder::Find(
+        candidates, &stats, &g_plan_cancel,
+        [](const DuplicateFinder::Stats& progress) {
+            JsonWriter json;
+            json.BeginObject().Key("type").String("fix_plan_progress");
+            DupeStatsFields(json, progress);
+            PushEvent(json.EndObject());
+        });
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    if (stats.cancelled) groups.clear();
+
+    JsonWriter json;
+    json.BeginObject().Key("type").String("fix_plan").Key("groups").BeginArray();
+    uint64_t reclaimable = 0;
+    for (const auto& group : groups) {
+        const std::string& keep = group.paths.front();
+        uint64_t reclaim = group.size * (group.paths.size() - 1);
+        reclaimable += reclaim;
+        json.BeginObject()
+            .Key("sha1").String(group.sha1)
+            .Key("size").UInt(group.size)
+            .Key("title_id").String(group.title_id)
+            .Key("title").String(titles[keep])
+            .Key("keep").String(keep)
+            .Key("remove").BeginArray();
+        for (size_t i = 1; i < group.paths.size(); i++) json.String(group.paths[i]);
+        json.EndArray().Key("reclaim").UInt(reclaim).EndObject();
+    }
+    json.EndArray().Key("actions").BeginArray();
+    for (const auto& group : groups) {
+        for (size_t i = 1; i < group.paths.size(); i++) {
+            json.BeginObject()
+                .Key("action").String("delete_duplicate")
+                .Key("path").String(group.paths[i])
+                .Key("duplicate_of").String(group.paths.front())
+                .Key("size").UInt(group.size)
+                .EndObject();
+        }
+    }
+    json.EndArray()
+        .Key("reclaimable").UInt(reclaimable)
+        .Key("cancelled").Bool(stats.cancelled)
+        .Key("stats").BeginObject();
+    DupeStatsFields(json, stats);
+    PushEvent(json.Key("elapsed_ms").Int(elapsed).EndObject().EndObject());
+}
+
+static void StopFixPlan() {
+    std::lock_guard<std::mutex> lock(g_plan_mutex);
+    g_plan_cancel.store(true);
+    if (g_plan_thread.joinable()) g_plan_thread.join();
+}
+
+FORGE_API int forge_generate_fix_plan() {
+    if (!g_initialized.load()) return 0;
+
+    std::lock_guard<std::mutex> lock(g_plan_mutex);
+    if (g_plan_running.load()) return 0;
+    if (g_plan_thread.joinable()) g_plan_thread.join();
+
+    g_plan_cancel.store(false);
+    g_plan_running.store(true);
+    JsonWriter started;
+    PushEvent(started.BeginObject().Key("type").String("fix_plan_started").EndObject());
+    g_plan_thread = std::thread([]() {
+        RunFixPlan();
+        g_plan_running.store(false);
+    });
+    return 1;
+}
+
+FORGE_API int forge_fix_plan_cancel() {
+    if (!g_plan_running.load()) return 0;
+    g_plan_cancel.store(true);
+    return 1;
+}
+
+// ============================================================================
+// Initialization
+// ============================================================================
+
+FORGE_API int forge_init(const char* db_path) {
+    if (g_initialized.exchange(true)) return 1;
+    g_db_path = db_path ? db_path : "";
+
+    // Pick the fastest hash kernels for this CPU once, up front
+    HashKernels::Init();
+    const HashKernels& kernels = HashKernels::Active();
+    std::cout << "[Forge] Hash kernels: SHA-1=" << kernels.sha1_name
+              << ", CRC32=" << kernels.crc32_name << std::endl;
+
+    // Map the DAT index; lookups need no parsing
+    if (DatIndex::Shared().Load(DataPath("redump.fdx"))) {
+        std::cout << "[Forge] DAT index: " << DatIndex::Shared().Count() << " entries" << std::endl;
+    }
+
+    // Identification and hashes of files that have not changed since last run
+    FingerprintCache::Shared().Open(DataPath("fingerprints.fcache"));
+    // Directory tree of each root as of its last scan, for incremental scans
+    ScanSnapshot::Shared().Open(DataPath("scan.fsnap"));
+    // Queryable library as of the last run, mapped in place; rebuilt from
+    // the scan snapshot when missing or from an incompatible build
+    if (LibraryStore::Shared().Open(DataPath("library.flib"))) {
+        std::cout << "[Forge] Library: " << LibraryStore::Shared().Count() << " titles" << std::endl;
+    } else {
+        LoadLibraryStore();
+    }
+    // Remote catalog as of the last sync, mapped read-only
+    LoadCatalog();
+    if (CatalogFile::Shared().IsLoaded()) {
+        std::cout << "[Forge] Catalog: " << CatalogFile::Shared().Count() << " entries" << std::endl;
+    }
+    // GameTDB metadata, looked up in place by title ID
+    if (GameTdbIndex::Shared().Load(DataPath("gametdb.fgdb"))) {
+        std::cout << "[Forge] GameTDB: " << GameTdbIndex::Shared().Count() << " games" << std::endl;
+    }
+    return 1;
+}
+
+FORGE_API void forge_shutdown() {
+    if (!g_initialized.exchange(false)) return;
+    forge_watch_stop();
+    StopScan();
+    StopFixPlan();
+    ReapBatches(true);
+    DatIndex::Shared().Unload();
+    CatalogFile::Shared().Unload();
+    GameTdbIndex::Shared().Unload();
+    FingerprintCache::Shared().Save();
+    LibraryStore::Shared().Close();
+}
+
+FORGE_API const char* forge_get_version() {
+    return "1.0.0";
+}
+
+// ============================================================================
+// Health engine
+// ============================================================================
+
+FORGE_API int forge_calculate_hash(const char* file_path, char* hash_output, size_t hash_size) {
+    if (!file_path || !hash_output || hash_size == 0) return 0;
+    hash_output[0] = '\0';
+
+    // SHA-1 hex digest plus terminator
+    if (hash_size < 41) return 0;
+
+    HashResult result = FingerprintCache::Shared().Hash(file_path, HASH_SHA1);
+    if (!result.ok) return 0;
+    FingerprintCache::Shared().Save();
+
+    std::string hex = result.Sha1Hex();
+    memcpy(hash_output, hex.c_str(), hex.size() + 1);
+    return 1;
+}
+
+FORGE_API int forge_dat_import(const char** dat_paths, size_t dat_count, const char* index_path) {
+    if (!dat_paths || dat_count == 0) return 0;
+
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < dat_count; i++) {
+        if (dat_paths[i]) paths.emplace_back(dat_paths[i]);
+    }
+    std::string target = index_path ? index_path : DataPath("redump.fdx");
+
+    DatIndex::Shared().Unload();
+    // On failure the previous index is untouched on disk and is mapped again
+    bool built = DatIndex::Build(paths, target);
+    return DatIndex::Shared().Load(target) && built ? 1 : 0;
+}
+
+FORGE_API int forge_verify_redump_hash(const char* file_path, const char* expected_hash) {
+    if (!file_path) return 0;
+    if (expected_hash && expected_hash[0]) {
+        std::string expected(expected_hash);
+        uint32_t kind = HashEngine::KindForHex(expected);
+        if (kind == 0) return 0;
+        HashResult result = FingerprintCache::Shared().Hash(file_path, kind);
+        FingerprintCache::Shared().Save();
+        return HashEngine::Matches(result, expected) ? 1 : 0;
+    }
+    bool verified = IntegrityAuditor::VerifyRedumpHash(file_path, "");
+    FingerprintCache::Shared().Save();
+    return verified ? 1 : 0;
+}
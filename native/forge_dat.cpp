@@ -0,0 +1,286 @@
+#include "forge_dat.h"
+#include "forge_hash.h"
+#include "forge_xml.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static bool ParseHex(const std::string* text, uint8_t* out, size_t out_size) {
+    if (!text || text->size() != out_size * 2) return false;
+    for (size_t i = 0; i < out_size; i++) {
+        int value = 0;
+        for (int j = 0; j < 2; j++) {
+            char c = (*text)[i * 2 + j];
+            int nibble;
+            if (c >= '0' && c <= '9') nibble = c - '0';
+            else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+            else return false;
+            value = (value << 4) | nibble;
+        }
+        out[i] = (uint8_t)value;
+    }
+    return true;
+}
+
+static bool IsZero(const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (data[i]) return false;
+    }
+    return true;
+}
+
+static std::string Trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+// ============================================================================
+// Import
+// ============================================================================
+
+bool DatIndex::Build(const std::vector<std::string>& dat_paths, const std::string& index_path,
+                     ImportStats* stats) {
+    ImportStats local;
+    std::vector<DatIndexEntry> entries;
+    // Offset 0 is the shared empty string
+    std::string pool(1, '\0');
+    bool too_big = false;
+
+    // Offsets are 32-bit: a string that would end past 4 GiB is refused
+    // before anything is cast
+    auto intern = [&pool, &too_big](const std::string& s) -> uint32_t {
+        if (s.empty()) return 0;
+        if (pool.size() + s.size() + 1 > UINT32_MAX) {
+            too_big = true;
+            return 0;
+        }
+        uint32_t offset = (uint32_t)pool.size();
+        pool += s;
+        pool.push_back('\0');
+        return offset;
+    };
+
+    for (const auto& dat_path : dat_paths) {
+        XmlStreamReader xml;
+        if (!xml.Open(dat_path)) return false;
+        local.dat_files++;
+
+        bool in_game = false;
+        std::string game_name;
+        std::string serial;
+        std::vector<DatIndexEntry> game_roms;
+
+        while (true) {
+            XmlStreamReader::Event ev = xml.Next();
+            if (ev == XmlStreamReader::Event::End) break;
+            if (ev == XmlStreamReader::Event::Error) return false;
+
+            const std::string& name = xml.Name();
+            if (ev == XmlStreamReader::Event::StartElement) {
+                if (name == "game" || name == "machine") {
+                    in_game = true;
+                    const std::string* attr = xml.Attribute("name");
+                    game_name = attr ? *attr : "";
+                    serial.clear();
+                    game_roms.clear();
+                } else if (in_game && name == "serial") {
+                    serial = Trim(xml.ReadElementText());
+                } else if (in_game && name == "rom") {
+                    DatIndexEntry entry;
+                    memset(&entry, 0, sizeof(entry));
+                    uint8_t crc_bytes[4];
+                    bool has_crc = ParseHex(xml.Attribute("crc"), crc_bytes, 4);
+                    if (has_crc) {
+                        entry.crc32 = ((uint32_t)crc_bytes[0] << 24) | ((uint32_t)crc_bytes[1] << 16) |
+                                      ((uint32_t)crc_bytes[2] << 8) | crc_bytes[3];
+                    }
+                    bool has_sha1 = ParseHex(xml.Attribute("sha1"), entry.sha1, 20);
+                    ParseHex(xml.Attribute("md5"), entry.md5, 16);
+                    if (const std::string* size = xml.Attribute("size")) {
+                        entry.size = strtoull(size->c_str(), nullptr, 10);
+                    }
+                    if (has_crc || has_sha1) game_roms.push_back(entry);
+                }
+            } else if (ev == XmlStreamReader::Event::EndElement && in_game &&
+                       (name == "game" || name == "machine")) {
+                in_game = false;
+                local.games++;
+                if (game_roms.empty()) continue;
+                uint32_t name_offset = intern(game_name);
+                uint32_t serial_offset = intern(serial);
+                if (too_big) return false;
+                for (auto& rom : game_roms) {
+                    rom.name_offset = name_offset;
+                    rom.serial_offset = serial_offset;
+                    entries.push_back(rom);
+                }
+                local.roms += game_roms.size();
+            }
+        }
+    }
+
+    // Sort by SHA-1 (stable, so the first DAT wins on duplicates)
+    auto entry_less = [](const DatIndexEntry& a, const DatIndexEntry& b) {
+        int cmp = memcmp(a.sha1, b.sha1, 20);
+        if (cmp != 0) return cmp < 0;
+        if (a.crc32 != b.crc32) return a.crc32 < b.crc32;
+        return a.size < b.size;
+    };
+    std::stable_sort(entries.begin(), entries.end(), entry_less);
+    auto last = std::unique(entries.begin(), entries.end(), [](const DatIndexEntry& a, const DatIndexEntry& b) {
+        return memcmp(a.sha1, b.sha1, 20) == 0 && a.crc32 == b.crc32 && a.size == b.size;
+    });
+    local.duplicates = (size_t)(entries.end() - last);
+    entries.erase(last, entries.end());
+
+    std::vector<DatCrcKey> crc_keys(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        crc_keys[i] = { entries[i].crc32, (uint32_t)i, entries[i].size };
+    }
+    std::sort(crc_keys.begin(), crc_keys.end(), [](const DatCrcKey& a, const DatCrcKey& b) {
+        if (a.crc32 != b.crc32) return a.crc32 < b.crc32;
+        return a.size < b.size;
+    });
+
+    DatIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = DAT_INDEX_MAGIC;
+    header.version = DAT_INDEX_VERSION;
+    header.entry_count = (uint32_t)entries.size();
+    header.source_count = (uint32_t)local.dat_files;
+    header.entries_offset = sizeof(DatIndexHeader);
+    header.crc_keys_offset = header.entries_offset + entries.size() * sizeof(DatIndexEntry);
+    header.strings_offset = header.crc_keys_offset + crc_keys.size() * sizeof(DatCrcKey);
+    header.strings_size = pool.size();
+
+    bool written = WriteFileAtomically(index_path, [&](FILE* f) {
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        if (ok && !entries.empty()) ok = fwrite(entries.data(), sizeof(DatIndexEntry), entries.size(), f) == entries.size();
+        if (ok && !crc_keys.empty()) ok = fwrite(crc_keys.data(), sizeof(DatCrcKey), crc_keys.size(), f) == crc_keys.size();
+        return ok && fwrite(pool.data(), 1, pool.size(), f) == pool.size();
+    });
+    if (!written) return false;
+
+    if (stats) *stats = local;
+    return true;
+}
+
+// ============================================================================
+// Lookup
+// ============================================================================
+
+bool DatIndex::Load(const std::string& index_path) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    header = nullptr;
+    entries = nullptr;
+    crc_keys = nullptr;
+    strings = nullptr;
+    if (!mapping.Open(index_path)) return false;
+
+    const uint8_t* base = mapping.Data();
+    size_t size = mapping.Size();
+    if (size < sizeof(DatIndexHeader)) {
+        mapping.Close();
+        return false;
+    }
+
+    const DatIndexHeader* h = reinterpret_cast<const DatIndexHeader*>(base);
+    uint64_t entries_end = h->entries_offset + (uint64_t)h->entry_count * sizeof(DatIndexEntry);
+    uint64_t keys_end = h->crc_keys_offset + (uint64_t)h->entry_count * sizeof(DatCrcKey);
+    bool valid = h->magic == DAT_INDEX_MAGIC && h->version == DAT_INDEX_VERSION &&
+                 entries_end <= size && keys_end <= size &&
+                 h->strings_size > 0 && h->strings_offset + h->strings_size <= size &&
+                 base[h->strings_offset + h->strings_size - 1] == '\0';
+    if (!valid) {
+        mapping.Close();
+        return false;
+    }
+
+    header = h;
+    entries = reinterpret_cast<const DatIndexEntry*>(base + h->entries_offset);
+    crc_keys = reinterpret_cast<const DatCrcKey*>(base + h->crc_keys_offset);
+    strings = reinterpret_cast<const char*>(base + h->strings_offset);
+    return true;
+}
+
+void DatIndex::Unload() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    header = nullptr;
+    entries = nullptr;
+    crc_keys = nullptr;
+    strings = nullptr;
+    mapping.Close();
+}
+
+bool DatIndex::IsLoaded() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return header != nullptr;
+}
+
+size_t DatIndex::Count() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return header ? header->entry_count : 0;
+}
+
+bool DatIndex::FillMatch(uint32_t entry_index, DatMatch* match) const {
+    const DatIndexEntry& entry = entries[entry_index];
+    if (entry.name_offset >= header->strings_size || entry.serial_offset >= header->strings_size) return false;
+    if (match) {
+        match->entry = entry;
+        match->name = strings + entry.name_offset;
+        match->serial = strings + entry.serial_offset;
+    }
+    return true;
+}
+
+bool DatIndex::FindBySha1(const uint8_t sha1[20], DatMatch* match) const {
+    if (IsZero(sha1, 20)) return false;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (!header) return false;
+
+    const DatIndexEntry* begin = entries;
+    const DatIndexEntry* end = entries + header->entry_count;
+    const DatIndexEntry* it = std::lower_bound(begin, end, sha1, [](const DatIndexEntry& e, const uint8_t* key) {
+        return memcmp(e.sha1, key, 20) < 0;
+    });
+    if (it == end || memcmp(it->sha1, sha1, 20) != 0) return false;
+    return FillMatch((uint32_t)(it - begin), match);
+}
+
+bool DatIndex::FindByCrc(uint32_t crc32, uint64_t size, DatMatch* match) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (!header) return false;
+
+    const DatCrcKey* begin = crc_keys;
+    const DatCrcKey* end = crc_keys + header->entry_count;
+    DatCrcKey key = { crc32, 0, size };
+    const DatCrcKey* it = std::lower_bound(begin, end, key, [](const DatCrcKey& a, const DatCrcKey& b) {
+        if (a.crc32 != b.crc32) return a.crc32 < b.crc32;
+        return a.size < b.size;
+    });
+    if (it == end || it->crc32 != crc32 || it->size != size) return false;
+    if (it->entry_index >= header->entry_count) return false;
+    return FillMatch(it->entry_index, match);
+}
+
+bool DatIndex::Find(const HashResult& hashes, DatMatch* match) const {
+    if (!hashes.ok) return false;
+    if ((hashes.kinds & HASH_SHA1) && FindBySha1(hashes.sha1.data(), match)) return true;
+    if (!(hashes.kinds & HASH_CRC32)) return false;
+
+    DatMatch crc_match;
+    if (!FindByCrc(hashes.crc32, hashes.bytes_hashed, &crc_match)) return false;
+    // A CRC hit only counts when the DAT had no SHA-1 to check against
+    if ((hashes.kinds & HASH_SHA1) && !IsZero(crc_match.entry.sha1, 20)) return false;
+    if (match) *match = crc_match;
+    return true;
+}
+
+DatIndex& DatIndex::Shared() {
+    static DatIndex instance;
+    return instance;
+}
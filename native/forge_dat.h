@@ -0,0 +1,101 @@
+#ifndef FORGE_DAT_H
+#define FORGE_DAT_H
+
+#include "forge_io.h"
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct HashResult;
+
+// ============================================================================
+// On-disk layout of the DAT hash index (little-endian, naturally aligned)
+//
+//   DatIndexHeader
+//   DatIndexEntry[entry_count]   sorted by sha1
+//   DatCrcKey[entry_count]       sorted by (crc32, size)
+//   string pool                  NUL-terminated UTF-8
+// ============================================================================
+
+constexpr uint32_t DAT_INDEX_MAGIC = 0x54414446;   // "FDAT"
+constexpr uint32_t DAT_INDEX_VERSION = 1;
+
+struct DatIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t source_count;      // Number of DAT files merged
+    uint64_t entries_offset;
+    uint64_t crc_keys_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+};
+
+struct DatIndexEntry {
+    uint8_t sha1[20];
+    uint32_t crc32;
+    uint8_t md5[16];
+    uint64_t size;
+    uint32_t name_offset;       // Game name in the string pool
+    uint32_t serial_offset;     // Serial (may be empty)
+};
+
+struct DatCrcKey {
+    uint32_t crc32;
+    uint32_t entry_index;
+    uint64_t size;
+};
+
+static_assert(sizeof(DatIndexHeader) == 48, "DatIndexHeader layout");
+static_assert(sizeof(DatIndexEntry) == 56, "DatIndexEntry layout");
+static_assert(sizeof(DatCrcKey) == 16, "DatCrcKey layout");
+
+// Result of a successful lookup (copied out of the mapping)
+struct DatMatch {
+    DatIndexEntry entry;
+    std::string name;
+    std::string serial;
+};
+
+// Redump / No-Intro hash database backed by a memory-mapped index file.
+// Lookups are binary searches over the mapped tables; nothing is parsed
+// or copied when the index is loaded.
+class DatIndex {
+public:
+    struct ImportStats {
+        size_t dat_files = 0;
+        size_t games = 0;
+        size_t roms = 0;
+        size_t duplicates = 0;
+    };
+
+    // Stream one or more Logiqx-XML DAT files into a new index file
+    static bool Build(const std::vector<std::string>& dat_paths, const std::string& index_path,
+                      ImportStats* stats = nullptr);
+
+    bool Load(const std::string& index_path);
+    void Unload();
+    bool IsLoaded() const;
+    size_t Count() const;
+
+    bool FindBySha1(const uint8_t sha1[20], DatMatch* match) const;
+    bool FindByCrc(uint32_t crc32, uint64_t size, DatMatch* match) const;
+    // SHA-1 when it was computed, otherwise CRC32 + size
+    bool Find(const HashResult& hashes, DatMatch* match) const;
+
+    // Process-wide index used by the verification entry points
+    static DatIndex& Shared();
+
+private:
+    bool FillMatch(uint32_t entry_index, DatMatch* match) const;
+
+    mutable std::shared_mutex mutex;
+    MappedFile mapping;
+    const DatIndexHeader* header = nullptr;
+    const DatIndexEntry* entries = nullptr;
+    const DatCrcKey* crc_keys = nullptr;
+    const char* strings = nullptr;
+};
+
+#endif // FORGE_DAT_H
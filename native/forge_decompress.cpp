@@ -0,0 +1,655 @@
+#include "forge_decompress.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// ============================================================================
+// Deflate
+//
+// Canonical Huffman codes are decoded a bit at a time from per-length code
+// counts (as in zlib's puff). That is slow per symbol, but a prefix decode
+// produces a few KB, so building lookup tables would cost more than it saves.
+// ============================================================================
+
+static constexpr int INFLATE_MAX_BITS = 15;
+static constexpr int INFLATE_MAX_LITERALS = 288;
+static constexpr int INFLATE_MAX_DISTANCES = 30;
+
+struct HuffmanCode {
+    uint16_t count[INFLATE_MAX_BITS + 1];       // Codes of each length
+    uint16_t symbol[INFLATE_MAX_LITERALS];      // Symbols ordered by code
+};
+
+// 0 for a complete code, > 0 incomplete, < 0 over-subscribed
+static int BuildHuffman(HuffmanCode* code, const uint8_t* lengths, int count) {
+    memset(code->count, 0, sizeof(code->count));
+    for (int i = 0; i < count; i++) code->count[lengths[i]]++;
+    if (code->count[0] == count) return 0;
+
+    int left = 1;
+    for (int length = 1; length <= INFLATE_MAX_BITS; length++) {
+        left = (left << 1) - code->count[length];
+        if (left < 0) return left;
+    }
+
+    uint16_t offsets[INFLATE_MAX_BITS + 1];
+    offsets[1] = 0;
+    for (int length = 1; length < INFLATE_MAX_BITS; length++) offsets[length + 1] = offsets[length] + code->count[length];
+    for (int i = 0; i < count; i++) {
+        if (lengths[i]) code->symbol[offsets[lengths[i]]++] = (uint16_t)i;
+    }
+    return left;
+}
+
+class Inflater {
+public:
+    Inflater(RangeReader& in, uint8_t* out, size_t capacity) : in(in), out(out), capacity(capacity) {}
+
+    enum class Status { Full, End, Error };
+
+    Status Run() {
+        while (pos < capacity) {
+            int last = 0, type = 0;
+            if (!Bits(1, &last) || !Bits(2, &type)) return Status::Error;
+            Status status;
+            if (type == 0) status = Stored();
+            else if (type == 1) status = Fixed();
+            else if (type == 2) status = Dynamic();
+            else return Status::Error;
+            if (status != Status::End) return status;
+            if (last) return Status::End;
+        }
+        return Status::Full;
+    }
+
+    size_t pos = 0;
+
+private:
+    bool Bits(int need, int* value) {
+        uint32_t bits = bit_buffer;
+        while (bit_count < need) {
+            uint8_t byte;
+            if (!in.Next(&byte)) return false;
+            bits |= (uint32_t)byte << bit_count;
+            bit_count += 8;
+        }
+        bit_buffer = bits >> need;
+        bit_count -= need;
+        *value = (int)(bits & ((1u << need) - 1));
+        return true;
+    }
+
+    bool Decode(const HuffmanCode& code, int* symbol) {
+        int value = 0, first = 0, index = 0;
+        for (int length = 1; length <= INFLATE_MAX_BITS; length++) {
+            int bit;
+            if (!Bits(1, &bit)) return false;
+            value |= bit;
+            int count = code.count[length];
+            if (value - count < first) {
+                *symbol = code.symbol[index + (value - first)];
+                return true;
+            }
+            index += count;
+            first = (first + count) << 1;
+            value <<= 1;
+        }
+        return false;
+    }
+
+    Status Stored() {
+        // Block data starts at the next byte boundary
+        bit_buffer = 0;
+        bit_count = 0;
+        uint8_t header[4];
+        if (in.Read(header, 4) != 4) return Status::Error;
+        size_t length = header[0] | (header[1] << 8);
+        if (length != (size_t)(~(header[2] | (header[3] << 8)) & 0xFFFF)) return Status::Error;
+
+        size_t take = (std::min)(length, capacity - pos);
+        if (in.Read(out + pos, take) != take) return Status::Error;
+        pos += take;
+        return take == length ? Status::End : Status::Full;
+    }
+
+    Status Codes(const HuffmanCode& literals, const HuffmanCode& distances) {
+        static const uint16_t LENGTH_BASE[29] = { 3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t DISTANCE_BASE[30] = { 1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                                    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                                    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+        for (;;) {
+            int symbol;
+            if (!Decode(literals, &symbol)) return Status::Error;
+            if (symbol < 256) {
+                out[pos++] = (uint8_t)symbol;
+                if (pos == capacity) return Status::Full;
+                continue;
+            }
+            if (symbol == 256) return Status::End;
+
+            symbol -= 257;
+            if (symbol >= 29) return Status::Error;
+            int extra;
+            if (!Bits(LENGTH_EXTRA[symbol], &extra)) return Status::Error;
+            size_t length = LENGTH_BASE[symbol] + extra;
+
+            if (!Decode(distances, &symbol) || symbol >= 30) return Status::Error;
+            if (!Bits(DISTANCE_EXTRA[symbol], &extra)) return Status::Error;
+            size_t distance = DISTANCE_BASE[symbol] + extra;
+            if (distance > pos) return Status::Error;
+
+            // Byte by byte: the source may overlap what is being written
+            size_t take = (std::min)(length, capacity - pos);
+            for (size_t i = 0; i < take; i++, pos++) out[pos] = out[pos - distance];
+            if (pos == capacity) return Status::Full;
+        }
+    }
+
+    Status Fixed() {
+        static HuffmanCode literals, distances;
+        static const bool built = [] {
+            uint8_t lengths[INFLATE_MAX_LITERALS];
+            int i = 0;
+            for (; i < 144; i++) lengths[i] = 8;
+            for (; i < 256; i++) lengths[i] = 9;
+            for (; i < 280; i++) lengths[i] = 7;
+            for (; i < INFLATE_MAX_LITERALS; i++) lengths[i] = 8;
+            BuildHuffman(&literals, lengths, INFLATE_MAX_LITERALS);
+            for (i = 0; i < INFLATE_MAX_DISTANCES; i++) lengths[i] = 5;
+            BuildHuffman(&distances, lengths, INFLATE_MAX_DISTANCES);
+            return true;
+        }();
+        (void)built;
+        return Codes(literals, distances);
+    }
+
+    Status Dynamic() {
+        static const uint8_t ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+        int literal_count, distance_count, code_count;
+        if (!Bits(5, &literal_count) || !Bits(5, &distance_count) || !Bits(4, &code_count)) return Status::Error;
+        literal_count += 257;
+        distance_count += 1;
+        code_count += 4;
+        if (literal_count > 286 || distance_count > INFLATE_MAX_DISTANCES) return Status::Error;
+
+        uint8_t lengths[INFLATE_MAX_LITERALS + INFLATE_MAX_DISTANCES] = {};
+        for (int i = 0; i < code_count; i++) {
+            int length;
+            if (!Bits(3, &length)) return Status::Error;
+            lengths[ORDER[i]] = (uint8_t)length;
+        }
+        HuffmanCode code_lengths;
+        if (BuildHuffman(&code_lengths, lengths, 19) != 0) return Status::Error;
+
+        int total = literal_count + distance_count;
+        for (int i = 0; i < total;) {
+            int symbol;
+            if (!Decode(code_lengths, &symbol)) return Status::Error;
+            if (symbol < 16) {
+                lengths[i++] = (uint8_t)symbol;
+                continue;
+            }
+            int repeat;
+            uint8_t value = 0;
+            if (symbol == 16) {
+                if (i == 0 || !Bits(2, &repeat)) return Status::Error;
+                value = lengths[i - 1];
+                repeat += 3;
+            } else if (symbol == 17) {
+                if (!Bits(3, &repeat)) return Status::Error;
+                repeat += 3;
+            } else {
+                if (!Bits(7, &repeat)) return Status::Error;
+                repeat += 11;
+            }
+            if (i + repeat > total) return Status::Error;
+            while (repeat--) lengths[i++] = value;
+        }
+        if (lengths[256] == 0) return Status::Error;
+
+        // Incomplete codes are legal (a single distance code, for one)
+        HuffmanCode literals, distances;
+        if (BuildHuffman(&literals, lengths, literal_count) < 0 ||
+            BuildHuffman(&distances, lengths + literal_count, distance_count) < 0) {
+            return Status::Error;
+        }
+        return Codes(literals, distances);
+    }
+
+    RangeReader& in;
+    uint8_t* out;
+    size_t capacity;
+    uint32_t bit_buffer = 0;
+    int bit_count = 0;
+};
+
+bool InflatePrefix(RangeReader& in, uint8_t* out, size_t capacity, size_t* produced) {
+    Inflater inflater(in, out, capacity);
+    Inflater::Status status = inflater.Run();
+    *produced = inflater.pos;
+    return status != Inflater::Status::Error;
+}
+
+// ============================================================================
+// LZMA / LZMA2
+//
+// Follows the reference decoder in the LZMA SDK (LzmaSpec.cpp). Probabilities
+// are 11-bit, adapted by 1/32 per decoded bit.
+// ============================================================================
+
+static constexpr uint16_t LZMA_PROB_INIT = 1 << 10;
+static constexpr unsigned LZMA_STATES = 12;
+static constexpr unsigned LZMA_POS_STATES_MAX = 1 << 4;
+static constexpr unsigned LZMA_LEN_TO_POS_STATES = 4;
+static constexpr unsigned LZMA_END_POS_MODEL_INDEX = 14;
+static constexpr unsigned LZMA_FULL_DISTANCES = 1 << (LZMA_END_POS_MODEL_INDEX >> 1);
+static constexpr unsigned LZMA_ALIGN_BITS = 4;
+
+class RangeDecoder {
+public:
+    explicit RangeDecoder(RangeReader& in) : in(in) {}
+
+    bool Init() {
+        uint8_t byte;
+        range = 0xFFFFFFFF;
+        code = 0;
+        if (!in.Next(&byte) || byte != 0) return false;
+        for (int i = 0; i < 4; i++) {
+            if (!in.Next(&byte)) return false;
+            code = (code << 8) | byte;
+        }
+        return code != range;
+    }
+
+    unsigned Bit(uint16_t* prob) {
+        uint32_t bound = (range >> 11) * *prob;
+        unsigned bit;
+        if (code < bound) {
+            *prob += ((1 << 11) - *prob) >> 5;
+            range = bound;
+            bit = 0;
+        } else {
+            *prob -= *prob >> 5;
+            code -= bound;
+            range -= bound;
+            bit = 1;
+        }
+        Normalize();
+        return bit;
+    }
+
+    uint32_t Direct(unsigned count) {
+        uint32_t result = 0;
+        while (count--) {
+            range >>= 1;
+            code -= range;
+            uint32_t mask = 0 - (code >> 31);
+            code += range & mask;
+            Normalize();
+            result = (result << 1) + (mask + 1);
+        }
+        return result;
+    }
+
+    unsigned Tree(uint16_t* probs, unsigned bits) {
+        unsigned m = 1;
+        for (unsigned i = 0; i < bits; i++) m = (m << 1) + Bit(&probs[m]);
+        return m - (1u << bits);
+    }
+
+    unsigned ReverseTree(uint16_t* probs, unsigned bits) {
+        unsigned m = 1, symbol = 0;
+        for (unsigned i = 0; i < bits; i++) {
+            unsigned bit = Bit(&probs[m]);
+            m = (m << 1) + bit;
+            symbol |= bit << i;
+        }
+        return symbol;
+    }
+
+    // Input ran out; later bits decode as garbage and the caller stops
+    bool failed = false;
+
+private:
+    void Normalize() {
+        if (range >= (1u << 24)) return;
+        uint8_t byte = 0;
+        if (!in.Next(&byte)) failed = true;
+        range <<= 8;
+        code = (code << 8) | byte;
+    }
+
+    RangeReader& in;
+    uint32_t range = 0;
+    uint32_t code = 0;
+};
+
+struct LzmaLengthModel {
+    uint16_t choice;
+    uint16_t choice2;
+    uint16_t low[LZMA_POS_STATES_MAX][1 << 3];
+    uint16_t mid[LZMA_POS_STATES_MAX][1 << 3];
+    uint16_t high[1 << 8];
+
+    unsigned Decode(RangeDecoder& rc, unsigned pos_state) {
+        if (!rc.Bit(&choice)) return rc.Tree(low[pos_state], 3);
+        if (!rc.Bit(&choice2)) return 8 + rc.Tree(mid[pos_state], 3);
+        return 16 + rc.Tree(high, 8);
+    }
+};
+
+class LzmaDecoder {
+public:
+    LzmaDecoder(uint8_t* out, size_t capacity) : out(out), capacity(capacity) {}
+
+    enum class Status { Full, Limit, End, Error };
+
+    bool SetProperties(uint8_t d) {
+        if (d >= 9 * 5 * 5) return false;
+        lc = d % 9;
+        d /= 9;
+        lp = d % 5;
+        pb = d / 5;
+        literals.resize((size_t)0x300 << (lc + lp));
+        return true;
+    }
+
+    void ResetState() {
+        std::fill(literals.begin(), literals.end(), LZMA_PROB_INIT);
+        uint16_t* models[] = { &is_match[0][0], is_rep, is_rep_g0, is_rep_g1, is_rep_g2, &is_rep0_long[0][0],
+                               &pos_slot[0][0], pos_special, align };
+        size_t sizes[] = { sizeof(is_match), sizeof(is_rep), sizeof(is_rep_g0), sizeof(is_rep_g1),
+                           sizeof(is_rep_g2), sizeof(is_rep0_long), sizeof(pos_slot), sizeof(pos_special),
+                           sizeof(align) };
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            std::fill(models[i], models[i] + sizes[i] / sizeof(uint16_t), LZMA_PROB_INIT);
+        }
+        std::fill((uint16_t*)&length, (uint16_t*)(&length + 1), LZMA_PROB_INIT);
+        std::fill((uint16_t*)&rep_length, (uint16_t*)(&rep_length + 1), LZMA_PROB_INIT);
+        state = 0;
+        rep0 = rep1 = rep2 = rep3 = 0;
+    }
+
+    // Decode until pos reaches limit (Limit, or Full at capacity)
+    Status Decode(RangeDecoder& rc, size_t limit) {
+        unsigned pb_mask = (1u << pb) - 1;
+        while (pos < limit) {
+            if (rc.failed) return Status::Error;
+            unsigned pos_state = (unsigned)pos & pb_mask;
+
+            if (!rc.Bit(&is_match[state][pos_state])) {
+                Literal(rc);
+                continue;
+            }
+
+            unsigned len;
+            if (rc.Bit(&is_rep[state])) {
+                if (pos == dict_start) return Status::Error;
+                if (!rc.Bit(&is_rep_g0[state])) {
+                    if (!rc.Bit(&is_rep0_long[state][pos_state])) {
+                        // Short rep: one byte from rep0
+                        state = state < 7 ? 9 : 11;
+                        out[pos] = out[pos - rep0 - 1];
+                        pos++;
+                        continue;
+                    }
+                } else {
+                    uint32_t distance;
+                    if (!rc.Bit(&is_rep_g1[state])) {
+                        distance = rep1;
+                    } else {
+                        if (!rc.Bit(&is_rep_g2[state])) {
+                            distance = rep2;
+                        } else {
+                            distance = rep3;
+                            rep3 = rep2;
+                        }
+                        rep2 = rep1;
+                    }
+                    rep1 = rep0;
+                    rep0 = distance;
+                }
+                len = rep_length.Decode(rc, pos_state);
+                state = state < 7 ? 8 : 11;
+            } else {
+                rep3 = rep2;
+                rep2 = rep1;
+                rep1 = rep0;
+                len = length.Decode(rc, pos_state);
+                state = state < 7 ? 7 : 10;
+                rep0 = Distance(rc, len);
+                if (rep0 == 0xFFFFFFFF) return rc.failed ? Status::Error : Status::End;
+            }
+
+            if (rep0 >= pos - dict_start) return Status::Error;
+            size_t take = (std::min)((size_t)len + 2, limit - pos);
+            for (size_t i = 0; i < take; i++, pos++) out[pos] = out[pos - rep0 - 1];
+        }
+        if (rc.failed) return Status::Error;
+        return pos == capacity ? Status::Full : Status::Limit;
+    }
+
+    size_t pos = 0;
+    size_t dict_start = 0;     // Matches may not reach before a dictionary reset
+    unsigned lc = 0, lp = 0, pb = 0;
+
+private:
+    void Literal(RangeDecoder& rc) {
+        unsigned previous = pos > dict_start ? out[pos - 1] : 0;
+        unsigned lit_state = (((unsigned)pos & ((1u << lp) - 1)) << lc) + (previous >> (8 - lc));
+        uint16_t* probs = &literals[(size_t)0x300 * lit_state];
+
+        unsigned symbol = 1;
+        if (state >= 7) {
+            // After a match the byte at rep0 predicts this one until they differ
+            unsigned match_byte = out[pos - rep0 - 1];
+            do {
+                unsigned match_bit = (match_byte >> 7) & 1;
+                match_byte <<= 1;
+                unsigned bit = rc.Bit(&probs[((1 + match_bit) << 8) + symbol]);
+                symbol = (symbol << 1) | bit;
+                if (match_bit != bit) break;
+            } while (symbol < 0x100);
+        }
+        while (symbol < 0x100) symbol = (symbol << 1) | rc.Bit(&probs[symbol]);
+        out[pos++] = (uint8_t)(symbol - 0x100);
+        state = state < 4 ? 0 : (state < 10 ? state - 3 : state - 6);
+    }
+
+    uint32_t Distance(RangeDecoder& rc, unsigned len) {
+        unsigned len_state = (std::min)(len, LZMA_LEN_TO_POS_STATES - 1);
+        unsigned slot = rc.Tree(pos_slot[len_state], 6);
+        if (slot < 4) return slot;
+
+        unsigned direct_bits = (slot >> 1) - 1;
+        uint32_t distance = (2 | (slot & 1)) << direct_bits;
+        if (slot < LZMA_END_POS_MODEL_INDEX) {
+            return distance + rc.ReverseTree(pos_special + distance - slot, direct_bits);
+        }
+        distance += rc.Direct(direct_bits - LZMA_ALIGN_BITS) << LZMA_ALIGN_BITS;
+        return distance + rc.ReverseTree(align, LZMA_ALIGN_BITS);
+    }
+
+    uint8_t* out;
+    size_t capacity;
+    std::vector<uint16_t> literals;
+    uint16_t is_match[LZMA_STATES][LZMA_POS_STATES_MAX];
+    uint16_t is_rep[LZMA_STATES];
+    uint16_t is_rep_g0[LZMA_STATES];
+    uint16_t is_rep_g1[LZMA_STATES];
+    uint16_t is_rep_g2[LZMA_STATES];
+    uint16_t is_rep0_long[LZMA_STATES][LZMA_POS_STATES_MAX];
+    uint16_t pos_slot[LZMA_LEN_TO_POS_STATES][1 << 6];
+    uint16_t pos_special[1 + LZMA_FULL_DISTANCES - LZMA_END_POS_MODEL_INDEX];
+    uint16_t align[1 << LZMA_ALIGN_BITS];
+    LzmaLengthModel length;
+    LzmaLengthModel rep_length;
+    unsigned state = 0;
+    uint32_t rep0 = 0, rep1 = 0, rep2 = 0, rep3 = 0;
+};
+
+bool LzmaDecodePrefix(RangeReader& in, const uint8_t* props, size_t props_size, uint8_t* out, size_t capacity,
+                      size_t* produced) {
+    *produced = 0;
+    LzmaDecoder decoder(out, capacity);
+    if (props_size < 5 || !decoder.SetProperties(props[0])) return false;
+    decoder.ResetState();
+
+    RangeDecoder rc(in);
+    if (!rc.Init()) return false;
+    LzmaDecoder::Status status = decoder.Decode(rc, capacity);
+    *produced = decoder.pos;
+    return status != LzmaDecoder::Status::Error;
+}
+
+static bool ReadBE16(RangeReader& in, uint32_t* value) {
+    uint8_t hi, lo;
+    if (!in.Next(&hi) || !in.Next(&lo)) return false;
+    *value = ((uint32_t)hi << 8) | lo;
+    return true;
+}
+
+bool Lzma2DecodePrefix(RangeReader& in, uint8_t* out, size_t capacity, size_t* produced) {
+    LzmaDecoder decoder(out, capacity);
+    bool have_properties = false;
+    bool ok = true;
+
+    while (ok && decoder.pos < capacity) {
+        uint8_t control;
+        uint32_t size;
+        if (!in.Next(&control)) {
+            ok = false;
+            break;
+        }
+        if (control == 0) break;    // End of stream
+
+        if (control == 1 || control == 2) {
+            // Uncompressed chunk; 1 also resets the dictionary
+            if (!ReadBE16(in, &size)) {
+                ok = false;
+                break;
+            }
+            size += 1;
+            if (control == 1) decoder.dict_start = decoder.pos;
+            size_t take = (std::min)((size_t)size, capacity - decoder.pos);
+            size_t got = in.Read(out + decoder.pos, take);
+            decoder.pos += got;
+            ok = got == take;
+            continue;
+        }
+        if (control < 0x80) {
+            ok = false;
+            break;
+        }
+
+        // LZMA chunk: bits 5-6 select what is reset before it
+        uint32_t unpacked_low, packed;
+        if (!ReadBE16(in, &unpacked_low) || !ReadBE16(in, &packed)) {
+            ok = false;
+            break;
+        }
+        size_t unpacked = (((size_t)control & 0x1F) << 16) + unpacked_low + 1;
+        packed += 1;
+        unsigned reset = (control >> 5) & 3;
+        if (reset == 3) decoder.dict_start = decoder.pos;
+        if (reset >= 2) {
+            uint8_t properties;
+            if (!in.Next(&properties) || !decoder.SetProperties(properties) || decoder.lc + decoder.lp > 4) {
+                ok = false;
+                break;
+            }
+            have_properties = true;
+        }
+        if (!have_properties) {
+            ok = false;
+            break;
+        }
+        if (reset >= 1) decoder.ResetState();
+
+        uint64_t start = in.Consumed();
+        RangeDecoder rc(in);
+        if (!rc.Init()) {
+            ok = false;
+            break;
+        }
+        LzmaDecoder::Status status = decoder.Decode(rc, (std::min)(capacity, decoder.pos + unpacked));
+        if (status == LzmaDecoder::Status::Full) break;
+        ok = status == LzmaDecoder::Status::Limit;
+        // The range coder may stop short of the chunk's last bytes
+        uint64_t used = in.Consumed() - start;
+        if (ok && used < packed) ok = in.Skip(packed - used);
+    }
+
+    *produced = decoder.pos;
+    return ok;
+}
+
+// ============================================================================
+// LZ4
+//
+// A block is a run of sequences: a token (literal length, match length - 4),
+// the literals, then a 16-bit little-endian match distance. Either length
+// nibble of 15 continues in following bytes. The last sequence has literals
+// only, so the block ends where the input does.
+// ============================================================================
+
+static constexpr size_t LZ4_MIN_MATCH = 4;
+
+static bool ReadLz4Length(RangeReader& in, size_t* length) {
+    uint8_t byte;
+    do {
+        if (!in.Next(&byte)) return false;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool Lz4BlockDecodePrefix(RangeReader& in, uint8_t* out, size_t capacity, size_t* produced) {
+    size_t pos = 0;
+    bool ok = true;
+    while (pos < capacity) {
+        uint8_t token;
+        if (!in.Next(&token)) break;    // End of block
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !ReadLz4Length(in, &literals)) {
+            ok = false;
+            break;
+        }
+        size_t take = (std::min)(literals, capacity - pos);
+        if (in.Read(out + pos, take) != take) {
+            ok = false;
+            break;
+        }
+        pos += take;
+        if (pos == capacity) break;
+
+        uint8_t lo, hi;
+        if (!in.Next(&lo)) break;       // Last sequence: literals only
+        if (!in.Next(&hi)) {
+            ok = false;
+            break;
+        }
+        size_t distance = (size_t)lo | ((size_t)hi << 8);
+        size_t length = token & 0x0F;
+        if (length == 15 && !ReadLz4Length(in, &length)) {
+            ok = false;
+            break;
+        }
+        length += LZ4_MIN_MATCH;
+        if (distance == 0 || distance > pos) {
+            ok = false;
+            break;
+        }
+        // Byte by byte: a match may overlap the bytes it produces
+        size_t end = (std::min)(capacity, pos + length);
+        for (; pos < end; pos++) out[pos] = out[pos - distance];
+    }
+    *produced = pos;
+    return ok && !in.Failed();
+}
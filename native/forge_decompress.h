@@ -0,0 +1,32 @@
+#ifndef FORGE_DECOMPRESS_H
+#define FORGE_DECOMPRESS_H
+
+#include "forge_io.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Prefix decoders for archive members and compressed disc images.
+//
+// Each decodes a compressed stream from the start until out holds capacity
+// bytes or the stream ends, and stops there: identifying a member needs its
+// first few KB, never the rest. out doubles as the dictionary (every match
+// refers back into it), so no separate window is allocated. *produced is
+// set even when decoding fails part-way; false means the data is corrupt
+// or the input range ended early.
+
+// Raw deflate (RFC 1951), zip method 8
+bool InflatePrefix(RangeReader& in, uint8_t* out, size_t capacity, size_t* produced);
+
+// LZMA with the 5-byte properties (lc/lp/pb + dictionary size) given
+// separately, as 7z and zip method 14 store them; no end marker required
+bool LzmaDecodePrefix(RangeReader& in, const uint8_t* props, size_t props_size, uint8_t* out, size_t capacity,
+                      size_t* produced);
+
+// LZMA2 chunk stream (7z, xz)
+bool Lzma2DecodePrefix(RangeReader& in, uint8_t* out, size_t capacity, size_t* produced);
+
+// One LZ4 block (no frame header): ZSO and CSO v2 sectors. The block ends
+// with the input range.
+bool Lz4BlockDecodePrefix(RangeReader& in, uint8_t* out, size_t capacity, size_t* produced);
+
+#endif // FORGE_DECOMPRESS_H
@@ -0,0 +1,140 @@
+#include "forge_device.h"
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#if defined(__linux__)
+#include <sys/sysmacros.h>
+#endif
+#endif
+
+unsigned StorageDevice::Concurrency() const {
+    unsigned cores = (std::max)(1u, std::thread::hardware_concurrency());
+    switch (kind) {
+    case Kind::SolidState: return cores;
+    case Kind::Rotational:
+    case Kind::Removable: return 1;
+    default: return (std::min)(2u, cores);
+    }
+}
+
+const char* StorageDevice::KindName() const {
+    switch (kind) {
+    case Kind::SolidState: return "ssd";
+    case Kind::Rotational: return "hdd";
+    case Kind::Removable: return "removable";
+    default: return "unknown";
+    }
+}
+
+#ifdef _WIN32
+
+StorageDevice DeviceForPath(const std::string& path) {
+    StorageDevice device;
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    if (wlen <= 0) return device;
+    std::wstring wpath(wlen, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wpath.data(), wlen);
+
+    wchar_t mount[MAX_PATH];
+    wchar_t volume[MAX_PATH];
+    if (!GetVolumePathNameW(wpath.c_str(), mount, MAX_PATH) ||
+        !GetVolumeNameForVolumeMountPointW(mount, volume, MAX_PATH)) {
+        return device;
+    }
+    std::wstring volume_path(volume);
+    if (!volume_path.empty() && volume_path.back() == L'\\') volume_path.pop_back();
+    device.id = std::string(volume_path.begin(), volume_path.end());
+
+    // Zero access rights are enough for storage queries
+    HANDLE h = CreateFileW(volume_path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                           OPEN_EXISTING, 0, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return device;
+
+    DWORD bytes = 0;
+    STORAGE_DEVICE_NUMBER number = {};
+    if (DeviceIoControl(h, IOCTL_STORAGE_GET_DEVICE_NUMBER, nullptr, 0, &number, sizeof(number), &bytes,
+                        nullptr)) {
+        device.id = "disk" + std::to_string(number.DeviceNumber);
+    }
+
+    STORAGE_PROPERTY_QUERY query = {};
+    query.PropertyId = StorageDeviceProperty;
+    query.QueryType = PropertyStandardQuery;
+    BYTE buffer[1024] = {};
+    if (DeviceIoControl(h, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query), buffer, sizeof(buffer), &bytes,
+                        nullptr)) {
+        const STORAGE_DEVICE_DESCRIPTOR* desc = reinterpret_cast<const STORAGE_DEVICE_DESCRIPTOR*>(buffer);
+        if (desc->BusType == BusTypeUsb || desc->BusType == BusTypeSd || desc->BusType == BusTypeMmc) {
+            device.kind = StorageDevice::Kind::Removable;
+        }
+    }
+
+    if (device.kind == StorageDevice::Kind::Unknown) {
+        query.PropertyId = StorageDeviceSeekPenaltyProperty;
+        DEVICE_SEEK_PENALTY_DESCRIPTOR penalty = {};
+        if (DeviceIoControl(h, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query), &penalty, sizeof(penalty),
+                            &bytes, nullptr)) {
+            device.kind = penalty.IncursSeekPenalty ? StorageDevice::Kind::Rotational
+                                                    : StorageDevice::Kind::SolidState;
+        }
+    }
+    CloseHandle(h);
+    return device;
+}
+
+#else
+
+#if defined(__linux__)
+static bool ReadSysFlag(const std::string& file, bool* value) {
+    std::ifstream in(file);
+    int v = 0;
+    if (!(in >> v)) return false;
+    *value = v != 0;
+    return true;
+}
+#endif
+
+StorageDevice DeviceForPath(const std::string& path) {
+    StorageDevice device;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return device;
+    device.id = "dev" + std::to_string((unsigned long long)st.st_dev);
+
+#if defined(__linux__)
+    // /sys/dev/block/MAJ:MIN resolves into the device tree; a partition's
+    // parent directory is its disk
+    std::string sys = "/sys/dev/block/" + std::to_string(major(st.st_dev)) + ":" + std::to_string(minor(st.st_dev));
+    char resolved[PATH_MAX];
+    if (!realpath(sys.c_str(), resolved)) return device;   // Not a block device (tmpfs, NFS, ...)
+    std::string node(resolved);
+    struct stat part;
+    if (stat((node + "/partition").c_str(), &part) == 0) node = node.substr(0, node.rfind('/'));
+    device.id = node.substr(node.rfind('/') + 1);
+
+    bool removable = false;
+    if (node.find("/usb") != std::string::npos || node.find("/mmc") != std::string::npos ||
+        (ReadSysFlag(node + "/removable", &removable) && removable)) {
+        device.kind = StorageDevice::Kind::Removable;
+        return device;
+    }
+    bool rotational = false;
+    if (ReadSysFlag(node + "/queue/rotational", &rotational)) {
+        device.kind = rotational ? StorageDevice::Kind::Rotational : StorageDevice::Kind::SolidState;
+    }
+#endif
+    return device;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef FORGE_DEVICE_H
+#define FORGE_DEVICE_H
+
+#include <string>
+
+// Physical storage device backing a path, as far as the OS will tell us
+struct StorageDevice {
+    enum class Kind { Unknown, SolidState, Rotational, Removable };
+
+    std::string id;                  // Stable per physical disk ("sdb", "disk2", ...)
+    Kind kind = Kind::Unknown;
+
+    // Concurrent sequential readers this device handles without thrashing:
+    // one for spinning disks and USB/SD media, one per core for SSDs
+    unsigned Concurrency() const;
+    const char* KindName() const;
+};
+
+StorageDevice DeviceForPath(const std::string& path);
+
+#endif // FORGE_DEVICE_H
@@ -0,0 +1,212 @@
+#include "forge_dupes.h"
+#include "forge_cache.h"
+#include "forge_device.h"
+#include "forge_hash.h"
+#include "forge_io.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+// Partial fingerprint: head and tail, plus evenly spaced samples. Copies
+// that differ only in the middle (a patched file, a different dump of the
+// same disc) almost always differ in one of these, and the full hash
+// catches the rest.
+static constexpr size_t DUPE_EDGE_SIZE = 64 * 1024;
+static constexpr size_t DUPE_SAMPLE_COUNT = 16;
+static constexpr size_t DUPE_SAMPLE_SIZE = 16 * 1024;
+// Files no larger than this are read whole by the partial pass
+static constexpr uint64_t DUPE_FULL_COVER = 2 * DUPE_EDGE_SIZE + DUPE_SAMPLE_COUNT * DUPE_SAMPLE_SIZE;
+// Partial fingerprints between progress reports (full hashes report each file)
+static constexpr size_t DUPE_PROGRESS_INTERVAL = 32;
+
+struct DupeDeviceQueue {
+    StorageDevice device;
+    std::vector<size_t> items;
+    std::atomic<size_t> next{0};
+};
+
+// Run work(i) for every path, one queue per physical device
+template <typename Fn>
+static void RunPerDevice(const std::vector<std::string>& paths, const std::atomic<bool>* cancel, Fn work) {
+    std::vector<std::unique_ptr<DupeDeviceQueue>> queues;
+    std::map<std::string, size_t> by_device;
+    for (size_t i = 0; i < paths.size(); i++) {
+        StorageDevice device = DeviceForPath(paths[i]);
+        auto it = by_device.find(device.id);
+        if (it == by_device.end()) {
+            it = by_device.emplace(device.id, queues.size()).first;
+            queues.push_back(std::make_unique<DupeDeviceQueue>());
+            queues.back()->device = device;
+        }
+        queues[it->second]->items.push_back(i);
+    }
+
+    auto worker = [&](DupeDeviceQueue* queue) {
+        while (!(cancel && cancel->load())) {
+            size_t index = queue->next.fetch_add(1);
+            if (index >= queue->items.size()) break;
+            work(queue->items[index]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (auto& queue : queues) {
+        size_t workers = (std::min)((size_t)queue->device.Concurrency(), queue->items.size());
+        for (size_t i = 0; i < workers; i++) pool.emplace_back(worker, queue.get());
+    }
+    for (auto& t : pool) t.join();
+}
+
+// SHA-1 over the sampled ranges; false if the file cannot be read or no
+// longer has the expected size
+static bool PartialFingerprint(const std::string& path, uint64_t size, std::string* digest, uint64_t* bytes_read) {
+    RandomAccessFile file;
+    if (!file.Open(path) || file.Size() != size) return false;
+
+    std::vector<std::pair<uint64_t, size_t>> ranges;
+    if (size <= DUPE_FULL_COVER) {
+        ranges.emplace_back(0, (size_t)size);
+    } else {
+        ranges.emplace_back(0, DUPE_EDGE_SIZE);
+        uint64_t middle = size - 2 * DUPE_EDGE_SIZE;
+        for (size_t i = 0; i < DUPE_SAMPLE_COUNT; i++) {
+            uint64_t offset = DUPE_EDGE_SIZE + (middle - DUPE_SAMPLE_SIZE) / (DUPE_SAMPLE_COUNT - 1) * i;
+            ranges.emplace_back(offset, DUPE_SAMPLE_SIZE);
+        }
+        ranges.emplace_back(size - DUPE_EDGE_SIZE, DUPE_EDGE_SIZE);
+    }
+
+    MultiHasher hasher(HASH_SHA1);
+    std::vector<uint8_t> buffer(DUPE_EDGE_SIZE);
+    for (const auto& range : ranges) {
+        for (uint64_t done = 0; done < range.second;) {
+            size_t chunk = (size_t)(std::min)((uint64_t)buffer.size(), range.second - done);
+            if (!file.ReadExact(range.first + done, buffer.data(), chunk)) return false;
+            hasher.Update(buffer.data(), chunk);
+            done += chunk;
+            *bytes_read += chunk;
+        }
+    }
+    *digest = hasher.Finish().Sha1Hex();
+    return true;
+}
+
+std::vector<DuplicateFinder::Group> DuplicateFinder::Find(const std::vector<Candidate>& candidates, Stats* stats,
+                                                          const std::atomic<bool>* cancel, const ProgressFn& on_progress) {
+    Stats local;
+    local.candidates = candidates.size();
+    std::vector<Group> groups;
+
+    // Hard links are one file under several names and deleting a name frees
+    // nothing, so each file takes part once, under its first path
+    std::map<std::pair<uint64_t, uint64_t>, size_t> files;
+    std::vector<bool> linked(candidates.size(), false);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        FileKey key;
+        if (candidates[i].size == 0 || !StatFileKey(candidates[i].path, &key)) continue;
+        auto inserted = files.emplace(std::make_pair(key.device, key.file_id), i);
+        if (inserted.second) continue;
+        size_t& first = inserted.first->second;
+        size_t other = i;
+        if (candidates[other].path < candidates[first].path) std::swap(first, other);
+        linked[other] = true;
+        local.hard_links++;
+    }
+
+    // 1. Buckets by title ID and size (metadata only)
+    std::map<std::pair<std::string, uint64_t>, std::vector<size_t>> buckets;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (candidates[i].size == 0 || linked[i]) continue;
+        buckets[{ candidates[i].title_id, candidates[i].size }].push_back(i);
+    }
+    std::vector<size_t> suspects;
+    for (const auto& bucket : buckets) {
+        if (bucket.second.size() > 1) suspects.insert(suspects.end(), bucket.second.begin(), bucket.second.end());
+    }
+    local.bucketed = suspects.size();
+
+    // 2. Partial fingerprints of every file sharing a bucket
+    std::vector<std::string> paths;
+    for (size_t i : suspects) paths.push_back(candidates[i].path);
+    std::vector<std::string> partial(suspects.size());
+    std::mutex stats_mutex;
+    RunPerDevice(paths, cancel, [&](size_t k) {
+        uint64_t bytes = 0;
+        bool ok = PartialFingerprint(paths[k], candidates[suspects[k]].size, &partial[k], &bytes);
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        local.bytes_read += bytes;
+        if (ok) local.partial_hashed++;
+        else local.errors++;
+        size_t done = local.partial_hashed + local.errors;
+        if (on_progress && (done % DUPE_PROGRESS_INTERVAL == 0 || done == paths.size())) on_progress(local);
+    });
+
+    std::map<std::tuple<std::string, uint64_t, std::string>, std::vector<size_t>> collisions;
+    for (size_t k = 0; k < suspects.size(); k++) {
+        if (partial[k].empty()) continue;
+        const Candidate& c = candidates[suspects[k]];
+        collisions[std::make_tuple(c.title_id, c.size, partial[k])].push_back(k);
+    }
+
+    // 3. Full hashes, only where partial fingerprints collide and did not
+    // already cover the whole file
+    std::vector<size_t> to_hash;
+    for (const auto& collision : collisions) {
+        if (collision.second.size() < 2) continue;
+        if (std::get<1>(collision.first) <= DUPE_FULL_COVER) {
+            Group group;
+            group.sha1 = std::get<2>(collision.first);
+            group.size = std::get<1>(collision.first);
+            group.title_id = std::get<0>(collision.first);
+            for (size_t k : collision.second) group.paths.push_back(paths[k]);
+            groups.push_back(std::move(group));
+        } else {
+            to_hash.insert(to_hash.end(), collision.second.begin(), collision.second.end());
+        }
+    }
+
+    std::vector<std::string> hash_paths;
+    for (size_t k : to_hash) hash_paths.push_back(paths[k]);
+    local.colliding = to_hash.size();
+    std::vector<std::string> full(to_hash.size());
+    RunPerDevice(hash_paths, cancel, [&](size_t j) {
+        HashResult result = FingerprintCache::Shared().Hash(hash_paths[j], HASH_SHA1, nullptr, cancel);
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        if (result.ok) {
+            full[j] = result.Sha1Hex();
+            local.full_hashed++;
+        } else if (!(cancel && cancel->load())) {
+            local.errors++;
+        }
+        if (on_progress) on_progress(local);
+    });
+    FingerprintCache::Shared().Save();
+
+    std::map<std::pair<uint64_t, std::string>, std::vector<size_t>> identical;
+    for (size_t j = 0; j < to_hash.size(); j++) {
+        if (!full[j].empty()) identical[{ candidates[suspects[to_hash[j]]].size, full[j] }].push_back(to_hash[j]);
+    }
+    for (const auto& set : identical) {
+        if (set.second.size() < 2) continue;
+        Group group;
+        group.sha1 = set.first.second;
+        group.size = set.first.first;
+        group.title_id = candidates[suspects[set.second.front()]].title_id;
+        for (size_t k : set.second) group.paths.push_back(paths[k]);
+        groups.push_back(std::move(group));
+    }
+
+    for (auto& group : groups) std::sort(group.paths.begin(), group.paths.end());
+    // Most space reclaimed first
+    std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) {
+        uint64_t wasted_a = a.size * (a.paths.size() - 1), wasted_b = b.size * (b.paths.size() - 1);
+        if (wasted_a != wasted_b) return wasted_a > wasted_b;
+        return a.paths.front() < b.paths.front();
+    });
+
+    local.cancelled = cancel && cancel->load();
+    if (stats) *stats = local;
+    return groups;
+}
@@ -0,0 +1,60 @@
+#ifndef FORGE_DUPES_H
+#define FORGE_DUPES_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Finds byte-identical copies of games, doing the cheapest work first:
+//
+//   1. Bucket by title ID and size. Identical bytes identify identically,
+//      so files in different buckets can never match; most files are
+//      ruled out here without reading any data. Hard links are collapsed
+//      by device and file ID first, so a file with several names counts
+//      once.
+//   2. Partial fingerprint of the files left: SHA-1 over the head, the tail
+//      and DUPE_SAMPLE_COUNT blocks spread evenly between them. Files small
+//      enough to be covered completely are decided here.
+//   3. Full SHA-1 of each partial-fingerprint collision, through the
+//      fingerprint cache (free when the file was hashed or verified before).
+//
+// Reads are spread over one queue per physical device, with the
+// concurrency BatchVerifier uses, so several drives are read in parallel.
+class DuplicateFinder {
+public:
+    struct Candidate {
+        std::string path;
+        std::string title_id;
+        uint64_t size = 0;
+    };
+
+    struct Group {
+        std::string sha1;                   // Hex
+        uint64_t size = 0;
+        std::string title_id;
+        std::vector<std::string> paths;     // Sorted
+    };
+
+    struct Stats {
+        size_t candidates = 0;
+        size_t hard_links = 0;              // Further names of a file already listed (left out)
+        size_t bucketed = 0;                // Shared a bucket with another file
+        size_t partial_hashed = 0;
+        size_t colliding = 0;               // Partial fingerprint collisions left to hash in full
+        size_t full_hashed = 0;             // Including fingerprint cache hits
+        uint64_t bytes_read = 0;            // Partial fingerprints only
+        size_t errors = 0;                  // Unreadable files (left out of every group)
+        bool cancelled = false;
+    };
+
+    // Called from worker threads as files are hashed
+    using ProgressFn = std::function<void(const Stats& stats)>;
+
+    // Blocks until every group is found or cancel is set
+    static std::vector<Group> Find(const std::vector<Candidate>& candidates, Stats* stats,
+                                   const std::atomic<bool>* cancel = nullptr, const ProgressFn& on_progress = nullptr);
+};
+
+#endif // FORGE_DUPES_H
@@ -0,0 +1,396 @@
+#include "forge_gametdb.h"
+#include "forge_xml.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unordered_set>
+
+static const struct {
+    GameTdbControl control;
+    const char* name;
+} GAMETDB_CONTROLS[GAMETDB_CONTROL_COUNT] = {
+    { CONTROL_WIIMOTE, "wiimote" },
+    { CONTROL_NUNCHUK, "nunchuk" },
+    { CONTROL_CLASSIC, "classiccontroller" },
+    { CONTROL_GAMECUBE, "gamecube" },
+    { CONTROL_MOTIONPLUS, "motionplus" },
+    { CONTROL_BALANCEBOARD, "balanceboard" },
+    { CONTROL_WHEEL, "wheel" },
+    { CONTROL_ZAPPER, "zapper" },
+    { CONTROL_GUITAR, "guitar" },
+    { CONTROL_DRUMS, "drums" },
+    { CONTROL_MICROPHONE, "microphone" },
+    { CONTROL_WIISPEAK, "wiispeak" },
+    { CONTROL_DANCEPAD, "dancepad" },
+    { CONTROL_KEYBOARD, "keyboard" },
+    { CONTROL_UDRAW, "udraw" },
+    { CONTROL_GAMEPAD, "wiiu" },
+    { CONTROL_PRO, "wiiupro" },
+};
+
+const char* GameTdbControlName(GameTdbControl control) {
+    for (const auto& entry : GAMETDB_CONTROLS) {
+        if (entry.control == control) return entry.name;
+    }
+    return "";
+}
+
+static uint32_t ParseControl(const std::string* type) {
+    if (!type) return 0;
+    for (const auto& entry : GAMETDB_CONTROLS) {
+        if (*type == entry.name) return entry.control;
+    }
+    return 0;
+}
+
+static std::string Trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+static uint8_t ParsePlayers(const std::string* text) {
+    if (!text) return 0;
+    unsigned long players = strtoul(text->c_str(), nullptr, 10);
+    return (uint8_t)(std::min)(players, 255ul);
+}
+
+// Title IDs pack into a NUL-padded 8-byte key
+static bool PackId(const std::string& title_id, uint64_t* key) {
+    if (title_id.empty() || title_id.size() > 8) return false;
+    char bytes[8] = {};
+    memcpy(bytes, title_id.data(), title_id.size());
+    memcpy(key, bytes, 8);
+    return true;
+}
+
+static uint64_t HashKey(uint64_t key, uint32_t seed) {
+    uint64_t x = key ^ ((uint64_t)seed * 0x9E3779B97F4A7C15ull);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// ============================================================================
+// Import
+// ============================================================================
+
+// Hash and displace: keys are spread over about four per bucket, and the
+// buckets, largest first, each get the smallest seed (from 1) that puts all
+// of their keys in free slots. A bucket's seed is stored in buckets[];
+// 0 marks a bucket with no keys.
+static bool BuildPerfectHash(const std::vector<uint64_t>& keys, std::vector<uint32_t>* buckets,
+                             std::vector<uint32_t>* slots) {
+    size_t n = keys.size();
+    size_t bucket_count = (std::max)((size_t)1, n / 4);
+    size_t slot_count = (std::max)((size_t)1, n + n / 4);
+    std::vector<std::vector<uint32_t>> members(bucket_count);
+    for (size_t i = 0; i < n; i++) members[HashKey(keys[i], 0) % bucket_count].push_back((uint32_t)i);
+
+    std::vector<uint32_t> order(bucket_count);
+    for (size_t b = 0; b < bucket_count; b++) order[b] = (uint32_t)b;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return members[a].size() > members[b].size();
+    });
+
+    buckets->assign(bucket_count, 0);
+    slots->assign(slot_count, 0);
+    std::vector<size_t> placed;
+    for (uint32_t b : order) {
+        if (members[b].empty()) break;
+        bool done = false;
+        for (uint32_t seed = 1; seed < (1u << 24) && !done; seed++) {
+            placed.clear();
+            done = true;
+            for (uint32_t i : members[b]) {
+                size_t slot = HashKey(keys[i], seed) % slot_count;
+                if ((*slots)[slot] != 0 || std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+                    done = false;
+                    break;
+                }
+                placed.push_back(slot);
+            }
+            if (!done) continue;
+            for (size_t k = 0; k < placed.size(); k++) (*slots)[placed[k]] = members[b][k] + 1;
+            (*buckets)[b] = seed;
+        }
+        if (!done) return false;
+    }
+    return true;
+}
+
+bool GameTdbIndex::Build(const std::string& xml_path, const std::string& index_path, ImportStats* stats) {
+    ImportStats local;
+    std::vector<GameTdbGame> games;
+    std::vector<GameTdbName> names;
+    std::vector<uint64_t> sizes;
+    std::vector<uint64_t> keys;
+    std::unordered_set<uint64_t> seen;
+    // Offset 0 is the shared empty string
+    std::string pool(1, '\0');
+    std::map<std::string, uint32_t> interned;
+
+    auto add_string = [&pool](const std::string& s) -> uint32_t {
+        if (s.empty()) return 0;
+        uint32_t offset = (uint32_t)pool.size();
+        pool += s;
+        pool.push_back('\0');
+        return offset;
+    };
+    // Regions and types repeat for every game
+    auto intern = [&](const std::string& s) -> uint32_t {
+        auto it = interned.find(s);
+        if (it != interned.end()) return it->second;
+        uint32_t offset = add_string(s);
+        interned.emplace(s, offset);
+        return offset;
+    };
+
+    XmlStreamReader xml;
+    if (!xml.Open(xml_path)) return false;
+
+    int game_depth = 0;
+    GameTdbGame game;
+    std::string id;
+    std::string language;
+    size_t names_before = 0, sizes_before = 0;
+    while (true) {
+        XmlStreamReader::Event ev = xml.Next();
+        if (ev == XmlStreamReader::Event::End) break;
+        if (ev == XmlStreamReader::Event::Error) return false;
+
+        const std::string& name = xml.Name();
+        if (ev == XmlStreamReader::Event::StartElement) {
+            if (name == "game" && !game_depth) {
+                game_depth = xml.Depth();
+                memset(&game, 0, sizeof(game));
+                id.clear();
+                language.clear();
+                names_before = names.size();
+                sizes_before = sizes.size();
+            } else if (!game_depth) {
+                continue;
+            } else if (name == "id" && xml.Depth() == game_depth + 1) {
+                id = Trim(xml.ReadElementText());
+            } else if (name == "type" && xml.Depth() == game_depth + 1) {
+                game.type = intern(Trim(xml.ReadElementText()));
+            } else if (name == "region" && xml.Depth() == game_depth + 1) {
+                game.region = intern(Trim(xml.ReadElementText()));
+            } else if (name == "locale") {
+                const std::string* lang = xml.Attribute("lang");
+                language = lang ? *lang : "";
+            } else if (name == "title" && !language.empty()) {
+                std::string title = Trim(xml.ReadElementText());
+                if (!title.empty()) {
+                    GameTdbName entry;
+                    memset(&entry, 0, sizeof(entry));
+                    memcpy(entry.language, language.data(), (std::min)(language.size(), sizeof(entry.language) - 1));
+                    entry.title = add_string(title);
+                    names.push_back(entry);
+                }
+            } else if (name == "input") {
+                game.players = ParsePlayers(xml.Attribute("players"));
+            } else if (name == "wi-fi") {
+                game.wifi_players = ParsePlayers(xml.Attribute("players"));
+            } else if (name == "control") {
+                uint32_t control = ParseControl(xml.Attribute("type"));
+                game.controllers |= control;
+                const std::string* required = xml.Attribute("required");
+                if (required && *required == "true") game.required_controllers |= control;
+            } else if (name == "rom") {
+                if (const std::string* size = xml.Attribute("size")) {
+                    uint64_t bytes = strtoull(size->c_str(), nullptr, 10);
+                    if (bytes) sizes.push_back(bytes);
+                }
+            }
+        } else if (ev == XmlStreamReader::Event::EndElement && game_depth) {
+            if (name == "locale") {
+                language.clear();
+            } else if (name == "game" && xml.Depth() < game_depth) {
+                game_depth = 0;
+                uint64_t key;
+                bool fresh = PackId(id, &key) && seen.insert(key).second;
+                if (fresh && names.size() - names_before <= UINT16_MAX && sizes.size() - sizes_before <= UINT16_MAX) {
+                    memcpy(game.id, &key, sizeof(game.id));
+                    game.first_name = (uint32_t)names_before;
+                    game.name_count = (uint16_t)(names.size() - names_before);
+                    game.first_size = (uint32_t)sizes_before;
+                    game.size_count = (uint16_t)(sizes.size() - sizes_before);
+                    games.push_back(game);
+                    keys.push_back(key);
+                    local.names += game.name_count;
+                } else {
+                    if (!id.empty()) local.duplicates++;
+                    names.resize(names_before);
+                    sizes.resize(sizes_before);
+                }
+            }
+        }
+        if (pool.size() > UINT32_MAX || names.size() > UINT32_MAX || sizes.size() > UINT32_MAX) return false;
+    }
+    local.games = games.size();
+
+    std::vector<uint32_t> buckets, slots;
+    if (!BuildPerfectHash(keys, &buckets, &slots)) return false;
+
+    GameTdbHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = GAMETDB_MAGIC;
+    header.version = GAMETDB_VERSION;
+    header.game_count = (uint32_t)games.size();
+    header.bucket_count = (uint32_t)buckets.size();
+    header.slot_count = (uint32_t)slots.size();
+
+    std::vector<uint8_t> image(sizeof(header), 0);
+    auto add = [&](GameTdbSection section, const void* data, size_t size) {
+        image.resize((image.size() + 7) & ~(size_t)7, 0);
+        header.sections[section] = { image.size(), size };
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        if (size) image.insert(image.end(), bytes, bytes + size);
+    };
+    add(GAMETDB_GAMES, games.data(), games.size() * sizeof(GameTdbGame));
+    add(GAMETDB_NAMES, names.data(), names.size() * sizeof(GameTdbName));
+    add(GAMETDB_SIZES, sizes.data(), sizes.size() * sizeof(uint64_t));
+    add(GAMETDB_BUCKETS, buckets.data(), buckets.size() * sizeof(uint32_t));
+    add(GAMETDB_SLOTS, slots.data(), slots.size() * sizeof(uint32_t));
+    add(GAMETDB_STRINGS, pool.data(), pool.size());
+    memcpy(image.data(), &header, sizeof(header));
+    if (!WriteFileAtomically(index_path, image.data(), image.size())) return false;
+
+    if (stats) *stats = local;
+    return true;
+}
+
+// ============================================================================
+// Lookup
+// ============================================================================
+
+bool GameTdbIndex::Load(const std::string& index_path) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    header = nullptr;
+    mapping.Close();
+    if (!mapping.Open(index_path)) return false;
+
+    const uint8_t* base = mapping.Data();
+    size_t size = mapping.Size();
+    const GameTdbHeader* h = reinterpret_cast<const GameTdbHeader*>(base);
+    bool valid = size >= sizeof(GameTdbHeader) && h->magic == GAMETDB_MAGIC && h->version == GAMETDB_VERSION &&
+                 h->bucket_count > 0 && h->slot_count > 0;
+    for (size_t s = 0; valid && s < GAMETDB_SECTION_COUNT; s++) {
+        const GameTdbFileSection& section = h->sections[s];
+        valid = section.offset % 8 == 0 && section.offset <= size && section.size <= size - section.offset;
+    }
+    valid = valid && h->sections[GAMETDB_GAMES].size == (uint64_t)h->game_count * sizeof(GameTdbGame) &&
+            h->sections[GAMETDB_NAMES].size % sizeof(GameTdbName) == 0 &&
+            h->sections[GAMETDB_SIZES].size % sizeof(uint64_t) == 0 &&
+            h->sections[GAMETDB_BUCKETS].size == (uint64_t)h->bucket_count * sizeof(uint32_t) &&
+            h->sections[GAMETDB_SLOTS].size == (uint64_t)h->slot_count * sizeof(uint32_t) &&
+            h->sections[GAMETDB_STRINGS].size > 0 &&
+            base[h->sections[GAMETDB_STRINGS].offset + h->sections[GAMETDB_STRINGS].size - 1] == '\0';
+    if (!valid) {
+        mapping.Close();
+        return false;
+    }
+
+    auto at = [&](GameTdbSection s) { return base + h->sections[s].offset; };
+    games = reinterpret_cast<const GameTdbGame*>(at(GAMETDB_GAMES));
+    names = reinterpret_cast<const GameTdbName*>(at(GAMETDB_NAMES));
+    name_count = (size_t)(h->sections[GAMETDB_NAMES].size / sizeof(GameTdbName));
+    sizes = reinterpret_cast<const uint64_t*>(at(GAMETDB_SIZES));
+    size_count = (size_t)(h->sections[GAMETDB_SIZES].size / sizeof(uint64_t));
+    buckets = reinterpret_cast<const uint32_t*>(at(GAMETDB_BUCKETS));
+    slots = reinterpret_cast<const uint32_t*>(at(GAMETDB_SLOTS));
+    strings = reinterpret_cast<const char*>(at(GAMETDB_STRINGS));
+    strings_size = (size_t)h->sections[GAMETDB_STRINGS].size;
+    header = h;
+    return true;
+}
+
+void GameTdbIndex::Unload() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    header = nullptr;
+    mapping.Close();
+}
+
+bool GameTdbIndex::IsLoaded() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return header != nullptr;
+}
+
+size_t GameTdbIndex::Count() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return header ? header->game_count : 0;
+}
+
+const char* GameTdbIndex::String(uint32_t offset) const {
+    return offset < strings_size ? strings + offset : "";
+}
+
+const GameTdbGame* GameTdbIndex::Lookup(uint64_t key) const {
+    uint32_t seed = buckets[HashKey(key, 0) % header->bucket_count];
+    if (seed == 0) return nullptr;
+    uint32_t slot = slots[HashKey(key, seed) % header->slot_count];
+    if (slot == 0 || slot > header->game_count) return nullptr;
+    const GameTdbGame* game = &games[slot - 1];
+    return memcmp(game->id, &key, sizeof(game->id)) == 0 ? game : nullptr;
+}
+
+const GameTdbGame* GameTdbIndex::LookupId(const std::string& title_id) const {
+    uint64_t key;
+    if (!PackId(title_id, &key)) return nullptr;
+    const GameTdbGame* game = Lookup(key);
+    if (!game && title_id.size() == 6 && PackId(title_id.substr(0, 4), &key)) game = Lookup(key);
+    return game;
+}
+
+bool GameTdbIndex::Fill(const GameTdbGame& game, GameTdbRecord* record) const {
+    if ((uint64_t)game.first_name + game.name_count > name_count ||
+        (uint64_t)game.first_size + game.size_count > size_count) {
+        return false;
+    }
+    if (!record) return true;
+    record->title_id = std::string(game.id, strnlen(game.id, sizeof(game.id)));
+    record->region = String(game.region);
+    record->type = String(game.type);
+    record->names.clear();
+    for (uint32_t i = 0; i < game.name_count; i++) {
+        const GameTdbName& name = names[game.first_name + i];
+        record->names.emplace_back(std::string(name.language, strnlen(name.language, sizeof(name.language))),
+                                   String(name.title));
+    }
+    record->players = game.players;
+    record->wifi_players = game.wifi_players;
+    record->controllers = game.controllers;
+    record->required_controllers = game.required_controllers;
+    record->sizes.assign(sizes + game.first_size, sizes + game.first_size + game.size_count);
+    return true;
+}
+
+bool GameTdbIndex::Find(const std::string& title_id, GameTdbRecord* record) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (!header) return false;
+    const GameTdbGame* game = LookupId(title_id);
+    return game && Fill(*game, record);
+}
+
+size_t GameTdbIndex::FindAll(const std::vector<std::string>& title_ids, const RecordFn& fn) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (!header) return 0;
+    size_t found = 0;
+    GameTdbRecord record;
+    for (size_t i = 0; i < title_ids.size(); i++) {
+        const GameTdbGame* game = LookupId(title_ids[i]);
+        if (!game || !Fill(*game, &record)) continue;
+        found++;
+        fn(i, record);
+    }
+    return found;
+}
+
+GameTdbIndex& GameTdbIndex::Shared() {
+    static GameTdbIndex instance;
+    return instance;
+}
@@ -0,0 +1,163 @@
+#ifndef FORGE_GAMETDB_H
+#define FORGE_GAMETDB_H
+
+#include "forge_io.h"
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+// ============================================================================
+// On-disk layout of the GameTDB index (little-endian, sections 8-aligned)
+//
+//   GameTdbHeader
+//   GAMETDB_GAMES      GameTdbGame[game_count]    in document order
+//   GAMETDB_NAMES      GameTdbName[name_count]    grouped by game
+//   GAMETDB_SIZES      uint64[size_count]         ROM sizes, grouped by game
+//   GAMETDB_BUCKETS    uint32[bucket_count]       perfect hash displacements
+//   GAMETDB_SLOTS      uint32[slot_count]         game number + 1, 0 = empty
+//   GAMETDB_STRINGS    NUL-terminated UTF-8; offset 0 is ""
+// ============================================================================
+
+constexpr uint32_t GAMETDB_MAGIC = 0x42445446;   // "FTDB"
+constexpr uint32_t GAMETDB_VERSION = 1;
+
+enum GameTdbSection {
+    GAMETDB_GAMES,
+    GAMETDB_NAMES,
+    GAMETDB_SIZES,
+    GAMETDB_BUCKETS,
+    GAMETDB_SLOTS,
+    GAMETDB_STRINGS,
+    GAMETDB_SECTION_COUNT
+};
+
+// Controllers a game accepts, from <control type="...">
+enum GameTdbControl : uint32_t {
+    CONTROL_WIIMOTE = 1u << 0,
+    CONTROL_NUNCHUK = 1u << 1,
+    CONTROL_CLASSIC = 1u << 2,
+    CONTROL_GAMECUBE = 1u << 3,
+    CONTROL_MOTIONPLUS = 1u << 4,
+    CONTROL_BALANCEBOARD = 1u << 5,
+    CONTROL_WHEEL = 1u << 6,
+    CONTROL_ZAPPER = 1u << 7,
+    CONTROL_GUITAR = 1u << 8,
+    CONTROL_DRUMS = 1u << 9,
+    CONTROL_MICROPHONE = 1u << 10,
+    CONTROL_WIISPEAK = 1u << 11,
+    CONTROL_DANCEPAD = 1u << 12,
+    CONTROL_KEYBOARD = 1u << 13,
+    CONTROL_UDRAW = 1u << 14,
+    CONTROL_GAMEPAD = 1u << 15,
+    CONTROL_PRO = 1u << 16,
+};
+constexpr size_t GAMETDB_CONTROL_COUNT = 17;
+
+const char* GameTdbControlName(GameTdbControl control);
+
+struct GameTdbFileSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct GameTdbHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t game_count;
+    uint32_t bucket_count;
+    uint32_t slot_count;
+    uint32_t reserved;
+    GameTdbFileSection sections[GAMETDB_SECTION_COUNT];
+};
+
+struct GameTdbGame {
+    char id[8];                 // Title ID, NUL-padded
+    uint32_t region;            // String offsets
+    uint32_t type;
+    uint32_t first_name;
+    uint32_t first_size;
+    uint16_t name_count;
+    uint16_t size_count;
+    uint8_t players;
+    uint8_t wifi_players;
+    uint16_t reserved;
+    uint32_t controllers;       // GameTdbControl bits
+    uint32_t required_controllers;
+};
+
+struct GameTdbName {
+    char language[4];           // "EN", "JA", ... NUL-padded
+    uint32_t title;             // String offset
+};
+
+static_assert(sizeof(GameTdbHeader) == 24 + 16 * GAMETDB_SECTION_COUNT, "GameTdbHeader layout");
+static_assert(sizeof(GameTdbGame) == 40, "GameTdbGame layout");
+static_assert(sizeof(GameTdbName) == 8, "GameTdbName layout");
+
+// A game's metadata (copied out of the mapping)
+struct GameTdbRecord {
+    std::string title_id;
+    std::string region;
+    std::string type;                   // Empty for Wii discs
+    std::vector<std::pair<std::string, std::string>> names;   // Language, title
+    uint8_t players = 0;
+    uint8_t wifi_players = 0;
+    uint32_t controllers = 0;
+    uint32_t required_controllers = 0;
+    std::vector<uint64_t> sizes;
+};
+
+// GameTDB metadata (wiitdb.xml and friends) keyed by title ID, backed by a
+// memory-mapped index file. The import streams the XML once through
+// XmlStreamReader and keeps only what goes into the index (synopses,
+// ratings and the like are never held). Lookups go through a
+// hash-and-displace perfect hash: one bucket read, one slot read and a key
+// compare, whatever the size of the database.
+class GameTdbIndex {
+public:
+    struct ImportStats {
+        size_t games = 0;
+        size_t names = 0;
+        size_t duplicates = 0;
+    };
+
+    static bool Build(const std::string& xml_path, const std::string& index_path, ImportStats* stats = nullptr);
+
+    bool Load(const std::string& index_path);
+    void Unload();
+    bool IsLoaded() const;
+    size_t Count() const;
+
+    // Six-character IDs without an entry fall back to their first four
+    // (WiiWare and Virtual Console titles are listed that way)
+    bool Find(const std::string& title_id, GameTdbRecord* record) const;
+    // Every ID under one lock; fn is called for each one found
+    using RecordFn = std::function<void(size_t index, const GameTdbRecord& record)>;
+    size_t FindAll(const std::vector<std::string>& title_ids, const RecordFn& fn) const;
+
+    static GameTdbIndex& Shared();
+
+private:
+    const GameTdbGame* Lookup(uint64_t key) const;
+    const GameTdbGame* LookupId(const std::string& title_id) const;
+    bool Fill(const GameTdbGame& game, GameTdbRecord* record) const;
+    const char* String(uint32_t offset) const;
+
+    mutable std::shared_mutex mutex;
+    MappedFile mapping;
+    const GameTdbHeader* header = nullptr;
+    const GameTdbGame* games = nullptr;
+    const GameTdbName* names = nullptr;
+    size_t name_count = 0;
+    const uint64_t* sizes = nullptr;
+    size_t size_count = 0;
+    const uint32_t* buckets = nullptr;
+    const uint32_t* slots = nullptr;
+    const char* strings = nullptr;
+    size_t strings_size = 0;
+};
+
+#endif // FORGE_GAMETDB_H
@@ -0,0 +1,277 @@
+#include "forge_hash.h"
+#include "forge_hash_kernels.h"
+#include "forge_io.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+
+// ============================================================================
+// CRC-32
+// ============================================================================
+
+void Crc32::Update(const uint8_t* data, size_t size) {
+    state = HashKernels::Active().crc32(state, data, size);
+}
+
+// ============================================================================
+// MD5
+// ============================================================================
+
+static inline uint32_t Rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t ReadLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void Md5::Reset() {
+    state[0] = 0x67452301;
+    state[1] = 0xEFCDAB89;
+    state[2] = 0x98BADCFE;
+    state[3] = 0x10325476;
+    length = 0;
+    buffered = 0;
+}
+
+void Md5::Transform(const uint8_t* block) {
+    static const uint32_t K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+    static const int S[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++) m[i] = ReadLE32(block + i * 4);
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16)      { f = (b & c) | (~b & d); g = i; }
+        else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) & 15; }
+        else if (i < 48) { f = b ^ c ^ d;          g = (3 * i + 5) & 15; }
+        else             { f = c ^ (b | ~d);       g = (7 * i) & 15; }
+        uint32_t tmp = d;
+        d = c;
+        c = b;
+        b = b + Rotl32(a + f + K[i] + m[g], S[i]);
+        a = tmp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+void Md5::Update(const uint8_t* data, size_t size) {
+    length += size;
+    if (buffered > 0) {
+        size_t take = (std::min)(size, sizeof(buffer) - buffered);
+        memcpy(buffer + buffered, data, take);
+        buffered += take;
+        data += take;
+        size -= take;
+        if (buffered < sizeof(buffer)) return;
+        Transform(buffer);
+        buffered = 0;
+    }
+    while (size >= 64) {
+        Transform(data);
+        data += 64;
+        size -= 64;
+    }
+    if (size > 0) {
+        memcpy(buffer, data, size);
+        buffered = size;
+    }
+}
+
+std::array<uint8_t, 16> Md5::Final() {
+    uint64_t bit_length = length * 8;
+    static const uint8_t pad[64] = { 0x80 };
+    size_t pad_len = (buffered < 56) ? (56 - buffered) : (120 - buffered);
+    Update(pad, pad_len);
+    uint8_t len_bytes[8];
+    for (int i = 0; i < 8; i++) len_bytes[i] = (uint8_t)(bit_length >> (8 * i));
+    Update(len_bytes, 8);
+
+    std::array<uint8_t, 16> out{};
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) out[i * 4 + j] = (uint8_t)(state[i] >> (8 * j));
+    }
+    return out;
+}
+
+// ============================================================================
+// SHA-1
+// ============================================================================
+
+void Sha1::Reset() {
+    state[0] = 0x67452301;
+    state[1] = 0xEFCDAB89;
+    state[2] = 0x98BADCFE;
+    state[3] = 0x10325476;
+    state[4] = 0xC3D2E1F0;
+    length = 0;
+    buffered = 0;
+}
+
+void Sha1::Update(const uint8_t* data, size_t size) {
+    const HashKernels& kernels = HashKernels::Active();
+    length += size;
+    if (buffered > 0) {
+        size_t take = (std::min)(size, sizeof(buffer) - buffered);
+        memcpy(buffer + buffered, data, take);
+        buffered += take;
+        data += take;
+        size -= take;
+        if (buffered < sizeof(buffer)) return;
+        kernels.sha1(state, buffer, 1);
+        buffered = 0;
+    }
+    // Whole blocks go to the kernel in one call so SIMD state stays in registers
+    size_t blocks = size / 64;
+    if (blocks > 0) {
+        kernels.sha1(state, data, blocks);
+        data += blocks * 64;
+        size -= blocks * 64;
+    }
+    if (size > 0) {
+        memcpy(buffer, data, size);
+        buffered = size;
+    }
+}
+
+std::array<uint8_t, 20> Sha1::Final() {
+    uint64_t bit_length = length * 8;
+    static const uint8_t pad[64] = { 0x80 };
+    size_t pad_len = (buffered < 56) ? (56 - buffered) : (120 - buffered);
+    Update(pad, pad_len);
+    uint8_t len_bytes[8];
+    for (int i = 0; i < 8; i++) len_bytes[i] = (uint8_t)(bit_length >> (56 - 8 * i));
+    Update(len_bytes, 8);
+
+    std::array<uint8_t, 20> out{};
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 4; j++) out[i * 4 + j] = (uint8_t)(state[i] >> (24 - 8 * j));
+    }
+    return out;
+}
+
+// ============================================================================
+// MultiHasher / HashResult
+// ============================================================================
+
+void MultiHasher::Update(const uint8_t* data, size_t size) {
+    total += size;
+    if (kinds & HASH_CRC32) crc.Update(data, size);
+    if (kinds & HASH_MD5) md5.Update(data, size);
+    if (kinds & HASH_SHA1) sha1.Update(data, size);
+}
+
+HashResult MultiHasher::Finish() {
+    HashResult result;
+    result.ok = true;
+    result.kinds = kinds;
+    result.bytes_hashed = total;
+    if (kinds & HASH_CRC32) result.crc32 = crc.Final();
+    if (kinds & HASH_MD5) result.md5 = md5.Final();
+    if (kinds & HASH_SHA1) result.sha1 = sha1.Final();
+    return result;
+}
+
+std::string HashResult::Crc32Hex() const {
+    char buf[9];
+    snprintf(buf, sizeof(buf), "%08x", crc32);
+    return buf;
+}
+
+std::string HashResult::Md5Hex() const {
+    return HashEngine::ToHex(md5.data(), md5.size());
+}
+
+std::string HashResult::Sha1Hex() const {
+    return HashEngine::ToHex(sha1.data(), sha1.size());
+}
+
+// ============================================================================
+// HashEngine
+// ============================================================================
+
+std::string HashEngine::ToHex(const uint8_t* data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(size * 2, '0');
+    for (size_t i = 0; i < size; i++) {
+        out[i * 2] = digits[data[i] >> 4];
+        out[i * 2 + 1] = digits[data[i] & 0x0F];
+    }
+    return out;
+}
+
+uint32_t HashEngine::KindForHex(const std::string& expected_hex) {
+    switch (expected_hex.size()) {
+        case 8: return HASH_CRC32;
+        case 32: return HASH_MD5;
+        case 40: return HASH_SHA1;
+        default: return 0;
+    }
+}
+
+bool HashEngine::Matches(const HashResult& result, const std::string& expected_hex) {
+    if (!result.ok) return false;
+
+    std::string actual;
+    uint32_t kind = KindForHex(expected_hex);
+    if (!(result.kinds & kind)) return false;
+    if (kind == HASH_CRC32) actual = result.Crc32Hex();
+    else if (kind == HASH_MD5) actual = result.Md5Hex();
+    else if (kind == HASH_SHA1) actual = result.Sha1Hex();
+    else return false;
+
+    for (size_t i = 0; i < actual.size(); i++) {
+        if (actual[i] != (char)std::tolower((unsigned char)expected_hex[i])) return false;
+    }
+    return true;
+}
+
+HashResult HashEngine::HashFile(const std::string& file_path, uint32_t kinds,
+                                const ProgressFn& progress, const std::atomic<bool>* cancel) {
+    HashResult failed;
+    failed.kinds = kinds;
+
+    // Reads run on their own thread so the digests never wait on the disk
+    ReadAheadReader reader;
+    ReadAheadReader::Options options;
+    options.block_size = CHUNK_SIZE;
+    options.depth = READ_AHEAD_DEPTH;
+    if (!reader.Open(file_path, options)) return failed;
+
+    MultiHasher hasher(kinds);
+    uint64_t total = reader.FileSize();
+    uint64_t done = 0;
+    const uint8_t* block = nullptr;
+    size_t size = 0;
+
+    while (reader.Next(&block, &size)) {
+        if (cancel && cancel->load()) return failed;
+        hasher.Update(block, size);
+        done += size;
+        if (progress) progress(done, total);
+    }
+
+    if (reader.Failed() || done != total) return failed;
+    return hasher.Finish();
+}
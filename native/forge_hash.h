@@ -0,0 +1,113 @@
+#ifndef FORGE_HASH_H
+#define FORGE_HASH_H
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <stdint.h>
+
+// Hash selection flags (combine with |)
+enum HashKind : uint32_t {
+    HASH_CRC32 = 1u << 0,
+    HASH_MD5   = 1u << 1,
+    HASH_SHA1  = 1u << 2,
+    HASH_ALL   = HASH_CRC32 | HASH_MD5 | HASH_SHA1
+};
+
+// Streaming CRC-32 (IEEE 802.3, reflected, as used by Redump/No-Intro DATs)
+class Crc32 {
+public:
+    void Reset() { state = 0xFFFFFFFFu; }
+    void Update(const uint8_t* data, size_t size);
+    uint32_t Final() const { return state ^ 0xFFFFFFFFu; }
+
+private:
+    uint32_t state = 0xFFFFFFFFu;
+};
+
+// Streaming MD5 (RFC 1321)
+class Md5 {
+public:
+    Md5() { Reset(); }
+    void Reset();
+    void Update(const uint8_t* data, size_t size);
+    std::array<uint8_t, 16> Final();
+
+private:
+    void Transform(const uint8_t* block);
+    uint32_t state[4];
+    uint64_t length;
+    uint8_t buffer[64];
+    size_t buffered;
+};
+
+// Streaming SHA-1 (FIPS 180-4)
+class Sha1 {
+public:
+    Sha1() { Reset(); }
+    void Reset();
+    void Update(const uint8_t* data, size_t size);
+    std::array<uint8_t, 20> Final();
+
+private:
+    uint32_t state[5];
+    uint64_t length;
+    uint8_t buffer[64];
+    size_t buffered;
+};
+
+// Digest set produced by a single pass over the data
+struct HashResult {
+    bool ok = false;
+    uint32_t kinds = 0;          // HashKind flags that were computed
+    uint64_t bytes_hashed = 0;
+    uint32_t crc32 = 0;
+    std::array<uint8_t, 16> md5{};
+    std::array<uint8_t, 20> sha1{};
+
+    std::string Crc32Hex() const;
+    std::string Md5Hex() const;
+    std::string Sha1Hex() const;
+};
+
+// Feeds every enabled digest from the same buffer so the data is only read once
+class MultiHasher {
+public:
+    explicit MultiHasher(uint32_t kinds = HASH_ALL) : kinds(kinds) {}
+    void Update(const uint8_t* data, size_t size);
+    HashResult Finish();
+
+private:
+    uint32_t kinds;
+    uint64_t total = 0;
+    Crc32 crc;
+    Md5 md5;
+    Sha1 sha1;
+};
+
+class HashEngine {
+public:
+    // Read size per chunk; memory use is bounded by CHUNK_SIZE * READ_AHEAD_DEPTH
+    // regardless of file size
+    static constexpr size_t CHUNK_SIZE = 4 * 1024 * 1024;
+    static constexpr size_t READ_AHEAD_DEPTH = 4;
+
+    // (bytes_done, bytes_total) - called once per chunk
+    using ProgressFn = std::function<void(uint64_t, uint64_t)>;
+
+    // Hash a file in one sequential pass. Returns ok=false on I/O error or cancel.
+    static HashResult HashFile(const std::string& file_path, uint32_t kinds = HASH_ALL,
+                               const ProgressFn& progress = nullptr,
+                               const std::atomic<bool>* cancel = nullptr);
+
+    // Pick the digest from the hex length (8=CRC32, 32=MD5, 40=SHA-1)
+    static uint32_t KindForHex(const std::string& expected_hex);
+
+    // Case-insensitive compare of the computed digest against a hex string
+    static bool Matches(const HashResult& result, const std::string& expected_hex);
+
+    static std::string ToHex(const uint8_t* data, size_t size);
+};
+
+#endif // FORGE_HASH_H
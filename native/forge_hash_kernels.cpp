@@ -0,0 +1,397 @@
+#include "forge_hash_kernels.h"
+#include <mutex>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FORGE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FORGE_TARGET(features)
+#else
+#include <cpuid.h>
+#define FORGE_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+static inline uint32_t Rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t ReadLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint32_t ReadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// ============================================================================
+// CRC-32: byte-wise and slice-by-16 tables
+// ============================================================================
+
+static uint32_t g_crc_tables[16][256];
+
+static void BuildCrcTables() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+        }
+        g_crc_tables[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 16; t++) {
+            uint32_t prev = g_crc_tables[t - 1][i];
+            g_crc_tables[t][i] = (prev >> 8) ^ g_crc_tables[0][prev & 0xFF];
+        }
+    }
+}
+
+static uint32_t Crc32Bytewise(uint32_t crc, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        crc = g_crc_tables[0][(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static uint32_t Crc32Slice16(uint32_t crc, const uint8_t* data, size_t size) {
+    const uint32_t (*t)[256] = g_crc_tables;
+    while (size >= 16) {
+        uint32_t one = ReadLE32(data) ^ crc;
+        uint32_t two = ReadLE32(data + 4);
+        uint32_t three = ReadLE32(data + 8);
+        uint32_t four = ReadLE32(data + 12);
+        crc = t[0][(four >> 24) & 0xFF] ^ t[1][(four >> 16) & 0xFF] ^
+              t[2][(four >> 8) & 0xFF] ^ t[3][four & 0xFF] ^
+              t[4][(three >> 24) & 0xFF] ^ t[5][(three >> 16) & 0xFF] ^
+              t[6][(three >> 8) & 0xFF] ^ t[7][three & 0xFF] ^
+              t[8][(two >> 24) & 0xFF] ^ t[9][(two >> 16) & 0xFF] ^
+              t[10][(two >> 8) & 0xFF] ^ t[11][two & 0xFF] ^
+              t[12][(one >> 24) & 0xFF] ^ t[13][(one >> 16) & 0xFF] ^
+              t[14][(one >> 8) & 0xFF] ^ t[15][one & 0xFF];
+        data += 16;
+        size -= 16;
+    }
+    return Crc32Bytewise(crc, data, size);
+}
+
+// ============================================================================
+// SHA-1: portable compression
+// ============================================================================
+
+static void Sha1BlocksPortable(uint32_t state[5], const uint8_t* data, size_t block_count) {
+    for (size_t blk = 0; blk < block_count; blk++, data += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) w[i] = ReadBE32(data + i * 4);
+        for (int i = 16; i < 80; i++) w[i] = Rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        // One loop per round function keeps the hot path branch-free
+#define SHA1_STEP(f, k)                                      \
+        {                                                    \
+            uint32_t tmp = Rotl32(a, 5) + (f) + e + (k) + w[i]; \
+            e = d;                                           \
+            d = c;                                           \
+            c = Rotl32(b, 30);                               \
+            b = a;                                           \
+            a = tmp;                                         \
+        }
+        int i = 0;
+        for (; i < 20; i++) SHA1_STEP((b & c) | (~b & d), 0x5A827999u);
+        for (; i < 40; i++) SHA1_STEP(b ^ c ^ d, 0x6ED9EBA1u);
+        for (; i < 60; i++) SHA1_STEP((b & c) | (b & d) | (c & d), 0x8F1BBCDCu);
+        for (; i < 80; i++) SHA1_STEP(b ^ c ^ d, 0xCA62C1D6u);
+#undef SHA1_STEP
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#ifdef FORGE_X86
+
+// ============================================================================
+// CRC-32: PCLMULQDQ folding
+// (Intel, "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ")
+// ============================================================================
+
+FORGE_TARGET("pclmul,sse4.1")
+static uint32_t Crc32FoldPclmul(uint32_t crc, const uint8_t* buf, size_t len) {
+    // Bit-reflected fold constants for the IEEE polynomial; len >= 64 and a
+    // multiple of 16
+    alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+    alignas(16) static const uint64_t k3k4[] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+    alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124ULL, 0x0000000000ULL };
+    alignas(16) static const uint64_t poly[] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    x0 = _mm_load_si128((const __m128i*)k1k2);
+    buf += 64;
+    len -= 64;
+
+    // Fold four 128-bit lanes in parallel
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        buf += 64;
+        len -= 64;
+    }
+
+    // Fold the four lanes into one
+    x0 = _mm_load_si128((const __m128i*)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i*)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 bits
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x0 = _mm_load_si128((const __m128i*)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t Crc32Pclmul(uint32_t crc, const uint8_t* data, size_t size) {
+    if (size >= 64) {
+        size_t chunk = size & ~(size_t)15;
+        crc = Crc32FoldPclmul(crc, data, chunk);
+        data += chunk;
+        size -= chunk;
+    }
+    return Crc32Slice16(crc, data, size);
+}
+
+// ============================================================================
+// SHA-1: SHA-NI
+// ============================================================================
+
+// Four rounds using E0 (even groups) or E1 (odd groups) as the E input
+#define SHA1_ROUNDS_EVEN(func, msg)               \
+    E0 = _mm_sha1nexte_epu32(E0, msg);            \
+    E1 = ABCD;                                    \
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, func);
+#define SHA1_ROUNDS_ODD(func, msg)                \
+    E1 = _mm_sha1nexte_epu32(E1, msg);            \
+    E0 = ABCD;                                    \
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, func);
+// Message schedule step driven by the words just consumed
+#define SHA1_SCHEDULE(cur, next, after, last)     \
+    next = _mm_sha1msg2_epu32(next, cur);         \
+    last = _mm_sha1msg1_epu32(last, cur);         \
+    after = _mm_xor_si128(after, cur);
+
+FORGE_TARGET("sha,sse4.1,ssse3")
+static void Sha1BlocksShaNi(uint32_t state[5], const uint8_t* data, size_t block_count) {
+    const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    __m128i ABCD = _mm_loadu_si128((const __m128i*)state);
+    __m128i E0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+    __m128i E1;
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
+
+    for (size_t blk = 0; blk < block_count; blk++, data += 64) {
+        __m128i ABCD_SAVE = ABCD;
+        __m128i E0_SAVE = E0;
+
+        __m128i MSG0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), MASK);
+        __m128i MSG1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), MASK);
+        __m128i MSG2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), MASK);
+        __m128i MSG3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), MASK);
+
+        // Rounds 0-15: message words come straight from the block
+        E0 = _mm_add_epi32(E0, MSG0);
+        E1 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+        SHA1_ROUNDS_ODD(0, MSG1);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+
+        SHA1_ROUNDS_EVEN(0, MSG2);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+        SHA1_ROUNDS_ODD(0, MSG3);
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+        // Rounds 16-79: scheduled words
+        SHA1_ROUNDS_EVEN(0, MSG0); SHA1_SCHEDULE(MSG0, MSG1, MSG2, MSG3);
+        SHA1_ROUNDS_ODD(1, MSG1);  SHA1_SCHEDULE(MSG1, MSG2, MSG3, MSG0);
+        SHA1_ROUNDS_EVEN(1, MSG2); SHA1_SCHEDULE(MSG2, MSG3, MSG0, MSG1);
+        SHA1_ROUNDS_ODD(1, MSG3);  SHA1_SCHEDULE(MSG3, MSG0, MSG1, MSG2);
+        SHA1_ROUNDS_EVEN(1, MSG0); SHA1_SCHEDULE(MSG0, MSG1, MSG2, MSG3);
+        SHA1_ROUNDS_ODD(1, MSG1);  SHA1_SCHEDULE(MSG1, MSG2, MSG3, MSG0);
+        SHA1_ROUNDS_EVEN(2, MSG2); SHA1_SCHEDULE(MSG2, MSG3, MSG0, MSG1);
+        SHA1_ROUNDS_ODD(2, MSG3);  SHA1_SCHEDULE(MSG3, MSG0, MSG1, MSG2);
+        SHA1_ROUNDS_EVEN(2, MSG0); SHA1_SCHEDULE(MSG0, MSG1, MSG2, MSG3);
+        SHA1_ROUNDS_ODD(2, MSG1);  SHA1_SCHEDULE(MSG1, MSG2, MSG3, MSG0);
+        SHA1_ROUNDS_EVEN(2, MSG2); SHA1_SCHEDULE(MSG2, MSG3, MSG0, MSG1);
+        SHA1_ROUNDS_ODD(3, MSG3);  SHA1_SCHEDULE(MSG3, MSG0, MSG1, MSG2);
+        SHA1_ROUNDS_EVEN(3, MSG0); SHA1_SCHEDULE(MSG0, MSG1, MSG2, MSG3);
+        SHA1_ROUNDS_ODD(3, MSG1);  SHA1_SCHEDULE(MSG1, MSG2, MSG3, MSG0);
+        SHA1_ROUNDS_EVEN(3, MSG2); SHA1_SCHEDULE(MSG2, MSG3, MSG0, MSG1);
+        SHA1_ROUNDS_ODD(3, MSG3);
+
+        E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+        ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+    }
+
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
+    _mm_storeu_si128((__m128i*)state, ABCD);
+    state[4] = (uint32_t)_mm_extract_epi32(E0, 3);
+}
+
+#undef SHA1_ROUNDS_EVEN
+#undef SHA1_ROUNDS_ODD
+#undef SHA1_SCHEDULE
+
+// ============================================================================
+// CPUID
+// ============================================================================
+
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool pclmul = false;
+    bool sha = false;
+};
+
+static CpuFeatures DetectCpu() {
+    CpuFeatures f;
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0);
+    unsigned int max_leaf = (unsigned int)regs[0];
+    __cpuid(regs, 1);
+    ecx = (unsigned int)regs[2];
+#else
+    unsigned int max_leaf = __get_cpuid_max(0, nullptr);
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+#endif
+    f.ssse3 = (ecx >> 9) & 1;
+    f.sse41 = (ecx >> 19) & 1;
+    f.pclmul = (ecx >> 1) & 1;
+
+    if (max_leaf >= 7) {
+#ifdef _MSC_VER
+        __cpuidex(regs, 7, 0);
+        ebx = (unsigned int)regs[1];
+#else
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+#endif
+        f.sha = (ebx >> 29) & 1;
+    }
+    return f;
+}
+
+#endif // FORGE_X86
+
+// ============================================================================
+// Dispatch
+// ============================================================================
+
+static HashKernels g_active;
+static std::once_flag g_init_once;
+
+std::vector<HashKernels::Crc32Kernel> HashKernels::AvailableCrc32() {
+    Init();
+    std::vector<Crc32Kernel> kernels = {
+        { "bytewise", Crc32Bytewise },
+        { "slice-by-16", Crc32Slice16 },
+    };
+#ifdef FORGE_X86
+    CpuFeatures cpu = DetectCpu();
+    if (cpu.pclmul && cpu.sse41) kernels.push_back({ "pclmulqdq", Crc32Pclmul });
+#endif
+    return kernels;
+}
+
+std::vector<HashKernels::Sha1Kernel> HashKernels::AvailableSha1() {
+    Init();
+    std::vector<Sha1Kernel> kernels = {
+        { "portable", Sha1BlocksPortable },
+    };
+#ifdef FORGE_X86
+    CpuFeatures cpu = DetectCpu();
+    if (cpu.sha && cpu.sse41 && cpu.ssse3) kernels.push_back({ "sha-ni", Sha1BlocksShaNi });
+#endif
+    return kernels;
+}
+
+void HashKernels::Init() {
+    std::call_once(g_init_once, [] {
+        BuildCrcTables();
+        g_active.crc32 = Crc32Slice16;
+        g_active.crc32_name = "slice-by-16";
+        g_active.sha1 = Sha1BlocksPortable;
+        g_active.sha1_name = "portable";
+#ifdef FORGE_X86
+        CpuFeatures cpu = DetectCpu();
+        if (cpu.pclmul && cpu.sse41) {
+            g_active.crc32 = Crc32Pclmul;
+            g_active.crc32_name = "pclmulqdq";
+        }
+        if (cpu.sha && cpu.sse41 && cpu.ssse3) {
+            g_active.sha1 = Sha1BlocksShaNi;
+            g_active.sha1_name = "sha-ni";
+        }
+#endif
+    });
+}
+
+const HashKernels& HashKernels::Active() {
+    Init();
+    return g_active;
+}
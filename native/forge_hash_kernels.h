@@ -0,0 +1,35 @@
+#ifndef FORGE_HASH_KERNELS_H
+#define FORGE_HASH_KERNELS_H
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// Low-level digest kernels selected once per process from the CPU features.
+//
+// CRC-32 kernels take and return the raw register (pre/post inversion is
+// done by Crc32). SHA-1 kernels compress whole 64-byte blocks.
+struct HashKernels {
+    using Crc32Fn = uint32_t (*)(uint32_t state, const uint8_t* data, size_t size);
+    using Sha1BlocksFn = void (*)(uint32_t state[5], const uint8_t* data, size_t block_count);
+
+    Crc32Fn crc32 = nullptr;
+    const char* crc32_name = "";
+    Sha1BlocksFn sha1 = nullptr;
+    const char* sha1_name = "";
+
+    // Run CPUID dispatch (idempotent, thread-safe). Called from forge_init.
+    static void Init();
+
+    // Kernels chosen by Init(); runs Init() on first use if needed
+    static const HashKernels& Active();
+
+    // Every kernel usable on this CPU, fastest last (for benchmarks and
+    // cross-checking the accelerated paths against the portable ones)
+    struct Crc32Kernel { const char* name; Crc32Fn fn; };
+    struct Sha1Kernel { const char* name; Sha1BlocksFn fn; };
+    static std::vector<Crc32Kernel> AvailableCrc32();
+    static std::vector<Sha1Kernel> AvailableSha1();
+};
+
+#endif // FORGE_HASH_KERNELS_H
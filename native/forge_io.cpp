@@ -0,0 +1,427 @@
+#include "forge_io.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <new>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ReadAheadReader::~ReadAheadReader() {
+    Close();
+}
+
+bool ReadAheadReader::Open(const std::string& file_path, const Options& options) {
+    Close();
+
+#ifdef _WIN32
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, file_path.c_str(), -1, nullptr, 0);
+    if (wlen <= 0) return false;
+    std::wstring wpath(wlen, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, file_path.c_str(), -1, wpath.data(), wlen);
+
+    // SEQUENTIAL_SCAN tells the cache manager to read ahead aggressively
+    HANDLE h = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(h, &size)) {
+        CloseHandle(h);
+        return false;
+    }
+    handle = h;
+    file_size = (uint64_t)size.QuadPart;
+#else
+    fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    file_size = (uint64_t)st.st_size;
+#endif
+
+    start = (std::min)(options.offset, file_size);
+    uint64_t available = file_size - start;
+    end = start + (std::min)(options.length, available);
+    block_size = (std::max)(options.block_size, ALIGNMENT);
+    block_size = (block_size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+
+#if defined(__linux__)
+    // Doubles the kernel readahead window for this descriptor
+    posix_fadvise(fd, (off_t)start, (off_t)(end - start), POSIX_FADV_SEQUENTIAL);
+#elif defined(__APPLE__)
+    fcntl(fd, F_RDAHEAD, 1);
+#endif
+
+    ring.resize((std::max)(options.depth, (size_t)2));
+    for (auto& slot : ring) {
+        slot.data = static_cast<uint8_t*>(::operator new(block_size, std::align_val_t(ALIGNMENT)));
+        slot.size = 0;
+        slot.filled = false;
+    }
+    consume_index = 0;
+    holding = false;
+    eof = false;
+    stop.store(false);
+    failed.store(false);
+
+    io_thread = std::thread(&ReadAheadReader::IoLoop, this);
+    return true;
+}
+
+void ReadAheadReader::Close() {
+    if (io_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop.store(true);
+        }
+        cv.notify_all();
+        io_thread.join();
+    }
+
+    for (auto& slot : ring) {
+        ::operator delete(slot.data, std::align_val_t(ALIGNMENT));
+    }
+    ring.clear();
+
+#ifdef _WIN32
+    if (handle) {
+        CloseHandle((HANDLE)handle);
+        handle = nullptr;
+    }
+#else
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+}
+
+// pread loop shared by the readers; a short count only happens at end of file
+#ifdef _WIN32
+static bool PositionalRead(void* handle, uint8_t* dst, size_t size, uint64_t offset, size_t* got) {
+#else
+static bool PositionalRead(int fd, uint8_t* dst, size_t size, uint64_t offset, size_t* got) {
+#endif
+    *got = 0;
+    while (*got < size) {
+#ifdef _WIN32
+        OVERLAPPED ov = {};
+        uint64_t pos = offset + *got;
+        ov.Offset = (DWORD)(pos & 0xFFFFFFFF);
+        ov.OffsetHigh = (DWORD)(pos >> 32);
+        DWORD want = (DWORD)(std::min)(size - *got, (size_t)0x40000000);
+        DWORD n = 0;
+        if (!ReadFile((HANDLE)handle, dst + *got, want, &n, &ov)) {
+            return GetLastError() == ERROR_HANDLE_EOF;
+        }
+#else
+        ssize_t n = ::pread(fd, dst + *got, size - *got, (off_t)(offset + *got));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+#endif
+        if (n == 0) break; // File shrank underneath us
+        *got += (size_t)n;
+    }
+    return true;
+}
+
+bool ReadAheadReader::ReadAt(uint8_t* dst, size_t size, uint64_t offset, size_t* got) {
+#ifdef _WIN32
+    return PositionalRead(handle, dst, size, offset, got);
+#else
+    return PositionalRead(fd, dst, size, offset, got);
+#endif
+}
+
+void ReadAheadReader::IoLoop() {
+    size_t produce_index = 0;
+    uint64_t pos = start;
+
+    while (pos < end && !stop.load()) {
+        Slot& slot = ring[produce_index];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return stop.load() || !slot.filled; });
+            if (stop.load()) break;
+        }
+
+        size_t want = (size_t)(std::min)((uint64_t)block_size, end - pos);
+        size_t got = 0;
+        if (!ReadAt(slot.data, want, pos, &got)) {
+            failed.store(true);
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot.size = got;
+            slot.filled = got > 0;
+        }
+        cv.notify_all();
+
+        pos += got;
+        if (got < want) {
+            // Short read means the file was truncated while we were reading it
+            failed.store(true);
+            break;
+        }
+        produce_index = (produce_index + 1) % ring.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        eof = true;
+    }
+    cv.notify_all();
+}
+
+bool ReadAheadReader::Next(const uint8_t** data, size_t* size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (ring.empty()) return false;
+
+    if (holding) {
+        // Hand the previous block back to the I/O thread
+        ring[consume_index].filled = false;
+        holding = false;
+        consume_index = (consume_index + 1) % ring.size();
+        cv.notify_all();
+    }
+
+    cv.wait(lock, [&] { return ring[consume_index].filled || eof || stop.load(); });
+    if (!ring[consume_index].filled) return false;
+
+    holding = true;
+    *data = ring[consume_index].data;
+    *size = ring[consume_index].size;
+    return true;
+}
+
+// ============================================================================
+// RandomAccessFile
+// ============================================================================
+
+RandomAccessFile::~RandomAccessFile() {
+    Close();
+}
+
+bool RandomAccessFile::Open(const std::string& file_path) {
+    Close();
+
+#ifdef _WIN32
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, file_path.c_str(), -1, nullptr, 0);
+    if (wlen <= 0) return false;
+    std::wstring wpath(wlen, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, file_path.c_str(), -1, wpath.data(), wlen);
+
+    HANDLE h = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(h, &size)) {
+        CloseHandle(h);
+        return false;
+    }
+    handle = h;
+    file_size = (uint64_t)size.QuadPart;
+#else
+    fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    file_size = (uint64_t)st.st_size;
+#if defined(__linux__)
+    // Scattered reads: don't drag in readahead pages we will never use
+    posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+#endif
+    return true;
+}
+
+void RandomAccessFile::Close() {
+#ifdef _WIN32
+    if (handle) {
+        CloseHandle((HANDLE)handle);
+        handle = nullptr;
+    }
+#else
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+    file_size = 0;
+}
+
+bool RandomAccessFile::ReadAt(uint64_t offset, uint8_t* dst, size_t size, size_t* got) const {
+    size_t local = 0;
+    if (!got) got = &local;
+    *got = 0;
+    if (!IsOpen()) return false;
+#ifdef _WIN32
+    return PositionalRead(handle, dst, size, offset, got);
+#else
+    return PositionalRead(fd, dst, size, offset, got);
+#endif
+}
+
+bool RandomAccessFile::ReadExact(uint64_t offset, uint8_t* dst, size_t size) const {
+    size_t got = 0;
+    return ReadAt(offset, dst, size, &got) && got == size;
+}
+
+RangeReader::RangeReader(const RandomAccessFile& file, uint64_t offset, uint64_t length)
+    : file(file), start_offset(offset), next_offset(offset), remaining(length), buffer(BUFFER_SIZE) {}
+
+bool RangeReader::Refill() {
+    if (remaining == 0 || failed) return false;
+    size_t want = (size_t)(std::min)((uint64_t)buffer.size(), remaining);
+    size_t got = 0;
+    if (!file.ReadAt(next_offset, buffer.data(), want, &got) || got == 0) {
+        failed = true;
+        return false;
+    }
+    next_offset += got;
+    remaining -= got;
+    pos = 0;
+    filled = got;
+    return true;
+}
+
+size_t RangeReader::Read(uint8_t* dst, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        if (pos == filled && !Refill()) break;
+        size_t n = (std::min)(size - done, filled - pos);
+        memcpy(dst + done, buffer.data() + pos, n);
+        pos += n;
+        done += n;
+    }
+    return done;
+}
+
+bool RangeReader::Skip(uint64_t size) {
+    while (size > 0) {
+        if (pos == filled && !Refill()) return false;
+        size_t n = (size_t)(std::min)(size, (uint64_t)(filled - pos));
+        pos += n;
+        size -= n;
+    }
+    return true;
+}
+
+// ============================================================================
+// MappedFile
+// ============================================================================
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::string& file_path) {
+    Close();
+
+#ifdef _WIN32
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, file_path.c_str(), -1, nullptr, 0);
+    if (wlen <= 0) return false;
+    std::wstring wpath(wlen, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, file_path.c_str(), -1, wpath.data(), wlen);
+
+    HANDLE h = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(h, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(h);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(h);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(h);
+        return false;
+    }
+    file_handle = h;
+    mapping_handle = mapping;
+    data = static_cast<const uint8_t*>(view);
+    size = (size_t)file_size.QuadPart;
+#else
+    int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    data = static_cast<const uint8_t*>(view);
+    size = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::Close() {
+    if (!data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mapping_handle);
+    CloseHandle((HANDLE)file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+// ============================================================================
+// Atomic replace
+// ============================================================================
+
+bool WriteFileAtomically(const std::string& path, const std::function<bool(FILE* f)>& write) {
+    std::string temp_path = path + ".tmp";
+    FILE* f = fopen(temp_path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = write(f);
+    ok = (fclose(f) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) std::filesystem::rename(temp_path, path, ec);
+    if (!ok || ec) {
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool WriteFileAtomically(const std::string& path, const void* data, size_t size) {
+    return WriteFileAtomically(path, [&](FILE* f) { return size == 0 || fwrite(data, 1, size, f) == size; });
+}
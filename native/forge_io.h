@@ -0,0 +1,184 @@
+#ifndef FORGE_IO_H
+#define FORGE_IO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+// Sequential file reader with a dedicated I/O thread.
+//
+// The I/O thread fills a ring of page-aligned blocks ahead of the consumer,
+// so a CPU-bound consumer (hashing) never waits on disk latency as long as
+// the device keeps up. Blocks are handed out in file order.
+class ReadAheadReader {
+public:
+    struct Options {
+        size_t block_size = 4 * 1024 * 1024; // Bytes per read request
+        size_t depth = 4;                    // Blocks in flight (ring size)
+        uint64_t offset = 0;                 // Start offset
+        uint64_t length = UINT64_MAX;        // Bytes to read (clamped to file size)
+    };
+
+    ReadAheadReader() = default;
+    ~ReadAheadReader();
+    ReadAheadReader(const ReadAheadReader&) = delete;
+    ReadAheadReader& operator=(const ReadAheadReader&) = delete;
+
+    // Open the file and start the I/O thread
+    bool Open(const std::string& file_path, const Options& options);
+    bool Open(const std::string& file_path) { return Open(file_path, Options()); }
+
+    // Get the next block in file order. The block stays valid until the next
+    // call to Next() or Close(). Returns false at end of range or on error.
+    bool Next(const uint8_t** data, size_t* size);
+
+    // Stop the I/O thread and close the file
+    void Close();
+
+    uint64_t FileSize() const { return file_size; }
+    bool Failed() const { return failed.load(); }
+
+    static constexpr size_t ALIGNMENT = 4096;
+
+private:
+    struct Slot {
+        uint8_t* data = nullptr;
+        size_t size = 0;
+        bool filled = false;
+    };
+
+    void IoLoop();
+    bool ReadAt(uint8_t* dst, size_t size, uint64_t offset, size_t* got);
+
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int fd = -1;
+#endif
+    uint64_t file_size = 0;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    size_t block_size = 0;
+
+    std::vector<Slot> ring;
+    size_t consume_index = 0;
+    bool holding = false;      // Consumer currently owns ring[consume_index]
+    bool eof = false;          // Producer finished (all blocks queued)
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> failed{false};
+    std::thread io_thread;
+};
+
+// Positional reads without read-ahead, for sampling scattered blocks.
+// ReadAt may be called from several threads at once.
+class RandomAccessFile {
+public:
+    RandomAccessFile() = default;
+    ~RandomAccessFile();
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+    bool Open(const std::string& file_path);
+    void Close();
+
+#ifdef _WIN32
+    bool IsOpen() const { return handle != nullptr; }
+#else
+    bool IsOpen() const { return fd >= 0; }
+#endif
+    uint64_t Size() const { return file_size; }
+
+    // Read up to size bytes; *got is short only at end of file
+    bool ReadAt(uint64_t offset, uint8_t* dst, size_t size, size_t* got) const;
+    // True only if all size bytes were read
+    bool ReadExact(uint64_t offset, uint8_t* dst, size_t size) const;
+
+private:
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int fd = -1;
+#endif
+    uint64_t file_size = 0;
+};
+
+// Sequential reads of one byte range of a RandomAccessFile through a small
+// buffer, for decoders that consume their input a byte at a time
+class RangeReader {
+public:
+    RangeReader(const RandomAccessFile& file, uint64_t offset, uint64_t length);
+
+    // False at the end of the range or on a read error
+    bool Next(uint8_t* byte) {
+        if (pos == filled && !Refill()) return false;
+        *byte = buffer[pos++];
+        return true;
+    }
+
+    // Up to size bytes; short only at the end of the range or on error
+    size_t Read(uint8_t* dst, size_t size);
+    bool Skip(uint64_t size);
+
+    // Bytes of the range handed out so far
+    uint64_t Consumed() const { return next_offset - filled + pos - start_offset; }
+    bool Failed() const { return failed; }
+
+    static constexpr size_t BUFFER_SIZE = 16 * 1024;
+
+private:
+    bool Refill();
+
+    const RandomAccessFile& file;
+    uint64_t start_offset;
+    uint64_t next_offset;
+    uint64_t remaining;
+    std::vector<uint8_t> buffer;
+    size_t pos = 0;
+    size_t filled = 0;
+    bool failed = false;
+};
+
+// Read-only memory mapping of a whole file. Pages are shared between
+// processes and faulted in on first access. Windows cannot replace a file
+// while it is mapped, so every mapping of a file is closed before it is
+// rewritten with WriteFileAtomically.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& file_path);
+    void Close();
+
+    bool IsOpen() const { return data != nullptr; }
+    const uint8_t* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
+
+// Write path + ".tmp" and rename it over path, so neither readers nor a
+// crash ever see a partial file. write fills the open temporary file and
+// returns false on error; on any failure the temporary file is removed and
+// path is left as it was.
+bool WriteFileAtomically(const std::string& path, const std::function<bool(FILE* f)>& write);
+bool WriteFileAtomically(const std::string& path, const void* data, size_t size);
+
+#endif // FORGE_IO_H
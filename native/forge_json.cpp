@@ -0,0 +1,414 @@
+#include "forge_json.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+const JsonValue* JsonValue::Find(const char* key) const {
+    for (const auto& member : members) {
+        if (member.first == key) return &member.second;
+    }
+    return nullptr;
+}
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : p(text.c_str()), end(text.c_str() + text.size()) {}
+
+    bool ParseDocument(JsonValue* out) {
+        if (!ParseValue(out, 0)) return false;
+        SkipWhitespace();
+        return p == end;
+    }
+
+private:
+    void SkipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    }
+
+    bool Literal(const char* word) {
+        size_t length = strlen(word);
+        if ((size_t)(end - p) < length || memcmp(p, word, length) != 0) return false;
+        p += length;
+        return true;
+    }
+
+    bool ParseValue(JsonValue* out, int depth) {
+        if (depth > JsonValue::MAX_DEPTH) return false;
+        SkipWhitespace();
+        if (p == end) return false;
+        switch (*p) {
+        case '{': return ParseObject(out, depth);
+        case '[': return ParseArray(out, depth);
+        case '"': out->type = JsonValue::Type::String; return ParseString(&out->string);
+        case 't': out->type = JsonValue::Type::Bool; out->boolean = true; return Literal("true");
+        case 'f': out->type = JsonValue::Type::Bool; out->boolean = false; return Literal("false");
+        case 'n': out->type = JsonValue::Type::Null; return Literal("null");
+        default: return ParseNumber(out);
+        }
+    }
+
+    bool ParseObject(JsonValue* out, int depth) {
+        out->type = JsonValue::Type::Object;
+        p++;
+        SkipWhitespace();
+        if (p < end && *p == '}') {
+            p++;
+            return true;
+        }
+        while (true) {
+            SkipWhitespace();
+            std::string key;
+            if (p == end || *p != '"' || !ParseString(&key)) return false;
+            SkipWhitespace();
+            if (p == end || *p++ != ':') return false;
+            out->members.emplace_back(std::move(key), JsonValue());
+            if (!ParseValue(&out->members.back().second, depth + 1)) return false;
+            SkipWhitespace();
+            if (p == end) return false;
+            if (*p == '}') {
+                p++;
+                return true;
+            }
+            if (*p++ != ',') return false;
+        }
+    }
+
+    bool ParseArray(JsonValue* out, int depth) {
+        out->type = JsonValue::Type::Array;
+        p++;
+        SkipWhitespace();
+        if (p < end && *p == ']') {
+            p++;
+            return true;
+        }
+        while (true) {
+            out->items.emplace_back();
+            if (!ParseValue(&out->items.back(), depth + 1)) return false;
+            SkipWhitespace();
+            if (p == end) return false;
+            if (*p == ']') {
+                p++;
+                return true;
+            }
+            if (*p++ != ',') return false;
+        }
+    }
+
+    bool ParseHex4(uint32_t* value) {
+        if (end - p < 4) return false;
+        *value = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = *p++;
+            uint32_t digit;
+            if (c >= '0' && c <= '9') digit = (uint32_t)(c - '0');
+            else if (c >= 'a' && c <= 'f') digit = (uint32_t)(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') digit = (uint32_t)(c - 'A' + 10);
+            else return false;
+            *value = (*value << 4) | digit;
+        }
+        return true;
+    }
+
+    static void AppendUtf8(uint32_t cp, std::string* out) {
+        if (cp < 0x80) {
+            out->push_back((char)cp);
+        } else if (cp < 0x800) {
+            out->push_back((char)(0xC0 | (cp >> 6)));
+            out->push_back((char)(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            out->push_back((char)(0xE0 | (cp >> 12)));
+            out->push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+            out->push_back((char)(0x80 | (cp & 0x3F)));
+        } else {
+            out->push_back((char)(0xF0 | (cp >> 18)));
+            out->push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+            out->push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+            out->push_back((char)(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    bool ParseString(std::string* out) {
+        p++;   // Opening quote
+        while (p < end) {
+            char c = *p++;
+            if (c == '"') return true;
+            if ((unsigned char)c < 0x20) return false;
+            if (c != '\\') {
+                out->push_back(c);
+                continue;
+            }
+            if (p == end) return false;
+            switch (*p++) {
+            case '"': out->push_back('"'); break;
+            case '\\': out->push_back('\\'); break;
+            case '/': out->push_back('/'); break;
+            case 'b': out->push_back('\b'); break;
+            case 'f': out->push_back('\f'); break;
+            case 'n': out->push_back('\n'); break;
+            case 'r': out->push_back('\r'); break;
+            case 't': out->push_back('\t'); break;
+            case 'u': {
+                uint32_t cp;
+                if (!ParseHex4(&cp)) return false;
+                if (cp >= 0xD800 && cp < 0xDC00) {
+                    uint32_t low;
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u') return false;
+                    p += 2;
+                    if (!ParseHex4(&low) || low < 0xDC00 || low >= 0xE000) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                } else if (cp >= 0xDC00 && cp < 0xE000) {
+                    return false;
+                }
+                AppendUtf8(cp, out);
+                break;
+            }
+            default: return false;
+            }
+        }
+        return false;
+    }
+
+    bool ParseNumber(JsonValue* out) {
+        const char* start = p;
+        if (p < end && *p == '-') p++;
+        if (p == end || *p < '0' || *p > '9') return false;
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' ||
+                           *p == '-')) {
+            p++;
+        }
+        std::string number(start, p);
+        char* parsed_end = nullptr;
+        out->type = JsonValue::Type::Number;
+        out->number = strtod(number.c_str(), &parsed_end);
+        return parsed_end == number.c_str() + number.size();
+    }
+
+    const char* p;
+    const char* end;
+};
+
+bool JsonValue::Parse(const std::string& text, JsonValue* out) {
+    JsonValue value;
+    JsonParser parser(text);
+    if (!parser.ParseDocument(&value)) return false;
+    *out = std::move(value);
+    return true;
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+JsonWriter::JsonWriter(size_t reserve) {
+    capacity = reserve ? reserve : 1;
+    data = (char*)malloc(capacity);
+    if (!data) {
+        capacity = 0;
+        failed = true;
+    }
+}
+
+JsonWriter::JsonWriter(char* buffer, size_t buffer_capacity)
+    : data(buffer), capacity(buffer ? buffer_capacity : 0), owned(false) {}
+
+JsonWriter::~JsonWriter() {
+    if (owned) free(data);
+}
+
+bool JsonWriter::Grow(size_t n) {
+    if (failed) return false;
+    size_t wanted = length + n + 1;   // Room for the terminator
+    size_t grown = capacity * 2;
+    if (grown < wanted) grown = wanted;
+    char* block = (char*)realloc(data, grown);
+    if (!block) {
+        failed = true;
+        return false;
+    }
+    data = block;
+    capacity = grown;
+    return true;
+}
+
+void JsonWriter::Put(char c) {
+    if (length + 1 < capacity || (owned && Grow(1))) data[length] = c;
+    length++;
+}
+
+void JsonWriter::Put(const char* s, size_t n) {
+    if (length + n < capacity || (owned && Grow(n))) {
+        memcpy(data + length, s, n);
+    } else if (!owned && length + 1 < capacity) {
+        memcpy(data + length, s, capacity - 1 - length);
+    }
+    length += n;
+}
+
+void JsonWriter::Separate() {
+    if (after_key) {
+        after_key = false;
+        return;
+    }
+    uint64_t bit = 1ull << (depth & 63);
+    if (has_items & bit) Put(',');
+    has_items |= bit;
+}
+
+JsonWriter& JsonWriter::BeginObject() {
+    Separate();
+    Put('{');
+    depth++;
+    has_items &= ~(1ull << (depth & 63));
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject() {
+    depth--;
+    Put('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::BeginArray() {
+    Separate();
+    Put('[');
+    depth++;
+    has_items &= ~(1ull << (depth & 63));
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray() {
+    depth--;
+    Put(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key) {
+    String(key);
+    Put(':');
+    after_key = true;
+    return *this;
+}
+
+// Length of the valid UTF-8 sequence starting at s[i], 0 if invalid. Per
+// RFC 3629: no overlong forms (C0, C1, E0 80-9F, F0 80-8F), no surrogates
+// (ED A0-BF) and nothing past U+10FFFF (F4 90+, F5-FF).
+static size_t Utf8Length(std::string_view s, size_t i) {
+    unsigned char c = (unsigned char)s[i];
+    if (c < 0x80) return 1;
+    size_t len = c >= 0xC2 && c <= 0xDF ? 2 : c >= 0xE0 && c <= 0xEF ? 3 : c >= 0xF0 && c <= 0xF4 ? 4 : 0;
+    if (len == 0 || i + len > s.size()) return 0;
+    // The second byte's range depends on the lead
+    unsigned char second = (unsigned char)s[i + 1];
+    unsigned char low = c == 0xE0 ? 0xA0 : c == 0xF0 ? 0x90 : 0x80;
+    unsigned char high = c == 0xED ? 0x9F : c == 0xF4 ? 0x8F : 0xBF;
+    if (second < low || second > high) return 0;
+    for (size_t k = 2; k < len; k++) {
+        if (((unsigned char)s[i + k] & 0xC0) != 0x80) return 0;
+    }
+    return len;
+}
+
+// Runs that need no escaping are copied in one go
+JsonWriter& JsonWriter::String(std::string_view s) {
+    Separate();
+    Put('"');
+    size_t run = 0;
+    for (size_t i = 0; i < s.size();) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            size_t len = c < 0x80 ? 1 : Utf8Length(s, i);
+            if (len) {
+                i += len;
+                continue;
+            }
+        }
+        Put(s.data() + run, i - run);
+        switch (c) {
+        case '"': Put("\\\"", 2); break;
+        case '\\': Put("\\\\", 2); break;
+        case '\n': Put("\\n", 2); break;
+        case '\r': Put("\\r", 2); break;
+        case '\t': Put("\\t", 2); break;
+        default:
+            if (c >= 0x80) {
+                Put("\\ufffd", 6);
+            } else {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                Put(escaped, 6);
+            }
+        }
+        run = ++i;
+    }
+    Put(s.data() + run, s.size() - run);
+    Put('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::Int(int64_t value) {
+    Separate();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    Put(digits, (size_t)(result.ptr - digits));
+    return *this;
+}
+
+JsonWriter& JsonWriter::UInt(uint64_t value) {
+    Separate();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    Put(digits, (size_t)(result.ptr - digits));
+    return *this;
+}
+
+JsonWriter& JsonWriter::Double(double value, int decimals) {
+    Separate();
+    if (!std::isfinite(value)) {
+        Put("null", 4);
+        return *this;
+    }
+    char digits[64];
+    int n = snprintf(digits, sizeof(digits), "%.*f", decimals, value);
+    if (n < 0 || (size_t)n >= sizeof(digits)) Put("null", 4);
+    else Put(digits, (size_t)n);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool value) {
+    Separate();
+    if (value) Put("true", 4);
+    else Put("false", 5);
+    return *this;
+}
+
+const char* JsonWriter::Release() {
+    if (!owned) {
+        if (capacity == 0) return nullptr;
+        data[(std::min)(length, capacity - 1)] = '\0';
+        return data;
+    }
+    if (failed) return nullptr;
+    data[length] = '\0';   // Grow() always left room
+    char* result = data;
+    data = nullptr;
+    capacity = 0;
+    length = 0;
+    failed = true;         // Spent
+    return result;
+}
+
+const char* JsonWriter::Copy(std::string_view text) {
+    char* result = (char*)malloc(text.size() + 1);
+    if (!result) return nullptr;
+    memcpy(result, text.data(), text.size());
+    result[text.size()] = '\0';
+    return result;
+}
+
+void JsonWriter::ReleaseResult(const char* result) {
+    free((void*)result);
+}
@@ -0,0 +1,99 @@
+#ifndef FORGE_JSON_H
+#define FORGE_JSON_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal JSON reader for the small documents callers pass in (query
+// filters, task payloads). Numbers are doubles, objects keep their member
+// order, and \u escapes (surrogate pairs included) are decoded to UTF-8.
+// Nesting is limited to JsonValue::MAX_DEPTH.
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    static constexpr int MAX_DEPTH = 64;
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> items;                               // Array
+    std::vector<std::pair<std::string, JsonValue>> members;     // Object
+
+    bool IsNull() const { return type == Type::Null; }
+    bool IsNumber() const { return type == Type::Number; }
+    bool IsString() const { return type == Type::String; }
+    bool IsArray() const { return type == Type::Array; }
+    bool IsObject() const { return type == Type::Object; }
+
+    // Member of an object, or nullptr (also for non-objects)
+    const JsonValue* Find(const char* key) const;
+
+    // Whole text must be one value (surrounding whitespace allowed)
+    static bool Parse(const std::string& text, JsonValue* out);
+};
+
+// Streaming JSON writer for the documents forge_core returns. Text goes
+// straight into one block that doubles as it fills (or into a caller's
+// buffer), with no DOM and no intermediate strings; commas are tracked per
+// nesting level, so callers only emit keys and values.
+//
+// Owned blocks leave through Release() and come back through
+// ReleaseResult(), which is all forge_free_string does.
+class JsonWriter {
+public:
+    // Own block, starting at reserve bytes (a guess of the document size)
+    explicit JsonWriter(size_t reserve = 256);
+    // Caller's buffer. Text past capacity is counted but not written; what
+    // was written is terminated by Release().
+    JsonWriter(char* buffer, size_t capacity);
+    ~JsonWriter();
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray();
+    JsonWriter& EndArray();
+    JsonWriter& Key(std::string_view key);
+    // Disc headers carry raw (often Shift-JIS) titles; bytes that are not
+    // valid UTF-8 become U+FFFD so the document stays decodable
+    JsonWriter& String(std::string_view s);
+    JsonWriter& Int(int64_t value);
+    JsonWriter& UInt(uint64_t value);
+    // Fixed point; null when not finite
+    JsonWriter& Double(double value, int decimals);
+    JsonWriter& Bool(bool value);
+
+    // Length of the document, including any text a caller's buffer had no
+    // room for
+    size_t Length() const { return length; }
+    // Terminate the document and hand over the block (nullptr when it could
+    // not be allocated). With a caller's buffer, terminate it and return it.
+    const char* Release();
+
+    // A result block holding a copy of text
+    static const char* Copy(std::string_view text);
+    static void ReleaseResult(const char* result);
+
+private:
+    void Separate();
+    void Put(char c);
+    void Put(const char* s, size_t n);
+    bool Grow(size_t n);
+
+    char* data = nullptr;
+    size_t capacity = 0;
+    size_t length = 0;
+    bool owned = true;
+    bool failed = false;          // An owned block could not grow
+    bool after_key = false;
+    int depth = 0;
+    uint64_t has_items = 0;       // Bit per nesting level (64 levels at most)
+};
+
+#endif // FORGE_JSON_H
@@ -0,0 +1,1269 @@
+#include "forge_library.h"
+#include "forge_hash.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <type_traits>
+#include <unordered_map>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static constexpr TitleIssue ISSUE_KINDS[] = { ISSUE_SAME_TITLE, ISSUE_NO_TITLE_ID, ISSUE_SCRUBBED, ISSUE_DAMAGED };
+static constexpr size_t ISSUE_KIND_COUNT = sizeof(ISSUE_KINDS) / sizeof(ISSUE_KINDS[0]);
+
+const char* TitleStatusName(TitleStatus status) {
+    switch (status) {
+    case TitleStatus::Healthy: return "healthy";
+    case TitleStatus::Verified: return "verified";
+    case TitleStatus::Unknown: return "unknown";
+    case TitleStatus::Suspicious: return "suspicious";
+    case TitleStatus::Error: return "error";
+    default: return "unverified";
+    }
+}
+
+bool ParseTitleStatus(const std::string& name, TitleStatus* status) {
+    static constexpr TitleStatus ALL[] = { TitleStatus::Unverified, TitleStatus::Healthy, TitleStatus::Verified,
+                                           TitleStatus::Unknown, TitleStatus::Suspicious, TitleStatus::Error };
+    for (TitleStatus candidate : ALL) {
+        if (name == TitleStatusName(candidate)) {
+            *status = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* TitleIssueName(TitleIssue issue) {
+    switch (issue) {
+    case ISSUE_SAME_TITLE: return "same_title";
+    case ISSUE_NO_TITLE_ID: return "no_title_id";
+    case ISSUE_SCRUBBED: return "scrubbed";
+    default: return "damaged";
+    }
+}
+
+bool ParseTitleIssue(const std::string& name, TitleIssue* issue) {
+    for (TitleIssue candidate : ISSUE_KINDS) {
+        if (name == TitleIssueName(candidate)) {
+            *issue = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// Bitmaps
+// ============================================================================
+
+static void SetBit(SnapshotColumn<uint64_t>* bitmap, size_t row) {
+    if (bitmap->size() <= row / 64) bitmap->resize(row / 64 + 1, 0);
+    bitmap->At(row / 64) |= 1ULL << (row % 64);
+}
+
+static void ClearBit(SnapshotColumn<uint64_t>* bitmap, size_t row) {
+    if (row / 64 < bitmap->size()) bitmap->At(row / 64) &= ~(1ULL << (row % 64));
+}
+
+// match &= other, where a missing tail of other counts as zeros. Plain word
+// loops: the compiler turns them into vector AND/OR.
+template <typename Bits>
+static void AndWith(std::vector<uint64_t>* match, const Bits& other) {
+    size_t shared = (std::min)(match->size(), other.size());
+    uint64_t* m = match->data();
+    const uint64_t* o = other.data();
+    for (size_t i = 0; i < shared; i++) m[i] &= o[i];
+    for (size_t i = shared; i < match->size(); i++) m[i] = 0;
+}
+
+template <typename Bits>
+static void OrWith(std::vector<uint64_t>* acc, const Bits& other) {
+    if (acc->size() < other.size()) acc->resize(other.size(), 0);
+    uint64_t* a = acc->data();
+    const uint64_t* o = other.data();
+    for (size_t i = 0; i < other.size(); i++) a[i] |= o[i];
+}
+
+static unsigned LowestBit(uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctzll(bits);
+#endif
+}
+
+template <typename Bits, typename Fn>
+static void ForEachRow(const Bits& bitmap, Fn fn) {
+    for (size_t w = 0; w < bitmap.size(); w++) {
+        for (uint64_t word = bitmap[w]; word; word &= word - 1) fn(w * 64 + LowestBit(word));
+    }
+}
+
+template <typename Bits>
+static size_t PopCount(const Bits& bitmap) {
+    size_t count = 0;
+    for (uint64_t word : bitmap) {
+#if defined(_MSC_VER)
+        count += (size_t)__popcnt64(word);
+#else
+        count += (size_t)__builtin_popcountll(word);
+#endif
+    }
+    return count;
+}
+
+// ============================================================================
+// Dictionary columns
+// ============================================================================
+
+template <typename T>
+uint8_t LibraryStore::Dictionary<T>::Code(T value) {
+    int found = Find(value);
+    if (found >= 0) return (uint8_t)found;
+    // Every column has at most 256 distinct values (enums and region letters)
+    values.push_back(value);
+    rows.emplace_back();
+    return (uint8_t)(values.size() - 1);
+}
+
+template <typename T>
+int LibraryStore::Dictionary<T>::Find(T value) const {
+    for (size_t i = 0; i < values.size(); i++) {
+        if (values[i] == value) return (int)i;
+    }
+    return -1;
+}
+
+template <typename T>
+void LibraryStore::FilterColumn(const Dictionary<T>& dictionary, const std::vector<T>& wanted,
+                                std::vector<uint64_t>* match) const {
+    if (wanted.empty()) return;
+    std::vector<uint64_t> any;
+    for (T value : wanted) {
+        int code = dictionary.Find(value);
+        if (code >= 0) OrWith(&any, dictionary.rows[code]);
+    }
+    AndWith(match, any);
+}
+
+// ============================================================================
+// Strings and indexes
+// ============================================================================
+
+LibraryStore::StringRef LibraryStore::AddString(const std::string& s) {
+    StringRef ref = { pool.size(), (uint32_t)s.size(), 0 };
+    pool.append(s.data(), s.size());
+    return ref;
+}
+
+// References are checked here rather than when the snapshot is opened, so
+// opening never reads the pool
+std::string_view LibraryStore::String(StringRef ref) const {
+    if (ref.offset > pool.size() || ref.length > pool.size() - ref.offset) return std::string_view();
+    return std::string_view(pool.data() + ref.offset, ref.length);
+}
+
+// FNV-1a. The path index is persisted, so this must never change.
+static uint64_t HashBytes(std::string_view s) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : s) {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// splitmix64 finaliser; persisted like HashBytes
+static uint64_t HashId(int64_t id) {
+    uint64_t x = (uint64_t)id;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t LibraryStore::PathHash(size_t row) const {
+    return HashBytes(String(paths[row]));
+}
+
+uint64_t LibraryStore::IdHash(size_t row) const {
+    return HashId(ids[row]);
+}
+
+// Slot holding a row that matches, or the empty slot that ends the probe.
+// Tables are a power of two long and at most 3/4 full.
+template <typename Matches>
+static size_t ProbeSlot(const SnapshotColumn<uint32_t>& table, uint64_t hash, Matches matches) {
+    size_t mask = table.size() - 1;
+    for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+        if (table[i] == 0 || matches((size_t)table[i] - 1)) return i;
+    }
+}
+
+static void InsertSlot(SnapshotColumn<uint32_t>* table, uint64_t hash, size_t row) {
+    size_t mask = table->size() - 1;
+    size_t i = (size_t)hash & mask;
+    while ((*table)[i] != 0) i = (i + 1) & mask;
+    table->At(i) = (uint32_t)(row + 1);
+}
+
+// Backward-shift deletion: later entries of the probe run move up into the
+// gap, so lookups never need tombstones
+template <typename RowHash>
+static void EraseSlot(SnapshotColumn<uint32_t>* table, size_t slot, RowHash row_hash) {
+    size_t mask = table->size() - 1;
+    for (size_t next = (slot + 1) & mask; (*table)[next] != 0; next = (next + 1) & mask) {
+        size_t home = (size_t)row_hash((size_t)(*table)[next] - 1) & mask;
+        // An entry whose home lies cyclically in (slot, next] stays put
+        bool stays = slot <= next ? (home > slot && home <= next) : (home > slot || home <= next);
+        if (stays) continue;
+        table->At(slot) = (*table)[next];
+        slot = next;
+    }
+    table->At(slot) = 0;
+}
+
+bool LibraryStore::FindPath(const std::string& path, size_t* row) const {
+    if (path_index.empty()) return false;
+    size_t slot = ProbeSlot(path_index, HashBytes(path), [&](size_t r) { return String(paths[r]) == path; });
+    if (path_index[slot] == 0) return false;
+    *row = (size_t)path_index[slot] - 1;
+    return true;
+}
+
+bool LibraryStore::FindId(int64_t id, size_t* row) const {
+    if (id_index.empty()) return false;
+    size_t slot = ProbeSlot(id_index, HashId(id), [&](size_t r) { return ids[r] == id; });
+    if (id_index[slot] == 0) return false;
+    *row = (size_t)id_index[slot] - 1;
+    return true;
+}
+
+void LibraryStore::IndexRow(size_t row) {
+    InsertSlot(&path_index, PathHash(row), row);
+    InsertSlot(&id_index, IdHash(row), row);
+}
+
+void LibraryStore::UnindexRow(size_t row) {
+    auto is_row = [row](size_t r) { return r == row; };
+    EraseSlot(&path_index, ProbeSlot(path_index, PathHash(row), is_row), [this](size_t r) { return PathHash(r); });
+    EraseSlot(&id_index, ProbeSlot(id_index, IdHash(row), is_row), [this](size_t r) { return IdHash(r); });
+}
+
+// Grow both tables before they pass 3/4 full, re-inserting the live rows
+void LibraryStore::ReserveIndexes(size_t titles) {
+    if (titles * 4 <= path_index.size() * 3) return;
+    size_t capacity = 16;
+    while (titles * 4 > capacity * 3) capacity *= 2;
+    capacity *= 2;
+    path_index.assign(capacity, 0);
+    id_index.assign(capacity, 0);
+    ForEachRow(live, [&](size_t row) { IndexRow(row); });
+}
+
+// ============================================================================
+// Rows
+// ============================================================================
+
+static std::string Fold(const std::string& s) {
+    std::string out = s;
+    for (char& c : out) {
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    }
+    return out;
+}
+
+static std::string FieldString(const char* field, size_t capacity) {
+    return std::string(field, strnlen(field, capacity));
+}
+
+size_t LibraryStore::AllocateRow() {
+    if (!free_rows.empty()) {
+        size_t row = free_rows[free_rows.size() - 1];
+        free_rows.pop_back();
+        return row;
+    }
+    size_t row = ids.size();
+    ids.push_back(0);
+    paths.push_back(StringRef{});
+    identities.push_back(GameIdentity{});
+    folded.push_back(StringRef{});
+    sizes.push_back(0);
+    platform_codes.push_back(0);
+    region_codes.push_back(0);
+    format_codes.push_back(0);
+    status_codes.push_back(0);
+    return row;
+}
+
+void LibraryStore::SetRow(size_t row, const std::string& path, const GameIdentity& identity, TitleStatus status) {
+    paths.At(row) = AddString(path);
+    identities.At(row) = identity;
+    folded.At(row) = AddString(Fold(FieldString(identity.game_title, sizeof(identity.game_title))) + '\n' +
+                               Fold(FieldString(identity.title_id, sizeof(identity.title_id))) + '\n' + Fold(path));
+    sizes.At(row) = identity.file_size;
+    platform_codes.At(row) = platforms.Code(identity.platform);
+    region_codes.At(row) = regions.Code(identity.region);
+    format_codes.At(row) = formats.Code(identity.format);
+    status_codes.At(row) = statuses.Code(status);
+    SetBit(&platforms.rows[platform_codes[row]], row);
+    SetBit(&regions.rows[region_codes[row]], row);
+    SetBit(&formats.rows[format_codes[row]], row);
+    SetBit(&statuses.rows[status_codes[row]], row);
+    SetBit(&live, row);
+    issues_dirty = true;
+}
+
+// The row's strings stay in the pool until the next compaction
+void LibraryStore::ClearRow(size_t row) {
+    ClearBit(&platforms.rows[platform_codes[row]], row);
+    ClearBit(&regions.rows[region_codes[row]], row);
+    ClearBit(&formats.rows[format_codes[row]], row);
+    ClearBit(&statuses.rows[status_codes[row]], row);
+    ClearBit(&live, row);
+    paths.At(row) = StringRef{};
+    folded.At(row) = StringRef{};
+    issues_dirty = true;
+}
+
+void LibraryStore::ClearAll() {
+    ids.clear();
+    paths.clear();
+    identities.clear();
+    folded.clear();
+    sizes.clear();
+    platform_codes.clear();
+    region_codes.clear();
+    format_codes.clear();
+    status_codes.clear();
+    pool.clear();
+    platforms = Dictionary<Platform>();
+    regions = Dictionary<char>();
+    formats = Dictionary<DiscFormat>();
+    statuses = Dictionary<TitleStatus>();
+    live.clear();
+    path_index.clear();
+    id_index.clear();
+    free_rows.clear();
+    title_count = 0;
+    issue_flags.clear();
+    for (auto& bitmap : issue_rows) bitmap.clear();
+    issues_dirty = true;
+}
+
+static bool SameIdentity(const GameIdentity& a, const GameIdentity& b) {
+    return a.platform == b.platform && a.format == b.format && a.file_size == b.file_size &&
+           strncmp(a.title_id, b.title_id, sizeof(a.title_id)) == 0 && a.disc_number == b.disc_number;
+}
+
+static bool SameDetails(const GameIdentity& a, const GameIdentity& b) {
+    return SameIdentity(a, b) && a.region == b.region && a.is_scrubbed == b.is_scrubbed &&
+           a.requires_cios == b.requires_cios && strncmp(a.game_title, b.game_title, sizeof(a.game_title)) == 0;
+}
+
+void LibraryStore::ApplyUpsert(const std::string& path, const GameIdentity& identity, int64_t id,
+                               TitleStatus status) {
+    size_t row;
+    if (FindPath(path, &row)) {
+        UnindexRow(row);
+        ClearRow(row);
+    } else {
+        ReserveIndexes(title_count + 1);
+        row = AllocateRow();
+        title_count++;
+    }
+    ids.At(row) = id;
+    SetRow(row, path, identity, status);
+    IndexRow(row);
+    next_id = (std::max)(next_id, id + 1);
+    generation++;
+}
+
+bool LibraryStore::ApplyRemove(const std::string& path) {
+    size_t row;
+    if (!FindPath(path, &row)) return false;
+    UnindexRow(row);
+    ClearRow(row);
+    free_rows.push_back((uint32_t)row);
+    title_count--;
+    generation++;
+    return true;
+}
+
+bool LibraryStore::ApplySetStatus(const std::string& path, TitleStatus status) {
+    size_t row;
+    if (!FindPath(path, &row)) return false;
+    ClearBit(&statuses.rows[status_codes[row]], row);
+    status_codes.At(row) = statuses.Code(status);
+    SetBit(&statuses.rows[status_codes[row]], row);
+    issues_dirty = true;
+    generation++;
+    return true;
+}
+
+// Log record kinds
+static constexpr uint8_t LOG_UPSERT = 1;
+static constexpr uint8_t LOG_REMOVE = 2;
+static constexpr uint8_t LOG_STATUS = 3;
+
+void LibraryStore::Upsert(const std::string& path, const GameIdentity& identity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t id = next_id;
+    TitleStatus status = TitleStatus::Unverified;
+    size_t row;
+    if (FindPath(path, &row)) {
+        // Full scans report every title again; only real changes are logged
+        if (SameDetails(identities[row], identity)) return;
+        // A rewritten file has to be verified again
+        if (SameIdentity(identities[row], identity)) status = statuses.values[status_codes[row]];
+        id = ids[row];
+    }
+    ApplyUpsert(path, identity, id, status);
+    AppendLog(LOG_UPSERT, path, id, status, &identity);
+}
+
+bool LibraryStore::Remove(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ApplyRemove(path)) return false;
+    AppendLog(LOG_REMOVE, path, 0, TitleStatus::Unverified, nullptr);
+    return true;
+}
+
+void LibraryStore::Reset(const std::vector<std::pair<std::string, GameIdentity>>& titles) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Keep ids and statuses of titles that are still there
+    struct Kept {
+        int64_t id;
+        GameIdentity identity;
+        TitleStatus status;
+    };
+    std::unordered_map<std::string, Kept> kept;
+    ForEachRow(live, [&](size_t row) {
+        kept.emplace(std::string(String(paths[row])),
+                     Kept{ ids[row], identities[row], statuses.values[status_codes[row]] });
+    });
+
+    ClearAll();
+    ReserveIndexes(titles.size());
+    for (const auto& title : titles) {
+        size_t existing;
+        if (FindPath(title.first, &existing)) continue;
+        size_t row = AllocateRow();
+        TitleStatus status = TitleStatus::Unverified;
+        auto old = kept.find(title.first);
+        if (old != kept.end()) {
+            ids.At(row) = old->second.id;
+            if (SameIdentity(old->second.identity, title.second)) status = old->second.status;
+        } else {
+            ids.At(row) = next_id++;
+        }
+        SetRow(row, title.first, title.second, status);
+        IndexRow(row);
+        title_count++;
+    }
+    generation++;
+    // Too many changes to log one by one; write a whole new snapshot
+    Compact();
+}
+
+bool LibraryStore::SetStatus(const std::string& path, TitleStatus status) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t row;
+    if (!FindPath(path, &row)) return false;
+    if (statuses.values[status_codes[row]] == status) return true;
+    ApplySetStatus(path, status);
+    AppendLog(LOG_STATUS, path, ids[row], status, nullptr);
+    return true;
+}
+
+// Titles sharing platform, title ID and disc are flagged same_title (only
+// DuplicateFinder can tell whether their bytes match); the rest of
+// the flags come straight from the identity and status columns
+void LibraryStore::RefreshIssues() const {
+    if (!issues_dirty) return;
+    issue_flags.assign(ids.size(), 0);
+    for (auto& bitmap : issue_rows) bitmap.assign(live.size(), 0);
+
+    std::unordered_map<std::string, size_t> first_row;
+    ForEachRow(live, [&](size_t row) {
+        const GameIdentity& identity = identities[row];
+        std::string title_id = FieldString(identity.title_id, sizeof(identity.title_id));
+        if (title_id.empty()) {
+            issue_flags.At(row) |= ISSUE_NO_TITLE_ID;
+        } else {
+            std::string key = std::to_string((int)identity.platform) + ':' + title_id + ':' +
+                              std::to_string(identity.disc_number);
+            auto inserted = first_row.emplace(key, row);
+            if (!inserted.second) {
+                issue_flags.At(row) |= ISSUE_SAME_TITLE;
+                issue_flags.At(inserted.first->second) |= ISSUE_SAME_TITLE;
+            }
+        }
+        if (identity.is_scrubbed) issue_flags.At(row) |= ISSUE_SCRUBBED;
+        TitleStatus status = statuses.values[status_codes[row]];
+        if (status == TitleStatus::Suspicious || status == TitleStatus::Error) issue_flags.At(row) |= ISSUE_DAMAGED;
+    });
+    ForEachRow(live, [&](size_t row) {
+        for (size_t k = 0; k < ISSUE_KIND_COUNT; k++) {
+            if (issue_flags[row] & ISSUE_KINDS[k]) SetBit(&issue_rows[k], row);
+        }
+    });
+    issues_dirty = false;
+}
+
+LibraryStore::Title LibraryStore::Materialise(size_t row) const {
+    Title title;
+    title.id = ids[row];
+    title.path = std::string(String(paths[row]));
+    title.identity = identities[row];
+    title.status = statuses.values[status_codes[row]];
+    title.issues = issue_flags[row];
+    return title;
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+// Rows whose size lies in [min, max], 64 rows per output word. The inner
+// loop has no branches, so it vectorises.
+static void FilterSizes(const uint64_t* sizes, size_t count, uint64_t min, uint64_t max,
+                        std::vector<uint64_t>* match) {
+    uint64_t range = max - min;
+    for (size_t w = 0; w < match->size(); w++) {
+        if (!(*match)[w]) continue;
+        size_t base = w * 64;
+        size_t n = (std::min)((size_t)64, count - base);
+        uint64_t bits = 0;
+        for (size_t i = 0; i < n; i++) bits |= (uint64_t)(sizes[base + i] - min <= range) << i;
+        (*match)[w] &= bits;
+    }
+}
+
+// Rows of the requested page, in order; the caller holds the lock
+std::vector<size_t> LibraryStore::PageRows(const Filter& filter, size_t* total) const {
+    RefreshIssues();
+
+    std::vector<uint64_t> match(live.begin(), live.end());
+    FilterColumn(platforms, filter.platforms, &match);
+    FilterColumn(regions, filter.regions, &match);
+    FilterColumn(formats, filter.formats, &match);
+    FilterColumn(statuses, filter.statuses, &match);
+    if (filter.issues) {
+        std::vector<uint64_t> any;
+        for (size_t k = 0; k < ISSUE_KIND_COUNT; k++) {
+            if (filter.issues & ISSUE_KINDS[k]) OrWith(&any, issue_rows[k]);
+        }
+        AndWith(&match, any);
+    }
+    if (filter.min_size > 0 || filter.max_size != UINT64_MAX) {
+        if (filter.min_size > filter.max_size) match.assign(match.size(), 0);
+        else FilterSizes(sizes.data(), sizes.size(), filter.min_size, filter.max_size, &match);
+    }
+
+    std::vector<size_t> rows;
+    rows.reserve(PopCount(match));
+    std::string needle = Fold(filter.search);
+    ForEachRow(match, [&](size_t row) {
+        if (needle.empty() || String(folded[row]).find(needle) != std::string_view::npos) rows.push_back(row);
+    });
+
+    auto key_less = [&](size_t a, size_t b) -> bool {
+        const GameIdentity& x = identities[a];
+        const GameIdentity& y = identities[b];
+        int order = 0;
+        switch (filter.sort) {
+        case SortKey::Title: {
+            std::string_view fa = String(folded[a]), fb = String(folded[b]);
+            order = fa.substr(0, fa.find('\n')).compare(fb.substr(0, fb.find('\n')));
+            break;
+        }
+        case SortKey::TitleId: order = strncmp(x.title_id, y.title_id, sizeof(x.title_id)); break;
+        case SortKey::Platform: order = strcmp(platform_to_string(x.platform), platform_to_string(y.platform)); break;
+        case SortKey::Region: order = (int)(unsigned char)x.region - (int)(unsigned char)y.region; break;
+        case SortKey::Format: order = strcmp(disc_format_to_string(x.format), disc_format_to_string(y.format)); break;
+        case SortKey::Size: order = sizes[a] < sizes[b] ? -1 : sizes[a] > sizes[b] ? 1 : 0; break;
+        case SortKey::Path: order = String(paths[a]).compare(String(paths[b])); break;
+        case SortKey::Status:
+            order = strcmp(TitleStatusName(statuses.values[status_codes[a]]),
+                           TitleStatusName(statuses.values[status_codes[b]]));
+            break;
+        }
+        if (order == 0) return ids[a] < ids[b];   // Stable across calls
+        return filter.descending ? order > 0 : order < 0;
+    };
+
+    *total = rows.size();
+    if (filter.offset >= rows.size()) return {};
+    size_t end = filter.limit ? (std::min)(rows.size(), filter.offset + filter.limit) : rows.size();
+    std::partial_sort(rows.begin(), rows.begin() + end, rows.end(), key_less);
+    rows.resize(end);
+    rows.erase(rows.begin(), rows.begin() + filter.offset);
+    return rows;
+}
+
+LibraryStore::Page LibraryStore::Query(const Filter& filter) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Page page;
+    std::vector<size_t> rows = PageRows(filter, &page.total);
+    page.titles.reserve(rows.size());
+    for (size_t row : rows) page.titles.push_back(Materialise(row));
+    return page;
+}
+
+size_t LibraryStore::Visit(const Filter& filter, const VisitFn& fn) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t total = 0;
+    TitleView title;
+    for (size_t row : PageRows(filter, &total)) {
+        title.id = ids[row];
+        title.path = String(paths[row]);
+        title.identity = &identities[row];
+        title.status = statuses.values[status_codes[row]];
+        title.issues = issue_flags[row];
+        fn(title);
+    }
+    return total;
+}
+
+LibraryStore::Summary LibraryStore::GetSummary() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    RefreshIssues();
+
+    Summary summary;
+    summary.titles = PopCount(live);
+    ForEachRow(live, [&](size_t row) { summary.bytes += sizes[row]; });
+
+    auto group = [&](const Bitmap& rows) {
+        std::vector<uint64_t> present(rows.begin(), rows.end());
+        AndWith(&present, live);
+        Group g;
+        ForEachRow(present, [&](size_t row) {
+            g.titles++;
+            g.bytes += sizes[row];
+        });
+        return g;
+    };
+    for (size_t i = 0; i < platforms.values.size(); i++) {
+        Group g = group(platforms.rows[i]);
+        if (g.titles) summary.platforms.emplace_back(platforms.values[i], g);
+    }
+    for (size_t i = 0; i < regions.values.size(); i++) {
+        Group g = group(regions.rows[i]);
+        if (g.titles) summary.regions.emplace_back(regions.values[i], g);
+    }
+    for (size_t i = 0; i < formats.values.size(); i++) {
+        Group g = group(formats.rows[i]);
+        if (g.titles) summary.formats.emplace_back(formats.values[i], g);
+    }
+    for (size_t i = 0; i < statuses.values.size(); i++) {
+        Group g = group(statuses.rows[i]);
+        if (g.titles) summary.statuses.emplace_back(statuses.values[i], g);
+    }
+    for (size_t k = 0; k < ISSUE_KIND_COUNT; k++) {
+        summary.issues.emplace_back(ISSUE_KINDS[k], PopCount(issue_rows[k]));
+    }
+    auto by_titles = [](const auto& a, const auto& b) { return a.second.titles > b.second.titles; };
+    std::stable_sort(summary.platforms.begin(), summary.platforms.end(), by_titles);
+    std::stable_sort(summary.regions.begin(), summary.regions.end(), by_titles);
+    std::stable_sort(summary.formats.begin(), summary.formats.end(), by_titles);
+    return summary;
+}
+
+bool LibraryStore::Find(int64_t id, Title* title) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t row;
+    if (!FindId(id, &row)) return false;
+    RefreshIssues();
+    if (title) *title = Materialise(row);
+    return true;
+}
+
+std::vector<LibraryStore::Title> LibraryStore::All() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    RefreshIssues();
+    std::vector<Title> titles;
+    ForEachRow(live, [&](size_t row) { titles.push_back(Materialise(row)); });
+    return titles;
+}
+
+size_t LibraryStore::Count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return title_count;
+}
+
+// ============================================================================
+// Snapshot file (little-endian, native struct layout)
+//
+//   LibraryFileHeader
+//   sections, each 8-byte aligned: every column exactly as held in memory,
+//   the string pool, each dictionary's values and row bitmaps (one after
+//   the other, `words` each), the live and issue bitmaps, both hash indexes
+//   and the free row list
+//
+// words = ceil(rows / 64). Next to it, "<snapshot>.wal" is the write-ahead
+// log: LibraryLogRecord entries, each followed by a GameIdentity (upserts
+// only) and the path. A record holds the resulting state of the row, not
+// the request, so replaying changes the snapshot already contains is
+// harmless and a crash between writing a snapshot and trimming the log
+// loses nothing.
+// ============================================================================
+
+static constexpr uint32_t LIBRARY_MAGIC = 0x42494C46;   // "FLIB"
+static constexpr uint32_t LIBRARY_VERSION = 1;
+static constexpr uint32_t LIBRARY_LOG_MAX_PATH = 32 * 1024;
+// Compact once the log outgrows this, or a quarter of the snapshot
+static constexpr uint64_t LIBRARY_LOG_COMPACT_SIZE = 4 * 1024 * 1024;
+
+enum LibrarySection {
+    SECTION_IDS,
+    SECTION_PATHS,
+    SECTION_IDENTITIES,
+    SECTION_FOLDED,
+    SECTION_SIZES,
+    SECTION_PLATFORM_CODES,
+    SECTION_REGION_CODES,
+    SECTION_FORMAT_CODES,
+    SECTION_STATUS_CODES,
+    SECTION_ISSUE_FLAGS,
+    SECTION_POOL,
+    SECTION_PLATFORM_VALUES,
+    SECTION_PLATFORM_ROWS,
+    SECTION_REGION_VALUES,
+    SECTION_REGION_ROWS,
+    SECTION_FORMAT_VALUES,
+    SECTION_FORMAT_ROWS,
+    SECTION_STATUS_VALUES,
+    SECTION_STATUS_ROWS,
+    SECTION_LIVE,
+    SECTION_ISSUE_ROWS,
+    SECTION_PATH_INDEX,
+    SECTION_ID_INDEX,
+    SECTION_FREE_ROWS,
+    LIBRARY_SECTION_COUNT
+};
+
+struct LibraryFileSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct LibraryFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t identity_size;
+    uint32_t section_count;
+    uint64_t rows;              // Row slots, free ones included
+    uint64_t titles;
+    int64_t next_id;
+    uint64_t reserved;
+    LibraryFileSection sections[LIBRARY_SECTION_COUNT];
+};
+
+struct LibraryLogRecord {
+    uint32_t crc32;             // Of the rest of the record, identity and path included
+    uint32_t path_length;
+    uint8_t op;                 // LOG_UPSERT, LOG_REMOVE or LOG_STATUS
+    uint8_t status;             // TitleStatus after the change
+    uint16_t reserved;
+    uint32_t reserved2;
+    int64_t id;
+};
+
+static_assert(sizeof(LibraryFileSection) == 16, "LibraryFileSection layout");
+static_assert(sizeof(LibraryLogRecord) == 24, "LibraryLogRecord layout");
+
+bool LibraryStore::MapSnapshot(const std::string& path) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(path) || file->Size() < sizeof(LibraryFileHeader)) return false;
+    const uint8_t* base = file->Data();
+    size_t size = file->Size();
+    const LibraryFileHeader* h = reinterpret_cast<const LibraryFileHeader*>(base);
+
+    bool valid = h->magic == LIBRARY_MAGIC && h->version == LIBRARY_VERSION &&
+                 h->identity_size == sizeof(GameIdentity) && h->section_count == LIBRARY_SECTION_COUNT &&
+                 h->rows < UINT32_MAX && h->titles <= h->rows;
+    for (const auto& section : h->sections) {
+        valid = valid && section.offset % 8 == 0 && section.offset <= size && section.size <= size - section.offset;
+    }
+    if (!valid) return false;
+
+    size_t rows = (size_t)h->rows;
+    size_t words = (rows + 63) / 64;
+    auto at = [&](LibrarySection s) { return base + h->sections[s].offset; };
+    auto count = [&](LibrarySection s, size_t element) { return (size_t)h->sections[s].size / element; };
+    auto is_array = [&](LibrarySection s, size_t element, size_t n) { return h->sections[s].size == (uint64_t)n * element; };
+    auto is_dictionary = [&](LibrarySection values, size_t element, LibrarySection bitmaps) {
+        size_t n = count(values, element);
+        return h->sections[values].size % element == 0 && n <= 256 && is_array(bitmaps, 8 * words, n);
+    };
+    valid = is_array(SECTION_IDS, sizeof(int64_t), rows) && is_array(SECTION_PATHS, sizeof(StringRef), rows) &&
+            is_array(SECTION_IDENTITIES, sizeof(GameIdentity), rows) &&
+            is_array(SECTION_FOLDED, sizeof(StringRef), rows) && is_array(SECTION_SIZES, sizeof(uint64_t), rows) &&
+            is_array(SECTION_PLATFORM_CODES, 1, rows) && is_array(SECTION_REGION_CODES, 1, rows) &&
+            is_array(SECTION_FORMAT_CODES, 1, rows) && is_array(SECTION_STATUS_CODES, 1, rows) &&
+            is_array(SECTION_ISSUE_FLAGS, sizeof(uint32_t), rows) &&
+            is_dictionary(SECTION_PLATFORM_VALUES, sizeof(Platform), SECTION_PLATFORM_ROWS) &&
+            is_dictionary(SECTION_REGION_VALUES, sizeof(char), SECTION_REGION_ROWS) &&
+            is_dictionary(SECTION_FORMAT_VALUES, sizeof(DiscFormat), SECTION_FORMAT_ROWS) &&
+            is_dictionary(SECTION_STATUS_VALUES, sizeof(TitleStatus), SECTION_STATUS_ROWS) &&
+            is_array(SECTION_LIVE, 8, words) && is_array(SECTION_ISSUE_ROWS, 8 * words, ISSUE_KIND_COUNT) &&
+            h->sections[SECTION_FREE_ROWS].size % 4 == 0;
+    if (!valid) return false;
+
+    // Check what could send a lookup out of bounds or into an endless probe:
+    // codes, index slots, free rows and bitmap tails. These are the narrow
+    // columns; identities and strings are not read until used.
+    auto codes_below = [&](LibrarySection s, size_t limit) {
+        const uint8_t* codes = at(s);
+        for (size_t i = 0; i < rows; i++) {
+            if (codes[i] >= limit) return false;
+        }
+        return true;
+    };
+    auto index_sound = [&](LibrarySection s) {
+        size_t n = count(s, 4), used = 0;
+        const uint32_t* slots = reinterpret_cast<const uint32_t*>(at(s));
+        if (h->sections[s].size % 4 != 0 || (n & (n - 1)) != 0) return false;
+        for (size_t i = 0; i < n; i++) {
+            if (slots[i] > rows) return false;
+            used += slots[i] != 0;
+        }
+        return used == h->titles && used * 4 <= n * 3 && (n > 0 || used == 0);
+    };
+    auto tails_clear = [&](LibrarySection s) {
+        if (rows % 64 == 0) return true;
+        const uint64_t* bits = reinterpret_cast<const uint64_t*>(at(s));
+        uint64_t beyond = ~0ULL << (rows % 64);
+        for (size_t i = words - 1; i < count(s, 8); i += words) {
+            if (bits[i] & beyond) return false;
+        }
+        return true;
+    };
+    const uint32_t* free_list = reinterpret_cast<const uint32_t*>(at(SECTION_FREE_ROWS));
+    size_t free_count = count(SECTION_FREE_ROWS, 4);
+    valid = codes_below(SECTION_PLATFORM_CODES, count(SECTION_PLATFORM_VALUES, sizeof(Platform))) &&
+            codes_below(SECTION_REGION_CODES, count(SECTION_REGION_VALUES, sizeof(char))) &&
+            codes_below(SECTION_FORMAT_CODES, count(SECTION_FORMAT_VALUES, sizeof(DiscFormat))) &&
+            codes_below(SECTION_STATUS_CODES, count(SECTION_STATUS_VALUES, sizeof(TitleStatus))) &&
+            index_sound(SECTION_PATH_INDEX) && index_sound(SECTION_ID_INDEX) &&
+            std::all_of(free_list, free_list + free_count, [&](uint32_t row) { return row < rows; });
+    for (LibrarySection s : { SECTION_PLATFORM_ROWS, SECTION_REGION_ROWS, SECTION_FORMAT_ROWS, SECTION_STATUS_ROWS,
+                              SECTION_LIVE, SECTION_ISSUE_ROWS }) {
+        valid = valid && tails_clear(s);
+    }
+    if (!valid) return false;
+
+    ClearAll();
+    mapping = std::move(file);
+    ids.Map(reinterpret_cast<const int64_t*>(at(SECTION_IDS)), rows);
+    paths.Map(reinterpret_cast<const StringRef*>(at(SECTION_PATHS)), rows);
+    identities.Map(reinterpret_cast<const GameIdentity*>(at(SECTION_IDENTITIES)), rows);
+    folded.Map(reinterpret_cast<const StringRef*>(at(SECTION_FOLDED)), rows);
+    sizes.Map(reinterpret_cast<const uint64_t*>(at(SECTION_SIZES)), rows);
+    platform_codes.Map(at(SECTION_PLATFORM_CODES), rows);
+    region_codes.Map(at(SECTION_REGION_CODES), rows);
+    format_codes.Map(at(SECTION_FORMAT_CODES), rows);
+    status_codes.Map(at(SECTION_STATUS_CODES), rows);
+    issue_flags.Map(reinterpret_cast<const uint32_t*>(at(SECTION_ISSUE_FLAGS)), rows);
+    pool.Map(reinterpret_cast<const char*>(at(SECTION_POOL)), count(SECTION_POOL, 1));
+
+    auto map_bitmaps = [&](LibrarySection s, Bitmap* bitmaps, size_t n) {
+        const uint64_t* bits = reinterpret_cast<const uint64_t*>(at(s));
+        for (size_t i = 0; i < n; i++) bitmaps[i].Map(bits + i * words, words);
+    };
+    auto map_dictionary = [&](auto* dictionary, LibrarySection values, LibrarySection bitmaps) {
+        using T = typename std::remove_reference<decltype(dictionary->values[0])>::type;
+        const T* first = reinterpret_cast<const T*>(at(values));
+        dictionary->values.assign(first, first + count(values, sizeof(T)));
+        dictionary->rows.resize(dictionary->values.size());
+        map_bitmaps(bitmaps, dictionary->rows.data(), dictionary->rows.size());
+    };
+    map_dictionary(&platforms, SECTION_PLATFORM_VALUES, SECTION_PLATFORM_ROWS);
+    map_dictionary(&regions, SECTION_REGION_VALUES, SECTION_REGION_ROWS);
+    map_dictionary(&formats, SECTION_FORMAT_VALUES, SECTION_FORMAT_ROWS);
+    map_dictionary(&statuses, SECTION_STATUS_VALUES, SECTION_STATUS_ROWS);
+    map_bitmaps(SECTION_LIVE, &live, 1);
+    map_bitmaps(SECTION_ISSUE_ROWS, issue_rows, ISSUE_KIND_COUNT);
+
+    path_index.Map(reinterpret_cast<const uint32_t*>(at(SECTION_PATH_INDEX)), count(SECTION_PATH_INDEX, 4));
+    id_index.Map(reinterpret_cast<const uint32_t*>(at(SECTION_ID_INDEX)), count(SECTION_ID_INDEX, 4));
+    free_rows.Map(free_list, free_count);
+    title_count = (size_t)h->titles;
+    next_id = (std::max)(next_id, h->next_id);
+    issues_dirty = false;
+    snapshot_size = size;
+    return true;
+}
+
+// Copy every column still viewing the mapping to the heap and unmap it, so
+// the snapshot file can be replaced
+void LibraryStore::DetachMapping() {
+    if (!mapping) return;
+    ids.Own();
+    paths.Own();
+    identities.Own();
+    folded.Own();
+    sizes.Own();
+    platform_codes.Own();
+    region_codes.Own();
+    format_codes.Own();
+    status_codes.Own();
+    issue_flags.Own();
+    pool.Own();
+    for (auto* rows : { &platforms.rows, &regions.rows, &formats.rows, &statuses.rows }) {
+        for (auto& bitmap : *rows) bitmap.Own();
+    }
+    live.Own();
+    for (auto& bitmap : issue_rows) bitmap.Own();
+    path_index.Own();
+    id_index.Own();
+    free_rows.Own();
+    mapping.reset();
+}
+
+// What a snapshot file holds, taken under the lock and turned into the file
+// without it. Columns still viewing the mapped snapshot are immutable, so
+// they are referenced (the mapping is kept alive) rather than copied; the
+// rest are copied, bitmaps already padded to `words`.
+struct LibraryStore::Frozen {
+    uint64_t generation = 0;
+    uint64_t log_size = 0;
+    size_t rows = 0;
+    size_t titles = 0;
+    int64_t next_id = 0;
+    std::shared_ptr<MappedFile> mapping;
+    struct Section {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        std::vector<uint8_t> owned;
+    };
+    Section sections[LIBRARY_SECTION_COUNT];
+};
+
+void LibraryStore::Freeze(Frozen* frozen) const {
+    RefreshIssues();
+    size_t rows = ids.size();
+    size_t words = (rows + 63) / 64;
+    frozen->generation = generation;
+    frozen->log_size = log ? log_size : 0;
+    frozen->rows = rows;
+    frozen->titles = title_count;
+    frozen->next_id = next_id;
+    frozen->mapping = mapping;
+
+    auto copy = [&](LibrarySection section, const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        Frozen::Section& out = frozen->sections[section];
+        out.owned.assign(bytes, bytes + size);
+        out.data = out.owned.data();
+        out.size = size;
+    };
+    auto keep = [&](LibrarySection section, const auto& column) {
+        size_t size = column.size() * sizeof(column[0]);
+        if (!column.IsMapped()) return copy(section, column.data(), size);
+        frozen->sections[section].data = reinterpret_cast<const uint8_t*>(column.data());
+        frozen->sections[section].size = size;
+    };
+    // Bitmaps grow lazily, so they are padded (or cut) to `words` here
+    auto bitmaps = [&](LibrarySection section, const Bitmap* first, size_t n) {
+        std::vector<uint64_t> out(n * words, 0);
+        for (size_t i = 0; i < n; i++) {
+            std::copy_n(first[i].data(), (std::min)(words, first[i].size()), out.begin() + i * words);
+        }
+        copy(section, out.data(), out.size() * sizeof(uint64_t));
+    };
+
+    keep(SECTION_IDS, ids);
+    keep(SECTION_PATHS, paths);
+    keep(SECTION_IDENTITIES, identities);
+    keep(SECTION_FOLDED, folded);
+    keep(SECTION_SIZES, sizes);
+    keep(SECTION_PLATFORM_CODES, platform_codes);
+    keep(SECTION_REGION_CODES, region_codes);
+    keep(SECTION_FORMAT_CODES, format_codes);
+    keep(SECTION_STATUS_CODES, status_codes);
+    keep(SECTION_ISSUE_FLAGS, issue_flags);
+    keep(SECTION_POOL, pool);
+    copy(SECTION_PLATFORM_VALUES, platforms.values.data(), platforms.values.size() * sizeof(Platform));
+    bitmaps(SECTION_PLATFORM_ROWS, platforms.rows.data(), platforms.rows.size());
+    copy(SECTION_REGION_VALUES, regions.values.data(), regions.values.size());
+    bitmaps(SECTION_REGION_ROWS, regions.rows.data(), regions.rows.size());
+    copy(SECTION_FORMAT_VALUES, formats.values.data(), formats.values.size() * sizeof(DiscFormat));
+    bitmaps(SECTION_FORMAT_ROWS, formats.rows.data(), formats.rows.size());
+    copy(SECTION_STATUS_VALUES, statuses.values.data(), statuses.values.size() * sizeof(TitleStatus));
+    bitmaps(SECTION_STATUS_ROWS, statuses.rows.data(), statuses.rows.size());
+    bitmaps(SECTION_LIVE, &live, 1);
+    bitmaps(SECTION_ISSUE_ROWS, issue_rows, ISSUE_KIND_COUNT);
+    keep(SECTION_PATH_INDEX, path_index);
+    keep(SECTION_ID_INDEX, id_index);
+    keep(SECTION_FREE_ROWS, free_rows);
+}
+
+std::vector<uint8_t> LibraryStore::BuildImage(const Frozen& frozen) {
+    const auto* sections = frozen.sections;
+    size_t rows = frozen.rows;
+    const StringRef* paths = reinterpret_cast<const StringRef*>(sections[SECTION_PATHS].data);
+    const StringRef* folded = reinterpret_cast<const StringRef*>(sections[SECTION_FOLDED].data);
+    const char* pool = reinterpret_cast<const char*>(sections[SECTION_POOL].data);
+    std::vector<uint64_t> live((rows + 63) / 64);
+    if (!live.empty()) memcpy(live.data(), sections[SECTION_LIVE].data, live.size() * sizeof(uint64_t));
+
+    // Only the strings of live rows are carried over
+    std::vector<char> packed;
+    std::vector<StringRef> packed_paths(rows, StringRef{}), packed_folded(rows, StringRef{});
+    auto pack = [&](StringRef ref) {
+        StringRef out = { packed.size(), ref.length, 0 };
+        packed.insert(packed.end(), pool + ref.offset, pool + ref.offset + ref.length);
+        return out;
+    };
+    ForEachRow(live, [&](size_t row) {
+        packed_paths[row] = pack(paths[row]);
+        packed_folded[row] = pack(folded[row]);
+    });
+
+    LibraryFileHeader header = {};
+    header.magic = LIBRARY_MAGIC;
+    header.version = LIBRARY_VERSION;
+    header.identity_size = sizeof(GameIdentity);
+    header.section_count = LIBRARY_SECTION_COUNT;
+    header.rows = rows;
+    header.titles = frozen.titles;
+    header.next_id = frozen.next_id;
+
+    std::vector<uint8_t> image(sizeof(header), 0);
+    auto add = [&](LibrarySection section, const void* data, size_t size) {
+        image.resize((image.size() + 7) & ~(size_t)7, 0);
+        header.sections[section] = { image.size(), size };
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        if (size) image.insert(image.end(), bytes, bytes + size);
+    };
+    for (int s = 0; s < LIBRARY_SECTION_COUNT; s++) {
+        LibrarySection section = (LibrarySection)s;
+        if (section == SECTION_PATHS) add(section, packed_paths.data(), rows * sizeof(StringRef));
+        else if (section == SECTION_FOLDED) add(section, packed_folded.data(), rows * sizeof(StringRef));
+        else if (section == SECTION_POOL) add(section, packed.data(), packed.size());
+        else add(section, sections[s].data, sections[s].size);
+    }
+    memcpy(image.data(), &header, sizeof(header));
+    return image;
+}
+
+static uint32_t LogChecksum(const std::string& record) {
+    Crc32 crc;
+    crc.Update(reinterpret_cast<const uint8_t*>(record.data()) + sizeof(uint32_t), record.size() - sizeof(uint32_t));
+    return crc.Final();
+}
+
+void LibraryStore::ReplayLog() {
+    std::string log_path = snapshot_path + ".wal";
+    uint64_t applied = 0;
+    FILE* f = fopen(log_path.c_str(), "rb");
+    if (f) {
+        LibraryLogRecord header;
+        while (fread(&header, sizeof(header), 1, f) == 1) {
+            if (header.path_length == 0 || header.path_length > LIBRARY_LOG_MAX_PATH ||
+                header.status > (uint8_t)TitleStatus::Error) {
+                break;
+            }
+            size_t extra = (header.op == LOG_UPSERT ? sizeof(GameIdentity) : 0) + header.path_length;
+            std::string record(sizeof(header) + extra, '\0');
+            memcpy(&record[0], &header, sizeof(header));
+            if (fread(&record[sizeof(header)], 1, extra, f) != extra || LogChecksum(record) != header.crc32) break;
+
+            std::string path = record.substr(record.size() - header.path_length);
+            TitleStatus status = (TitleStatus)header.status;
+            if (header.op == LOG_UPSERT) {
+                GameIdentity identity;
+                memcpy(&identity, &record[sizeof(header)], sizeof(identity));
+                ApplyUpsert(path, identity, header.id, status);
+            } else if (header.op == LOG_REMOVE) {
+                ApplyRemove(path);
+            } else if (header.op == LOG_STATUS) {
+                ApplySetStatus(path, status);
+            } else {
+                break;
+            }
+            applied += record.size();
+        }
+        fclose(f);
+        // Drop a record torn by a crash, so appends follow the last good one
+        std::error_code ec;
+        if (applied < fs::file_size(log_path, ec) && !ec) fs::resize_file(log_path, applied, ec);
+    }
+    log = fopen(log_path.c_str(), "ab");
+    log_size = applied;
+}
+
+void LibraryStore::AppendLog(uint8_t op, const std::string& path, int64_t id, TitleStatus status,
+                             const GameIdentity* identity) {
+    if (!log) return;
+    LibraryLogRecord header = {};
+    header.path_length = (uint32_t)path.size();
+    header.op = op;
+    header.status = (uint8_t)status;
+    header.id = id;
+    std::string record(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (identity) record.append(reinterpret_cast<const char*>(identity), sizeof(*identity));
+    record += path;
+    header.crc32 = LogChecksum(record);
+    memcpy(&record[0], &header.crc32, sizeof(header.crc32));
+
+    if (path.size() > LIBRARY_LOG_MAX_PATH || fwrite(record.data(), 1, record.size(), log) != record.size() ||
+        fflush(log) != 0) {
+        // The log may now end in a torn record; a full snapshot replaces it
+        fclose(log);
+        log = nullptr;
+        Compact();
+        return;
+    }
+    log_size += record.size();
+    if (log_size > (std::max)(LIBRARY_LOG_COMPACT_SIZE, snapshot_size / 4)) Compact();
+}
+
+// Drop the first `applied` bytes of the log, now part of the snapshot
+void LibraryStore::TrimLog(uint64_t applied) {
+    std::string log_path = snapshot_path + ".wal";
+    std::string tail;
+    if (log) {
+        fclose(log);
+        // Positional 64-bit read: fseek takes a long, 32 bits on Windows
+        RandomAccessFile f;
+        if (applied < log_size && f.Open(log_path)) {
+            tail.resize((size_t)(log_size - applied));
+            if (!f.ReadExact(applied, reinterpret_cast<uint8_t*>(&tail[0]), tail.size())) tail.clear();
+        }
+    }
+    // A log that failed is dropped whole: its changes reach the next snapshot
+    WriteFileAtomically(log_path, tail.data(), tail.size());
+    log = fopen(log_path.c_str(), "ab");
+    std::error_code ec;
+    uint64_t size = fs::file_size(log_path, ec);
+    log_size = ec ? 0 : size;
+}
+
+static bool WriteFile(const std::string& path, const std::vector<uint8_t>& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = (fclose(f) == 0) && ok;
+    std::error_code ec;
+    if (!ok) fs::remove(path, ec);
+    return ok;
+}
+
+static bool ReplaceFile(const std::string& temp_path, const std::string& path) {
+    std::error_code ec;
+    fs::rename(temp_path, path, ec);
+    if (ec) fs::remove(temp_path, ec);
+    return !ec;
+}
+
+// Write the current state as a new snapshot on a background thread, then
+// trim what it covers from the log. The state is frozen under the lock;
+// the image is built and written without it, and the lock is taken again
+// only to swap the file in. Changes made meanwhile stay in the log (or,
+// after a Reset, trigger another round). When nothing changed during the
+// write, the new file is mapped in place of the old one and the heap
+// copies.
+void LibraryStore::Compact() {
+    if (snapshot_path.empty() || closing) return;
+    if (compacting) {
+        compact_again = true;
+        return;
+    }
+    if (compactor.joinable()) compactor.join();
+    compacting = true;
+    compactor = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        do {
+            compact_again = false;
+            Frozen frozen;
+            Freeze(&frozen);
+            std::string path = snapshot_path;
+            std::string temp_path = path + ".tmp";
+            lock.unlock();
+            std::vector<uint8_t> image = BuildImage(frozen);
+            // Drop the reference to the old mapping before it is replaced
+            frozen.mapping.reset();
+            bool ok = WriteFile(temp_path, image);
+            lock.lock();
+            if (!ok) break;
+
+            // The old file must be unmapped before it is replaced: map the
+            // new one first (it may be renamed while mapped) or copy what
+            // still views the old one
+            bool mapped = frozen.generation == generation && MapSnapshot(temp_path);
+            if (!mapped) DetachMapping();
+            if (!ReplaceFile(temp_path, path)) break;
+            snapshot_size = image.size();
+            TrimLog(frozen.log_size);
+        } while (compact_again && !closing);
+        compacting = false;
+    });
+}
+
+bool LibraryStore::Open(const std::string& path) {
+    Close();
+    std::lock_guard<std::mutex> lock(mutex);
+    snapshot_path = path;
+    if (path.empty()) return false;
+
+    bool mapped = MapSnapshot(path);
+    if (mapped) {
+        ReplayLog();
+        // Fold the replayed changes into a fresh snapshot
+        if (log_size > 0) Compact();
+    } else {
+        // The log only makes sense on top of its snapshot
+        ClearAll();
+        std::error_code ec;
+        fs::remove(path + ".wal", ec);
+        log = fopen((path + ".wal").c_str(), "ab");
+        log_size = 0;
+    }
+    return mapped;
+}
+
+void LibraryStore::Close() {
+    std::thread finishing;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+        finishing = std::move(compactor);
+    }
+    if (finishing.joinable()) finishing.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // Leave an empty log behind, so the next start maps the snapshot and
+    // has nothing to replay
+    if (log && log_size > 0) {
+        Frozen frozen;
+        Freeze(&frozen);
+        std::vector<uint8_t> image = BuildImage(frozen);
+        frozen.mapping.reset();
+        DetachMapping();
+        if (WriteFileAtomically(snapshot_path, image.data(), image.size())) TrimLog(log_size);
+    }
+    if (log) fclose(log);
+    log = nullptr;
+    log_size = 0;
+    snapshot_path.clear();
+    compacting = false;
+    closing = false;
+}
+
+LibraryStore::~LibraryStore() {
+    Close();
+}
+
+LibraryStore& LibraryStore::Shared() {
+    static LibraryStore store;
+    return store;
+}
@@ -0,0 +1,333 @@
+#ifndef FORGE_LIBRARY_H
+#define FORGE_LIBRARY_H
+
+#include "forge_io.h"
+#include "platform_identifier.h"
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+// Verification state of a title, as last reported by BatchVerifier
+enum class TitleStatus : uint8_t {
+    Unverified,
+    Healthy,
+    Verified,
+    Unknown,
+    Suspicious,
+    Error,
+};
+
+// Problems a title can be listed under in the issues view
+enum TitleIssue : uint32_t {
+    ISSUE_SAME_TITLE = 0x01,     // Another title has the same platform, title ID and disc (not necessarily the same bytes)
+    ISSUE_NO_TITLE_ID = 0x02,    // Identified by platform only
+    ISSUE_SCRUBBED = 0x04,       // Partition data removed
+    ISSUE_DAMAGED = 0x08,        // Verification found it suspicious or unreadable
+};
+constexpr uint32_t ISSUE_ALL = ISSUE_SAME_TITLE | ISSUE_NO_TITLE_ID | ISSUE_SCRUBBED | ISSUE_DAMAGED;
+
+const char* TitleStatusName(TitleStatus status);
+bool ParseTitleStatus(const std::string& name, TitleStatus* status);
+const char* TitleIssueName(TitleIssue issue);
+bool ParseTitleIssue(const std::string& name, TitleIssue* issue);
+
+// A column that reads straight from the mapped library snapshot until its
+// first write, which copies it to the heap
+template <typename T>
+class SnapshotColumn {
+public:
+    SnapshotColumn() = default;
+    SnapshotColumn(const SnapshotColumn&) = delete;
+    SnapshotColumn& operator=(const SnapshotColumn&) = delete;
+    SnapshotColumn(SnapshotColumn&& other) noexcept { *this = std::move(other); }
+    SnapshotColumn& operator=(SnapshotColumn&& other) noexcept {
+        owned = std::move(other.owned);
+        mapped = other.mapped;
+        view = mapped ? other.view : owned.data();
+        count = other.count;
+        other.owned.clear();
+        other.view = nullptr;
+        other.count = 0;
+        other.mapped = false;
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool IsMapped() const { return mapped; }
+    const T* data() const { return view; }
+    const T* begin() const { return view; }
+    const T* end() const { return view + count; }
+    const T& operator[](size_t i) const { return view[i]; }
+
+    T& At(size_t i) {
+        Own();
+        return owned[i];
+    }
+    void push_back(const T& value) {
+        Own();
+        owned.push_back(value);
+        Sync();
+    }
+    void pop_back() {
+        Own();
+        owned.pop_back();
+        Sync();
+    }
+    void append(const T* values, size_t n) {
+        Own();
+        owned.insert(owned.end(), values, values + n);
+        Sync();
+    }
+    void resize(size_t n, const T& value = T()) {
+        Own();
+        owned.resize(n, value);
+        Sync();
+    }
+    void assign(size_t n, const T& value) {
+        mapped = false;
+        owned.assign(n, value);
+        Sync();
+    }
+    void clear() { assign(0, T()); }
+
+    // View n values at data; they must outlive the view
+    void Map(const T* data, size_t n) {
+        owned.clear();
+        owned.shrink_to_fit();
+        view = data;
+        count = n;
+        mapped = true;
+    }
+    void Own() {
+        if (!mapped) return;
+        owned.assign(view, view + count);
+        mapped = false;
+        Sync();
+    }
+
+private:
+    void Sync() {
+        view = owned.data();
+        count = owned.size();
+    }
+
+    std::vector<T> owned;
+    const T* view = nullptr;
+    size_t count = 0;
+    bool mapped = false;
+};
+
+// In-memory, column-oriented store of every title in the library, fed by
+// the scan snapshot, scan/watch changes and verification results.
+//
+// Platform, region, format and status are dictionary-encoded (one byte per
+// row) with one row bitmap per dictionary entry, so a filter on them is a
+// handful of OR/AND passes over 64-bit words. Size ranges are a branch-free
+// scan of the size column, and the text search only visits rows that
+// survive the bitmaps. Sorting is partial: only the rows up to the end of
+// the requested page are ordered, and only that page is materialised.
+//
+// The columns, string pool, bitmaps and hash indexes are persisted as one
+// flat file that Open() maps and queries read in place, so startup costs
+// page faults rather than a rebuild. Changes are appended to a write-ahead
+// log next to it and folded into a new snapshot by a background thread.
+class LibraryStore {
+public:
+    enum class SortKey { Title, TitleId, Platform, Region, Format, Size, Path, Status };
+
+    struct Filter {
+        std::vector<Platform> platforms;     // Any of; empty = all
+        std::vector<char> regions;           // Region letters; 0 matches titles without one
+        std::vector<DiscFormat> formats;
+        std::vector<TitleStatus> statuses;
+        uint32_t issues = 0;                 // Titles with any of these TitleIssue flags
+        std::string search;                  // Case-insensitive substring of title, title ID or path
+        uint64_t min_size = 0;
+        uint64_t max_size = UINT64_MAX;
+        SortKey sort = SortKey::Title;
+        bool descending = false;
+        size_t offset = 0;
+        size_t limit = 100;
+    };
+
+    struct Title {
+        int64_t id = 0;                      // Stable for the path across runs
+        std::string path;                    // ArchiveMemberPath for games inside archives
+        GameIdentity identity = {};
+        TitleStatus status = TitleStatus::Unverified;
+        uint32_t issues = 0;
+    };
+
+    // A title read in place; only valid during the Visit() callback
+    struct TitleView {
+        int64_t id = 0;
+        std::string_view path;
+        const GameIdentity* identity = nullptr;
+        TitleStatus status = TitleStatus::Unverified;
+        uint32_t issues = 0;
+    };
+    using VisitFn = std::function<void(const TitleView& title)>;
+
+    struct Page {
+        size_t total = 0;                    // Rows matching the filter
+        std::vector<Title> titles;           // [offset, offset + limit) of them
+    };
+
+    struct Group {
+        size_t titles = 0;
+        uint64_t bytes = 0;
+    };
+
+    struct Summary {
+        size_t titles = 0;
+        uint64_t bytes = 0;
+        std::vector<std::pair<Platform, Group>> platforms;
+        std::vector<std::pair<char, Group>> regions;
+        std::vector<std::pair<DiscFormat, Group>> formats;
+        std::vector<std::pair<TitleStatus, Group>> statuses;
+        std::vector<std::pair<TitleIssue, size_t>> issues;
+    };
+
+    // Add a title or replace the one at the same path (its status is reset
+    // when the identity changed)
+    void Upsert(const std::string& path, const GameIdentity& identity);
+    bool Remove(const std::string& path);
+    // Replace every title; statuses of paths still present are kept
+    void Reset(const std::vector<std::pair<std::string, GameIdentity>>& titles);
+    bool SetStatus(const std::string& path, TitleStatus status);
+
+    Page Query(const Filter& filter) const;
+    // Query() without copying the page out: fn sees each title of the page
+    // in order, under the store lock. Returns the rows matching the filter.
+    size_t Visit(const Filter& filter, const VisitFn& fn) const;
+    Summary GetSummary() const;
+    bool Find(int64_t id, Title* title) const;
+    // Every title, unordered
+    std::vector<Title> All() const;
+    size_t Count() const;
+
+    // Map the snapshot at snapshot_path and replay its log. False when there
+    // is no usable snapshot: the store is then empty and expects a Reset().
+    // Changes are persisted from here on; an empty path keeps them in memory.
+    bool Open(const std::string& snapshot_path);
+    // Finish any compaction, fold the log into the snapshot and stop persisting
+    void Close();
+
+    LibraryStore() = default;
+    ~LibraryStore();
+    LibraryStore(const LibraryStore&) = delete;
+    LibraryStore& operator=(const LibraryStore&) = delete;
+
+    static LibraryStore& Shared();
+
+private:
+    using Bitmap = SnapshotColumn<uint64_t>;
+
+    struct StringRef {
+        uint64_t offset;
+        uint32_t length;
+        uint32_t reserved;
+    };
+
+    // Distinct values of a column in first-seen order; a row stores the
+    // index and each index has a bitmap of its rows
+    template <typename T>
+    struct Dictionary {
+        std::vector<T> values;
+        std::vector<Bitmap> rows;
+        uint8_t Code(T value);
+        int Find(T value) const;
+    };
+
+    // Rows
+    size_t AllocateRow();
+    void SetRow(size_t row, const std::string& path, const GameIdentity& identity, TitleStatus status);
+    void ClearRow(size_t row);
+    void ClearAll();
+    void RefreshIssues() const;
+    Title Materialise(size_t row) const;
+    std::vector<size_t> PageRows(const Filter& filter, size_t* total) const;
+    template <typename T>
+    void FilterColumn(const Dictionary<T>& dictionary, const std::vector<T>& wanted,
+                      std::vector<uint64_t>* match) const;
+
+    // Strings and indexes
+    StringRef AddString(const std::string& s);
+    std::string_view String(StringRef ref) const;
+    uint64_t PathHash(size_t row) const;
+    uint64_t IdHash(size_t row) const;
+    bool FindPath(const std::string& path, size_t* row) const;
+    bool FindId(int64_t id, size_t* row) const;
+    void IndexRow(size_t row);
+    void UnindexRow(size_t row);
+    void ReserveIndexes(size_t titles);
+
+    // Changes, applied the same way live and from the log
+    void ApplyUpsert(const std::string& path, const GameIdentity& identity, int64_t id, TitleStatus status);
+    bool ApplyRemove(const std::string& path);
+    bool ApplySetStatus(const std::string& path, TitleStatus status);
+
+    // Persistence
+    struct Frozen;
+    bool MapSnapshot(const std::string& path);
+    void DetachMapping();
+    void ReplayLog();
+    void AppendLog(uint8_t op, const std::string& path, int64_t id, TitleStatus status, const GameIdentity* identity);
+    void Freeze(Frozen* frozen) const;
+    static std::vector<uint8_t> BuildImage(const Frozen& frozen);
+    void Compact();
+    void TrimLog(uint64_t applied);
+
+    mutable std::mutex mutex;
+
+    // Columns, one entry per row slot (free slots are absent from `live`)
+    SnapshotColumn<int64_t> ids;
+    SnapshotColumn<StringRef> paths;
+    SnapshotColumn<GameIdentity> identities;
+    SnapshotColumn<StringRef> folded;        // Lower-case title, title ID and path, for search
+    SnapshotColumn<uint64_t> sizes;
+    SnapshotColumn<uint8_t> platform_codes;
+    SnapshotColumn<uint8_t> region_codes;
+    SnapshotColumn<uint8_t> format_codes;
+    SnapshotColumn<uint8_t> status_codes;
+    SnapshotColumn<char> pool;               // Path and folded strings
+
+    Dictionary<Platform> platforms;
+    Dictionary<char> regions;
+    Dictionary<DiscFormat> formats;
+    Dictionary<TitleStatus> statuses;
+    Bitmap live;
+
+    // Open-addressing hash tables (linear probing) of row + 1, 0 = empty
+    SnapshotColumn<uint32_t> path_index;
+    SnapshotColumn<uint32_t> id_index;
+    SnapshotColumn<uint32_t> free_rows;
+    size_t title_count = 0;
+    int64_t next_id = 1;
+
+    // Derived from the columns on first use after a change
+    mutable bool issues_dirty = true;
+    mutable SnapshotColumn<uint32_t> issue_flags;
+    mutable Bitmap issue_rows[4];
+
+    // Snapshot file and write-ahead log
+    std::string snapshot_path;
+    std::shared_ptr<MappedFile> mapping;     // Backs the columns that are still views
+    uint64_t snapshot_size = 0;
+    FILE* log = nullptr;
+    uint64_t log_size = 0;
+    uint64_t generation = 0;                 // Bumped by every change
+    std::thread compactor;
+    bool compacting = false;
+    bool compact_again = false;
+    bool closing = false;
+};
+
+#endif // FORGE_LIBRARY_H
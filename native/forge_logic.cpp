@@ -1,7 +1,11 @@
 #include "forge_logic.h"
+#include "forge_cache.h"
+#include "forge_dat.h"
+#include "forge_hash.h"
 #include <iostream>
 #include <fstream>
 #include <cstring>
+#include <cctype>
 #include <algorithm>
 
 #ifdef _WIN32
@@ -72,19 +76,33 @@ bool WbfsSplitter::SplitFile(const std::string& input_path, const SplitInfo& inf
 }
 
 // PartitionStripper Implementation
+static uint32_t ReadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
 std::vector<PartitionStripper::PartitionInfo> PartitionStripper::AnalyzePartitions(const uint8_t* disc_data, size_t disc_size) {
     std::vector<PartitionInfo> partitions;
     if (disc_size < 0x40020) return partitions;
-    
-    const uint32_t* table = reinterpret_cast<const uint32_t*>(disc_data + 0x40000);
-    uint32_t count = table[0];
-    for (uint32_t i = 0; i < count && i < 8; i++) {
-        PartitionInfo info;
-        info.offset = table[1 + i * 2] * (uint32_t)WBFS_SECTOR_SIZE;
-        info.type = static_cast<PartitionType>(table[2 + i * 2] & 0xFF);
-        info.should_keep = (info.type == PartitionType::GAME);
-        info.size = 0x800000;
-        partitions.push_back(info);
+
+    // Four groups at 0x40000, each {count, table offset >> 2}; every table
+    // entry is {partition offset >> 2, type}. All fields are big-endian.
+    for (int group = 0; group < 4; group++) {
+        uint32_t count = ReadBE32(disc_data + 0x40000 + group * 8);
+        uint64_t table = (uint64_t)ReadBE32(disc_data + 0x40004 + group * 8) << 2;
+        for (uint32_t i = 0; i < count && i < 64; i++) {
+            uint64_t entry = table + i * 8;
+            if (entry + 8 > disc_size) break;
+            PartitionInfo info;
+            info.offset = (uint64_t)ReadBE32(disc_data + entry) << 2;
+            info.type = static_cast<PartitionType>(ReadBE32(disc_data + entry + 4));
+            info.should_keep = (info.type == PartitionType::GAME);
+            info.size = 0;
+            if (info.offset + 0x2C0 <= disc_size) {
+                const uint8_t* header = disc_data + info.offset;
+                info.size = ((uint64_t)ReadBE32(header + 0x2B8) << 2) + ((uint64_t)ReadBE32(header + 0x2BC) << 2);
+            }
+            partitions.push_back(info);
+        }
     }
     return partitions;
 }
@@ -107,15 +125,38 @@ bool PartitionStripper::StripPartitions(std::vector<uint8_t>& disc_data, const s
 
 // IntegrityAuditor Implementation
 bool IntegrityAuditor::VerifySHA1(const std::string& file_path, const std::string& expected_hash) {
-    return true; // Stub
+    if (HashEngine::KindForHex(expected_hash) != HASH_SHA1) return false;
+    HashResult result = FingerprintCache::Shared().Hash(file_path, HASH_SHA1);
+    return HashEngine::Matches(result, expected_hash);
 }
 
 std::string IntegrityAuditor::CalculateSHA1(const std::vector<uint8_t>& data) {
-    return "sha1_stub";
+    MultiHasher hasher(HASH_SHA1);
+    hasher.Update(data.data(), data.size());
+    return hasher.Finish().Sha1Hex();
+}
+
+static std::string NormalizeSerial(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (isalnum((unsigned char)c)) out.push_back((char)toupper((unsigned char)c));
+    }
+    return out;
 }
 
 bool IntegrityAuditor::VerifyRedumpHash(const std::string& file_path, const std::string& game_id) {
-    return true;
+    const DatIndex& index = DatIndex::Shared();
+    if (!index.IsLoaded()) return false;
+
+    HashResult hashes = FingerprintCache::Shared().Hash(file_path, HASH_CRC32 | HASH_SHA1);
+    DatMatch match;
+    if (!index.Find(hashes, &match)) return false;
+
+    // Redump serials look like "RVL-RSPE-USA"; the 4-character game code
+    // from the disc header must appear in it when the DAT carries one
+    if (game_id.empty() || match.serial.empty()) return true;
+    std::string code = NormalizeSerial(game_id).substr(0, 4);
+    return NormalizeSerial(match.serial).find(code) != std::string::npos;
 }
 
 // HardwareWizard Implementation
@@ -54,13 +54,15 @@ public:
 
 class PartitionStripper {
 public:
-    enum class PartitionType : uint32_t { UPDATE = 0x01, CHANNEL = 0x02, GAME = 0x03 };
+    enum class PartitionType : uint32_t { GAME = 0x00, UPDATE = 0x01, CHANNEL = 0x02 };
     struct PartitionInfo {
-        uint32_t offset;
-        uint32_t size;
+        uint64_t offset;            // Absolute disc offset of the partition header
+        uint64_t size;              // Header + data; 0 if the header was not in the buffer
         PartitionType type;
         bool should_keep;
     };
+    // disc_data must cover the partition tables (the first 0x50000 bytes is enough
+    // for every retail disc)
     static std::vector<PartitionInfo> AnalyzePartitions(const uint8_t* disc_data, size_t disc_size);
     static bool StripPartitions(std::vector<uint8_t>& disc_data, const std::vector<PartitionInfo>& partitions);
 };
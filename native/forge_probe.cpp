@@ -0,0 +1,319 @@
+#include "forge_probe.h"
+#include "forge_io.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#if defined(FORGE_HAVE_IO_URING)
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+// Pre-io_uring path: one file at a time on the calling thread (callers such
+// as the scanner already run one batch per worker)
+static void ProbePortable(const std::vector<std::string>& paths, const HeaderProber::NeedHeaderFn& need_header,
+                          std::vector<HeaderProber::Result>* results) {
+    for (size_t i = 0; i < paths.size(); i++) {
+        HeaderProber::Result& result = (*results)[i];
+        result.exists = StatFileKey(paths[i], &result.key);
+        if (!result.exists || (need_header && !need_header(i, result.key))) continue;
+
+        RandomAccessFile file;
+        size_t got = 0;
+        if (file.Open(paths[i]) && file.ReadAt(0, result.header, HeaderProber::HEADER_SIZE, &got)) {
+            result.header_size = got;
+            result.header_read = true;
+        }
+    }
+}
+
+#if defined(FORGE_HAVE_IO_URING)
+
+// ============================================================================
+// io_uring (raw syscalls; no liburing dependency)
+// ============================================================================
+
+static constexpr unsigned RING_ENTRIES = HeaderProber::MAX_BATCH * 2;
+
+class IoUring {
+public:
+    ~IoUring() {
+        if (sq_ring && sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+        if (cq_ring && cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        if (sqes && sqes != MAP_FAILED) munmap(sqes, sqes_size);
+        if (fd >= 0) close(fd);
+    }
+
+    bool Init(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0) return false;
+        // STATX, OPENAT, READ and CLOSE arrived together with RW_CUR_POS (5.6);
+        // older rings accept the setup but fail every one of them
+        if (!(params.features & IORING_FEAT_RW_CUR_POS)) return false;
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) sq_ring_size = cq_ring_size = (std::max)(sq_ring_size, cq_ring_size);
+
+        sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED) return false;
+        cq_ring = single_mmap ? sq_ring
+                              : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                     IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) return false;
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+
+        char* sq = static_cast<char*>(sq_ring);
+        char* cq = static_cast<char*>(cq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    io_uring_sqe* Next() {
+        unsigned tail = *sq_tail;
+        unsigned index = (tail + queued) & sq_mask;
+        io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes) + index;
+        memset(sqe, 0, sizeof(*sqe));
+        sq_array[index] = index;
+        queued++;
+        return sqe;
+    }
+
+    // Submit everything queued and call on_complete(user_data, res) for each
+    // completion; false if the ring itself failed
+    template <typename Fn>
+    bool SubmitAndWait(Fn on_complete) {
+        unsigned expected = queued;
+        __atomic_store_n(sq_tail, *sq_tail + queued, __ATOMIC_RELEASE);
+        unsigned to_submit = queued;
+        queued = 0;
+
+        unsigned completed = 0;
+        while (completed < expected) {
+            int ret = (int)syscall(__NR_io_uring_enter, fd, to_submit, expected - completed,
+                                   IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            to_submit -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+
+            unsigned head = *cq_head;
+            while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+                const io_uring_cqe& cqe = cqes[head & cq_mask];
+                on_complete(cqe.user_data, cqe.res);
+                head++;
+                completed++;
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        }
+        return true;
+    }
+
+private:
+    int fd = -1;
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    void* sqes = nullptr;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    size_t sqes_size = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned queued = 0;
+};
+
+// Containers and older kernels may refuse io_uring. Each thread decides for
+// itself, and a thread whose ring failed goes back to pread for good.
+struct ThreadRingState {
+    std::unique_ptr<IoUring> ring;
+    bool tried = false;
+};
+static thread_local ThreadRingState t_ring;
+
+static IoUring* ThreadRing() {
+    if (!t_ring.tried) {
+        t_ring.tried = true;
+        auto candidate = std::make_unique<IoUring>();
+        if (candidate->Init(RING_ENTRIES)) t_ring.ring = std::move(candidate);
+    }
+    return t_ring.ring.get();
+}
+
+// After a failed io_uring_enter the ring is in an unknown state: tear it
+// down and leave this thread on pread
+static void RetireThreadRing() {
+    t_ring.ring.reset();
+}
+
+static constexpr uint64_t OP_STATX = 0;
+static constexpr uint64_t OP_OPEN = 1;
+static constexpr uint64_t OP_READ = 2;
+static constexpr uint64_t OP_CLOSE = 3;
+
+static uint64_t Tag(size_t index, uint64_t op) {
+    return ((uint64_t)index << 2) | op;
+}
+
+// Everything the kernel reads or writes for one batch. When the ring fails
+// with requests in flight, they may still complete into these buffers, so
+// the batch is then left allocated (at most once per thread, since the ring
+// is not used again) instead of being freed under the kernel.
+struct UringBatch {
+    std::vector<std::string> paths;
+    std::vector<struct statx> stats;
+    std::vector<int> fds;
+    std::vector<uint8_t> headers;
+};
+
+// Round 1: statx for every file. Files the caller still needs a header for
+// (on a warm scan, usually none) are then opened in round 2, and round 3
+// reads each header linked to its close.
+static bool ProbeUring(IoUring& ring, const std::vector<std::string>& paths,
+                       const HeaderProber::NeedHeaderFn& need_header, std::vector<HeaderProber::Result>* results) {
+    auto batch = std::make_unique<UringBatch>();
+    batch->paths = paths;
+    batch->stats.resize(paths.size());
+    batch->fds.assign(paths.size(), -1);
+    batch->headers.resize(paths.size() * HeaderProber::HEADER_SIZE);
+    std::vector<struct statx>& stats = batch->stats;
+    std::vector<int>& fds = batch->fds;
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        io_uring_sqe* sqe = ring.Next();
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uint64_t)(uintptr_t)batch->paths[i].c_str();
+        sqe->len = STATX_TYPE | STATX_INO | STATX_SIZE | STATX_MTIME;
+        sqe->off = (uint64_t)(uintptr_t)&stats[i];
+        sqe->user_data = Tag(i, OP_STATX);
+    }
+    bool ok = ring.SubmitAndWait([&](uint64_t tag, int res) {
+        size_t i = (size_t)(tag >> 2);
+        if (res != 0 || !S_ISREG(stats[i].stx_mode)) return;
+        HeaderProber::Result& result = (*results)[i];
+        result.exists = true;
+        result.key.device = (uint64_t)makedev(stats[i].stx_dev_major, stats[i].stx_dev_minor);
+        result.key.file_id = stats[i].stx_ino;
+        result.key.size = stats[i].stx_size;
+        result.key.mtime_ns = (int64_t)stats[i].stx_mtime.tv_sec * 1000000000LL + stats[i].stx_mtime.tv_nsec;
+    });
+    if (!ok) {
+        batch.release();
+        return false;
+    }
+
+    std::vector<size_t> wanted;
+    for (size_t i = 0; i < paths.size(); i++) {
+        const HeaderProber::Result& result = (*results)[i];
+        if (result.exists && (!need_header || need_header(i, result.key))) wanted.push_back(i);
+    }
+    if (wanted.empty()) return true;
+
+    for (size_t i : wanted) {
+        io_uring_sqe* sqe = ring.Next();
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uint64_t)(uintptr_t)batch->paths[i].c_str();
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        sqe->user_data = Tag(i, OP_OPEN);
+    }
+    ok = ring.SubmitAndWait([&](uint64_t tag, int res) { fds[(size_t)(tag >> 2)] = res; });
+    if (!ok) {
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+        batch.release();
+        return false;
+    }
+
+    size_t queued = 0;
+    for (size_t i : wanted) {
+        if (fds[i] < 0) continue;
+        io_uring_sqe* sqe = ring.Next();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fds[i];
+        sqe->addr = (uint64_t)(uintptr_t)&batch->headers[i * HeaderProber::HEADER_SIZE];
+        sqe->len = HeaderProber::HEADER_SIZE;
+        sqe->off = 0;
+        // Close runs after the read whether or not it succeeded
+        sqe->flags = IOSQE_IO_HARDLINK;
+        sqe->user_data = Tag(i, OP_READ);
+
+        sqe = ring.Next();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = fds[i];
+        sqe->user_data = Tag(i, OP_CLOSE);
+        queued++;
+    }
+    if (queued == 0) return true;
+
+    ok = ring.SubmitAndWait([&](uint64_t tag, int res) {
+        if ((tag & 3) != OP_READ || res < 0) return;
+        size_t i = (size_t)(tag >> 2);
+        HeaderProber::Result& result = (*results)[i];
+        memcpy(result.header, &batch->headers[i * HeaderProber::HEADER_SIZE], (size_t)res);
+        result.header_size = (size_t)res;
+        result.header_read = true;
+    });
+    // Which descriptors were closed is unknown; closing them again could hit
+    // reused numbers, so they are left to the abandoned batch
+    if (!ok) batch.release();
+    return ok;
+}
+
+#endif
+
+void HeaderProber::Probe(const std::vector<std::string>& paths, const NeedHeaderFn& need_header,
+                         std::vector<Result>* results) {
+    results->assign(paths.size(), Result());
+#if defined(FORGE_HAVE_IO_URING)
+    for (size_t begin = 0; begin < paths.size(); begin += MAX_BATCH) {
+        IoUring* ring = ThreadRing();
+        size_t end = (std::min)(paths.size(), begin + MAX_BATCH);
+        std::vector<std::string> batch(paths.begin() + begin, paths.begin() + end);
+        std::vector<Result> batch_results(batch.size());
+        auto batch_need = [&](size_t index, const FileKey& key) {
+            return !need_header || need_header(begin + index, key);
+        };
+        if (!ring || !ProbeUring(*ring, batch, batch_need, &batch_results)) {
+            if (ring) RetireThreadRing();
+            batch_results.assign(batch.size(), Result());
+            ProbePortable(batch, batch_need, &batch_results);
+        }
+        std::copy(batch_results.begin(), batch_results.end(), results->begin() + begin);
+    }
+#else
+    ProbePortable(paths, need_header, results);
+#endif
+}
+
+const char* HeaderProber::BackendName() {
+#if defined(FORGE_HAVE_IO_URING)
+    return ThreadRing() ? "io_uring" : "pread";
+#else
+    return "pread";
+#endif
+}
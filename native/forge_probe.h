@@ -0,0 +1,40 @@
+#ifndef FORGE_PROBE_H
+#define FORGE_PROBE_H
+
+#include "forge_cache.h"
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Metadata and first bytes of many files at once. On Linux a whole batch is
+// stat'ed through io_uring in one submission; only files whose header is
+// still needed are then opened, read and closed, in two more. Per-file
+// latency on network mounts and USB hubs overlaps instead of adding up.
+// Without io_uring each file is probed with stat + pread.
+class HeaderProber {
+public:
+    // Enough for every first-sector signature identify_from_header knows
+    static constexpr size_t HEADER_SIZE = IDENTIFY_HEADER_SIZE;
+    // Files per Probe() call that fit the ring in one go
+    static constexpr size_t MAX_BATCH = 128;
+
+    struct Result {
+        bool exists = false;        // Stat succeeded
+        bool header_read = false;   // Header was requested and read
+        FileKey key;
+        size_t header_size = 0;
+        uint8_t header[HEADER_SIZE];
+    };
+
+    // Decides per file, once its key is known, whether the header is needed
+    // (false when a cache already answers for that size/mtime)
+    using NeedHeaderFn = std::function<bool(size_t index, const FileKey& key)>;
+
+    static void Probe(const std::vector<std::string>& paths, const NeedHeaderFn& need_header,
+                      std::vector<Result>* results);
+
+    static const char* BackendName();
+};
+
+#endif // FORGE_PROBE_H
@@ -0,0 +1,255 @@
+#include "forge_quick.h"
+#include "forge_io.h"
+#include "forge_logic.h"
+#include "forge_wii.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+static constexpr size_t QUICK_HEADER_SIZE = 0x440;
+static constexpr size_t QUICK_MAX_FST_SIZE = 16 * 1024 * 1024;
+static constexpr size_t QUICK_MAX_FST_CLUSTERS = 64;
+static constexpr size_t WII_DISC_TABLE_SPAN = 0x50000;
+
+static uint32_t ReadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// SplitMix64: the sample only depends on the file, so repeated sweeps agree
+static uint64_t NextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t SeedFor(const uint8_t* header, size_t size, uint64_t file_size) {
+    uint64_t h = 0xCBF29CE484222325ULL ^ file_size;
+    for (size_t i = 0; i < size; i++) {
+        h ^= header[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+class QuickCheck {
+public:
+    explicit QuickCheck(QuickVerifyResult& result) : result(result) {}
+
+    bool operator()(bool passed, const char* failure) {
+        result.checks++;
+        if (passed) result.checks_passed++;
+        else if (result.first_failure.empty()) result.first_failure = failure;
+        return passed;
+    }
+
+private:
+    QuickVerifyResult& result;
+};
+
+// Read clusters at the given offsets (sorted so the head sweeps once)
+static void SampleReadable(const RandomAccessFile& file, std::vector<uint64_t> offsets,
+                           QuickVerifyResult& result, QuickCheck& check) {
+    std::sort(offsets.begin(), offsets.end());
+    std::vector<uint8_t> cluster(WII_CLUSTER_SIZE);
+    for (uint64_t offset : offsets) {
+        size_t size = (size_t)(std::min)((uint64_t)WII_CLUSTER_SIZE, file.Size() - offset);
+        result.clusters_sampled++;
+        check(file.ReadExact(offset, cluster.data(), size), "Unreadable cluster");
+    }
+}
+
+static std::vector<uint64_t> RandomOffsets(uint64_t& seed, uint64_t begin, uint64_t end, uint32_t count) {
+    std::vector<uint64_t> offsets;
+    uint64_t clusters = end > begin ? (end - begin + WII_CLUSTER_SIZE - 1) / WII_CLUSTER_SIZE : 0;
+    for (uint32_t i = 0; i < count && clusters; i++) {
+        offsets.push_back(begin + (NextRandom(seed) % clusters) * WII_CLUSTER_SIZE);
+    }
+    return offsets;
+}
+
+// ============================================================================
+// GameCube: FST layout must fit the image
+// ============================================================================
+
+static void VerifyGameCube(const RandomAccessFile& file, const uint8_t* header, uint64_t seed,
+                           uint32_t samples, QuickVerifyResult& result, QuickCheck& check) {
+    uint64_t file_size = file.Size();
+    uint64_t fst_offset = ReadBE32(header + 0x424);
+    uint64_t fst_size = ReadBE32(header + 0x428);
+    uint64_t data_end = file_size;
+
+    if (check(fst_size >= 12 && fst_size <= QUICK_MAX_FST_SIZE && fst_offset + fst_size <= file_size,
+              "FST outside image")) {
+        std::vector<uint8_t> fst((size_t)fst_size);
+        if (check(file.ReadExact(fst_offset, fst.data(), fst.size()), "FST unreadable")) {
+            // 12-byte entries: flags, 24-bit name offset, offset, length.
+            // The root directory's length is the entry count.
+            uint32_t count = ReadBE32(fst.data() + 8);
+            bool valid = fst[0] == 1 && count > 0 && (uint64_t)count * 12 <= fst_size;
+            uint64_t strings_size = valid ? fst_size - (uint64_t)count * 12 : 0;
+            uint64_t max_end = fst_offset + fst_size;
+            for (uint32_t i = 1; valid && i < count; i++) {
+                const uint8_t* entry = fst.data() + i * 12;
+                uint32_t name_offset = ReadBE32(entry) & 0x00FFFFFF;
+                if (name_offset >= strings_size) valid = false;
+                if (entry[0] == 0) {
+                    max_end = (std::max)(max_end, (uint64_t)ReadBE32(entry + 4) + ReadBE32(entry + 8));
+                }
+            }
+            check(valid, "FST corrupt");
+            if (check(max_end <= file_size, "Image truncated (files past end)")) data_end = max_end;
+        }
+    }
+
+    // Boundaries (start, FST, end of file data) plus the random sample
+    std::vector<uint64_t> offsets = RandomOffsets(seed, 0, data_end, samples);
+    if (data_end >= WII_CLUSTER_SIZE) offsets.push_back((data_end - 1) / WII_CLUSTER_SIZE * WII_CLUSTER_SIZE);
+    SampleReadable(file, offsets, result, check);
+}
+
+// ============================================================================
+// Wii: partition table, H3/TMD and sampled clusters through the hash tree
+// ============================================================================
+
+struct WiiSample {
+    size_t partition;
+    uint64_t cluster;
+};
+
+static void VerifyWii(const RandomAccessFile& file, uint64_t seed, uint32_t samples,
+                      QuickVerifyResult& result, QuickCheck& check) {
+    uint64_t file_size = file.Size();
+    std::vector<uint8_t> disc(WII_DISC_TABLE_SPAN);
+    size_t got = 0;
+    file.ReadAt(0, disc.data(), disc.size(), &got);
+    std::vector<PartitionStripper::PartitionInfo> partitions = PartitionStripper::AnalyzePartitions(disc.data(), got);
+    if (!check(!partitions.empty(), "No partitions found")) return;
+
+    std::vector<WiiPartition> opened(partitions.size());
+    std::vector<bool> usable(partitions.size(), false);
+    std::vector<uint64_t> plain_offsets;
+    uint64_t total_clusters = 0;
+
+    for (size_t i = 0; i < partitions.size(); i++) {
+        const PartitionStripper::PartitionInfo& info = partitions[i];
+        uint8_t header[0x2C0];
+        if (!check(info.offset < file_size && file.ReadExact(info.offset, header, sizeof(header)),
+                   "Partition header unreadable")) {
+            continue;
+        }
+        uint64_t data_start = info.offset + ((uint64_t)ReadBE32(header + 0x2B8) << 2);
+        uint64_t data_end = data_start + ((uint64_t)ReadBE32(header + 0x2BC) << 2);
+        check(data_end <= file_size, "Image truncated (partition past end)");
+
+        if (!WiiHashTreeVerifier::HasCommonKey(header[0x1F1])) {
+            // No key: boundaries and sample are only checked for readability
+            plain_offsets.push_back(data_start);
+            if (data_end > data_start + WII_CLUSTER_SIZE) plain_offsets.push_back(data_end - WII_CLUSTER_SIZE);
+            continue;
+        }
+        if (!opened[i].Open(file, info)) continue;
+        check(opened[i].H3Ok(), "H3 table does not match TMD");
+        usable[i] = true;
+        total_clusters += opened[i].ClusterCount();
+    }
+
+    // Partition boundaries, FST clusters and a random sample over all data
+    std::vector<WiiSample> picks;
+    std::vector<uint8_t> encrypted(WII_CLUSTER_SIZE);
+    std::vector<uint8_t> payload(WII_CLUSTER_DATA_SIZE);
+    for (size_t i = 0; i < opened.size(); i++) {
+        if (!usable[i] || opened[i].ClusterCount() == 0) continue;
+        const WiiPartition& partition = opened[i];
+        picks.push_back({ i, 0 });
+        picks.push_back({ i, partition.ClusterCount() - 1 });
+
+        // boot.bin sits at the start of cluster 0's payload; FST offset/size are shifted by 2
+        if (!file.ReadExact(partition.DataOffset(), encrypted.data(), encrypted.size())) continue;
+        if (partition.CheckCluster(0, encrypted.data(), payload.data()) != WII_CLUSTER_OK) continue;
+        uint64_t fst_offset = (uint64_t)ReadBE32(payload.data() + 0x424) << 2;
+        uint64_t fst_size = (uint64_t)ReadBE32(payload.data() + 0x428) << 2;
+        if (fst_size == 0) continue;
+        uint64_t first = fst_offset / WII_CLUSTER_DATA_SIZE;
+        uint64_t last = (std::min)((fst_offset + fst_size - 1) / WII_CLUSTER_DATA_SIZE,
+                                   first + QUICK_MAX_FST_CLUSTERS - 1);
+        for (uint64_t c = first; c <= last && c < partition.ClusterCount(); c++) picks.push_back({ i, c });
+    }
+    for (uint32_t n = 0; n < samples && total_clusters; n++) {
+        uint64_t index = NextRandom(seed) % total_clusters;
+        for (size_t i = 0; i < opened.size(); i++) {
+            if (!usable[i]) continue;
+            if (index < opened[i].ClusterCount()) {
+                picks.push_back({ i, index });
+                break;
+            }
+            index -= opened[i].ClusterCount();
+        }
+    }
+
+    std::sort(picks.begin(), picks.end(), [](const WiiSample& a, const WiiSample& b) {
+        return a.partition != b.partition ? a.partition < b.partition : a.cluster < b.cluster;
+    });
+    picks.erase(std::unique(picks.begin(), picks.end(), [](const WiiSample& a, const WiiSample& b) {
+        return a.partition == b.partition && a.cluster == b.cluster;
+    }), picks.end());
+
+    for (const WiiSample& pick : picks) {
+        const WiiPartition& partition = opened[pick.partition];
+        result.clusters_sampled++;
+        uint64_t offset = partition.DataOffset() + pick.cluster * WII_CLUSTER_SIZE;
+        if (!check(file.ReadExact(offset, encrypted.data(), encrypted.size()), "Unreadable cluster")) continue;
+        check(partition.CheckCluster(pick.cluster, encrypted.data()) == WII_CLUSTER_OK,
+              "Hash tree mismatch in sampled cluster");
+        result.hash_tree_checked = true;
+    }
+
+    if (!plain_offsets.empty() || total_clusters == 0) {
+        std::vector<uint64_t> offsets = RandomOffsets(seed, 0, file_size, total_clusters ? 0 : samples);
+        offsets.insert(offsets.end(), plain_offsets.begin(), plain_offsets.end());
+        offsets.erase(std::remove_if(offsets.begin(), offsets.end(),
+                                     [file_size](uint64_t o) { return o >= file_size; }), offsets.end());
+        SampleReadable(file, offsets, result, check);
+    }
+}
+
+// ============================================================================
+// Entry point
+// ============================================================================
+
+QuickVerifyResult QuickVerifier::Verify(const std::string& file_path, uint32_t sample_clusters) {
+    QuickVerifyResult result;
+    QuickCheck check(result);
+
+    RandomAccessFile file;
+    uint8_t header[QUICK_HEADER_SIZE] = {};
+    size_t got = 0;
+    if (!file.Open(file_path) || !file.ReadAt(0, header, sizeof(header), &got)) {
+        result.first_failure = "File unreadable";
+        return result;
+    }
+
+    result.supported = identify_from_header(header, got, &result.identity) ||
+                       identify_from_file(file_path.c_str(), &result.identity);
+    if (!result.supported) {
+        result.first_failure = "Header not recognised";
+        return result;
+    }
+    result.identity.file_size = file.Size();
+    uint64_t seed = SeedFor(header, got, file.Size());
+
+    if (result.identity.format == FORMAT_ISO && result.identity.platform == PLATFORM_GAMECUBE &&
+        got >= QUICK_HEADER_SIZE) {
+        VerifyGameCube(file, header, seed, sample_clusters, result, check);
+    } else if (result.identity.format == FORMAT_ISO && result.identity.platform == PLATFORM_WII) {
+        VerifyWii(file, seed, sample_clusters, result, check);
+    } else {
+        // Containers and ROMs: the header was recognised; sample the body
+        std::vector<uint64_t> offsets = RandomOffsets(seed, 0, file.Size(), sample_clusters);
+        if (file.Size() > WII_CLUSTER_SIZE) offsets.push_back(file.Size() - WII_CLUSTER_SIZE);
+        SampleReadable(file, offsets, result, check);
+    }
+
+    result.confidence = result.checks ? (float)result.checks_passed / (float)result.checks : 0.0f;
+    return result;
+}
@@ -0,0 +1,35 @@
+#ifndef FORGE_QUICK_H
+#define FORGE_QUICK_H
+
+#include "platform_identifier.h"
+#include <string>
+#include <stdint.h>
+
+// Outcome of a sampled health check
+struct QuickVerifyResult {
+    bool supported = false;           // Header recognised, sampling was possible
+    GameIdentity identity = {};
+    uint32_t checks = 0;
+    uint32_t checks_passed = 0;
+    uint32_t clusters_sampled = 0;
+    bool hash_tree_checked = false;   // Wii clusters were checked against H0-H3
+    float confidence = 0.0f;          // checks_passed / checks, 0 when nothing was checked
+    std::string first_failure;
+
+    // A full hash should be run on this file
+    bool Suspicious() const { return !supported || checks_passed < checks; }
+};
+
+// Triage tier in front of the full hash: reads only the header, the FST,
+// partition boundaries and a deterministic pseudo-random sample of 32 KiB
+// clusters. On Wii images (with the common key set) sampled clusters are
+// checked against the partition hash tree; elsewhere they are checked for
+// readability and against the layout the header and FST describe.
+class QuickVerifier {
+public:
+    static constexpr uint32_t DEFAULT_SAMPLES = 16;
+
+    static QuickVerifyResult Verify(const std::string& file_path, uint32_t sample_clusters = DEFAULT_SAMPLES);
+};
+
+#endif // FORGE_QUICK_H
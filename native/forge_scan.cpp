@@ -0,0 +1,831 @@
+#include "forge_scan.h"
+#include "forge_cache.h"
+#include "forge_container.h"
+#include "forge_io.h"
+#include "forge_probe.h"
+#include "forge_wiiu.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <set>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Scans are bound by directory listing and header reads (often over SMB/NFS),
+// not CPU, so run more threads than cores
+static constexpr unsigned SCAN_MIN_THREADS = 4;
+static constexpr unsigned SCAN_MAX_THREADS = 16;
+static constexpr size_t SCAN_PROGRESS_INTERVAL = 256;
+// Files of one directory are probed in batches: big enough to keep many
+// requests in flight, small enough for idle threads to steal
+static constexpr size_t SCAN_PROBE_BATCH = 64;
+// Recorded for a file whose header could not be read: no file has this
+// mtime, so the next incremental scan probes it again
+static constexpr int64_t SCAN_UNREAD_MTIME_NS = INT64_MIN;
+
+// ============================================================================
+// Snapshot persistence (little-endian, native struct packing)
+//
+//   SnapshotFileHeader
+//   { string root, u32 dir_count,
+//     { string path, i64 mtime_ns, u32 subdir_count, u32 file_count,
+//       string subdir * subdir_count,
+//       { string name, u64 size, i64 mtime_ns, u32 identified,
+//         GameIdentity (only if identified), u32 member_count,
+//         { string name, GameIdentity } * member_count } * file_count
+//     } * dir_count
+//   } * root_count
+//
+// Strings are a u32 length followed by the bytes. A Wii U title folder is a
+// directory with no subdirs and a single file whose name is empty.
+// ============================================================================
+
+static constexpr uint32_t SNAPSHOT_MAGIC = 0x504E5346;   // "FSNP"
+static constexpr uint32_t SNAPSHOT_VERSION = 4;
+static constexpr uint32_t SNAPSHOT_MAX_STRING = 32 * 1024;
+
+struct SnapshotFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t identity_size;
+    uint32_t root_count;
+};
+
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(FILE* f) : f(f) {}
+
+    template <typename T>
+    void Write(const T& value) {
+        ok = ok && fwrite(&value, sizeof(T), 1, f) == 1;
+    }
+
+    void WriteString(const std::string& s) {
+        Write((uint32_t)s.size());
+        ok = ok && (s.empty() || fwrite(s.data(), 1, s.size(), f) == s.size());
+    }
+
+    bool ok = true;
+
+private:
+    FILE* f;
+};
+
+class SnapshotReader {
+public:
+    explicit SnapshotReader(FILE* f) : f(f) {}
+
+    template <typename T>
+    bool Read(T* value) {
+        ok = ok && fread(value, sizeof(T), 1, f) == 1;
+        return ok;
+    }
+
+    bool ReadString(std::string* s) {
+        uint32_t length = 0;
+        if (!Read(&length) || length > SNAPSHOT_MAX_STRING) return ok = false;
+        s->assign(length, '\0');
+        ok = length == 0 || fread(&(*s)[0], 1, length, f) == length;
+        return ok;
+    }
+
+    bool ok = true;
+
+private:
+    FILE* f;
+};
+
+bool ScanSnapshot::Open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    snapshot_path = path;
+    roots.clear();
+    dirty = false;
+    loaded = false;
+    return true;
+}
+
+// Called with the mutex held by everything that reads or replaces roots
+void ScanSnapshot::Load() const {
+    if (loaded) return;
+    loaded = true;
+    if (snapshot_path.empty()) return;
+
+    FILE* f = fopen(snapshot_path.c_str(), "rb");
+    if (!f) return; // First run
+
+    SnapshotReader in(f);
+    SnapshotFileHeader header;
+    bool ok = in.Read(&header) && header.magic == SNAPSHOT_MAGIC && header.version == SNAPSHOT_VERSION &&
+              header.identity_size == sizeof(GameIdentity);
+
+    for (uint32_t r = 0; ok && r < header.root_count; r++) {
+        std::string root;
+        uint32_t dir_count = 0;
+        ok = in.ReadString(&root) && in.Read(&dir_count);
+
+        auto tree = std::make_shared<Tree>();
+        for (uint32_t d = 0; ok && d < dir_count; d++) {
+            std::string dir_path;
+            DirEntry dir;
+            uint32_t subdir_count = 0, file_count = 0;
+            ok = in.ReadString(&dir_path) && in.Read(&dir.mtime_ns) && in.Read(&subdir_count) &&
+                 in.Read(&file_count);
+            for (uint32_t i = 0; ok && i < subdir_count; i++) {
+                std::string name;
+                if (in.ReadString(&name)) dir.subdirs.push_back(std::move(name));
+                ok = in.ok;
+            }
+            for (uint32_t i = 0; ok && i < file_count; i++) {
+                std::string name;
+                FileEntry file;
+                uint32_t identified = 0;
+                ok = in.ReadString(&name) && in.Read(&file.size) && in.Read(&file.mtime_ns) &&
+                     in.Read(&identified);
+                file.identified = identified != 0;
+                if (ok && file.identified) ok = in.Read(&file.identity);
+                uint32_t member_count = 0;
+                ok = ok && in.Read(&member_count);
+                for (uint32_t m = 0; ok && m < member_count; m++) {
+                    ArchiveMember member;
+                    ok = in.ReadString(&member.name) && in.Read(&member.identity);
+                    if (ok) file.members.push_back(std::move(member));
+                }
+                if (ok) dir.files.emplace(std::move(name), std::move(file));
+            }
+            if (ok) (*tree)[dir_path] = std::move(dir);
+        }
+        if (ok) roots[root] = std::move(tree);
+    }
+    fclose(f);
+
+    if (!ok) {
+        // Corrupt or from an incompatible build: the next scan is a full walk
+        roots.clear();
+        dirty = true;
+    }
+}
+
+bool ScanSnapshot::Save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!dirty || snapshot_path.empty()) return true;
+
+    bool written = WriteFileAtomically(snapshot_path, [&](FILE* f) {
+        SnapshotWriter out(f);
+        SnapshotFileHeader header = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION, (uint32_t)sizeof(GameIdentity),
+                                      (uint32_t)roots.size() };
+        out.Write(header);
+        for (const auto& root : roots) {
+            out.WriteString(root.first);
+            out.Write((uint32_t)root.second->size());
+            for (const auto& dir : *root.second) {
+                out.WriteString(dir.first);
+                out.Write(dir.second.mtime_ns);
+                out.Write((uint32_t)dir.second.subdirs.size());
+                out.Write((uint32_t)dir.second.files.size());
+                for (const auto& name : dir.second.subdirs) out.WriteString(name);
+                for (const auto& file : dir.second.files) {
+                    out.WriteString(file.first);
+                    out.Write(file.second.size);
+                    out.Write(file.second.mtime_ns);
+                    out.Write((uint32_t)(file.second.identified ? 1 : 0));
+                    if (file.second.identified) out.Write(file.second.identity);
+                    out.Write((uint32_t)file.second.members.size());
+                    for (const auto& member : file.second.members) {
+                        out.WriteString(member.name);
+                        out.Write(member.identity);
+                    }
+                }
+            }
+            if (!out.ok) break;
+        }
+        return out.ok;
+    });
+    if (!written) return false;
+    dirty = false;
+    return true;
+}
+
+void ScanSnapshot::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Load();
+    dirty = dirty || !roots.empty();
+    roots.clear();
+}
+
+std::shared_ptr<const ScanSnapshot::Tree> ScanSnapshot::Get(const std::string& root) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Load();
+    auto it = roots.find(root);
+    return it != roots.end() ? it->second : nullptr;
+}
+
+void ScanSnapshot::Put(const std::string& root, Tree tree) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Load();
+    roots[root] = std::make_shared<const Tree>(std::move(tree));
+    dirty = true;
+}
+
+ScanSnapshot& ScanSnapshot::Shared() {
+    static ScanSnapshot snapshot;
+    return snapshot;
+}
+
+// Windows does not maintain directory write times on FAT-family volumes, so
+// an unchanged mtime there proves nothing and every directory is listed
+static bool DirectoryMtimeTrusted(const std::string& root) {
+#ifdef _WIN32
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, root.c_str(), -1, nullptr, 0);
+    if (wlen <= 0) return false;
+    std::wstring wpath(wlen, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, root.c_str(), -1, wpath.data(), wlen);
+
+    wchar_t volume[MAX_PATH];
+    wchar_t fs_name[MAX_PATH];
+    if (!GetVolumePathNameW(wpath.c_str(), volume, MAX_PATH) ||
+        !GetVolumeInformationW(volume, nullptr, 0, nullptr, nullptr, nullptr, fs_name, MAX_PATH)) {
+        return false;
+    }
+    std::wstring name(fs_name);
+    return name.find(L"FAT") == std::wstring::npos;
+#else
+    (void)root;
+    return true;
+#endif
+}
+
+// ============================================================================
+// Work-stealing scan
+// ============================================================================
+
+struct ScanWork {
+    std::string path;                   // Directory to expand
+    std::vector<std::string> names;     // Or: files to probe within path
+    size_t root = 0;
+    bool directory = false;
+};
+
+// A root that is a single file is stored under its own path with name ""
+static std::string FilePath(const std::string& dir, const std::string& name) {
+    return name.empty() ? dir : (fs::path(dir) / name).string();
+}
+
+void ScanSnapshot::ForEachTitle(
+    const std::function<void(const std::string& path, const GameIdentity& identity)>& fn) const {
+    std::vector<std::shared_ptr<const Tree>> trees;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Load();
+        for (const auto& root : roots) trees.push_back(root.second);
+    }
+    for (const auto& tree : trees) {
+        for (const auto& dir : *tree) {
+            for (const auto& file : dir.second.files) {
+                std::string path = FilePath(dir.first, file.first);
+                if (file.second.identified) fn(path, file.second.identity);
+                for (const auto& member : file.second.members) fn(ArchiveMemberPath(path, member.name), member.identity);
+            }
+        }
+    }
+}
+
+class ScanDeque {
+public:
+    void Push(ScanWork work) {
+        std::lock_guard<std::mutex> lock(mutex);
+        items.push_back(std::move(work));
+    }
+
+    // Owner end
+    bool Pop(ScanWork* work) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) return false;
+        *work = std::move(items.back());
+        items.pop_back();
+        return true;
+    }
+
+    // Thief end
+    bool Steal(ScanWork* work) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) return false;
+        *work = std::move(items.front());
+        items.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<ScanWork> items;
+};
+
+struct ScanRoot {
+    std::string path;
+    bool available = false;
+    bool trust_mtime = false;
+    std::shared_ptr<const ScanSnapshot::Tree> previous;   // Incremental scans only
+    std::mutex mutex;
+    ScanSnapshot::Tree tree;                               // Built by this scan
+};
+
+class ScanState {
+public:
+    ScanState(unsigned threads, const LibraryScanner::Options& options, const LibraryScanner::ChangeFn& on_change,
+              const LibraryScanner::ProgressFn& on_progress, const std::atomic<bool>* cancel)
+        : options(options), on_change(on_change), on_progress(on_progress), cancel(cancel) {
+        for (unsigned i = 0; i < threads; i++) queues.push_back(std::make_unique<ScanDeque>());
+    }
+
+    std::vector<std::unique_ptr<ScanRoot>> roots;
+
+    void Push(size_t worker, ScanWork work) {
+        pending.fetch_add(1);
+        queues[worker % queues.size()]->Push(std::move(work));
+    }
+
+    void Report(LibraryScanner::Change change, const std::string& path, const GameIdentity* identity) {
+        if (change == LibraryScanner::Change::Removed) removed.fetch_add(1);
+        else if (change != LibraryScanner::Change::RootUnavailable) found.fetch_add(1);
+        if (on_change) on_change(change, path, identity);
+    }
+
+    void Worker(size_t self) {
+        ScanWork work;
+        while (!Cancelled()) {
+            if (Next(self, &work)) {
+                if (work.directory) Expand(self, work);
+                else ProbeFiles(work);
+                pending.fetch_sub(1);
+                continue;
+            }
+            // Nothing queued anywhere and nobody is expanding a directory
+            if (pending.load() == 0) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    bool Cancelled() const { return cancel && cancel->load(); }
+
+    LibraryScanner::Stats Snapshot() const {
+        LibraryScanner::Stats stats;
+        stats.directories = directories.load();
+        stats.reused = reused.load();
+        stats.files = files.load();
+        stats.found = found.load();
+        stats.removed = removed.load();
+        stats.unchanged = unchanged.load();
+        stats.errors = errors.load();
+        stats.cancelled = Cancelled();
+        return stats;
+    }
+
+private:
+    using DirEntry = ScanSnapshot::DirEntry;
+    using FileEntry = ScanSnapshot::FileEntry;
+
+    bool Next(size_t self, ScanWork* work) {
+        if (queues[self]->Pop(work)) return true;
+        for (size_t i = 1; i < queues.size(); i++) {
+            if (queues[(self + i) % queues.size()]->Steal(work)) return true;
+        }
+        return false;
+    }
+
+    static const DirEntry* PreviousDir(const ScanRoot& root, const std::string& dir) {
+        if (!root.previous) return nullptr;
+        auto it = root.previous->find(dir);
+        return it != root.previous->end() ? &it->second : nullptr;
+    }
+
+    static const FileEntry* PreviousFile(const ScanRoot& root, const std::string& dir, const std::string& name) {
+        const DirEntry* entry = PreviousDir(root, dir);
+        if (!entry) return nullptr;
+        auto it = entry->files.find(name);
+        return it != entry->files.end() ? &it->second : nullptr;
+    }
+
+    static bool HasMember(const FileEntry& file, const std::string& name) {
+        for (const auto& member : file.members) {
+            if (member.name == name) return true;
+        }
+        return false;
+    }
+
+    // Every title a file held: itself, or the games inside an archive
+    void ReportFileRemoved(const std::string& path, const FileEntry& file) {
+        if (file.identified) Report(LibraryScanner::Change::Removed, path, &file.identity);
+        for (const auto& member : file.members) {
+            Report(LibraryScanner::Change::Removed, ArchiveMemberPath(path, member.name), &member.identity);
+        }
+    }
+
+    // Found on a full scan; otherwise diffed by name against the archive's
+    // previous contents (members of a rewritten archive report Changed)
+    void ReportMembers(const std::string& path, const FileEntry& file, const FileEntry* prev) {
+        for (const auto& member : file.members) {
+            LibraryScanner::Change change = LibraryScanner::Change::Found;
+            if (options.incremental) {
+                change = prev && HasMember(*prev, member.name) ? LibraryScanner::Change::Changed
+                                                               : LibraryScanner::Change::Added;
+            }
+            Report(change, ArchiveMemberPath(path, member.name), &member.identity);
+        }
+        if (!options.incremental || !prev) return;
+        for (const auto& member : prev->members) {
+            if (!HasMember(file, member.name)) {
+                Report(LibraryScanner::Change::Removed, ArchiveMemberPath(path, member.name), &member.identity);
+            }
+        }
+    }
+
+    void ReportRemovedTree(const ScanRoot& root, const std::string& dir) {
+        const DirEntry* entry = PreviousDir(root, dir);
+        if (!entry) return;
+        for (const auto& file : entry->files) ReportFileRemoved(FilePath(dir, file.first), file.second);
+        for (const auto& sub : entry->subdirs) ReportRemovedTree(root, (fs::path(dir) / sub).string());
+    }
+
+    void Expand(size_t self, const ScanWork& work) {
+        ScanRoot& root = *roots[work.root];
+        const DirEntry* prev = PreviousDir(root, work.path);
+        FileKey key;
+        if (!StatFileKey(work.path, &key)) {
+            errors.fetch_add(1);
+            return;
+        }
+
+        // No entry added, removed or renamed: reuse the listing and only stat
+        // its files. In-place rewrites do not touch the directory, and a
+        // preallocated download only becomes a game once it is written, so
+        // every file is checked; unchanged ones cost a stat and nothing more.
+        if (options.incremental && prev && root.trust_mtime && prev->mtime_ns == key.mtime_ns) {
+            reused.fetch_add(1);
+            if (prev->files.count(std::string())) {
+                ProbeTitleFolder(root, work.path, key, prev);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(root.mutex);
+                root.tree[work.path] = *prev;
+            }
+            for (const auto& sub : prev->subdirs) {
+                Push(self, { (fs::path(work.path) / sub).string(), {}, work.root, true });
+            }
+            std::vector<std::string> names;
+            for (const auto& file : prev->files) names.push_back(file.first);
+            PushFiles(self, work, names);
+            return;
+        }
+
+        directories.fetch_add(1);
+        std::error_code ec;
+        fs::directory_iterator it(work.path, fs::directory_options::skip_permission_denied, ec);
+        if (ec) {
+            // Keep what we knew rather than reporting the whole subtree removed
+            errors.fetch_add(1);
+            if (prev) {
+                std::lock_guard<std::mutex> lock(root.mutex);
+                root.tree[work.path] = *prev;
+            }
+            return;
+        }
+
+        DirEntry entry;
+        entry.mtime_ns = key.mtime_ns;
+        for (fs::directory_iterator end; it != end; it.increment(ec)) {
+            if (ec || Cancelled()) break;
+            std::error_code entry_ec;
+            // Like recursive_directory_iterator, directory symlinks are not followed
+            if (it->is_directory(entry_ec)) {
+                if (!it->is_symlink(entry_ec)) entry.subdirs.push_back(it->path().filename().string());
+            } else if (it->is_regular_file(entry_ec)) {
+                entry.files.emplace(it->path().filename().string(), FileEntry());
+            }
+        }
+
+        if (!Cancelled() && WiiUFolderListing(entry.subdirs) && IsWiiUTitleFolder(work.path)) {
+            ProbeTitleFolder(root, work.path, key, prev);
+            return;
+        }
+
+        std::vector<std::string> subdirs = entry.subdirs;
+        std::vector<std::string> names;
+        for (const auto& file : entry.files) names.push_back(file.first);
+
+        if (options.incremental && prev) {
+            for (const auto& file : prev->files) {
+                if (!entry.files.count(file.first)) {
+                    ReportFileRemoved(FilePath(work.path, file.first), file.second);
+                }
+            }
+            std::set<std::string> present(subdirs.begin(), subdirs.end());
+            for (const auto& sub : prev->subdirs) {
+                if (!present.count(sub)) ReportRemovedTree(root, (fs::path(work.path) / sub).string());
+            }
+        }
+
+        // The entry must exist before its files are probed
+        {
+            std::lock_guard<std::mutex> lock(root.mutex);
+            root.tree[work.path] = std::move(entry);
+        }
+        for (const auto& sub : subdirs) {
+            Push(self, { (fs::path(work.path) / sub).string(), {}, work.root, true });
+        }
+        PushFiles(self, work, names);
+    }
+
+    static bool WiiUFolderListing(const std::vector<std::string>& subdirs) {
+        auto has = [&](const char* name) { return std::find(subdirs.begin(), subdirs.end(), name) != subdirs.end(); };
+        return has("code") && has("content") && has("meta");
+    }
+
+    // A Wii U title folder is one title, recorded as the directory's only
+    // file under the empty name. Its subdirectories are never listed:
+    // meta.xml names the game and the fingerprint cache remembers the size
+    // of content/, which can hold thousands of files.
+    void ProbeTitleFolder(ScanRoot& root, const std::string& dir, const FileKey& dir_key, const DirEntry* prev) {
+        const FileEntry* prev_title = nullptr;
+        if (prev) {
+            auto it = prev->files.find(std::string());
+            if (it != prev->files.end()) prev_title = &it->second;
+        }
+        // The folder used to be an ordinary directory: whatever it held is
+        // now part of the title
+        if (options.incremental && prev && !prev_title) {
+            for (const auto& file : prev->files) ReportFileRemoved(FilePath(dir, file.first), file.second);
+            for (const auto& sub : prev->subdirs) ReportRemovedTree(root, (fs::path(dir) / sub).string());
+        }
+
+        FileEntry title;
+        FileKey key;
+        title.identified = FingerprintCache::Shared().IdentifyFolder(dir, &title.identity, &key);
+        title.size = key.size;
+        title.mtime_ns = key.mtime_ns;
+
+        if (prev_title && prev_title->size == title.size && prev_title->mtime_ns == title.mtime_ns &&
+            prev_title->identified == title.identified) {
+            if (title.identified) unchanged.fetch_add(1);
+        } else if (!options.incremental) {
+            if (title.identified) Report(LibraryScanner::Change::Found, dir, &title.identity);
+        } else if (title.identified) {
+            Report(prev_title && prev_title->identified ? LibraryScanner::Change::Changed : LibraryScanner::Change::Added,
+                   dir, &title.identity);
+        } else if (prev_title && prev_title->identified) {
+            Report(LibraryScanner::Change::Removed, dir, &prev_title->identity);
+        }
+
+        DirEntry entry;
+        entry.mtime_ns = dir_key.mtime_ns;
+        entry.files.emplace(std::string(), std::move(title));
+        {
+            std::lock_guard<std::mutex> lock(root.mutex);
+            root.tree[dir] = std::move(entry);
+        }
+        files.fetch_add(1);
+    }
+
+    void PushFiles(size_t self, const ScanWork& dir, const std::vector<std::string>& names) {
+        for (size_t begin = 0; begin < names.size(); begin += SCAN_PROBE_BATCH) {
+            size_t end = (std::min)(names.size(), begin + SCAN_PROBE_BATCH);
+            Push(self, { dir.path, std::vector<std::string>(names.begin() + begin, names.begin() + end), dir.root, false });
+        }
+    }
+
+    // Stat and header reads for the whole batch are issued together; files
+    // the snapshot or the fingerprint cache already answers are not read
+    void ProbeFiles(const ScanWork& work) {
+        ScanRoot& root = *roots[work.root];
+        FingerprintCache& cache = FingerprintCache::Shared();
+        size_t count = work.names.size();
+
+        std::vector<std::string> paths(count);
+        std::vector<const FileEntry*> prev(count, nullptr);
+        for (size_t i = 0; i < count; i++) {
+            paths[i] = FilePath(work.path, work.names[i]);
+            if (options.incremental) prev[i] = PreviousFile(root, work.path, work.names[i]);
+        }
+
+        std::vector<FingerprintRecord> cached(count);
+        std::vector<bool> from_cache(count, false);
+        std::vector<HeaderProber::Result> probed;
+        HeaderProber::Probe(paths, [&](size_t i, const FileKey& key) {
+            if (prev[i] && prev[i]->size == key.size && prev[i]->mtime_ns == key.mtime_ns) return false;
+            // Archives are never cached, but an older build may have cached one as "not a game"
+            from_cache[i] = !ArchiveFileName(paths[i]) && cache.Lookup(paths[i], key, &cached[i]) &&
+                            cached[i].identity_known;
+            return !from_cache[i];
+        }, &probed);
+
+        for (size_t i = 0; i < count; i++) {
+            const std::string& path = paths[i];
+            const std::string& name = work.names[i];
+            const HeaderProber::Result& result = probed[i];
+
+            if (!result.exists) {
+                // Deleted since it was listed (or since the snapshot)
+                if (prev[i]) ReportFileRemoved(path, *prev[i]);
+                std::lock_guard<std::mutex> lock(root.mutex);
+                root.tree[work.path].files.erase(name);
+                continue;
+            }
+
+            FileEntry entry;
+            if (prev[i] && prev[i]->size == result.key.size && prev[i]->mtime_ns == result.key.mtime_ns) {
+                entry = *prev[i];
+                if (entry.identified) unchanged.fetch_add(1);
+                unchanged.fetch_add(entry.members.size());
+            } else if (!from_cache[i] && !result.header_read) {
+                // EIO, a share timeout or a locked file: keep what was known
+                // without its key, so the file is not trusted until it is read
+                errors.fetch_add(1);
+                if (prev[i]) entry = *prev[i];
+                entry.size = result.key.size;
+                entry.mtime_ns = SCAN_UNREAD_MTIME_NS;
+            } else {
+                entry.size = result.key.size;
+                entry.mtime_ns = result.key.mtime_ns;
+                if (from_cache[i]) {
+                    entry.identified = cached[i].identified;
+                    entry.identity = cached[i].identity;
+                } else {
+                    entry.identified = identify_from_header(result.header, result.header_size, &entry.identity);
+                    ArchiveType archive =
+                        entry.identified ? ArchiveType::None : DetectArchive(result.header, result.header_size);
+                    if (archive != ArchiveType::None) {
+                        // Members live in the snapshot; the cache only describes whole files
+                        IdentifyArchiveMembers(path, archive, &entry.members);
+                    } else {
+                        // SNES and PlayStation signatures lie past the probed sector, and
+                        // compressed images (GCZ, CSO, CHD, ...) hide the disc header
+                        if (!entry.identified && (result.key.size >= IDENTIFY_DEEP_MIN_FILE_SIZE ||
+                                                  DetectContainer(result.header, result.header_size) != FORMAT_UNKNOWN)) {
+                            entry.identified = identify_from_file(path.c_str(), &entry.identity);
+                        }
+                        entry.identity.file_size = result.key.size;
+                        cache.StoreIdentity(path, result.key, &entry.identity, entry.identified);
+                    }
+                }
+                if (entry.identified && entry.identity.file_size == 0) entry.identity.file_size = result.key.size;
+
+                if (!options.incremental) {
+                    if (entry.identified) Report(LibraryScanner::Change::Found, path, &entry.identity);
+                } else if (entry.identified) {
+                    Report(prev[i] && prev[i]->identified ? LibraryScanner::Change::Changed : LibraryScanner::Change::Added,
+                           path, &entry.identity);
+                } else if (prev[i] && prev[i]->identified) {
+                    Report(LibraryScanner::Change::Removed, path, &prev[i]->identity);
+                }
+                ReportMembers(path, entry, prev[i]);
+            }
+
+            std::lock_guard<std::mutex> lock(root.mutex);
+            root.tree[work.path].files[name] = std::move(entry);
+        }
+
+        size_t before = files.fetch_add(count);
+        if (on_progress && before / SCAN_PROGRESS_INTERVAL != (before + count) / SCAN_PROGRESS_INTERVAL) {
+            on_progress(Snapshot());
+        }
+    }
+
+    const LibraryScanner::Options& options;
+    const LibraryScanner::ChangeFn& on_change;
+    const LibraryScanner::ProgressFn& on_progress;
+    const std::atomic<bool>* cancel;
+
+    std::vector<std::unique_ptr<ScanDeque>> queues;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> directories{0};
+    std::atomic<size_t> reused{0};
+    std::atomic<size_t> files{0};
+    std::atomic<size_t> found{0};
+    std::atomic<size_t> removed{0};
+    std::atomic<size_t> unchanged{0};
+    std::atomic<size_t> errors{0};
+};
+
+LibraryScanner::Stats LibraryScanner::Run(const std::vector<std::string>& roots, const Options& options,
+                                          const ChangeFn& on_change, const ProgressFn& on_progress,
+                                          const std::atomic<bool>* cancel) {
+    unsigned threads = options.threads;
+    if (threads == 0) {
+        unsigned cores = (std::max)(1u, std::thread::hardware_concurrency());
+        threads = (std::min)(SCAN_MAX_THREADS, (std::max)(SCAN_MIN_THREADS, cores * 2));
+    }
+
+    ScanState state(threads, options, on_change, on_progress, cancel);
+    std::set<std::string> seen;
+    for (const auto& path : roots) {
+        if (!seen.insert(path).second) continue;
+        size_t index = state.roots.size();
+        state.roots.push_back(std::make_unique<ScanRoot>());
+        ScanRoot& root = *state.roots.back();
+        root.path = path;
+
+        std::error_code ec;
+        fs::file_status status = fs::status(path, ec);
+        if (ec || !fs::exists(status)) {
+            state.Report(Change::RootUnavailable, path, nullptr);
+            continue;
+        }
+        root.available = true;
+        root.trust_mtime = DirectoryMtimeTrusted(path);
+        if (options.incremental) root.previous = ScanSnapshot::Shared().Get(path);
+
+        if (fs::is_directory(status)) {
+            state.Push(index, { path, {}, index, true });
+        } else {
+            root.tree[path].files[std::string()] = ScanSnapshot::FileEntry();
+            state.Push(index, { path, { std::string() }, index, false });
+        }
+    }
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++) pool.emplace_back([&state, i]() { state.Worker(i); });
+    for (auto& t : pool) t.join();
+
+    // A cancelled scan saw only part of each tree; keep the previous snapshot
+    if (!state.Cancelled()) {
+        for (auto& root : state.roots) {
+            if (root->available) ScanSnapshot::Shared().Put(root->path, std::move(root->tree));
+        }
+        ScanSnapshot::Shared().Save();
+    }
+    FingerprintCache::Shared().Save();
+    return state.Snapshot();
+}
+
+int LibraryScanner::Walk(const std::string& folder, bool recursive, const WalkFn& on_found, std::string* error) {
+    FingerprintCache& cache = FingerprintCache::Shared();
+    int found_count = 0;
+    auto visit_folder = [&](const fs::directory_entry& entry, bool* title_folder) {
+        *title_folder = false;
+        if (!entry.is_directory() || entry.is_symlink() || !IsWiiUTitleFolder(entry.path().string())) return true;
+        *title_folder = true;
+        std::string path = entry.path().string();
+        GameIdentity identity;
+        if (!cache.IdentifyFolder(path, &identity)) return true;
+        found_count++;
+        return on_found(entry.path(), path, identity);
+    };
+    auto visit = [&](const fs::directory_entry& entry) {
+        if (!entry.is_regular_file()) return true;
+        std::string path = entry.path().string();
+        GameIdentity identity;
+        if (cache.Identify(path, &identity)) {
+            found_count++;
+            return on_found(entry.path(), path, identity);
+        }
+        if (!ArchiveFileName(path)) return true;
+        std::vector<ArchiveMember> members;
+        IdentifyArchiveMembers(path, DetectArchiveFile(path), &members);
+        for (const auto& member : members) {
+            found_count++;
+            if (!on_found(entry.path(), ArchiveMemberPath(path, member.name), member.identity)) return false;
+        }
+        return true;
+    };
+
+    try {
+        // The folder picked may itself be a title
+        bool title_folder = false;
+        visit_folder(fs::directory_entry(folder), &title_folder);
+        if (!title_folder && recursive) {
+            for (fs::recursive_directory_iterator it(folder), end; it != end; ++it) {
+                if (!visit_folder(*it, &title_folder) || !visit(*it)) break;
+                if (title_folder) it.disable_recursion_pending();
+            }
+        } else if (!title_folder) {
+            for (const auto& entry : fs::directory_iterator(folder)) {
+                if (!visit_folder(entry, &title_folder) || !visit(entry)) break;
+            }
+        }
+    } catch (const std::exception& e) {
+        if (error) *error = e.what();
+    }
+
+    cache.Save();
+    return found_count;
+}
+
+const char* LibraryScanner::ChangeName(Change change) {
+    switch (change) {
+    case Change::Found: return "found";
+    case Change::Added: return "added";
+    case Change::Changed: return "changed";
+    case Change::Removed: return "removed";
+    default: return "root_unavailable";
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef FORGE_SCAN_H
+#define FORGE_SCAN_H
+
+#include "forge_archive.h"
+#include "platform_identifier.h"
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+// Directory tree of every scanned root as of its last complete scan:
+// per-directory mtime, per-file size/mtime and identification result.
+// An incremental scan trusts a directory whose mtime is unchanged (no
+// entries added, removed or renamed) without listing it again.
+class ScanSnapshot {
+public:
+    struct FileEntry {
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        bool identified = false;
+        GameIdentity identity = {};
+        std::vector<ArchiveMember> members;     // Games inside a zip/7z file
+    };
+
+    struct DirEntry {
+        int64_t mtime_ns = 0;
+        std::vector<std::string> subdirs;            // Names
+        std::map<std::string, FileEntry> files;      // By name
+    };
+
+    // Keyed by full directory path. A root that is a single file is stored
+    // as a directory entry under its own path holding one file named "".
+    using Tree = std::unordered_map<std::string, DirEntry>;
+
+    // Remember where snapshots are kept. The file is read on first use
+    // (missing file = nothing scanned yet), so startup does not pay for it.
+    bool Open(const std::string& snapshot_path);
+    // Write back if any root changed (atomic replace)
+    bool Save();
+    void Clear();
+
+    // Tree from the last complete scan of root, or null
+    std::shared_ptr<const Tree> Get(const std::string& root) const;
+    void Put(const std::string& root, Tree tree);
+
+    // Every identified title of every root: files and Wii U title folders by
+    // path, games inside archives by ArchiveMemberPath
+    void ForEachTitle(const std::function<void(const std::string& path, const GameIdentity& identity)>& fn) const;
+
+    static ScanSnapshot& Shared();
+
+private:
+    void Load() const;
+
+    mutable std::mutex mutex;
+    std::string snapshot_path;
+    mutable std::map<std::string, std::shared_ptr<const Tree>> roots;
+    mutable bool dirty = false;
+    mutable bool loaded = true;
+};
+
+// Parallel library scanner. Directories and files are work items in
+// per-thread deques: a thread expands/probes from the back of its own deque
+// (depth-first, good locality) and steals from the front of others when it
+// runs dry, so one huge folder does not leave the other threads idle.
+// Identification goes through the fingerprint cache. Games inside zip and 7z
+// files are reported one per member, under ArchiveMemberPath(archive, name).
+class LibraryScanner {
+public:
+    struct Options {
+        bool incremental = false;   // Diff against the snapshot instead of reporting everything
+        unsigned threads = 0;       // 0 = pick from the core count
+    };
+
+    enum class Change {
+        Found,              // Full scan: every identified title
+        Added,              // Incremental scan: new title
+        Changed,            // Incremental scan: title file rewritten
+        Removed,            // Incremental scan: title gone (identity is the last known one)
+        RootUnavailable,    // Root missing (drive unplugged); its snapshot is kept
+    };
+
+    struct Stats {
+        size_t directories = 0;     // Directories listed
+        size_t reused = 0;          // Directories taken from the snapshot without listing
+        size_t files = 0;           // Files examined (stat or identify)
+        size_t found = 0;           // Found + Added + Changed
+        size_t removed = 0;
+        size_t unchanged = 0;       // Identified titles an incremental scan did not report
+        size_t errors = 0;          // Directories that could not be listed, files that could not be read
+        bool cancelled = false;
+    };
+
+    // Both are called from worker threads. identity is null for RootUnavailable.
+    using ChangeFn = std::function<void(Change change, const std::string& path, const GameIdentity* identity)>;
+    using ProgressFn = std::function<void(const Stats& stats)>;
+
+    // Roots may be directories (scanned recursively) or single files.
+    // Blocks until the scan finishes or cancel is set; the snapshot of each
+    // root is only replaced when its scan completed.
+    static Stats Run(const std::vector<std::string>& roots, const Options& options,
+                     const ChangeFn& on_change, const ProgressFn& on_progress = nullptr,
+                     const std::atomic<bool>* cancel = nullptr);
+
+    static const char* ChangeName(Change change);
+
+    // entry is the file or title folder; path is its string form, or
+    // ArchiveMemberPath(archive, name) for a game inside an archive
+    using WalkFn = std::function<bool(const std::filesystem::path& entry, const std::string& path,
+                                      const GameIdentity& identity)>;
+
+    // Serial walk without a snapshot: every recognised game under folder
+    // (one level unless recursive) until on_found returns false. Unchanged
+    // files are answered from the fingerprint cache without being opened;
+    // games inside zip/7z files are reported once per member, under
+    // ArchiveMemberPath like LibraryScanner::Run. A Wii U title folder is one game and is not descended
+    // into. error, if given, receives the reason a listing failed part-way.
+    static int Walk(const std::string& folder, bool recursive, const WalkFn& on_found, std::string* error = nullptr);
+};
+
+#endif // FORGE_SCAN_H
@@ -0,0 +1,460 @@
+#include "forge_watch.h"
+#include "forge_cache.h"
+#include "forge_wiiu.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <unordered_set>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+LibraryWatcher::~LibraryWatcher() {
+    Stop();
+}
+
+const char* LibraryWatcher::ModeName(Mode mode) {
+    return mode == Mode::Inotify ? "inotify" : "polling";
+}
+
+bool LibraryWatcher::Start(const std::vector<std::string>& watch_roots, const LibraryScanner::ChangeFn& callback,
+                           unsigned interval_ms) {
+    if (running.load() || watch_roots.empty()) return false;
+    if (thread.joinable()) thread.join();
+
+    roots = watch_roots;
+    on_change = callback;
+    poll_interval_ms = interval_ms ? interval_ms : DEFAULT_POLL_INTERVAL_MS;
+    stop.store(false);
+    snapshot_stale.store(false);
+#if defined(__linux__)
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+    running.store(true);
+    thread = std::thread([this]() { Run(); });
+    return true;
+}
+
+void LibraryWatcher::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        stop.store(true);
+    }
+    wake.notify_all();
+#if defined(__linux__)
+    if (wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+#endif
+    if (thread.joinable()) thread.join();
+#if defined(__linux__)
+    if (wake_fd >= 0) close(wake_fd);
+    wake_fd = -1;
+#endif
+}
+
+static bool SameIdentity(const GameIdentity& a, const GameIdentity& b) {
+    return a.platform == b.platform && a.format == b.format && a.region == b.region &&
+           a.disc_number == b.disc_number && a.file_size == b.file_size &&
+           a.is_scrubbed == b.is_scrubbed && a.requires_cios == b.requires_cios &&
+           strncmp(a.title_id, b.title_id, sizeof(a.title_id)) == 0 &&
+           strncmp(a.game_title, b.game_title, sizeof(a.game_title)) == 0;
+}
+
+void LibraryWatcher::Deliver(LibraryScanner::Change change, const std::string& path, const GameIdentity* identity) {
+    using Change = LibraryScanner::Change;
+    std::unique_lock<std::mutex> lock(titles_mutex);
+    auto known = titles.find(path);
+
+    if (change == Change::Removed) {
+        if (known == titles.end()) {
+            // An archive holds no title itself, only its members
+            lock.unlock();
+            if (!SplitArchiveMemberPath(path, nullptr, nullptr)) DeliverArchive(path, {});
+            return;
+        }
+        GameIdentity last = known->second;
+        titles.erase(known);
+        lock.unlock();
+        snapshot_stale.store(true);
+        if (on_change) on_change(Change::Removed, path, &last);
+        return;
+    }
+    if (change == Change::RootUnavailable || !identity) {
+        lock.unlock();
+        if (on_change) on_change(change, path, identity);
+        return;
+    }
+
+    // Events and rescans overlap; only report what actually differs
+    if (known != titles.end() && SameIdentity(known->second, *identity)) return;
+    Change reported = known != titles.end() ? Change::Changed : Change::Added;
+    titles[path] = *identity;
+    lock.unlock();
+    snapshot_stale.store(true);
+    if (on_change) on_change(reported, path, identity);
+}
+
+// The file at path is now an archive holding members: report them, and drop
+// the members it no longer holds (or the title the file itself used to be)
+void LibraryWatcher::DeliverArchive(const std::string& path, const std::vector<ArchiveMember>& members) {
+    std::string prefix = ArchiveMemberPath(path, std::string());
+    std::vector<std::string> gone;
+    {
+        std::lock_guard<std::mutex> lock(titles_mutex);
+        if (titles.count(path)) gone.push_back(path);
+        for (const auto& title : titles) {
+            if (title.first.compare(0, prefix.size(), prefix) != 0) continue;
+            bool kept = false;
+            for (const auto& member : members) {
+                kept = kept || title.first.compare(prefix.size(), std::string::npos, member.name) == 0;
+            }
+            if (!kept) gone.push_back(title.first);
+        }
+    }
+    for (const auto& member : members) Deliver(LibraryScanner::Change::Added, prefix + member.name, &member.identity);
+    for (const auto& title : gone) Deliver(LibraryScanner::Change::Removed, title, nullptr);
+}
+
+// The folder at dir is now a Wii U title (or, with no identity, no longer
+// one): report it, and drop the titles found inside it as ordinary files
+void LibraryWatcher::DeliverTitleFolder(const std::string& dir, const GameIdentity* identity) {
+    std::string prefix = (fs::path(dir) / "").string();
+    std::vector<std::string> gone;
+    {
+        std::lock_guard<std::mutex> lock(titles_mutex);
+        for (const auto& title : titles) {
+            if (title.first.compare(0, prefix.size(), prefix) == 0) gone.push_back(title.first);
+        }
+    }
+    Deliver(identity ? LibraryScanner::Change::Added : LibraryScanner::Change::Removed, dir, identity);
+    for (const auto& path : gone) Deliver(LibraryScanner::Change::Removed, path, nullptr);
+}
+
+// A directory was deleted or moved away: every title below it is gone, and
+// so is the directory itself if it was a title folder
+void LibraryWatcher::RemoveUnder(const std::string& dir) {
+    std::string prefix = (fs::path(dir) / "").string();
+    std::vector<std::string> gone;
+    {
+        std::lock_guard<std::mutex> lock(titles_mutex);
+        for (const auto& title : titles) {
+            if (title.first == dir || title.first.compare(0, prefix.size(), prefix) == 0) gone.push_back(title.first);
+        }
+    }
+    for (const auto& path : gone) Deliver(LibraryScanner::Change::Removed, path, nullptr);
+}
+
+bool LibraryWatcher::Known(const std::string& path) {
+    std::lock_guard<std::mutex> lock(titles_mutex);
+    return titles.count(path) != 0;
+}
+
+// Known titles are whatever the last complete scan left in the snapshot
+void LibraryWatcher::Seed() {
+    std::lock_guard<std::mutex> lock(titles_mutex);
+    titles.clear();
+    for (const auto& root : roots) {
+        std::shared_ptr<const ScanSnapshot::Tree> tree = ScanSnapshot::Shared().Get(root);
+        if (!tree) continue;
+        for (const auto& dir : *tree) {
+            for (const auto& file : dir.second.files) {
+                // A root that is a single file is stored under its own path with name ""
+                std::string path = file.first.empty() ? dir.first : (fs::path(dir.first) / file.first).string();
+                if (file.second.identified) titles[path] = file.second.identity;
+                for (const auto& member : file.second.members) {
+                    titles[ArchiveMemberPath(path, member.name)] = member.identity;
+                }
+            }
+        }
+    }
+}
+
+// Incremental scan of every root, reported through Deliver
+void LibraryWatcher::Rescan() {
+    LibraryScanner::Options options;
+    options.incremental = true;
+    LibraryScanner::Stats stats = LibraryScanner::Run(
+        roots, options,
+        [this](LibraryScanner::Change change, const std::string& path, const GameIdentity* identity) {
+            Deliver(change, path, identity);
+        },
+        nullptr, &stop);
+    // The scan wrote a fresh snapshot unless it was interrupted
+    if (!stats.cancelled) snapshot_stale.store(false);
+}
+
+bool LibraryWatcher::WaitForStop(unsigned ms) {
+    std::unique_lock<std::mutex> lock(wait_mutex);
+    return wake.wait_for(lock, std::chrono::milliseconds(ms), [this]() { return stop.load(); });
+}
+
+void LibraryWatcher::Poll() {
+    mode.store(Mode::Polling);
+    while (!WaitForStop(poll_interval_ms)) Rescan();
+}
+
+#if defined(__linux__)
+
+// ============================================================================
+// inotify
+// ============================================================================
+
+static constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE |
+                                       IN_DELETE_SELF | IN_ONLYDIR;
+static constexpr size_t WATCH_BUFFER_SIZE = 64 * 1024;
+// Quiet time after the last change before the snapshot is brought up to date
+static constexpr int SNAPSHOT_REFRESH_DELAY_MS = 30000;
+
+class InotifySession {
+public:
+    InotifySession(LibraryWatcher& watcher, const std::vector<std::string>& roots, int wake_fd)
+        : watcher(watcher), roots(roots), wake_fd(wake_fd) {}
+
+    ~InotifySession() {
+        if (fd >= 0) close(fd);
+    }
+
+    // Every directory under every root gets a watch; false if inotify is
+    // unavailable or the per-user watch limit is too low for the library
+    bool Init() {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return false;
+        for (std::string root : roots) {
+            while (root.size() > 1 && root.back() == '/') root.pop_back();
+            root_dirs.insert(root);
+        }
+        for (const auto& root : roots) {
+            std::error_code ec;
+            if (fs::is_directory(root, ec) && !AddTree(root)) return false;
+        }
+        return true;
+    }
+
+    // Returns false when watching can no longer be exact (watch limit hit
+    // for a new directory, or the descriptor failed). Once changes have
+    // been quiet for a while, rescan also refreshes the scan snapshot, so
+    // the next startup scan does not report them again.
+    bool Loop(const std::atomic<bool>& stop, const std::function<void()>& rescan) {
+        std::vector<char> buffer(WATCH_BUFFER_SIZE);
+        pollfd fds[2] = { { fd, POLLIN, 0 }, { wake_fd, POLLIN, 0 } };
+        while (!stop.load()) {
+            int timeout = watcher.snapshot_stale.load() ? SNAPSHOT_REFRESH_DELAY_MS : -1;
+            int ready = poll(fds, wake_fd >= 0 ? 2 : 1, timeout);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (ready == 0) {
+                rescan();
+                continue;
+            }
+            if (wake_fd >= 0 && (fds[1].revents & POLLIN)) break;
+
+            ssize_t length;
+            while ((length = read(fd, buffer.data(), buffer.size())) > 0) {
+                for (char* p = buffer.data(); p < buffer.data() + length;) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                    p += sizeof(inotify_event) + event->len;
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        // Events were dropped: the incremental scan finds what we missed
+                        rescan();
+                        continue;
+                    }
+                    if (!Handle(event)) return false;
+                }
+            }
+            // A copy into a title folder closes many files in one burst;
+            // the folder is identified once for all of them
+            for (const auto& dir : pending_titles) IdentifyTitle(dir);
+            pending_titles.clear();
+        }
+        return true;
+    }
+
+private:
+    bool AddTree(const std::string& dir) {
+        if (!AddWatch(dir)) return false;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            std::error_code entry_ec;
+            if (it->is_symlink(entry_ec)) {
+                if (it->is_directory(entry_ec)) it.disable_recursion_pending();
+                continue;
+            }
+            if (it->is_directory(entry_ec) && !AddWatch(it->path().string())) return false;
+        }
+        return true;
+    }
+
+    bool AddWatch(const std::string& dir) {
+        int wd = inotify_add_watch(fd, dir.c_str(), WATCH_MASK);
+        if (wd < 0) return errno != ENOSPC;   // Vanished or unreadable directories are skipped
+        watches[wd] = dir;
+        return true;
+    }
+
+    void RemoveWatches(const std::string& dir) {
+        std::string prefix = dir + "/";
+        for (auto it = watches.begin(); it != watches.end();) {
+            if (it->second == dir || it->second.compare(0, prefix.size(), prefix) == 0) {
+                inotify_rm_watch(fd, it->first);
+                it = watches.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void IdentifyFile(const std::string& path) {
+        GameIdentity identity;
+        memset(&identity, 0, sizeof(identity));
+        if (FingerprintCache::Shared().Identify(path, &identity)) {
+            FileKey key;
+            if (identity.file_size == 0 && StatFileKey(path, &key)) identity.file_size = key.size;
+            watcher.Deliver(LibraryScanner::Change::Added, path, &identity);
+        } else if (ArchiveFileName(path)) {
+            std::vector<ArchiveMember> members;
+            IdentifyArchiveMembers(path, DetectArchiveFile(path), &members);
+            watcher.DeliverArchive(path, members);
+        } else {
+            // Overwritten with something that is not a game
+            watcher.Deliver(LibraryScanner::Change::Removed, path, nullptr);
+        }
+    }
+
+    // A title folder is one title; its files are never identified one by
+    // one. Something inside it changed, so the cached record is re-read. A
+    // folder that stopped being a title is usually being deleted; whatever
+    // ordinary files it still holds are found by the next snapshot refresh.
+    void IdentifyTitle(const std::string& dir) {
+        GameIdentity identity;
+        memset(&identity, 0, sizeof(identity));
+        bool identified = FingerprintCache::Shared().RefreshFolder(dir, &identity);
+        watcher.DeliverTitleFolder(dir, identified ? &identity : nullptr);
+    }
+
+    void IdentifyTree(const std::string& dir) {
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            std::error_code entry_ec;
+            std::string path = it->path().string();
+            if (it->is_directory(entry_ec) && !it->is_symlink(entry_ec) && IsWiiUTitleFolder(path)) {
+                it.disable_recursion_pending();
+                IdentifyTitle(path);
+            } else if (it->is_regular_file(entry_ec)) {
+                IdentifyFile(path);
+            }
+        }
+    }
+
+    // The title folder path lies in: the nearest folder above it, up to its
+    // root, that is a Wii U title now or was one when last identified
+    std::string EnclosingTitleFolder(const std::string& path) {
+        for (fs::path dir = fs::path(path).parent_path(); dir.has_relative_path(); dir = dir.parent_path()) {
+            std::string candidate = dir.string();
+            if (watcher.Known(candidate) || IsWiiUTitleFolder(candidate)) return candidate;
+            if (root_dirs.count(candidate)) break;
+        }
+        return std::string();
+    }
+
+    bool Handle(const inotify_event* event) {
+        if (event->mask & IN_IGNORED) {
+            watches.erase(event->wd);
+            return true;
+        }
+        auto watch = watches.find(event->wd);
+        if (watch == watches.end()) return true;
+
+        if (event->mask & IN_DELETE_SELF) {
+            for (const auto& root : roots) {
+                if (root == watch->second) {
+                    watcher.Deliver(LibraryScanner::Change::RootUnavailable, root, nullptr);
+                }
+            }
+            return true;
+        }
+        if (event->len == 0) return true;
+        std::string path = watch->second + "/" + event->name;
+
+        // Anything written or removed inside a title folder changes the title
+        std::string title = EnclosingTitleFolder(path);
+
+        if (event->mask & IN_ISDIR) {
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                // Files may have landed before the watch existed
+                if (!AddTree(path)) return false;
+                if (!title.empty()) pending_titles.insert(title);
+                else if (IsWiiUTitleFolder(path)) pending_titles.insert(path);
+                else IdentifyTree(path);
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                RemoveWatches(path);
+                watcher.RemoveUnder(path);
+                if (!title.empty()) pending_titles.insert(title);
+            }
+            return true;
+        }
+
+        if (!title.empty()) {
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM)) pending_titles.insert(title);
+            return true;
+        }
+        // IN_CREATE alone is a file still being written; wait for IN_CLOSE_WRITE
+        if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) IdentifyFile(path);
+        else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) watcher.Deliver(LibraryScanner::Change::Removed, path, nullptr);
+        return true;
+    }
+
+    LibraryWatcher& watcher;
+    const std::vector<std::string>& roots;
+    int wake_fd;
+    int fd = -1;
+    std::unordered_map<int, std::string> watches;
+    std::unordered_set<std::string> root_dirs;      // Roots without a trailing '/'
+    std::set<std::string> pending_titles;           // Title folders to identify after this read
+};
+
+#endif
+
+void LibraryWatcher::Run() {
+    Seed();
+#if defined(__linux__)
+    // Watches go in before the catch-up scan so nothing slips between the two
+    auto session = std::make_unique<InotifySession>(*this, roots, wake_fd);
+    bool watching = session->Init();
+    if (!watching) session.reset();
+    Rescan();
+    if (watching) {
+        mode.store(Mode::Inotify);
+        // A new directory that cannot be watched drops us to polling
+        if (!session->Loop(stop, [this]() { Rescan(); }) && !stop.load()) {
+            session.reset();
+            Poll();
+        }
+    } else {
+        Poll();
+    }
+#else
+    Rescan();
+    Poll();
+#endif
+
+    // No scan on the way out: stopping must not wait on a walk of every
+    // root. The snapshot is refreshed while watching instead; changes from
+    // the last few seconds are reported again by the next startup scan.
+    running.store(false);
+}
@@ -0,0 +1,69 @@
+#ifndef FORGE_WATCH_H
+#define FORGE_WATCH_H
+
+#include "forge_scan.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Keeps library roots in sync after the initial scan. On Linux, inotify
+// reports files as they finish writing (IN_CLOSE_WRITE) or are renamed into
+// place, and only those files are identified. Elsewhere, or when the inotify
+// watch limit is reached, roots are re-scanned incrementally on an interval.
+// A Wii U title folder is one title keyed by the folder, as in the scanner.
+class LibraryWatcher {
+public:
+    enum class Mode { Inotify, Polling };
+
+    static constexpr unsigned DEFAULT_POLL_INTERVAL_MS = 60000;
+
+    ~LibraryWatcher();
+
+    // Report changes made since the last scan, then keep reporting until
+    // Stop(). Added/Changed/Removed only fire when the title actually
+    // changed. on_change is called from background threads.
+    bool Start(const std::vector<std::string>& roots, const LibraryScanner::ChangeFn& on_change,
+               unsigned poll_interval_ms = DEFAULT_POLL_INTERVAL_MS);
+    void Stop();
+
+    bool Running() const { return running.load(); }
+    Mode ActiveMode() const { return mode.load(); }
+    static const char* ModeName(Mode mode);
+
+private:
+    friend class InotifySession;
+
+    // Route a change through the known-title set, dropping no-ops
+    void Deliver(LibraryScanner::Change change, const std::string& path, const GameIdentity* identity);
+    void DeliverArchive(const std::string& path, const std::vector<ArchiveMember>& members);
+    void DeliverTitleFolder(const std::string& dir, const GameIdentity* identity);
+    void RemoveUnder(const std::string& dir);
+    bool Known(const std::string& path);
+    void Run();
+    void Seed();
+    void Rescan();
+    void Poll();
+    bool WaitForStop(unsigned ms);
+
+    std::vector<std::string> roots;
+    LibraryScanner::ChangeFn on_change;
+    unsigned poll_interval_ms = DEFAULT_POLL_INTERVAL_MS;
+
+    std::thread thread;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> running{false};
+    std::atomic<Mode> mode{Mode::Polling};
+    std::atomic<bool> snapshot_stale{false};
+    std::mutex wait_mutex;
+    std::condition_variable wake;
+    int wake_fd = -1;
+
+    std::mutex titles_mutex;
+    std::unordered_map<std::string, GameIdentity> titles;
+};
+
+#endif // FORGE_WATCH_H
@@ -0,0 +1,276 @@
+#include "forge_wii.h"
+#include "forge_aes.h"
+#include "forge_io.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+static constexpr size_t WII_GROUP_SIZE = WII_CLUSTER_SIZE * WII_GROUP_CLUSTERS;
+static constexpr size_t WII_H3_ENTRIES = WII_H3_SIZE / 20;
+static constexpr size_t WII_PARTITION_HEADER_SIZE = 0x2C0;
+static constexpr size_t WII_DISC_TABLE_SPAN = 0x50000;
+static constexpr unsigned WII_COMMON_KEY_COUNT = 3;
+
+static uint32_t ReadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static std::mutex g_keys_mutex;
+static std::array<std::array<uint8_t, 16>, WII_COMMON_KEY_COUNT> g_common_keys;
+static bool g_common_key_set[WII_COMMON_KEY_COUNT] = {};
+
+bool WiiHashTreeVerifier::SetCommonKey(unsigned index, const uint8_t key[16]) {
+    if (index >= WII_COMMON_KEY_COUNT || !key) return false;
+    std::lock_guard<std::mutex> lock(g_keys_mutex);
+    memcpy(g_common_keys[index].data(), key, 16);
+    g_common_key_set[index] = true;
+    return true;
+}
+
+bool WiiHashTreeVerifier::HasCommonKey(unsigned index) {
+    if (index >= WII_COMMON_KEY_COUNT) return false;
+    std::lock_guard<std::mutex> lock(g_keys_mutex);
+    return g_common_key_set[index];
+}
+
+static bool GetCommonKey(unsigned index, uint8_t key[16]) {
+    if (index >= WII_COMMON_KEY_COUNT) return false;
+    std::lock_guard<std::mutex> lock(g_keys_mutex);
+    if (!g_common_key_set[index]) return false;
+    memcpy(key, g_common_keys[index].data(), 16);
+    return true;
+}
+
+static bool Sha1Equals(const uint8_t* data, size_t size, const uint8_t* expected) {
+    Sha1 sha1;
+    sha1.Update(data, size);
+    std::array<uint8_t, 20> digest = sha1.Final();
+    return memcmp(digest.data(), expected, 20) == 0;
+}
+
+// ============================================================================
+// WiiPartition
+// ============================================================================
+
+bool WiiPartition::Open(const RandomAccessFile& file, const PartitionStripper::PartitionInfo& info,
+                        std::string* error) {
+    auto fail = [error](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    uint8_t header[WII_PARTITION_HEADER_SIZE];
+    if (!file.ReadExact(info.offset, header, sizeof(header))) return fail("Partition header unreadable");
+
+    // Ticket: encrypted title key at 0x1BF, title ID (IV) at 0x1DC, key index at 0x1F1
+    unsigned key_index = header[0x1F1];
+    uint8_t common_key[16];
+    if (!GetCommonKey(key_index, common_key)) {
+        return fail("Wii common key " + std::to_string(key_index) + " not set");
+    }
+    uint8_t iv[16] = {};
+    memcpy(iv, header + 0x1DC, 8);
+    uint8_t title_key[16];
+    Aes128Decryptor(common_key).DecryptCbc(iv, header + 0x1BF, title_key, 16);
+    aes.SetKey(title_key);
+
+    uint32_t tmd_size = ReadBE32(header + 0x2A4);
+    uint64_t tmd_offset = (uint64_t)ReadBE32(header + 0x2A8) << 2;
+    uint64_t h3_offset = (uint64_t)ReadBE32(header + 0x2B4) << 2;
+    uint64_t data_start = (uint64_t)ReadBE32(header + 0x2B8) << 2;
+    data_size = (uint64_t)ReadBE32(header + 0x2BC) << 2;
+
+    // The first content record's SHA-1 (TMD + 0x1F4) covers the H3 table
+    if (tmd_size < 0x208 || tmd_size > 0x10000) return fail("TMD unreadable");
+    std::vector<uint8_t> tmd(tmd_size);
+    if (!file.ReadExact(info.offset + tmd_offset, tmd.data(), tmd.size())) return fail("TMD unreadable");
+    h3.resize(WII_H3_SIZE);
+    if (!file.ReadExact(info.offset + h3_offset, h3.data(), h3.size())) return fail("H3 table unreadable");
+    h3_ok = Sha1Equals(h3.data(), WII_H3_SIZE, tmd.data() + 0x1F4);
+
+    data_offset = info.offset + data_start;
+    cluster_count = (std::min)(data_size / WII_CLUSTER_SIZE, (uint64_t)WII_H3_ENTRIES * WII_GROUP_CLUSTERS);
+    return true;
+}
+
+uint8_t WiiPartition::CheckCluster(uint64_t cluster, const uint8_t* encrypted, uint8_t* payload) const {
+    static const uint8_t zero_iv[16] = {};
+    uint8_t hashes[WII_CLUSTER_HASH_SIZE];
+    uint8_t local[WII_CLUSTER_DATA_SIZE];
+    uint8_t* data = payload ? payload : local;
+
+    aes.DecryptCbc(zero_iv, encrypted, hashes, WII_CLUSTER_HASH_SIZE);
+    // The payload IV is taken from the still-encrypted hash block
+    aes.DecryptCbc(encrypted + 0x3D0, encrypted + WII_CLUSTER_HASH_SIZE, data, WII_CLUSTER_DATA_SIZE);
+
+    uint8_t flags = WII_CLUSTER_OK;
+    for (size_t i = 0; i < WII_CLUSTER_DATA_SIZE / 0x400; i++) {
+        if (!Sha1Equals(data + i * 0x400, 0x400, hashes + i * 20)) {
+            flags |= WII_CLUSTER_H0_MISMATCH;
+            break;
+        }
+    }
+
+    const uint8_t* h1 = hashes + 0x280;
+    const uint8_t* h2 = hashes + 0x340;
+    if (!Sha1Equals(hashes, 31 * 20, h1 + (cluster % 8) * 20)) flags |= WII_CLUSTER_H1_MISMATCH;
+    if (!Sha1Equals(h1, 8 * 20, h2 + ((cluster / 8) % 8) * 20)) flags |= WII_CLUSTER_H2_MISMATCH;
+    if (!Sha1Equals(h2, 8 * 20, h3.data() + (cluster / WII_GROUP_CLUSTERS) * 20)) flags |= WII_CLUSTER_H3_MISMATCH;
+    return flags;
+}
+
+// Worker: stream groups [first_group, end_group) and fill their damage entries.
+// Clusters that are never read keep WII_CLUSTER_UNREADABLE.
+static void VerifyGroups(const std::string& file_path, const WiiPartition& partition, uint8_t* damage,
+                         uint64_t first_group, uint64_t end_group, std::atomic<uint64_t>* bytes_done,
+                         const std::atomic<bool>* cancel) {
+    uint64_t cluster = first_group * WII_GROUP_CLUSTERS;
+    uint64_t end_cluster = (std::min)(end_group * WII_GROUP_CLUSTERS, partition.ClusterCount());
+    if (cluster >= end_cluster) return;
+
+    ReadAheadReader::Options options;
+    options.block_size = WII_GROUP_SIZE;
+    options.depth = 2;
+    options.offset = partition.DataOffset() + cluster * WII_CLUSTER_SIZE;
+    options.length = (end_cluster - cluster) * WII_CLUSTER_SIZE;
+    ReadAheadReader reader;
+    if (!reader.Open(file_path, options)) return;
+
+    const uint8_t* block;
+    size_t size;
+    while (cluster < end_cluster && reader.Next(&block, &size)) {
+        if (cancel && cancel->load()) break;
+        for (size_t pos = 0; pos + WII_CLUSTER_SIZE <= size && cluster < end_cluster; pos += WII_CLUSTER_SIZE) {
+            damage[cluster] = partition.CheckCluster(cluster, block + pos);
+            cluster++;
+        }
+        bytes_done->fetch_add(size);
+        // A short block means the image ends inside this range
+        if (size % WII_CLUSTER_SIZE != 0) break;
+    }
+}
+
+// ============================================================================
+// Verify
+// ============================================================================
+
+WiiVerifyReport WiiHashTreeVerifier::Verify(const std::string& file_path, unsigned threads,
+                                            const HashEngine::ProgressFn& progress,
+                                            const std::atomic<bool>* cancel) {
+    WiiVerifyReport report;
+
+    RandomAccessFile file;
+    std::vector<uint8_t> disc(WII_DISC_TABLE_SPAN);
+    size_t got = 0;
+    if (!file.Open(file_path) || !file.ReadAt(0, disc.data(), disc.size(), &got) || got < 0x40020 ||
+        ReadBE32(disc.data() + 0x18) != WII_DISC_MAGIC) {
+        report.error = "Not a raw Wii disc image";
+        return report;
+    }
+
+    std::vector<PartitionStripper::PartitionInfo> partitions =
+        PartitionStripper::AnalyzePartitions(disc.data(), got);
+    if (partitions.empty()) {
+        report.error = "No partitions found";
+        return report;
+    }
+
+    std::vector<WiiPartition> opened(partitions.size());
+    report.partitions.resize(partitions.size());
+    uint64_t total_bytes = 0;
+    for (size_t i = 0; i < partitions.size(); i++) {
+        WiiPartitionReport& part = report.partitions[i];
+        part.info = partitions[i];
+        std::string error;
+        if (!opened[i].Open(file, part.info, &error)) {
+            if (report.error.empty()) report.error = error;
+            continue;
+        }
+        part.header_ok = true;
+        part.h3_ok = opened[i].H3Ok();
+        part.info.size = opened[i].DataOffset() - part.info.offset + opened[i].DataSize();
+        part.damage.assign(opened[i].ClusterCount(), WII_CLUSTER_UNREADABLE);
+        total_bytes += opened[i].ClusterCount() * WII_CLUSTER_SIZE;
+    }
+
+    if (threads == 0) threads = (std::max)(1u, std::thread::hardware_concurrency());
+    std::atomic<uint64_t> bytes_done{0};
+
+    for (size_t i = 0; i < opened.size(); i++) {
+        WiiPartitionReport& part = report.partitions[i];
+        if (!part.header_ok) continue;
+        if (cancel && cancel->load()) break;
+        const WiiPartition& partition = opened[i];
+
+        // Contiguous group ranges per worker keep each reader sequential
+        uint64_t groups = (partition.ClusterCount() + WII_GROUP_CLUSTERS - 1) / WII_GROUP_CLUSTERS;
+        uint64_t workers = (std::min)((uint64_t)threads, groups);
+        if (workers == 0) continue;
+
+        std::mutex done_mutex;
+        std::condition_variable done_cv;
+        uint64_t finished = 0;
+        std::vector<std::thread> pool;
+        for (uint64_t w = 0; w < workers; w++) {
+            uint64_t first = groups * w / workers;
+            uint64_t end = groups * (w + 1) / workers;
+            pool.emplace_back([&, first, end]() {
+                VerifyGroups(file_path, partition, part.damage.data(), first, end, &bytes_done, cancel);
+                std::lock_guard<std::mutex> lock(done_mutex);
+                finished++;
+                done_cv.notify_one();
+            });
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            while (finished < workers) {
+                done_cv.wait_for(lock, std::chrono::milliseconds(100));
+                if (progress) {
+                    lock.unlock();
+                    progress(bytes_done.load(), total_bytes);
+                    lock.lock();
+                }
+            }
+        }
+        for (auto& t : pool) t.join();
+    }
+
+    for (auto& part : report.partitions) {
+        part.damaged_clusters = 0;
+        for (uint8_t flags : part.damage) {
+            if (flags != WII_CLUSTER_OK) part.damaged_clusters++;
+        }
+    }
+
+    if (cancel && cancel->load()) {
+        report.error = "Cancelled";
+        return report;
+    }
+    report.ok = report.error.empty();
+    return report;
+}
+
+uint64_t WiiVerifyReport::ClusterCount() const {
+    uint64_t count = 0;
+    for (const auto& part : partitions) count += part.damage.size();
+    return count;
+}
+
+uint64_t WiiVerifyReport::DamagedClusters() const {
+    uint64_t count = 0;
+    for (const auto& part : partitions) count += part.damaged_clusters;
+    return count;
+}
+
+bool WiiVerifyReport::Intact() const {
+    if (!ok) return false;
+    for (const auto& part : partitions) {
+        if (!part.header_ok || !part.h3_ok || part.damaged_clusters) return false;
+    }
+    return true;
+}
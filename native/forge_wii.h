@@ -0,0 +1,103 @@
+#ifndef FORGE_WII_H
+#define FORGE_WII_H
+
+#include "forge_aes.h"
+#include "forge_hash.h"
+#include "forge_logic.h"
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// ============================================================================
+// Wii partition layout
+//
+// Partition data is stored in 32 KiB clusters: a 0x400-byte hash block
+// followed by 0x7C00 bytes of payload, both AES-128-CBC encrypted with the
+// partition title key. The hash block holds
+//   H0[31]  SHA-1 of each 1 KiB payload block
+//   H1[8]   SHA-1 of the H0 table of each cluster in the subgroup (8 clusters)
+//   H2[8]   SHA-1 of the H1 table of each subgroup in the group (64 clusters)
+// and the partition's H3 table holds SHA-1 of each group's H2 table. The
+// TMD content hash is the SHA-1 of the whole H3 table.
+// ============================================================================
+
+constexpr size_t WII_CLUSTER_SIZE = 0x8000;
+constexpr size_t WII_CLUSTER_HASH_SIZE = 0x400;
+constexpr size_t WII_CLUSTER_DATA_SIZE = 0x7C00;
+constexpr size_t WII_GROUP_CLUSTERS = 64;
+constexpr size_t WII_H3_SIZE = 0x18000;
+constexpr uint32_t WII_DISC_MAGIC = 0x5D1C9EA3;
+
+// Per-cluster damage flags
+enum WiiClusterDamage : uint8_t {
+    WII_CLUSTER_OK = 0x00,
+    WII_CLUSTER_H0_MISMATCH = 0x01,   // A payload block does not match its H0 entry
+    WII_CLUSTER_H1_MISMATCH = 0x02,   // H0 table does not match H1
+    WII_CLUSTER_H2_MISMATCH = 0x04,   // H1 table does not match H2
+    WII_CLUSTER_H3_MISMATCH = 0x08,   // H2 table does not match the partition H3 table
+    WII_CLUSTER_UNREADABLE = 0x10,    // Past the end of the image or read error
+};
+
+struct WiiPartitionReport {
+    PartitionStripper::PartitionInfo info;
+    bool header_ok = false;           // Ticket, TMD and H3 table read, title key decrypted
+    bool h3_ok = false;               // H3 table matches the TMD content hash
+    uint64_t damaged_clusters = 0;
+    std::vector<uint8_t> damage;      // WiiClusterDamage flags, one per cluster
+};
+
+struct WiiVerifyReport {
+    bool ok = false;                  // Image parsed and every partition walked
+    std::string error;
+    std::vector<WiiPartitionReport> partitions;
+
+    uint64_t ClusterCount() const;
+    uint64_t DamagedClusters() const;
+    bool Intact() const;
+};
+
+class RandomAccessFile;
+
+// One partition opened for hash-tree checks: title key decrypted and the
+// H3 table loaded. Immutable after Open(), so workers can share it.
+class WiiPartition {
+public:
+    bool Open(const RandomAccessFile& file, const PartitionStripper::PartitionInfo& info,
+              std::string* error = nullptr);
+
+    uint64_t DataOffset() const { return data_offset; }   // Absolute offset of cluster 0
+    uint64_t DataSize() const { return data_size; }
+    uint64_t ClusterCount() const { return cluster_count; }
+    bool H3Ok() const { return h3_ok; }                    // H3 table matches the TMD
+
+    // Decrypt one WII_CLUSTER_SIZE block and check it against the tree.
+    // Returns WiiClusterDamage flags; payload (0x7C00 bytes) is optional.
+    uint8_t CheckCluster(uint64_t cluster, const uint8_t* encrypted, uint8_t* payload = nullptr) const;
+
+private:
+    Aes128Decryptor aes;
+    std::vector<uint8_t> h3;
+    uint64_t data_offset = 0;
+    uint64_t data_size = 0;
+    uint64_t cluster_count = 0;
+    bool h3_ok = false;
+};
+
+// Self-contained integrity check for raw Wii disc images: decrypts every
+// cluster and checks the H0-H3 hash tree against the TMD, spread across
+// worker threads. No external hash database is needed.
+class WiiHashTreeVerifier {
+public:
+    // The Wii common keys are not shipped; the frontend supplies them.
+    // index is the ticket's common key index (0 = retail, 1 = Korean, 2 = vWii).
+    static bool SetCommonKey(unsigned index, const uint8_t key[16]);
+    static bool HasCommonKey(unsigned index);
+
+    // threads = 0 uses every hardware thread
+    static WiiVerifyReport Verify(const std::string& file_path, unsigned threads = 0,
+                                  const HashEngine::ProgressFn& progress = nullptr,
+                                  const std::atomic<bool>* cancel = nullptr);
+};
+
+#endif // FORGE_WII_H
@@ -0,0 +1,145 @@
+#include "forge_wiiu.h"
+#include "forge_xml.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+static std::string Trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return std::string();
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+// Long names are laid out for the Wii U menu: "The Legend of Zelda\nBreath of the Wild"
+static std::string SingleLine(const std::string& s) {
+    std::string out;
+    for (char c : Trim(s)) {
+        if (c == '\r') continue;
+        if (c == '\n') {
+            if (!out.empty() && out.back() != ' ') out.push_back(' ');
+        } else {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+// longname_en wins; otherwise the first language that has the field
+static void TakeLocalized(const std::string& element, const char* field, const std::string& value,
+                          std::string* out, bool* english) {
+    size_t length = strlen(field);
+    if (element.compare(0, length, field) != 0 || element.size() <= length || element[length] != '_') return;
+    if (value.empty() || *english) return;
+    bool is_english = element.compare(length + 1, std::string::npos, "en") == 0;
+    if (is_english || out->empty()) *out = value;
+    *english = is_english;
+}
+
+bool IsWiiUTitleFolder(const std::string& folder) {
+    std::error_code ec;
+    fs::path root(folder);
+    return fs::is_directory(root / "code", ec) && fs::is_directory(root / "content", ec) &&
+           fs::is_regular_file(root / "meta" / "meta.xml", ec);
+}
+
+bool ReadWiiUMeta(const std::string& meta_path, WiiUTitleInfo* info) {
+    XmlStreamReader xml;
+    if (!xml.Open(meta_path)) return false;
+
+    WiiUTitleInfo local;
+    bool long_en = false, short_en = false, publisher_en = false;
+    bool in_menu = false;
+    while (true) {
+        XmlStreamReader::Event ev = xml.Next();
+        if (ev == XmlStreamReader::Event::End) break;
+        if (ev == XmlStreamReader::Event::Error) return false;
+        if (ev != XmlStreamReader::Event::StartElement) continue;
+
+        const std::string& name = xml.Name();
+        if (xml.Depth() == 1) {
+            in_menu = name == "menu";
+            if (!in_menu) return false;
+            continue;
+        }
+        // Every field is a direct child of <menu>
+        if (!in_menu || xml.Depth() != 2) continue;
+
+        std::string element = name;
+        std::string value = Trim(xml.ReadElementText());
+        if (element == "title_id") {
+            local.title_id = value;
+        } else if (element == "product_code") {
+            local.product_code = value;
+        } else if (element == "company_code") {
+            local.company_code = value;
+        } else if (element == "region") {
+            local.region_mask = (uint32_t)strtoul(value.c_str(), nullptr, 16);
+        } else if (element == "title_version") {
+            local.title_version = (uint32_t)strtoul(value.c_str(), nullptr, 10);
+        } else {
+            TakeLocalized(element, "longname", SingleLine(value), &local.long_name, &long_en);
+            TakeLocalized(element, "shortname", SingleLine(value), &local.short_name, &short_en);
+            TakeLocalized(element, "publisher", SingleLine(value), &local.publisher, &publisher_en);
+        }
+    }
+
+    if (local.title_id.empty() && local.product_code.empty()) return false;
+    *info = std::move(local);
+    return true;
+}
+
+bool ReadWiiUTitle(const std::string& folder, WiiUTitleInfo* info) {
+    if (!IsWiiUTitleFolder(folder)) return false;
+    WiiUTitleInfo local;
+    if (!ReadWiiUMeta((fs::path(folder) / "meta" / "meta.xml").string(), &local)) return false;
+
+    // One pass over content/; the listing already carries each file's size
+    // on Windows, and elsewhere costs one stat per file
+    std::error_code ec;
+    fs::recursive_directory_iterator it(fs::path(folder) / "content", fs::directory_options::skip_permission_denied, ec);
+    for (fs::recursive_directory_iterator end; !ec && it != end; it.increment(ec)) {
+        std::error_code entry_ec;
+        if (!it->is_regular_file(entry_ec)) continue;
+        uintmax_t size = it->file_size(entry_ec);
+        if (entry_ec) continue;
+        local.content_size += size;
+        local.content_files++;
+    }
+
+    *info = std::move(local);
+    return true;
+}
+
+void WiiUTitleToIdentity(const WiiUTitleInfo& info, GameIdentity* identity) {
+    memset(identity, 0, sizeof(*identity));
+    identity->platform = PLATFORM_WII_U;
+    identity->format = FORMAT_FOLDER;
+
+    // "WUP-P-ARPE" + company "0001" -> "ARPE01", as GameTDB lists Wii U titles
+    const std::string& product = info.product_code;
+    if (product.size() >= 10 && product.compare(0, 4, "WUP-") == 0 && product[5] == '-') {
+        std::string id = product.substr(6, 4);
+        if (info.company_code.size() >= 2) id += info.company_code.substr(info.company_code.size() - 2);
+        memcpy(identity->title_id, id.data(), (std::min)(id.size(), sizeof(identity->title_id) - 1));
+        identity->region = product[9];
+    } else if (info.region_mask & 2) {
+        identity->region = 'E';
+    } else if (info.region_mask & 4) {
+        identity->region = 'P';
+    } else if (info.region_mask & 1) {
+        identity->region = 'J';
+    }
+
+    const std::string& name = !info.long_name.empty() ? info.long_name : info.short_name;
+    if (!name.empty()) {
+        snprintf(identity->game_title, sizeof(identity->game_title), "%s", name.c_str());
+    } else {
+        snprintf(identity->game_title, sizeof(identity->game_title), "Wii U %s", info.title_id.c_str());
+    }
+    identity->file_size = info.content_size;
+}
@@ -0,0 +1,44 @@
+#ifndef FORGE_WIIU_H
+#define FORGE_WIIU_H
+
+#include "platform_identifier.h"
+#include <string>
+#include <stdint.h>
+
+// ============================================================================
+// Wii U title folders (the installable / Loadiine layout)
+//
+//   code/     app.xml, cos.xml, the RPX and its RPLs
+//   content/  game data, often thousands of files
+//   meta/     meta.xml, icons and boot images
+//
+// meta/meta.xml is stream-parsed for the title's IDs and names, and content/
+// is walked once to total its size. Nothing else in the folder is opened.
+// ============================================================================
+
+struct WiiUTitleInfo {
+    std::string title_id;         // 16 hex digits, e.g. "0005000010101D00"
+    std::string product_code;     // "WUP-P-ARPE"
+    std::string company_code;     // "0001"
+    std::string long_name;        // longname_en, else the first other language set
+    std::string short_name;       // shortname_en, likewise
+    std::string publisher;        // publisher_en, likewise
+    uint32_t region_mask = 0;     // 1 = JPN, 2 = USA, 4 = EUR
+    uint32_t title_version = 0;
+    uint64_t content_size = 0;    // Sum of every file under content/
+    uint64_t content_files = 0;
+};
+
+// code/ and content/ are directories and meta/meta.xml exists
+bool IsWiiUTitleFolder(const std::string& folder);
+
+// Parse a meta.xml; false if it cannot be read or names no product or title ID
+bool ReadWiiUMeta(const std::string& meta_path, WiiUTitleInfo* info);
+
+// Folder check, meta.xml and the content/ size pass
+bool ReadWiiUTitle(const std::string& folder, WiiUTitleInfo* info);
+
+// "ARPE01"-style ID (product code + maker), region letter, name and size
+void WiiUTitleToIdentity(const WiiUTitleInfo& info, GameIdentity* identity);
+
+#endif // FORGE_WIIU_H
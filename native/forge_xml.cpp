@@ -0,0 +1,262 @@
+#include "forge_xml.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+static constexpr size_t XML_BUFFER_SIZE = 64 * 1024;
+
+static bool IsSpace(int c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void AppendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back((char)cp);
+    } else if (cp < 0x800) {
+        out.push_back((char)(0xC0 | (cp >> 6)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back((char)(0xE0 | (cp >> 12)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x110000) {
+        out.push_back((char)(0xF0 | (cp >> 18)));
+        out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+XmlStreamReader::~XmlStreamReader() {
+    Close();
+}
+
+bool XmlStreamReader::Open(const std::string& file_path) {
+    Close();
+    file = fopen(file_path.c_str(), "rb");
+    if (!file) return false;
+    buffer.resize(XML_BUFFER_SIZE);
+    pos = len = 0;
+    depth = 0;
+    pending_end = false;
+    failed = false;
+
+    // Skip a UTF-8 byte order mark
+    if (Peek() == 0xEF) {
+        Get();
+        if (Get() != 0xBB || Get() != 0xBF) failed = true;
+    }
+    return !failed;
+}
+
+void XmlStreamReader::Close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    buffer.clear();
+    pos = len = 0;
+}
+
+int XmlStreamReader::Peek() {
+    if (pos >= len) {
+        if (!file) return EOF;
+        len = fread(buffer.data(), 1, buffer.size(), file);
+        pos = 0;
+        if (len == 0) return EOF;
+    }
+    return (unsigned char)buffer[pos];
+}
+
+int XmlStreamReader::Get() {
+    int c = Peek();
+    if (c != EOF) pos++;
+    return c;
+}
+
+bool XmlStreamReader::SkipUntil(const char* terminator) {
+    size_t term_len = strlen(terminator);
+    std::string window;
+    int c;
+    while ((c = Get()) != EOF) {
+        window.push_back((char)c);
+        if (window.size() > term_len) window.erase(0, 1);
+        if (window == terminator) return true;
+    }
+    return false;
+}
+
+void XmlStreamReader::DecodeEntity(std::string& out) {
+    // '&' has already been consumed
+    std::string entity;
+    int c;
+    while ((c = Peek()) != EOF && c != ';' && entity.size() < 10 && !IsSpace(c) && c != '<') {
+        entity.push_back((char)Get());
+    }
+    if (c != ';') {
+        out.push_back('&');
+        out += entity;
+        return;
+    }
+    Get();
+
+    if (entity == "amp") out.push_back('&');
+    else if (entity == "lt") out.push_back('<');
+    else if (entity == "gt") out.push_back('>');
+    else if (entity == "quot") out.push_back('"');
+    else if (entity == "apos") out.push_back('\'');
+    else if (entity.size() > 1 && entity[0] == '#') {
+        bool hex = entity[1] == 'x' || entity[1] == 'X';
+        uint32_t cp = (uint32_t)strtoul(entity.c_str() + (hex ? 2 : 1), nullptr, hex ? 16 : 10);
+        AppendUtf8(out, cp);
+    } else {
+        out.push_back('&');
+        out += entity;
+        out.push_back(';');
+    }
+}
+
+bool XmlStreamReader::ParseTag() {
+    // '<' has been consumed and the next character starts the element name
+    name.clear();
+    attributes.clear();
+    int c;
+    while ((c = Peek()) != EOF && !IsSpace(c) && c != '/' && c != '>') {
+        name.push_back((char)Get());
+    }
+    if (name.empty()) return false;
+
+    while (true) {
+        while (IsSpace(Peek())) Get();
+        c = Get();
+        if (c == EOF) return false;
+        if (c == '>') return true;
+        if (c == '/') {
+            if (Get() != '>') return false;
+            pending_end = true;
+            return true;
+        }
+
+        std::string attr_name(1, (char)c);
+        while ((c = Peek()) != EOF && !IsSpace(c) && c != '=' && c != '>' && c != '/') {
+            attr_name.push_back((char)Get());
+        }
+        while (IsSpace(Peek())) Get();
+        if (Get() != '=') return false;
+        while (IsSpace(Peek())) Get();
+        int quote = Get();
+        if (quote != '"' && quote != '\'') return false;
+
+        std::string value;
+        while ((c = Get()) != EOF && c != quote) {
+            if (c == '&') DecodeEntity(value);
+            else value.push_back((char)c);
+        }
+        if (c == EOF) return false;
+        attributes.emplace_back(std::move(attr_name), std::move(value));
+    }
+}
+
+XmlStreamReader::Event XmlStreamReader::Next() {
+    if (failed) return Event::Error;
+    if (pending_end) {
+        pending_end = false;
+        depth--;
+        return Event::EndElement;
+    }
+
+    text.clear();
+    while (true) {
+        int c = Peek();
+        if (c == EOF) return Event::End;
+
+        if (c != '<') {
+            bool whitespace_only = true;
+            while ((c = Peek()) != EOF && c != '<') {
+                Get();
+                if (c == '&') {
+                    DecodeEntity(text);
+                    whitespace_only = false;
+                } else {
+                    text.push_back((char)c);
+                    if (!IsSpace(c)) whitespace_only = false;
+                }
+            }
+            if (!whitespace_only) return Event::Text;
+            text.clear();
+            continue;
+        }
+
+        Get(); // '<'
+        c = Peek();
+        if (c == '?') {
+            if (!SkipUntil("?>")) break;
+            continue;
+        }
+        if (c == '!') {
+            Get();
+            if (Peek() == '-') {
+                if (!SkipUntil("-->")) break;
+                continue;
+            }
+            if (Peek() == '[') {
+                // <![CDATA[ ... ]]>
+                std::string marker;
+                for (int i = 0; i < 7 && Peek() != EOF; i++) marker.push_back((char)Get());
+                if (marker != "[CDATA[") break;
+                while ((c = Get()) != EOF) {
+                    text.push_back((char)c);
+                    if (text.size() >= 3 && text.compare(text.size() - 3, 3, "]]>") == 0) {
+                        text.resize(text.size() - 3);
+                        break;
+                    }
+                }
+                if (c == EOF) break;
+                if (!text.empty()) return Event::Text;
+                continue;
+            }
+            if (!SkipUntil(">")) break;
+            continue;
+        }
+        if (c == '/') {
+            Get();
+            name.clear();
+            while ((c = Get()) != EOF && c != '>') {
+                if (!IsSpace(c)) name.push_back((char)c);
+            }
+            if (c == EOF) break;
+            depth--;
+            return Event::EndElement;
+        }
+
+        if (!ParseTag()) break;
+        depth++;
+        return Event::StartElement;
+    }
+
+    failed = true;
+    return Event::Error;
+}
+
+const std::string* XmlStreamReader::Attribute(const char* attr_name) const {
+    for (const auto& attr : attributes) {
+        if (attr.first == attr_name) return &attr.second;
+    }
+    return nullptr;
+}
+
+std::string XmlStreamReader::ReadElementText() {
+    std::string content;
+    int start_depth = depth;
+    while (true) {
+        Event ev = Next();
+        if (ev == Event::Text) {
+            content += text;
+        } else if (ev == Event::EndElement && depth < start_depth) {
+            break;
+        } else if (ev == Event::End || ev == Event::Error) {
+            break;
+        }
+    }
+    return content;
+}
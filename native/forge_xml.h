@@ -0,0 +1,65 @@
+#ifndef FORGE_XML_H
+#define FORGE_XML_H
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal pull-style (SAX-like) XML reader.
+//
+// Reads the file through a fixed buffer, so memory stays bounded no matter
+// how large the document is. Only what DAT files, GameTDB and Wii U
+// meta.xml need is supported: elements, attributes, text, CDATA and the
+// predefined/numeric entities. Comments, processing instructions and
+// DOCTYPE declarations are skipped. Self-closing elements produce a
+// StartElement followed by an EndElement.
+class XmlStreamReader {
+public:
+    enum class Event { StartElement, EndElement, Text, End, Error };
+
+    XmlStreamReader() = default;
+    ~XmlStreamReader();
+    XmlStreamReader(const XmlStreamReader&) = delete;
+    XmlStreamReader& operator=(const XmlStreamReader&) = delete;
+
+    bool Open(const std::string& file_path);
+    void Close();
+
+    // Advance to the next event
+    Event Next();
+
+    // Element name for StartElement/EndElement
+    const std::string& Name() const { return name; }
+    // Decoded character data for Text (whitespace-only runs are skipped)
+    const std::string& Text() const { return text; }
+    // Attribute of the current StartElement, or nullptr
+    const std::string* Attribute(const char* attr_name) const;
+    // Nesting depth of the current element (root = 1)
+    int Depth() const { return depth; }
+
+    // Read the text content of the current StartElement up to its end tag
+    // (nested markup is skipped). Leaves the reader after the end tag.
+    std::string ReadElementText();
+
+private:
+    int Get();
+    int Peek();
+    bool SkipUntil(const char* terminator);
+    bool ParseTag();
+    void DecodeEntity(std::string& out);
+
+    FILE* file = nullptr;
+    std::vector<char> buffer;
+    size_t pos = 0;
+    size_t len = 0;
+
+    std::string name;
+    std::string text;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    int depth = 0;
+    bool pending_end = false; // Self-closing element still owes an EndElement
+    bool failed = false;
+};
+
+#endif // FORGE_XML_H
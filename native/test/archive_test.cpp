@@ -0,0 +1,162 @@
+// Zip and 7z member identification: zipfile's stored/deflate/LZMA members,
+// a ZIP64 directory, 7z with a solid LZMA2 folder, a Copy folder and an
+// LZMA-encoded header. Truncated and corrupt archives must be rejected or
+// report a subset of the real members, never crash.
+
+#include "forge_archive.h"
+#include "forge_test.h"
+#include <algorithm>
+#include <cstring>
+
+struct Expected {
+    const char* name;
+    Platform platform;
+    uint64_t size;
+};
+
+struct Archive {
+    const char* fixture;
+    ArchiveType type;
+    std::vector<Expected> members;
+};
+
+static const Expected MELEE = { "GameCube/Melee.iso", PLATFORM_GAMECUBE, 0x4000 };
+static const Expected ZELDA = { "NES/Zelda.nes", PLATFORM_NES, 0x8010 };
+static const Expected UMD = { "PSP/Umd.iso", PLATFORM_PSP, 0x10800 };
+static const Expected SONIC = { "Genesis/Sonic.md", PLATFORM_GENESIS, 0x1000 };
+
+static const Archive ARCHIVES[] = {
+    { "games.zip", ArchiveType::Zip, { MELEE, ZELDA, UMD } },
+    { "melee64.zip", ArchiveType::Zip, { MELEE } },
+    { "games.7z", ArchiveType::SevenZip, { MELEE, ZELDA, SONIC } },
+    { "games_encoded.7z", ArchiveType::SevenZip, { MELEE, ZELDA, SONIC } },
+};
+
+static bool IsExpected(const ArchiveMember& member, const Expected& expected) {
+    return member.name == expected.name && member.identity.platform == expected.platform &&
+           member.identity.file_size == expected.size;
+}
+
+// Every member is one of the archive's real members, at most once
+static bool IsSubset(const std::vector<ArchiveMember>& members, const Archive& archive) {
+    std::vector<bool> seen(archive.members.size());
+    for (const ArchiveMember& member : members) {
+        bool found = false;
+        for (size_t i = 0; i < archive.members.size() && !found; i++) {
+            if (!seen[i] && IsExpected(member, archive.members[i])) seen[i] = found = true;
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+static bool IdentifyBytes(const std::vector<uint8_t>& data, ArchiveType type, std::vector<ArchiveMember>* members) {
+    return IdentifyArchiveMembers(forge_test::WriteScratch("archive.bin", data), type, members);
+}
+
+TEST(Detect) {
+    for (const Archive& archive : ARCHIVES) {
+        CHECK_CASE(DetectArchiveFile(forge_test::Fixture(archive.fixture)) == archive.type, "%s", archive.fixture);
+    }
+    CHECK(DetectArchiveFile(forge_test::Fixture("melee.gcz")) == ArchiveType::None);
+    CHECK(DetectArchiveFile(forge_test::Fixture("missing.zip")) == ArchiveType::None);
+    CHECK(DetectArchive((const uint8_t*)"PK\x03", 3) == ArchiveType::None);
+}
+
+TEST(FileNames) {
+    CHECK(ArchiveFileName("games/roms.zip"));
+    CHECK(ArchiveFileName("C:\\games\\roms.7Z"));
+    CHECK(!ArchiveFileName("games/roms.zip.part"));
+    CHECK(!ArchiveFileName("games.zip/roms"));
+    CHECK(!ArchiveFileName("zip"));
+}
+
+TEST(MemberPaths) {
+    std::string path = ArchiveMemberPath("/games/roms.zip", "NES/Zelda.nes");
+    std::string archive, member;
+    CHECK(path.size() == strlen("/games/roms.zip") + 1 + strlen("NES/Zelda.nes"));
+    CHECK(SplitArchiveMemberPath(path, &archive, &member));
+    CHECK(archive == "/games/roms.zip" && member == "NES/Zelda.nes");
+    CHECK(SplitArchiveMemberPath(path, nullptr, nullptr));
+    CHECK(!SplitArchiveMemberPath("/games/roms.zip", &archive, &member));
+}
+
+TEST(Identify) {
+    for (const Archive& archive : ARCHIVES) {
+        std::vector<ArchiveMember> members;
+        bool ok = IdentifyArchiveMembers(forge_test::Fixture(archive.fixture), archive.type, &members);
+        CHECK_CASE(ok && members.size() == archive.members.size() && IsSubset(members, archive), "%s",
+                   archive.fixture);
+    }
+    std::vector<ArchiveMember> members;
+    CHECK(!IdentifyArchiveMembers(forge_test::Fixture("games.zip"), ArchiveType::None, &members));
+    CHECK(!IdentifyArchiveMembers(forge_test::Fixture("games.zip"), ArchiveType::SevenZip, &members));
+    CHECK(members.empty());
+}
+
+// Both formats keep their directory at the end, so any cut loses it
+TEST(Truncated) {
+    for (const Archive& archive : ARCHIVES) {
+        std::vector<uint8_t> data = forge_test::ReadFixture(archive.fixture);
+        size_t step = (std::max)((size_t)1, data.size() / 400);
+        for (size_t cut = 0; cut < data.size(); cut += cut + 64 >= data.size() ? 1 : step) {
+            std::vector<ArchiveMember> members;
+            bool ok = IdentifyArchiveMembers(forge_test::WriteScratch("archive.bin", data.data(), cut), archive.type,
+                                             &members);
+            CHECK_CASE(!ok && members.empty(), "%s cut at %zu", archive.fixture, cut);
+        }
+    }
+}
+
+// Flip bits across the directory and member data: the archive may be
+// rejected or lose members, but what is reported must be real
+TEST(Corrupt) {
+    for (const Archive& archive : ARCHIVES) {
+        std::vector<uint8_t> data = forge_test::ReadFixture(archive.fixture);
+        size_t step = (std::max)((size_t)1, data.size() / 120);
+        size_t tail = data.size() > 0x100 ? data.size() - 0x100 : 0;
+        for (size_t pos = 0; pos < data.size(); pos += pos >= tail ? 2 : step) {
+            for (uint8_t flip : { 0x01, 0xFF }) {
+                std::vector<uint8_t> corrupt = data;
+                corrupt[pos] ^= flip;
+                std::vector<ArchiveMember> members;
+                bool ok = IdentifyBytes(corrupt, archive.type, &members);
+                CHECK_CASE(ok || members.empty(), "%s byte %zu", archive.fixture, pos);
+                CHECK_CASE(members.size() <= archive.members.size(), "%s byte %zu", archive.fixture, pos);
+            }
+        }
+    }
+}
+
+TEST(ZipMemberOutsideFile) {
+    // The first local header offset in the directory, moved past the end:
+    // that member is skipped, the others still identified
+    std::vector<uint8_t> zip = forge_test::ReadFixture("games.zip");
+    std::vector<uint8_t> moved = zip;
+    size_t directory = 0;
+    for (size_t i = 0; i + 4 <= zip.size(); i++) {
+        if (memcmp(&zip[i], "PK\x01\x02", 4) == 0) {
+            directory = i;
+            break;
+        }
+    }
+    CHECK(directory != 0);
+    memset(&moved[directory + 42], 0x7F, 4);
+    std::vector<ArchiveMember> members;
+    CHECK(IdentifyBytes(moved, ArchiveType::Zip, &members));
+    CHECK(members.size() == 2 && IsExpected(members[0], ZELDA) && IsExpected(members[1], UMD));
+}
+
+TEST(SevenZipBadEncodedHeader) {
+    // The encoded header's LZMA stream starts right after the packed files:
+    // a broken range coder start rejects the archive
+    std::vector<uint8_t> data = forge_test::ReadFixture("games_encoded.7z");
+    std::vector<uint8_t> plain = forge_test::ReadFixture("games.7z");
+    size_t packed_files = 0;
+    for (int i = 0; i < 8; i++) packed_files |= (size_t)plain[12 + i] << (8 * i);
+    data[32 + packed_files] = 0x80;
+    std::vector<ArchiveMember> members;
+    CHECK(!IdentifyBytes(data, ArchiveType::SevenZip, &members) && members.empty());
+}
+
+TEST_MAIN()
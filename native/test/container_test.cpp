@@ -0,0 +1,221 @@
+// Container probes against GCZ, CSO/ZSO, WUX and CHD images built around
+// zlib, liblzma and lz4 output: detection, identification of the disc
+// inside, every truncation of the file and targeted corruption of the
+// headers, indexes and maps.
+
+#include "forge_container.h"
+#include "forge_test.h"
+#include <algorithm>
+#include <cstring>
+
+struct Image {
+    const char* fixture;
+    DiscFormat format;
+    Platform platform;
+    const char* title_id;
+    const char* game_title;
+};
+
+static const Image IMAGES[] = {
+    { "melee.gcz", FORMAT_GCZ, PLATFORM_GAMECUBE, "GALE01", "Super Smash Bros. Melee" },
+    { "umd.cso", FORMAT_CSO, PLATFORM_PSP, "", "TEST_UMD" },
+    { "umd.zso", FORMAT_CSO, PLATFORM_PSP, "", "TEST_UMD" },
+    { "wiiu.wux", FORMAT_WUX, PLATFORM_WII_U, "ARPE", "" },
+    { "ps2.chd", FORMAT_CHD, PLATFORM_PS2, "", "TEST_PS2" },
+    { "ps1.chd", FORMAT_CHD, PLATFORM_PS1, "", "TEST_PS1" },
+    { "melee.chd", FORMAT_CHD, PLATFORM_GAMECUBE, "GALE01", "Super Smash Bros. Melee" },
+};
+
+static bool Matches(const GameIdentity& identity, const Image& image) {
+    return identity.platform == image.platform && identity.format == image.format &&
+           strcmp(identity.title_id, image.title_id) == 0 && strcmp(identity.game_title, image.game_title) == 0;
+}
+
+static bool Identify(const std::string& path, DiscFormat format, GameIdentity* identity) {
+    return IdentifyContainer(path.c_str(), format, identity);
+}
+
+static bool IdentifyBytes(const std::vector<uint8_t>& data, DiscFormat format, GameIdentity* identity) {
+    return Identify(forge_test::WriteScratch("image.bin", data), format, identity);
+}
+
+static uint32_t ReadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t ReadBE64(const uint8_t* p) {
+    return ((uint64_t)ReadBE32(p) << 32) | ReadBE32(p + 4);
+}
+
+static void WriteLE32(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(value >> (8 * i));
+}
+
+TEST(Detect) {
+    for (const Image& image : IMAGES) {
+        std::vector<uint8_t> data = forge_test::ReadFixture(image.fixture);
+        CHECK_CASE(DetectContainer(data.data(), data.size()) == image.format, "%s", image.fixture);
+    }
+    // A Wii CISO keeps its block size where CSO has the header size
+    uint8_t wii_ciso[0x18] = { 'C', 'I', 'S', 'O', 0x00, 0x00, 0x20, 0x00 };
+    CHECK(DetectContainer(wii_ciso, sizeof(wii_ciso)) == FORMAT_UNKNOWN);
+    uint8_t short_header[0x10] = { 'W', 'U', 'X', '0', 0x2E, 0xD0, 0x99, 0x10 };
+    CHECK(DetectContainer(short_header, sizeof(short_header)) == FORMAT_UNKNOWN);
+}
+
+TEST(Identify) {
+    for (const Image& image : IMAGES) {
+        GameIdentity identity;
+        CHECK_CASE(Identify(forge_test::Fixture(image.fixture), image.format, &identity) && Matches(identity, image),
+                   "%s", image.fixture);
+    }
+}
+
+TEST(IdentifyFromFile) {
+    for (const Image& image : IMAGES) {
+        std::string path = forge_test::Fixture(image.fixture);
+        GameIdentity identity;
+        CHECK_CASE(identify_from_file(path.c_str(), &identity) && Matches(identity, image) &&
+                   identity.file_size == forge_test::ReadFile(path).size(),
+                   "%s", image.fixture);
+    }
+}
+
+// A file cut short either still holds everything the probe reads or is
+// rejected; it never identifies as something else. The container format
+// is reported either way.
+TEST(Truncated) {
+    for (const Image& image : IMAGES) {
+        std::vector<uint8_t> data = forge_test::ReadFixture(image.fixture);
+        size_t step = (std::max)((size_t)1, data.size() / 500);
+        for (size_t cut = 0; cut < data.size(); cut += cut < 0x200 ? 1 : step) {
+            GameIdentity identity;
+            bool identified = Identify(forge_test::WriteScratch("image.bin", data.data(), cut), image.format, &identity);
+            CHECK_CASE(identity.format == image.format && (!identified || Matches(identity, image)), "%s cut at %zu",
+                       image.fixture, cut);
+            CHECK_CASE(cut >= 0x18 || !identified, "%s cut at %zu", image.fixture, cut);
+        }
+    }
+}
+
+// Flip bits in the header, index and first blocks: the probe may give up
+// but must not crash or read outside the file
+TEST(Corrupt) {
+    for (const Image& image : IMAGES) {
+        std::vector<uint8_t> data = forge_test::ReadFixture(image.fixture);
+        size_t step = (std::max)((size_t)1, data.size() / 300);
+        for (size_t pos = 0; pos < data.size(); pos += pos < 0x100 ? 1 : step) {
+            for (uint8_t flip : { 0x01, 0x80, 0xFF }) {
+                std::vector<uint8_t> corrupt = data;
+                corrupt[pos] ^= flip;
+                GameIdentity identity;
+                IdentifyBytes(corrupt, image.format, &identity);
+                CHECK_CASE(identity.format == image.format, "%s byte %zu", image.fixture, pos);
+            }
+        }
+    }
+}
+
+TEST(InvalidGcz) {
+    std::vector<uint8_t> gcz = forge_test::ReadFixture("melee.gcz");
+    GameIdentity identity;
+
+    std::vector<uint8_t> block_size = gcz;
+    WriteLE32(&block_size[0x18], 0x3000);
+    CHECK(!IdentifyBytes(block_size, FORMAT_GCZ, &identity));
+
+    // Block 0 is zlib: break its header check bits
+    uint32_t block_count = gcz[0x1C];
+    std::vector<uint8_t> zlib_header = gcz;
+    zlib_header[0x20 + block_count * 12 + 1] ^= 0x01;
+    CHECK(!IdentifyBytes(zlib_header, FORMAT_GCZ, &identity));
+
+    // Block 0 ends where block 1 starts: past the end of the file
+    std::vector<uint8_t> pointer = gcz;
+    WriteLE32(&pointer[0x28], 0x7FFFFFF0);
+    CHECK(!IdentifyBytes(pointer, FORMAT_GCZ, &identity));
+    CHECK(identity.format == FORMAT_GCZ && identity.platform == PLATFORM_UNKNOWN);
+}
+
+TEST(InvalidCso) {
+    std::vector<uint8_t> cso = forge_test::ReadFixture("umd.cso");
+    GameIdentity identity;
+
+    for (uint32_t block_size : { 1024u, 0x900u, 2u * 1024 * 1024 }) {
+        std::vector<uint8_t> bad = cso;
+        WriteLE32(&bad[0x10], block_size);
+        CHECK_CASE(!IdentifyBytes(bad, FORMAT_CSO, &identity), "block size %u", block_size);
+    }
+
+    // Index entries running backwards
+    std::vector<uint8_t> backwards = cso;
+    WriteLE32(&backwards[0x18 + 4], 0x18);
+    CHECK(!IdentifyBytes(backwards, FORMAT_CSO, &identity));
+
+    // Block 0 ending past the end of the file
+    std::vector<uint8_t> zso = forge_test::ReadFixture("umd.zso");
+    std::vector<uint8_t> end = zso;
+    WriteLE32(&end[0x18 + 4], (uint32_t)zso.size() + 1);
+    CHECK(!IdentifyBytes(end, FORMAT_CSO, &identity));
+}
+
+TEST(InvalidWux) {
+    std::vector<uint8_t> wux = forge_test::ReadFixture("wiiu.wux");
+    GameIdentity identity;
+
+    std::vector<uint8_t> sector = wux;
+    WriteLE32(&sector[0x20], 1000);      // Disc sector 0 stored past the end
+    CHECK(!IdentifyBytes(sector, FORMAT_WUX, &identity));
+
+    std::vector<uint8_t> magic = wux;
+    magic[4] ^= 0x01;
+    CHECK(!IdentifyBytes(magic, FORMAT_WUX, &identity));
+
+    std::vector<uint8_t> sector_size = wux;
+    WriteLE32(&sector_size[0x08], 0x80);
+    CHECK(!IdentifyBytes(sector_size, FORMAT_WUX, &identity));
+}
+
+TEST(InvalidChd) {
+    std::vector<uint8_t> chd = forge_test::ReadFixture("ps2.chd");
+    uint64_t map_offset = ReadBE64(&chd[40]);
+    uint64_t metadata_offset = ReadBE64(&chd[48]);
+    GameIdentity identity;
+
+    std::vector<uint8_t> version = chd;
+    version[15] = 4;
+    CHECK(!IdentifyBytes(version, FORMAT_CHD, &identity));
+
+    std::vector<uint8_t> hunk_size = chd;
+    memset(&hunk_size[56], 0, 4);
+    CHECK(!IdentifyBytes(hunk_size, FORMAT_CHD, &identity));
+
+    // Neither a DVD nor a CD without its tag
+    std::vector<uint8_t> untagged = chd;
+    memcpy(&untagged[metadata_offset], "XXXX", 4);
+    CHECK(!IdentifyBytes(untagged, FORMAT_CHD, &identity));
+
+    // An empty Huffman table decodes no hunk type
+    std::vector<uint8_t> table = chd;
+    memset(&table[map_offset + 16], 0, 8);
+    CHECK(!IdentifyBytes(table, FORMAT_CHD, &identity));
+
+    // A map cut short of the fields it announces
+    std::vector<uint8_t> map_size = chd;
+    uint32_t size = ReadBE32(&chd[map_offset]);
+    for (int i = 0; i < 4; i++) map_size[map_offset + i] = (uint8_t)((size - 8) >> (24 - 8 * i));
+    CHECK(!IdentifyBytes(map_size, FORMAT_CHD, &identity));
+
+    // Hunks start far past the end of the file
+    std::vector<uint8_t> first_offset = chd;
+    first_offset[map_offset + 4] = 0x7F;
+    CHECK(!IdentifyBytes(first_offset, FORMAT_CHD, &identity));
+
+    // Uncompressed map: hunk 0 stored past the end of the file
+    std::vector<uint8_t> raw = forge_test::ReadFixture("melee.chd");
+    std::vector<uint8_t> raw_map = raw;
+    memset(&raw_map[ReadBE64(&raw[40])], 0x7F, 4);
+    CHECK(!IdentifyBytes(raw_map, FORMAT_CHD, &identity));
+}
+
+TEST_MAIN()
@@ -0,0 +1,229 @@
+// Prefix decoders against streams written by zlib, liblzma and lz4: full and
+// partial round trips, every truncation of the input, byte-level corruption
+// (which may decode to garbage but must never write past capacity) and
+// hand-made invalid streams that must be rejected.
+
+#include "forge_decompress.h"
+#include "forge_test.h"
+#include "platform_identifier.h"
+#include <algorithm>
+#include <fstream>
+
+enum class Codec { Inflate, Lzma, Lzma2, Lz4 };
+
+struct Stream {
+    const char* fixture;
+    Codec codec;
+    const char* plain;          // Fixture it decodes to
+    bool ends_with_input;       // LZ4 blocks: a cut at a sequence boundary is a valid block
+};
+
+static const Stream STREAMS[] = {
+    { "payload.deflate_stored", Codec::Inflate, "payload.bin", false },
+    { "payload.deflate_fixed", Codec::Inflate, "payload.bin", false },
+    { "payload.deflate", Codec::Inflate, "payload.bin", false },
+    { "payload.lzma", Codec::Lzma, "payload.bin", false },
+    { "payload.lzma2", Codec::Lzma2, "payload.bin", false },
+    { "noise.lzma2", Codec::Lzma2, "noise.bin", false },
+    { "payload.lz4", Codec::Lz4, "payload.bin", true },
+};
+
+// .lzma files (xz --format=lzma): properties, u64 size, then the stream
+static constexpr size_t LZMA_ALONE_HEADER_SIZE = 13;
+static constexpr size_t CANARY_SIZE = 64;
+static constexpr uint8_t CANARY = 0xA5;
+
+struct Decoded {
+    bool ok = false;
+    bool overrun = false;       // Wrote past capacity or reported more than it
+    std::vector<uint8_t> out;
+};
+
+static Decoded Decode(const RandomAccessFile& file, Codec codec, uint64_t length, size_t capacity) {
+    Decoded result;
+    std::vector<uint8_t> buffer(capacity + CANARY_SIZE, CANARY);
+    size_t produced = SIZE_MAX;
+    uint64_t offset = 0;
+    uint8_t props[5] = {};
+    if (codec == Codec::Lzma) {
+        file.ReadExact(0, props, sizeof(props));
+        offset = LZMA_ALONE_HEADER_SIZE;
+        length = length > offset ? length - offset : 0;
+    }
+    RangeReader in(file, offset, length);
+    switch (codec) {
+    case Codec::Inflate: result.ok = InflatePrefix(in, buffer.data(), capacity, &produced); break;
+    case Codec::Lzma: result.ok = LzmaDecodePrefix(in, props, sizeof(props), buffer.data(), capacity, &produced); break;
+    case Codec::Lzma2: result.ok = Lzma2DecodePrefix(in, buffer.data(), capacity, &produced); break;
+    case Codec::Lz4: result.ok = Lz4BlockDecodePrefix(in, buffer.data(), capacity, &produced); break;
+    }
+    result.overrun = produced > capacity ||
+                     std::any_of(buffer.begin() + capacity, buffer.end(), [](uint8_t b) { return b != CANARY; });
+    buffer.resize((std::min)(produced, capacity));
+    result.out = std::move(buffer);
+    return result;
+}
+
+static Decoded DecodeFile(const std::string& path, Codec codec, size_t capacity) {
+    RandomAccessFile file;
+    if (!file.Open(path)) return Decoded();
+    return Decode(file, codec, file.Size(), capacity);
+}
+
+static Decoded DecodeBytes(const std::vector<uint8_t>& stream, Codec codec, size_t capacity) {
+    return DecodeFile(forge_test::WriteScratch("stream.bin", stream), codec, capacity);
+}
+
+static bool IsPrefix(const std::vector<uint8_t>& prefix, const std::vector<uint8_t>& of) {
+    return prefix.size() <= of.size() && std::equal(prefix.begin(), prefix.end(), of.begin());
+}
+
+TEST(RoundTrip) {
+    for (const Stream& stream : STREAMS) {
+        std::vector<uint8_t> plain = forge_test::ReadFixture(stream.plain);
+        Decoded decoded = DecodeFile(forge_test::Fixture(stream.fixture), stream.codec, plain.size());
+        CHECK_CASE(decoded.ok && !decoded.overrun && decoded.out == plain, "%s", stream.fixture);
+    }
+}
+
+TEST(StopsAtCapacity) {
+    for (const Stream& stream : STREAMS) {
+        std::vector<uint8_t> plain = forge_test::ReadFixture(stream.plain);
+        for (size_t capacity : { (size_t)0, (size_t)1, (size_t)100, (size_t)IDENTIFY_HEADER_SIZE, plain.size() - 1 }) {
+            Decoded decoded = DecodeFile(forge_test::Fixture(stream.fixture), stream.codec, capacity);
+            CHECK_CASE(decoded.ok && !decoded.overrun && decoded.out.size() == capacity && IsPrefix(decoded.out, plain),
+                       "%s, capacity %zu", stream.fixture, capacity);
+        }
+    }
+}
+
+TEST(StopsAtStreamEnd) {
+    for (const Stream& stream : STREAMS) {
+        std::vector<uint8_t> plain = forge_test::ReadFixture(stream.plain);
+        Decoded decoded = DecodeFile(forge_test::Fixture(stream.fixture), stream.codec, plain.size() + 1000);
+        CHECK_CASE(decoded.ok && !decoded.overrun && decoded.out == plain, "%s", stream.fixture);
+    }
+}
+
+TEST(NoiseIsStoredInLzma2) {
+    // Uncompressed chunks (control 1) are what xz writes for data that does not shrink
+    std::vector<uint8_t> stream = forge_test::ReadFixture("noise.lzma2");
+    CHECK(!stream.empty() && stream[0] == 1);
+}
+
+// Every way the input can end early: what was produced is a correct prefix,
+// and a short result is an error unless the format cannot tell
+TEST(Truncated) {
+    for (const Stream& stream : STREAMS) {
+        std::vector<uint8_t> plain = forge_test::ReadFixture(stream.plain);
+        RandomAccessFile file;
+        CHECK(file.Open(forge_test::Fixture(stream.fixture)));
+        uint64_t size = file.Size();
+        uint64_t step = (std::max)((uint64_t)1, size / 700);
+        for (uint64_t cut = 0; cut < size; cut += step) {
+            Decoded decoded = Decode(file, stream.codec, cut, plain.size());
+            CHECK_CASE(!decoded.overrun && IsPrefix(decoded.out, plain), "%s cut at %llu", stream.fixture,
+                       (unsigned long long)cut);
+            bool short_output = decoded.out.size() < plain.size();
+            CHECK_CASE(stream.ends_with_input || !short_output || !decoded.ok, "%s cut at %llu", stream.fixture,
+                       (unsigned long long)cut);
+        }
+    }
+}
+
+// Flip bits all over each stream: the decoders may produce anything, but
+// never more than capacity and never outside the buffer
+TEST(Corrupt) {
+    for (const Stream& stream : STREAMS) {
+        std::vector<uint8_t> data = forge_test::ReadFixture(stream.fixture);
+        std::vector<uint8_t> plain = forge_test::ReadFixture(stream.plain);
+        std::string path = forge_test::WriteScratch("corrupt.bin", data);
+        std::fstream patch(path, std::ios::in | std::ios::out | std::ios::binary);
+        RandomAccessFile file;
+        CHECK(file.Open(path));
+        size_t step = (std::max)((size_t)1, data.size() / 400);
+        for (size_t pos = 0; pos < data.size(); pos += step) {
+            bool overrun = false;
+            for (uint8_t flip : { 0x01, 0x10, 0x80, 0xFF }) {
+                char byte = (char)(data[pos] ^ flip);
+                patch.seekp((std::streamoff)pos);
+                patch.write(&byte, 1);
+                patch.flush();
+                overrun = overrun || Decode(file, stream.codec, data.size(), plain.size()).overrun;
+            }
+            char original = (char)data[pos];
+            patch.seekp((std::streamoff)pos);
+            patch.write(&original, 1);
+            patch.flush();
+            CHECK_CASE(!overrun, "%s byte %zu", stream.fixture, pos);
+        }
+    }
+}
+
+TEST(InvalidDeflate) {
+    // Block type 3 is reserved
+    Decoded reserved = DecodeBytes({ 0x07, 0x00, 0x00, 0x00 }, Codec::Inflate, 64);
+    CHECK(!reserved.ok && reserved.out.empty());
+
+    // A stored block whose length and its complement disagree
+    std::vector<uint8_t> stored = forge_test::ReadFixture("payload.deflate_stored");
+    stored[3] ^= 0x01;
+    Decoded mismatch = DecodeBytes(stored, Codec::Inflate, 64);
+    CHECK(!mismatch.ok && mismatch.out.empty());
+
+    // A distance reaching before the start of the output: fixed Huffman,
+    // literal 'a', then length 3 at distance 2
+    Decoded distance = DecodeBytes({ 0x4B, 0x04, 0x42, 0x00 }, Codec::Inflate, 64);
+    CHECK(!distance.ok && !distance.overrun);
+}
+
+TEST(InvalidLzma) {
+    std::vector<uint8_t> stream = forge_test::ReadFixture("payload.lzma");
+    stream[0] = 9 * 5 * 5;      // lc/lp/pb out of range
+    Decoded decoded = DecodeBytes(stream, Codec::Lzma, 64);
+    CHECK(!decoded.ok && decoded.out.empty());
+
+    // The range coder's first byte is always 0
+    stream = forge_test::ReadFixture("payload.lzma");
+    stream[LZMA_ALONE_HEADER_SIZE] = 0x80;
+    decoded = DecodeBytes(stream, Codec::Lzma, 64);
+    CHECK(!decoded.ok && decoded.out.empty());
+}
+
+TEST(InvalidLzma2) {
+    Decoded control = DecodeBytes({ 0x03, 0x00, 0x00 }, Codec::Lzma2, 64);
+    CHECK(!control.ok && control.out.empty());
+
+    // An LZMA chunk needs properties before its first use
+    std::vector<uint8_t> stream = forge_test::ReadFixture("payload.lzma2");
+    CHECK(stream[0] == 0xE0);
+    stream[0] = 0x80;
+    Decoded missing = DecodeBytes(stream, Codec::Lzma2, 64);
+    CHECK(!missing.ok && missing.out.empty());
+
+    // Uncompressed chunk longer than the stream
+    Decoded stored = DecodeBytes({ 0x01, 0x00, 0x10, 'a', 'b' }, Codec::Lzma2, 64);
+    CHECK(!stored.ok && !stored.overrun);
+}
+
+TEST(InvalidLz4) {
+    // Literal 'a', then a match at distance 0 / past the start of the output
+    Decoded zero = DecodeBytes({ 0x10, 'a', 0x00, 0x00 }, Codec::Lz4, 64);
+    CHECK(!zero.ok && zero.out.size() == 1);
+    Decoded before = DecodeBytes({ 0x10, 'a', 0x02, 0x00 }, Codec::Lz4, 64);
+    CHECK(!before.ok && before.out.size() == 1);
+
+    // Five literals announced, two present
+    Decoded literals = DecodeBytes({ 0x50, 'a', 'b' }, Codec::Lz4, 64);
+    CHECK(!literals.ok && !literals.overrun);
+
+    // Literals only: a complete last sequence
+    Decoded last = DecodeBytes({ 0x10, 'a' }, Codec::Lz4, 64);
+    CHECK(last.ok && last.out == std::vector<uint8_t>{ 'a' });
+
+    // A match overlapping its own output
+    Decoded overlap = DecodeBytes({ 0x12, 'a', 0x01, 0x00, 0x10, 'b' }, Codec::Lz4, 64);
+    CHECK(overlap.ok && overlap.out == std::vector<uint8_t>({ 'a', 'a', 'a', 'a', 'a', 'a', 'a', 'b' }));
+}
+
+TEST_MAIN()
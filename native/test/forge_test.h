@@ -0,0 +1,128 @@
+#ifndef FORGE_TEST_H
+#define FORGE_TEST_H
+
+// Just enough of a test harness for the native tests: each test file is its
+// own executable registered with CTest, runs every TEST in it and exits
+// non-zero if any CHECK failed. Fixtures come from test/data (written by
+// test/make_fixtures.py); variants made at run time go to a scratch folder
+// that is removed on exit.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#ifndef FORGE_TEST_DATA_DIR
+#error "FORGE_TEST_DATA_DIR must name the fixture folder"
+#endif
+
+namespace forge_test {
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+inline std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline bool Register(const char* name, void (*run)()) {
+    Registry().push_back({ name, run });
+    return true;
+}
+
+inline void Fail(const char* file, int line, const std::string& what) {
+    fprintf(stderr, "%s:%d: CHECK failed: %s\n", file, line, what.c_str());
+    Failures()++;
+}
+
+inline std::string Fixture(const std::string& name) {
+    return (std::filesystem::path(FORGE_TEST_DATA_DIR) / name).string();
+}
+
+inline std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+inline std::vector<uint8_t> ReadFixture(const std::string& name) {
+    std::vector<uint8_t> data = ReadFile(Fixture(name));
+    if (data.empty()) Fail(__FILE__, __LINE__, "fixture " + name + " is missing or empty");
+    return data;
+}
+
+inline const std::filesystem::path& ScratchDir() {
+    static const std::filesystem::path dir = [] {
+        std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                     ("forge_test_" + std::to_string(std::random_device()()));
+        std::filesystem::create_directories(path);
+        return path;
+    }();
+    return dir;
+}
+
+// Write data to a scratch file and return its path
+inline std::string WriteScratch(const std::string& name, const uint8_t* data, size_t size) {
+    std::string path = (ScratchDir() / name).string();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char*)data, (std::streamsize)size);
+    return path;
+}
+
+inline std::string WriteScratch(const std::string& name, const std::vector<uint8_t>& data) {
+    return WriteScratch(name, data.data(), data.size());
+}
+
+inline int RunAll() {
+    for (const TestCase& test : Registry()) {
+        int before = Failures();
+        auto start = std::chrono::steady_clock::now();
+        test.run();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        printf("%s %s (%lld ms)\n", Failures() == before ? "[ OK ]" : "[FAIL]", test.name, (long long)ms.count());
+    }
+    std::error_code error;
+    std::filesystem::remove_all(ScratchDir(), error);
+    printf("%zu tests, %d failed checks\n", Registry().size(), Failures());
+    return Failures() == 0 ? 0 : 1;
+}
+
+} // namespace forge_test
+
+#define TEST(name)                                                                          \
+    static void name();                                                                     \
+    static const bool name##_registered = forge_test::Register(#name, name);               \
+    static void name()
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) forge_test::Fail(__FILE__, __LINE__, #condition);                 \
+    } while (0)
+
+// CHECK inside a loop over cases: names the case and stops the loop at the
+// first failure instead of repeating it for every iteration
+#define CHECK_CASE(condition, ...)                                                          \
+    if (!(condition)) {                                                                     \
+        char case_name[160];                                                                \
+        snprintf(case_name, sizeof(case_name), __VA_ARGS__);                                \
+        forge_test::Fail(__FILE__, __LINE__, std::string(#condition) + " (" + case_name + ")"); \
+        break;                                                                              \
+    }
+
+#define TEST_MAIN()                                                                         \
+    int main() { return forge_test::RunAll(); }
+
+#endif // FORGE_TEST_H
@@ -0,0 +1,87 @@
+// JsonWriter string escaping: control characters and quotes are escaped,
+// well-formed UTF-8 passes through, and every byte sequence RFC 3629 rules
+// out becomes U+FFFD, one per byte, so strict decoders accept the document.
+
+#include "forge_json.h"
+#include "forge_test.h"
+
+struct Case {
+    const char* name;
+    std::string input;
+    std::string expected;       // Between the quotes
+};
+
+static const std::string FFFD = "\\ufffd";
+
+static std::string Written(std::string_view s) {
+    JsonWriter writer;
+    writer.String(s);
+    const char* result = writer.Release();
+    std::string text = result ? result : "";
+    JsonWriter::ReleaseResult(result);
+    return text;
+}
+
+TEST(Escapes) {
+    CHECK(Written("plain") == "\"plain\"");
+    CHECK(Written("a\"b\\c") == "\"a\\\"b\\\\c\"");
+    CHECK(Written("\n\r\t") == "\"\\n\\r\\t\"");
+    CHECK(Written(std::string("\x01\x1F", 2)) == "\"\\u0001\\u001f\"");
+    CHECK(Written(std::string("a\0b", 3)) == "\"a\\u0000b\"");
+}
+
+TEST(ValidUtf8) {
+    static const Case cases[] = {
+        { "U+00A9", "\xC2\xA9", "\xC2\xA9" },
+        { "U+07FF", "\xDF\xBF", "\xDF\xBF" },
+        { "U+0800", "\xE0\xA0\x80", "\xE0\xA0\x80" },
+        { "U+30AB", "\xE3\x82\xAB", "\xE3\x82\xAB" },
+        { "U+D7FF", "\xED\x9F\xBF", "\xED\x9F\xBF" },
+        { "U+E000", "\xEE\x80\x80", "\xEE\x80\x80" },
+        { "U+FFFD", "\xEF\xBF\xBD", "\xEF\xBF\xBD" },
+        { "U+10000", "\xF0\x90\x80\x80", "\xF0\x90\x80\x80" },
+        { "U+10FFFF", "\xF4\x8F\xBF\xBF", "\xF4\x8F\xBF\xBF" },
+    };
+    for (const Case& c : cases) {
+        CHECK_CASE(Written(c.input) == "\"" + c.expected + "\"", "%s", c.name);
+    }
+}
+
+TEST(InvalidUtf8) {
+    static const Case cases[] = {
+        // Shift-JIS half-width katakana: overlong C0/C1 leads
+        { "C0 B1", "\xC0\xB1", FFFD + FFFD },
+        { "C1 BF", "\xC1\xBF", FFFD + FFFD },
+        // Overlong three- and four-byte forms
+        { "E0 80 80", "\xE0\x80\x80", FFFD + FFFD + FFFD },
+        { "E0 9F BF", "\xE0\x9F\xBF", FFFD + FFFD + FFFD },
+        { "F0 80 80 80", "\xF0\x80\x80\x80", FFFD + FFFD + FFFD + FFFD },
+        { "F0 8F BF BF", "\xF0\x8F\xBF\xBF", FFFD + FFFD + FFFD + FFFD },
+        // UTF-16 surrogates
+        { "ED A0 80", "\xED\xA0\x80", FFFD + FFFD + FFFD },
+        { "ED BF BF", "\xED\xBF\xBF", FFFD + FFFD + FFFD },
+        // Past U+10FFFF
+        { "F4 90 80 80", "\xF4\x90\x80\x80", FFFD + FFFD + FFFD + FFFD },
+        { "F5 80 80 80", "\xF5\x80\x80\x80", FFFD + FFFD + FFFD + FFFD },
+        { "F7 BF BF BF", "\xF7\xBF\xBF\xBF", FFFD + FFFD + FFFD + FFFD },
+        { "F8 88 80 80 80", "\xF8\x88\x80\x80\x80", FFFD + FFFD + FFFD + FFFD + FFFD },
+        { "FF", "\xFF", FFFD },
+        // Stray continuation bytes and cut-short sequences
+        { "80", "\x80", FFFD },
+        { "E3 82 a", "\xE3\x82" "a", FFFD + FFFD + "a" },
+        { "F0 90 80", "\xF0\x90\x80", FFFD + FFFD + FFFD },
+        { "C3 at end", "ok\xC3", "ok" + FFFD },
+    };
+    for (const Case& c : cases) {
+        CHECK_CASE(Written(c.input) == "\"" + c.expected + "\"", "%s", c.name);
+    }
+}
+
+// What a strict decoder gets back: U+FFFD where the raw bytes were
+TEST(RoundTrip) {
+    JsonValue value;
+    CHECK(JsonValue::Parse(Written("Zelda \xC0\xB1 \xE3\x82\xAB"), &value));
+    CHECK(value.IsString() && value.string == "Zelda \xEF\xBF\xBD\xEF\xBF\xBD \xE3\x82\xAB");
+}
+
+TEST_MAIN()
@@ -0,0 +1,531 @@
+#!/usr/bin/env python3
+"""Writes the native test fixtures into test/data.
+
+Compressed streams come from the real encoders: zlib, liblzma (the library
+behind xz) and the lz4 command-line tool. Containers and archives are laid
+out here byte by byte around them, so every field the readers look at is
+spelled out below. Checksums the readers do not verify are left zero.
+
+Run from anywhere; the output is deterministic for a given zlib, liblzma
+and lz4, so regenerating only changes the files when an encoder changes.
+"""
+
+import io
+import lzma
+import os
+import struct
+import subprocess
+import zipfile
+import zlib
+
+DATA = os.path.join(os.path.dirname(os.path.abspath(__file__)), "data")
+
+
+def write(name, data):
+    with open(os.path.join(DATA, name), "wb") as f:
+        f.write(data)
+
+
+# ============================================================================
+# Payloads
+# ============================================================================
+
+def noise(size, seed):
+    """Incompressible bytes from a 64-bit LCG"""
+    out = bytearray()
+    x = seed
+    while len(out) < size:
+        x = (x * 6364136223846793005 + 1442695040888963407) & (2**64 - 1)
+        out.append(x >> 56)
+    return bytes(out)
+
+
+def payload():
+    """Text, a long run and noise: literals, near and far matches"""
+    lines = b"".join(b"line %04d: the quick brown fox jumps over the lazy dog\n" % i for i in range(120))
+    return (lines + b"\0" * 1500 + noise(2048, 1) + lines[:3000])[:12288]
+
+
+# ============================================================================
+# Codecs
+# ============================================================================
+
+def deflate(data, level=9, strategy=zlib.Z_DEFAULT_STRATEGY):
+    c = zlib.compressobj(level, zlib.DEFLATED, -15, 9, strategy)
+    return c.compress(data) + c.flush()
+
+
+def zlib_stream(data):
+    return zlib.compress(data, 9)
+
+
+LZMA_PROPS_LC3_LP0_PB2 = 3 + 9 * (0 + 5 * 2)
+
+
+def lzma_raw(data, dict_size=1 << 16):
+    """LZMA1 stream without a header, lc 3 / lp 0 / pb 2"""
+    filters = [{"id": lzma.FILTER_LZMA1, "dict_size": dict_size, "lc": 3, "lp": 0, "pb": 2}]
+    return lzma.compress(data, format=lzma.FORMAT_RAW, filters=filters)
+
+
+def lzma_props(dict_size=1 << 16):
+    return bytes([LZMA_PROPS_LC3_LP0_PB2]) + struct.pack("<I", dict_size)
+
+
+def lzma2_raw(data):
+    return lzma.compress(data, format=lzma.FORMAT_RAW, filters=[{"id": lzma.FILTER_LZMA2, "preset": 6}])
+
+
+def lz4_block(data):
+    """The one block of an lz4 frame (64 KiB blocks, no checksums)"""
+    assert len(data) <= 65536
+    frame = subprocess.run(["lz4", "-c", "-B4", "--no-frame-crc"], input=data, capture_output=True,
+                           check=True).stdout
+    assert frame[:4] == b"\x04\x22\x4d\x18"
+    flags = frame[4]
+    pos = 7 + (8 if flags & 0x08 else 0) + (4 if flags & 0x01 else 0)
+    size = struct.unpack_from("<I", frame, pos)[0]
+    assert not size & 0x80000000, "lz4 stored the block uncompressed"
+    return frame[pos + 4:pos + 4 + size]
+
+
+# ============================================================================
+# Discs
+# ============================================================================
+
+def gamecube_disc(size):
+    """GameCube disc header: game ID, disc number, magic at 0x1C, title"""
+    disc = bytearray(size)
+    disc[0:6] = b"GALE01"
+    disc[0x1C:0x20] = b"\xC2\x33\x9F\x3D"
+    title = b"Super Smash Bros. Melee"
+    disc[0x20:0x20 + len(title)] = title
+    return disc
+
+
+def playstation_disc(size, system, volume_id, volume_blocks):
+    """ISO 9660 primary volume descriptor at sector 16 and nothing else"""
+    disc = bytearray(size)
+    pvd = 0x8000
+    disc[pvd:pvd + 6] = b"\x01CD001"
+    disc[pvd + 8:pvd + 8 + len(system)] = system
+    disc[pvd + 40:pvd + 40 + len(volume_id)] = volume_id
+    disc[pvd + 80:pvd + 84] = struct.pack("<I", volume_blocks)
+    return disc
+
+
+def wiiu_disc(size):
+    disc = bytearray(size)
+    disc[0:10] = b"WUP-P-ARPE"
+    return disc
+
+
+# ============================================================================
+# Containers
+# ============================================================================
+
+def gcz(disc, block_size, stored_blocks=()):
+    blocks = []
+    for i in range(0, len(disc), block_size):
+        block = bytes(disc[i:i + block_size])
+        blocks.append((block, True) if i // block_size in stored_blocks else (zlib_stream(block), False))
+    pointers, hashes, data = b"", b"", b""
+    for block, stored in blocks:
+        pointers += struct.pack("<Q", len(data) | (1 << 63 if stored else 0))
+        hashes += struct.pack("<I", zlib.adler32(block))
+        data += block
+    header = struct.pack("<IIQQII", 0xB10BC001, 0, len(data), len(disc), block_size, len(blocks))
+    return header + pointers + hashes + data
+
+
+def cso(disc, block_size, zso=False, stored_blocks=()):
+    """CSO v1 (deflate, flag = stored) or ZSO (LZ4, flag = stored)"""
+    count = (len(disc) + block_size - 1) // block_size
+    offset = 0x18 + (count + 1) * 4
+    index, data = b"", b""
+    for i in range(count):
+        block = bytes(disc[i * block_size:(i + 1) * block_size])
+        stored = i in stored_blocks
+        packed = block if stored else lz4_block(block) if zso else deflate(block)
+        index += struct.pack("<I", (offset + len(data)) | (0x80000000 if stored else 0))
+        data += packed
+    index += struct.pack("<I", offset + len(data))
+    header = (b"ZISO" if zso else b"CISO") + struct.pack("<IQIBB2x", 0x18, len(disc), block_size, 1, 0)
+    return header + index + data
+
+
+def wux(disc, sector_size):
+    """Duplicate sectors are stored once"""
+    count = (len(disc) + sector_size - 1) // sector_size
+    stored, index = [], b""
+    for i in range(count):
+        sector = bytes(disc[i * sector_size:(i + 1) * sector_size]).ljust(sector_size, b"\0")
+        if sector not in stored:
+            stored.append(sector)
+        index += struct.pack("<I", stored.index(sector))
+    header = b"WUX0" + struct.pack("<IIIQI4x", 0x1099D02E, sector_size, 0, len(disc), 0)
+    body = header + index
+    body += b"\0" * (-len(body) % sector_size)
+    return body + b"".join(stored)
+
+
+# CHD v5: the 124-byte header, hunk data, the map, then the metadata chain
+
+CHD_HEADER_SIZE = 124
+CHD_NONE, CHD_SELF, CHD_RLE_SMALL, CHD_SELF_0 = 4, 5, 7, 9
+
+
+class BitWriter:
+    """Most significant bit first, like the CHD map"""
+
+    def __init__(self):
+        self.bits = []
+
+    def write(self, value, count):
+        self.bits += [(value >> (count - 1 - i)) & 1 for i in range(count)]
+
+    def bytes(self):
+        bits = self.bits + [0] * (-len(self.bits) % 8)
+        return bytes(int("".join(map(str, bits[i:i + 8])), 2) for i in range(0, len(bits), 8))
+
+
+def chd_huffman(symbols):
+    """A complete code over symbols (lengths 1, 2, ..., n-1, n-1) in the
+    map's run-length coded table, and each symbol's code. Canonical codes
+    are handed out from the longest length down, as ChdHuffman does."""
+    lengths = [0] * 16
+    for i, symbol in enumerate(symbols):
+        lengths[symbol] = min(i + 1, len(symbols) - 1) if len(symbols) > 1 else 1
+    table = BitWriter()
+    for length in lengths:
+        if length == 1:
+            table.write(1, 4)       # 1 escapes itself
+        table.write(length, 4)
+    histogram = [0] * 9
+    for length in lengths:
+        histogram[length] += 1
+    start = 0
+    for length in range(8, 0, -1):
+        histogram[length], start = start, (start + histogram[length]) >> 1
+    codes = {}
+    for symbol, length in enumerate(lengths):
+        if length:
+            codes[symbol] = (histogram[length], length)
+            histogram[length] += 1
+    return table, codes
+
+
+def chd(disc, hunk_size, unit_size, codecs, hunks, metadata):
+    """hunks: per hunk (type, data or referenced hunk); types 0-3 pick a codec.
+    An entry of (CHD_RLE_SMALL, n) repeats the previous type 3 + n times."""
+    assert len(disc) % unit_size == 0
+    codec_fns = {b"zlib": deflate, b"lzma": lzma_raw}
+    data = b""
+    fields = []         # (value, bits) after the types, hunk by hunk
+    types = []          # Coded symbols
+    for entry in hunks:
+        kind, arg = entry
+        types.append(kind)
+        if kind == CHD_RLE_SMALL:
+            assert types[-2] in (CHD_SELF_0,), "repeated hunks would need their fields"
+            types.append(arg)
+            continue
+        if kind <= 3:
+            packed = codec_fns[codecs[kind]](arg)
+            fields.append((len(packed), 16))
+            fields.append((0, 16))
+            data += packed
+        elif kind == CHD_NONE:
+            assert len(arg) == hunk_size
+            fields.append((0, 16))
+            data += arg
+        elif kind == CHD_SELF:
+            fields.append((arg, 4))
+    repeated = []
+    for kind, arg in hunks:
+        if kind == CHD_RLE_SMALL:
+            repeated += [repeated[-1]] * (3 + arg)
+        else:
+            repeated.append(kind)
+    assert len(repeated) == (len(disc) + hunk_size - 1) // hunk_size
+
+    huffman, codes = chd_huffman(sorted(set(types)))
+    bits = huffman
+    for symbol in types:
+        bits.write(*codes[symbol])
+    for value, count in fields:
+        bits.write(value, count)
+    map_data = bits.bytes()
+
+    first_offset = CHD_HEADER_SIZE
+    map_offset = first_offset + len(data)
+    map_header = struct.pack(">IIH", len(map_data), first_offset >> 16, first_offset & 0xFFFF)
+    map_header += struct.pack(">HBBBB", 0, 16, 4, 0, 0)
+    metadata_offset = map_offset + len(map_header) + len(map_data)
+
+    chain = b""
+    for i, (tag, text) in enumerate(metadata):
+        next_offset = metadata_offset + len(chain) + 16 + len(text) if i + 1 < len(metadata) else 0
+        chain += tag + struct.pack(">IQ", len(text), next_offset) + text
+
+    header = b"MComprHD" + struct.pack(">II", CHD_HEADER_SIZE, 5)
+    header += b"".join(codec.ljust(4, b"\0") if codec else b"\0" * 4 for codec in (codecs + [None] * 4)[:4])
+    header += struct.pack(">QQQII", len(disc), map_offset, metadata_offset, hunk_size, unit_size)
+    header = header.ljust(CHD_HEADER_SIZE, b"\0")
+    return header + data + map_header + map_data + chain
+
+
+def chd_uncompressed(disc, hunk_size, metadata_tag):
+    """codecs[0] = 0: a u32 per hunk giving its offset in hunks, 0 = zeros"""
+    count = (len(disc) + hunk_size - 1) // hunk_size
+    map_offset = CHD_HEADER_SIZE
+    data_hunk = (map_offset + count * 4 + hunk_size - 1) // hunk_size
+    index, stored = b"", b""
+    for i in range(count):
+        hunk = bytes(disc[i * hunk_size:(i + 1) * hunk_size]).ljust(hunk_size, b"\0")
+        if hunk.count(0) == hunk_size:
+            index += struct.pack(">I", 0)
+        else:
+            index += struct.pack(">I", data_hunk + len(stored) // hunk_size)
+            stored += hunk
+    metadata_offset = (data_hunk * hunk_size) + len(stored)
+    header = b"MComprHD" + struct.pack(">II", CHD_HEADER_SIZE, 5) + b"\0" * 16
+    header += struct.pack(">QQQII", len(disc), map_offset, metadata_offset, hunk_size, 2048)
+    header = header.ljust(CHD_HEADER_SIZE, b"\0")
+    body = header + index
+    body += b"\0" * (data_hunk * hunk_size - len(body))
+    return body + stored + metadata_tag + struct.pack(">IQ", 0, 0)
+
+
+CD_SYNC = b"\x00" + b"\xFF" * 10 + b"\x00"
+CD_FRAME = 2352 + 96
+
+
+def cd_hunk(sectors, codec):
+    """cdzl/cdlz: sync-dropped bitmap, base length, sector data, subcode.
+    The sync of every sector is dropped here and regenerated on read."""
+    frames = len(sectors) // 2352
+    bitmap = bytearray((frames + 7) // 8)
+    data = bytearray(sectors)
+    for f in range(frames):
+        if data[f * 2352:f * 2352 + 12] == CD_SYNC:
+            bitmap[f // 8] |= 1 << (f % 8)
+            data[f * 2352:f * 2352 + 12] = b"\0" * 12
+    base = codec(bytes(data))
+    return bytes(bitmap) + struct.pack(">H", len(base)) + base + deflate(b"\0" * 96 * frames)
+
+
+def raw_cd_sector(lba, user_data):
+    """Mode 2 form 1: sync, BCD address, mode, subheader, 2048 bytes"""
+    bcd = lambda v: (v // 10) << 4 | v % 10
+    frame = lba + 150
+    address = bytes([bcd(frame // 4500), bcd(frame // 75 % 60), bcd(frame % 75)])
+    sector = CD_SYNC + address + b"\x02" + b"\0\0\x08\0" * 2 + user_data.ljust(2048, b"\0")
+    return sector.ljust(2352, b"\0")
+
+
+def chd_cd(sectors_per_hunk, tracks_frames, sectors):
+    """A CD CHD whose hunks alternate between cdzl and cdlz"""
+    hunk_size = sectors_per_hunk * CD_FRAME
+    data, lengths = b"", []
+    for i in range(0, len(sectors), sectors_per_hunk):
+        hunk = b"".join(sectors[i:i + sectors_per_hunk])
+        hunk = hunk.ljust(sectors_per_hunk * 2352, b"\0")
+        packed = cd_hunk(hunk, deflate if (i // sectors_per_hunk) % 2 == 0 else lzma_raw)
+        lengths.append(len(packed))
+        data += packed
+    count = len(lengths)
+    huffman, codes = chd_huffman([0, 1])
+    bits = huffman
+    for i in range(count):
+        bits.write(*codes[i % 2])
+    for length in lengths:
+        bits.write(length, 16)
+        bits.write(0, 16)
+    map_data = bits.bytes()
+    map_offset = CHD_HEADER_SIZE + len(data)
+    map_header = struct.pack(">IIHHBBBB", len(map_data), 0, CHD_HEADER_SIZE, 0, 16, 0, 0, 0)
+    metadata_offset = map_offset + len(map_header) + len(map_data)
+    text = b"TRACK:1 TYPE:MODE2_RAW SUBTYPE:NONE FRAMES:%d PREGAP:0 PGTYPE:MODE2_RAW PGSUB:RW POSTGAP:0\0" % tracks_frames
+    header = b"MComprHD" + struct.pack(">II", CHD_HEADER_SIZE, 5) + b"cdzlcdlz" + b"\0" * 8
+    header += struct.pack(">QQQII", count * hunk_size, map_offset, metadata_offset, hunk_size, CD_FRAME)
+    header = header.ljust(CHD_HEADER_SIZE, b"\0")
+    return header + data + map_header + map_data + b"CHT2" + struct.pack(">IQ", len(text), 0) + text
+
+
+# ============================================================================
+# Archives
+# ============================================================================
+
+def nes_rom():
+    return b"NES\x1A\x02\x01\x01\x00" + b"\0" * 8 + noise(0x8000, 2)
+
+
+def genesis_rom():
+    rom = bytearray(noise(0x1000, 3))
+    rom[0x100:0x110] = b"SEGA GENESIS    "
+    title = b"SONIC THE HEDGEHOG"
+    rom[0x120:0x150] = title.ljust(48, b" ")
+    return bytes(rom)
+
+
+def zip_archive():
+    """zipfile's own layout: one member per method and two that are skipped"""
+    members = [
+        ("GameCube/Melee.iso", bytes(gamecube_disc(0x4000)), zipfile.ZIP_DEFLATED),
+        ("NES/Zelda.nes", nes_rom(), zipfile.ZIP_STORED),
+        ("PSP/Umd.iso", bytes(playstation_disc(0x10800, b"PSP GAME", b"TEST_UMD", 33)), zipfile.ZIP_LZMA),
+        ("docs/", b"", zipfile.ZIP_STORED),
+        ("docs/readme.txt", b"not a game\n" * 20, zipfile.ZIP_DEFLATED),
+    ]
+    buffer = io.BytesIO()
+    with zipfile.ZipFile(buffer, "w") as z:
+        for name, data, method in members:
+            info = zipfile.ZipInfo(name, date_time=(2026, 1, 1, 0, 0, 0))
+            info.compress_type = method
+            z.writestr(info, data)
+    return buffer.getvalue()
+
+
+def zip64_archive():
+    """Every size and offset saturated in the central directory and given in
+    the ZIP64 extra field, and a ZIP64 end record"""
+    disc = bytes(gamecube_disc(0x4000))
+    packed = deflate(disc)
+    name = b"GameCube/Melee.iso"
+    crc = zlib.crc32(disc)
+    local = struct.pack("<IHHHHHIIIHH", 0x04034B50, 45, 0, 8, 0, 0, crc, len(packed), len(disc), len(name), 0)
+    local += name + packed
+    extra = struct.pack("<HHQQQ", 0x0001, 24, len(disc), len(packed), 0)
+    central = struct.pack("<IHHHHHHIIIHHHHHII", 0x02014B50, 45, 45, 0, 8, 0, 0, crc, 0xFFFFFFFF, 0xFFFFFFFF,
+                          len(name), len(extra), 0, 0, 0, 0, 0xFFFFFFFF)
+    central += name + extra
+    directory_offset = len(local)
+    end64_offset = directory_offset + len(central)
+    end64 = struct.pack("<IQHHIIQQQQ", 0x06064B50, 44, 45, 45, 0, 0, 1, 1, len(central), directory_offset)
+    locator = struct.pack("<IIQI", 0x07064B50, 0, end64_offset, 1)
+    end = struct.pack("<IHHHHIIH", 0x06054B50, 0, 0, 0xFFFF, 0xFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0)
+    return local + central + end64 + locator + end
+
+
+def sz_number(value):
+    """7z's variable-length number: leading 1-bits count the extra bytes"""
+    for n in range(9):
+        if n == 8 or value < (1 << (7 * (n + 1))):
+            break
+    if n == 0:
+        return bytes([value])
+    high = value >> (8 * n) if n < 8 else 0
+    first = (0xFF << (8 - n)) & 0xFF | high
+    return bytes([first]) + (value & ((1 << (8 * n)) - 1)).to_bytes(n, "little")
+
+
+def sz_names(names):
+    data = b"\0" + b"".join(name.encode("utf-16-le") + b"\0\0" for name in names)
+    return b"\x11" + sz_number(len(data)) + data
+
+
+def sz_bits(flags):
+    out = bytearray((len(flags) + 7) // 8)
+    for i, flag in enumerate(flags):
+        if flag:
+            out[i // 8] |= 0x80 >> (i % 8)
+    return bytes(out)
+
+
+def sz_streams(pack_position, folders):
+    """folders: (coder id, properties, packed size, unpack size, [file sizes])"""
+    info = b"\x06" + sz_number(pack_position) + sz_number(len(folders)) + b"\x09"
+    info += b"".join(sz_number(f[2]) for f in folders) + b"\x00"
+    info += b"\x07\x0B" + sz_number(len(folders)) + b"\x00"
+    for coder, properties, _, _, _ in folders:
+        flags = len(coder) | (0x20 if properties else 0)
+        info += b"\x01" + bytes([flags]) + coder
+        if properties:
+            info += sz_number(len(properties)) + properties
+    info += b"\x0C" + b"".join(sz_number(f[3]) for f in folders) + b"\x00"
+    if any(len(f[4]) != 1 for f in folders):
+        info += b"\x08\x0D" + b"".join(sz_number(len(f[4])) for f in folders) + b"\x09"
+        info += b"".join(sz_number(size) for f in folders for size in f[4][:-1]) + b"\x00"
+    return info + b"\x00"
+
+
+def seven_zip(encode_header):
+    """A solid LZMA2 folder of two games, a stored folder of one, and an
+    empty directory. The header is itself LZMA-compressed when encode_header
+    is set, as 7-Zip writes it."""
+    melee = bytes(gamecube_disc(0x4000))
+    zelda = nes_rom()
+    sonic = genesis_rom()
+    solid = lzma2_raw(melee + zelda)
+    packed = solid + sonic
+    folders = [
+        (b"\x21", bytes([16]), len(solid), len(melee) + len(zelda), [len(melee), len(zelda)]),
+        (b"\x00", b"", len(sonic), len(sonic), [len(sonic)]),
+    ]
+    names = ["GameCube/Melee.iso", "NES/Zelda.nes", "Genesis/Sonic.md", "docs"]
+    files = b"\x05" + sz_number(len(names))
+    files += b"\x0E" + sz_number(1) + sz_bits([False, False, False, True])
+    files += sz_names(names) + b"\x00"
+    header = b"\x01\x04" + sz_streams(0, folders) + files + b"\x00"
+
+    if encode_header:
+        encoded = lzma_raw(header)
+        header_folder = [(b"\x03\x01\x01", lzma_props(), len(encoded), len(header), [len(header)])]
+        header = b"\x17" + sz_streams(len(packed), header_folder)
+        packed += encoded
+
+    start = struct.pack("<QQI", len(packed), len(header), zlib.crc32(header))
+    return b"7z\xBC\xAF\x27\x1C\x00\x04" + struct.pack("<I", zlib.crc32(start)) + start + packed + header
+
+
+# ============================================================================
+
+def main():
+    os.makedirs(DATA, exist_ok=True)
+
+    # Decoders
+    data = payload()
+    write("payload.bin", data)
+    write("payload.deflate_stored", deflate(data, level=0))
+    write("payload.deflate_fixed", deflate(data, strategy=zlib.Z_FIXED))
+    write("payload.deflate", deflate(data))
+    write("payload.lzma", lzma.compress(data, format=lzma.FORMAT_ALONE))
+    write("payload.lzma2", lzma2_raw(data))
+    write("payload.lz4", lz4_block(data))
+    write("noise.bin", noise(4096, 4))
+    write("noise.lzma2", lzma2_raw(noise(4096, 4)))
+
+    # Containers
+    write("melee.gcz", gcz(gamecube_disc(0x10000), 0x4000, stored_blocks={1}))
+    umd = playstation_disc(0x10800, b"PSP GAME", b"TEST_UMD", 33)
+    write("umd.cso", cso(umd, 0x800, stored_blocks={16}))
+    write("umd.zso", cso(umd, 0x800, zso=True, stored_blocks={3}))
+    write("wiiu.wux", wux(wiiu_disc(0x4000), 0x1000))
+
+    ps2 = playstation_disc(0x12000, b"PLAYSTATION", b"TEST_PS2", 1 << 20)
+    zeros = bytes(0x2000)
+    write("ps2.chd", chd(ps2, 0x2000, 2048, [b"zlib", b"lzma"], [
+        (0, zeros),                 # 0
+        (1, zeros),                 # 1
+        (CHD_NONE, zeros),          # 2
+        (CHD_SELF, 1),              # 3
+        (0, bytes(ps2[0x8000:0xA000])),
+        (CHD_SELF_0, None),         # 5
+        (CHD_RLE_SMALL, 0),         # 6-8
+    ], [(b"DVD ", b"")]))
+    write("melee.chd", chd_uncompressed(gamecube_disc(0x8000), 0x1000, b"DVD "))
+
+    sectors = [raw_cd_sector(lba, b"") for lba in range(32)]
+    sectors[16] = raw_cd_sector(16, bytes(playstation_disc(0x8800, b"PLAYSTATION", b"TEST_PS1", 1000)[0x8000:]))
+    write("ps1.chd", chd_cd(8, 32, sectors))
+
+    # Archives
+    write("games.zip", zip_archive())
+    write("melee64.zip", zip64_archive())
+    write("games.7z", seven_zip(False))
+    write("games_encoded.7z", seven_zip(True))
+
+
+if __name__ == "__main__":
+    main()
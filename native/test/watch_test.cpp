@@ -0,0 +1,119 @@
+// LibraryWatcher on a scratch root: Wii U title folders created in place,
+// renamed in and deleted are reported as one title keyed by the folder,
+// never as the files inside them.
+
+#include "forge_watch.h"
+#include "forge_test.h"
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+static constexpr int EVENT_TIMEOUT_MS = 10000;
+static constexpr unsigned POLL_INTERVAL_MS = 200;
+
+// Titles as the watcher's events say they are now
+class Listener {
+public:
+    void OnChange(LibraryScanner::Change change, const std::string& path, const GameIdentity* identity) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (change == LibraryScanner::Change::Removed) {
+            titles.erase(path);
+            removed.push_back(path);
+        } else if (identity) {
+            titles[path] = *identity;
+        }
+        paths.push_back(path);
+        changed.notify_all();
+    }
+
+    bool WaitFor(const std::function<bool()>& done) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::milliseconds(EVENT_TIMEOUT_MS), done);
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<std::string, GameIdentity> titles;
+    std::vector<std::string> removed;
+    std::vector<std::string> paths;     // Every path an event named
+};
+
+static void WriteBytes(const fs::path& path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char*)data.data(), (std::streamsize)data.size());
+}
+
+// meta.xml first, then content/: content/ holds an NES ROM that would be a
+// title of its own if the folder were not one
+static uint64_t WriteTitle(const fs::path& dir, const char* product_code, const char* name) {
+    fs::create_directories(dir / "code");
+    fs::create_directories(dir / "meta");
+    fs::create_directories(dir / "content" / "sub");
+    std::string meta = std::string("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<menu type=\"complex\">\n") +
+                       "  <product_code type=\"string\">" + product_code + "</product_code>\n" +
+                       "  <company_code type=\"string\">0001</company_code>\n" +
+                       "  <longname_en type=\"string\">" + name + "</longname_en>\n</menu>\n";
+    WriteBytes(dir / "meta" / "meta.xml", std::vector<uint8_t>(meta.begin(), meta.end()));
+    WriteBytes(dir / "code" / "app.rpx", std::vector<uint8_t>(0x100, 0x7F));
+    std::vector<uint8_t> rom = { 'N', 'E', 'S', 0x1A, 0x02, 0x01, 0x01, 0x00 };
+    rom.resize(0x8010, 0x5A);
+    WriteBytes(dir / "content" / "sub" / "game.nes", rom);
+    WriteBytes(dir / "content" / "data.bin", std::vector<uint8_t>(0x1000, 0x11));
+    return rom.size() + 0x1000;
+}
+
+static bool IsTitle(const GameIdentity& identity, const char* title_id, uint64_t size) {
+    return identity.platform == PLATFORM_WII_U && strcmp(identity.title_id, title_id) == 0 && identity.file_size == size;
+}
+
+TEST(TitleFolders) {
+    fs::path root = forge_test::ScratchDir() / "library";
+    fs::path staging = forge_test::ScratchDir() / "staging";
+    fs::create_directories(root);
+    fs::create_directories(staging);
+
+    Listener listener;
+    LibraryWatcher watcher;
+    CHECK(watcher.Start({ root.string() },
+                        [&](LibraryScanner::Change change, const std::string& path, const GameIdentity* identity) {
+                            listener.OnChange(change, path, identity);
+                        },
+                        POLL_INTERVAL_MS));
+    // Created in place
+    std::string created = (root / "Created").string();
+    uint64_t created_size = WriteTitle(created, "WUP-P-ARPE", "Created Title");
+    CHECK(listener.WaitFor([&] {
+        auto it = listener.titles.find(created);
+        return it != listener.titles.end() && IsTitle(it->second, "ARPE01", created_size);
+    }));
+    printf("watching in %s mode\n", LibraryWatcher::ModeName(watcher.ActiveMode()));
+
+    // Renamed in from outside the root
+    std::string moved = (root / "Moved").string();
+    uint64_t moved_size = WriteTitle(staging / "Moved", "WUP-P-AMKP", "Moved Title");
+    fs::rename(staging / "Moved", moved);
+    CHECK(listener.WaitFor([&] {
+        auto it = listener.titles.find(moved);
+        return it != listener.titles.end() && IsTitle(it->second, "AMKP01", moved_size);
+    }));
+
+    // Deleted
+    fs::remove_all(created);
+    CHECK(listener.WaitFor([&] {
+        return !listener.titles.count(created) &&
+               std::find(listener.removed.begin(), listener.removed.end(), created) != listener.removed.end();
+    }));
+
+    watcher.Stop();
+    std::lock_guard<std::mutex> lock(listener.mutex);
+    CHECK(listener.titles.size() == 1 && listener.titles.count(moved));
+    for (const std::string& path : listener.paths) {
+        CHECK_CASE(path == created || path == moved, "event for %s", path.c_str());
+    }
+}
+
+TEST_MAIN()